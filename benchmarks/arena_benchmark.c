@@ -0,0 +1,83 @@
+#include "utilities/arena.h"
+#include "utilities/benchmark_helpers.h"
+#include "utilities/string.h"
+#include <stdio.h>
+
+/*
+ * A request handler's string work: copy the request path, split it on '/',
+ * join the parts back with '.' and replace the dots. Every string and array
+ * either comes from libc and is freed one at a time, or comes from an arena
+ * that is reset once per request.
+ */
+static char const *paths[] = {
+    "api/v1/users/12345/orders/678/items/",
+    "static/css/site/theme/dark/main.css/",
+    "api/v2/search/products/shoes/running/page/3/",
+    "images/thumbnails/2024/05/17/holiday/beach/",
+};
+#define PATH_COUNT (sizeof(paths) / sizeof(char *))
+
+static uint32_t handle_request(char const *path,
+                               fennec_allocator const *allocator) {
+  string slash = string_wrap_cstring("/");
+  string dot = string_wrap_cstring(".");
+  string colon = string_wrap_cstring("::");
+
+  string line = string_new_with_allocator(path, allocator);
+  dynamic_array parts = string_split(&line, &slash);
+  string joined = string_join_with_allocator((string *)parts.data, &dot,
+                                             parts.size, allocator);
+  string replaced = string_replace(&joined, &dot, &colon);
+  uint32_t length = replaced.length;
+  benchmark_consume(replaced.data);
+
+  if (allocator == NULL) {
+    for (uint32_t i = 0; i < parts.size; ++i) {
+      string_free((string *)dynamic_array_get_at(&parts, i));
+    }
+    dynamic_array_free(&parts);
+    string_free(&line);
+    string_free(&joined);
+    string_free(&replaced);
+  }
+
+  return length;
+}
+
+int main(int argc, char **argv) {
+  unsigned requests = argc > 1 ? (unsigned)atoi(argv[1]) : 1000000;
+  uint64_t total = 0;
+
+  double start = benchmark_now();
+  for (unsigned i = 0; i < requests; ++i) {
+    total += handle_request(paths[i % PATH_COUNT], NULL);
+  }
+  BENCHMARK_REPORT("split + join, malloc/free", requests,
+                   benchmark_now() - start);
+
+  arena a = arena_new(0);
+  fennec_allocator allocator = arena_allocator(&a);
+  uint64_t arena_total = 0;
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < requests; ++i) {
+    arena_total += handle_request(paths[i % PATH_COUNT], &allocator);
+    arena_reset(&a);
+  }
+  BENCHMARK_REPORT("split + join, arena reset per request", requests,
+                   benchmark_now() - start);
+
+  arena_statistics stats;
+  arena_stats(&a, &stats);
+  printf("    %llu arena allocations, %llu chunks from malloc\n",
+         (unsigned long long)stats.allocations,
+         (unsigned long long)stats.chunk_allocations);
+  if (total != arena_total) {
+    printf("    results differ: %llu vs %llu\n", (unsigned long long)total,
+           (unsigned long long)arena_total);
+  }
+
+  arena_free(&a);
+
+  return 0;
+}
@@ -0,0 +1,174 @@
+#include "data_structures/concurrent_hashtable.h"
+#include "data_structures/hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define KEY_COUNT (1u << 20)
+#define OPERATIONS_PER_THREAD (1u << 21)
+#define MAX_THREADS 64
+
+/*
+ * 90% lookups and 10% inserts over a prefilled key range, run with 1..N
+ * threads against the concurrent table and against a plain hashtable behind
+ * one global mutex.
+ */
+typedef struct {
+  concurrent_hashtable *concurrent;
+  hashtable *locked;
+  pthread_mutex_t *lock;
+  uint32_t seed;
+} worker_context;
+
+static uint32_t unsigned_hash(void const *key) {
+  uint32_t hash = *(unsigned const *)key;
+  hash ^= hash >> 16;
+  hash *= 0x7feb352d;
+  hash ^= hash >> 15;
+  hash *= 0x846ca68b;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+static bool unsigned_comparison(void const *key1, void const *key2) {
+  return *(unsigned const *)key1 == *(unsigned const *)key2;
+}
+
+static void *unsigned_copy(void const *key) {
+  unsigned *copy = malloc(sizeof(unsigned));
+  *copy = *(unsigned const *)key;
+  return copy;
+}
+
+static uint32_t next_random(uint32_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+static void *concurrent_worker(void *data) {
+  worker_context *context = (worker_context *)data;
+
+  for (unsigned i = 0; i < OPERATIONS_PER_THREAD; ++i) {
+    uint32_t random = next_random(&context->seed);
+    unsigned key = random % KEY_COUNT;
+    unsigned value;
+
+    if (random % 10 == 0) {
+      concurrent_hashtable_insert(context->concurrent, &key, &key);
+    } else {
+      concurrent_hashtable_lookup(context->concurrent, &key, &value);
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * Inserting an existing key into a hashtable adds a duplicate, so the locked
+ * baseline overwrites the value in place instead.
+ */
+static void *locked_worker(void *data) {
+  worker_context *context = (worker_context *)data;
+
+  for (unsigned i = 0; i < OPERATIONS_PER_THREAD; ++i) {
+    uint32_t random = next_random(&context->seed);
+    unsigned key = random % KEY_COUNT;
+
+    pthread_mutex_lock(context->lock);
+    unsigned *value = hashtable_lookup(context->locked, &key);
+    if (random % 10 == 0 && value != NULL) {
+      *value = key;
+    }
+    benchmark_consume(value);
+    pthread_mutex_unlock(context->lock);
+  }
+
+  return NULL;
+}
+
+static double run_threads(unsigned thread_count, void *(*worker)(void *),
+                          worker_context const *base) {
+  pthread_t threads[MAX_THREADS];
+  worker_context contexts[MAX_THREADS];
+
+  double start = benchmark_now();
+  for (unsigned i = 0; i < thread_count; ++i) {
+    contexts[i] = *base;
+    contexts[i].seed = 2463534242u + i * 7919u;
+    pthread_create(&threads[i], NULL, worker, &contexts[i]);
+  }
+  for (unsigned i = 0; i < thread_count; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+
+  return benchmark_now() - start;
+}
+
+/*
+ * Doubles the thread count, ending on max_threads even when it isn't a power
+ * of two.
+ */
+static unsigned next_thread_count(unsigned threads, unsigned max_threads) {
+  if (threads < max_threads && threads << 1 > max_threads) {
+    return max_threads;
+  }
+  return threads << 1;
+}
+
+int main(int argc, char **argv) {
+  unsigned max_threads = argc > 1 ? (unsigned)atoi(argv[1])
+                                  : (unsigned)sysconf(_SC_NPROCESSORS_ONLN);
+  if (max_threads == 0) {
+    max_threads = 1;
+  }
+  if (max_threads > MAX_THREADS) {
+    max_threads = MAX_THREADS;
+  }
+
+  concurrent_hashtable concurrent = concurrent_hashtable_new(
+      sizeof(unsigned), unsigned_hash, unsigned_comparison, unsigned_copy);
+  hashtable locked = hashtable_new(sizeof(unsigned), unsigned_hash,
+                                   unsigned_comparison, unsigned_copy);
+  pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+  for (unsigned key = 0; key < KEY_COUNT; ++key) {
+    concurrent_hashtable_insert(&concurrent, &key, &key);
+    hashtable_insert(&locked, &key, &key);
+  }
+
+  worker_context base = {&concurrent, &locked, &lock, 0};
+  double concurrent_single = 0;
+  double locked_single = 0;
+
+  for (unsigned threads = 1; threads <= max_threads;
+       threads = next_thread_count(threads, max_threads)) {
+    double operations = (double)OPERATIONS_PER_THREAD * threads;
+    char name[64];
+
+    double elapsed = run_threads(threads, concurrent_worker, &base);
+    double throughput = operations / elapsed;
+    if (threads == 1) {
+      concurrent_single = throughput;
+    }
+    sprintf(name, "concurrent_hashtable %u threads", threads);
+    BENCHMARK_REPORT(name, operations, elapsed);
+    printf("    scaling %.2fx\n", throughput / concurrent_single);
+
+    elapsed = run_threads(threads, locked_worker, &base);
+    throughput = operations / elapsed;
+    if (threads == 1) {
+      locked_single = throughput;
+    }
+    sprintf(name, "hashtable + global mutex %u threads", threads);
+    BENCHMARK_REPORT(name, operations, elapsed);
+    printf("    scaling %.2fx\n", throughput / locked_single);
+  }
+
+  concurrent_hashtable_free(&concurrent);
+  hashtable_free(&locked);
+
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include "data_structures/deque.h"
+#include "data_structures/dynamic_array.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+/*
+ * A work queue of count (1M by default) tasks: fill it, then take a task off
+ * the front and queue a new one at the back over and over. With a
+ * dynamic_array every dequeue moves the whole queue down (so it only runs a
+ * few thousand rounds), a deque just moves its head. Then draining the queue
+ * in batches of 64 with deque_pop_front_n.
+ */
+int main(int argc, char **argv) {
+  unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 1000000;
+  unsigned array_rounds = 2000;
+  uint64_t checksum = 0;
+
+  dynamic_array a = dynamic_array_new(sizeof(uint32_t));
+  for (uint32_t i = 0; i < count; ++i) {
+    dynamic_array_push_back(&a, &i);
+  }
+  double start = benchmark_now();
+  for (uint32_t i = 0; i < array_rounds; ++i) {
+    checksum += *(uint32_t *)dynamic_array_get_front(&a);
+    dynamic_array_remove(&a, 0);
+    uint32_t task = count + i;
+    dynamic_array_push_back(&a, &task);
+  }
+  BENCHMARK_REPORT("dynamic_array remove front + push back", array_rounds,
+                   benchmark_now() - start);
+  dynamic_array_free(&a);
+
+  deque d = deque_new(sizeof(uint32_t));
+  for (uint32_t i = 0; i < count; ++i) {
+    deque_push_back(&d, &i);
+  }
+  start = benchmark_now();
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t task;
+    deque_pop_front(&d, &task);
+    checksum += task;
+    task = count + i;
+    deque_push_back(&d, &task);
+  }
+  BENCHMARK_REPORT("deque pop front + push back", count,
+                   benchmark_now() - start);
+
+  uint32_t batch[64];
+  start = benchmark_now();
+  for (uint32_t popped = deque_pop_front_n(&d, batch, 64); popped > 0;
+       popped = deque_pop_front_n(&d, batch, 64)) {
+    for (uint32_t i = 0; i < popped; ++i) {
+      checksum += batch[i];
+    }
+  }
+  BENCHMARK_REPORT("deque pop_front_n, batches of 64", count,
+                   benchmark_now() - start);
+  benchmark_consume(&checksum);
+
+  deque_free(&d);
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+#include "data_structures/dynamic_array.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+/*
+ * Loading an array from a buffer (as if it was read from a file): one
+ * dynamic_array_push_back per element against the bulk calls, with a plain
+ * memcpy of the same bytes for reference. Then lots of short arrays (like the
+ * pieces of a split path) on the heap against ones in a stack buffer. Last an
+ * expiry sweep over the first 200k elements that drops every 10th one: one
+ * dynamic_array_remove each, against remove_if, remove_indices and
+ * swap_remove.
+ */
+static bool is_expired(void const *element, void *context) {
+  (void)context;
+  return *(uint32_t const *)element % 10 == 0;
+}
+
+static void report(char const *name, unsigned count, double elapsed) {
+  BENCHMARK_REPORT(name, count, elapsed);
+  printf("    %.0f MB/s\n", count * sizeof(uint32_t) / elapsed / 1e6);
+}
+
+int main(int argc, char **argv) {
+  unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 16000000;
+  uint32_t *source = malloc(sizeof(uint32_t) * count);
+  for (unsigned i = 0; i < count; ++i) {
+    source[i] = i * 2654435761u;
+  }
+
+  uint32_t *copy = malloc(sizeof(uint32_t) * count);
+  double start = benchmark_now();
+  memcpy(copy, source, sizeof(uint32_t) * count);
+  benchmark_consume(copy);
+  report("memcpy", count, benchmark_now() - start);
+  free(copy);
+
+  dynamic_array a = dynamic_array_new(sizeof(uint32_t));
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    dynamic_array_push_back(&a, &source[i]);
+  }
+  report("push_back loop", count, benchmark_now() - start);
+  dynamic_array_free(&a);
+
+  a = dynamic_array_new(sizeof(uint32_t));
+  start = benchmark_now();
+  dynamic_array_push_back_n(&a, source, count);
+  report("push_back_n", count, benchmark_now() - start);
+  dynamic_array_free(&a);
+
+  a = dynamic_array_new(sizeof(uint32_t));
+  start = benchmark_now();
+  uint32_t *space = dynamic_array_emplace_back_uninit(&a, count);
+  for (unsigned i = 0; i < count; ++i) {
+    space[i] = i * 2654435761u;
+  }
+  report("emplace_back_uninit + fill", count, benchmark_now() - start);
+  dynamic_array_free(&a);
+
+  unsigned arrays = count / 8;
+  start = benchmark_now();
+  for (unsigned i = 0; i < arrays; ++i) {
+    dynamic_array short_array = dynamic_array_new(sizeof(uint32_t));
+    for (unsigned j = 0; j < 6; ++j) {
+      dynamic_array_push_back(&short_array, &source[i * 8 + j]);
+    }
+    benchmark_consume(short_array.data);
+    dynamic_array_free(&short_array);
+  }
+  BENCHMARK_REPORT("6 element array, heap", arrays, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < arrays; ++i) {
+    uint32_t buffer[8];
+    dynamic_array short_array =
+        dynamic_array_new_with_buffer(sizeof(uint32_t), buffer, 8);
+    for (unsigned j = 0; j < 6; ++j) {
+      dynamic_array_push_back(&short_array, &source[i * 8 + j]);
+    }
+    benchmark_consume(short_array.data);
+    dynamic_array_free(&short_array);
+  }
+  BENCHMARK_REPORT("6 element array, stack buffer", arrays,
+                   benchmark_now() - start);
+
+  unsigned sweep = count < 200000 ? count : 200000;
+  uint32_t *expired = malloc(sizeof(uint32_t) * (sweep / 10 + 1));
+  uint32_t expired_count = 0;
+  for (uint32_t i = 0; i < sweep; i += 10) {
+    expired[expired_count++] = i;
+  }
+
+  a = dynamic_array_new(sizeof(uint32_t));
+  for (uint32_t i = 0; i < sweep; ++i) {
+    dynamic_array_push_back(&a, &i);
+  }
+  start = benchmark_now();
+  for (uint32_t i = 0; i < a.size;) {
+    if (is_expired(dynamic_array_get_at(&a, i), NULL)) {
+      dynamic_array_remove(&a, i);
+    } else {
+      ++i;
+    }
+  }
+  BENCHMARK_REPORT("sweep, remove one at a time", sweep,
+                   benchmark_now() - start);
+
+  dynamic_array_clear(&a);
+  for (uint32_t i = 0; i < sweep; ++i) {
+    dynamic_array_push_back(&a, &i);
+  }
+  start = benchmark_now();
+  dynamic_array_remove_if(&a, is_expired, NULL);
+  BENCHMARK_REPORT("sweep, remove_if", sweep, benchmark_now() - start);
+
+  dynamic_array_clear(&a);
+  for (uint32_t i = 0; i < sweep; ++i) {
+    dynamic_array_push_back(&a, &i);
+  }
+  start = benchmark_now();
+  dynamic_array_remove_indices(&a, expired, expired_count);
+  BENCHMARK_REPORT("sweep, remove_indices", sweep, benchmark_now() - start);
+
+  dynamic_array_clear(&a);
+  for (uint32_t i = 0; i < sweep; ++i) {
+    dynamic_array_push_back(&a, &i);
+  }
+  start = benchmark_now();
+  for (uint32_t i = expired_count; i-- > 0;) {
+    dynamic_array_swap_remove(&a, expired[i]);
+  }
+  BENCHMARK_REPORT("sweep, swap_remove (unordered)", sweep,
+                   benchmark_now() - start);
+  dynamic_array_free(&a);
+  free(expired);
+
+  free(source);
+
+  return 0;
+}
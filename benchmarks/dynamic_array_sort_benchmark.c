@@ -0,0 +1,95 @@
+#include "data_structures/dynamic_array.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+#include <unistd.h>
+
+/*
+ * Sorting count random 32 bit keys (10M and then 100M by default, or just the
+ * count given): qsort for reference, then dynamic_array_sort, the radix sort
+ * and the parallel sort on 1, 2, 4, ... threads up to the number of online
+ * cores.
+ */
+static int compare_uint32(void const *a, void const *b) {
+  uint32_t x = *(uint32_t const *)a;
+  uint32_t y = *(uint32_t const *)b;
+  return (x > y) - (x < y);
+}
+
+static void fill(dynamic_array *array, uint32_t const *source, unsigned count) {
+  dynamic_array_clear(array);
+  dynamic_array_push_back_n(array, source, count);
+}
+
+static void check(dynamic_array const *array, char const *name) {
+  uint32_t const *data = (uint32_t const *)array->data;
+  for (uint32_t i = 1; i < array->size; ++i) {
+    if (data[i - 1] > data[i]) {
+      printf("    %s is out of order at %u\n", name, i);
+      return;
+    }
+  }
+}
+
+static void run(unsigned count, uint32_t cores) {
+  uint32_t *source = malloc(sizeof(uint32_t) * count);
+  uint64_t state = 88172645463325252ull;
+  for (unsigned i = 0; i < count; ++i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    source[i] = (uint32_t)state;
+  }
+
+  dynamic_array a = dynamic_array_new(sizeof(uint32_t));
+  dynamic_array_reserve(&a, count);
+
+  fill(&a, source, count);
+  double start = benchmark_now();
+  qsort(a.data, a.size, a.object_size, compare_uint32);
+  BENCHMARK_REPORT("qsort", count, benchmark_now() - start);
+
+  fill(&a, source, count);
+  start = benchmark_now();
+  dynamic_array_sort(&a, compare_uint32);
+  BENCHMARK_REPORT("dynamic_array_sort", count, benchmark_now() - start);
+  check(&a, "dynamic_array_sort");
+
+  fill(&a, source, count);
+  start = benchmark_now();
+  dynamic_array_radix_sort(&a, 0, dynamic_array_key_uint32);
+  BENCHMARK_REPORT("dynamic_array_radix_sort", count, benchmark_now() - start);
+  check(&a, "dynamic_array_radix_sort");
+
+  for (uint32_t threads = 1; threads <= cores;
+       threads = threads < cores && threads * 2 > cores ? cores
+                                                        : threads * 2) {
+    char name[64];
+    snprintf(name, sizeof(name), "dynamic_array_parallel_sort, %u threads",
+             threads);
+    fill(&a, source, count);
+    start = benchmark_now();
+    dynamic_array_parallel_sort(&a, compare_uint32, threads);
+    BENCHMARK_REPORT(name, count, benchmark_now() - start);
+    check(&a, name);
+  }
+
+  dynamic_array_free(&a);
+  free(source);
+}
+
+int main(int argc, char **argv) {
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t cores = online > 0 ? (uint32_t)online : 1;
+
+  if (argc > 1) {
+    run((unsigned)atoi(argv[1]), cores);
+    return 0;
+  }
+
+  printf("10M keys:\n");
+  run(10000000, cores);
+  printf("100M keys:\n");
+  run(100000000, cores);
+
+  return 0;
+}
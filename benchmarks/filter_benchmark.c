@@ -0,0 +1,132 @@
+#include "data_structures/filter.h"
+#include "data_structures/hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+/*
+ * Membership tests where most keys are missing: first against the filters
+ * on their own (speed, false positive rate and size), then against large
+ * hashtables with and without hashtable_set_filter.
+ */
+typedef hashtable (*table_constructor)(
+    uint32_t object_size, hash_function_type hash_function,
+    hash_comparison_function_type comparison_function,
+    hash_key_copy_function_type copy_function);
+
+static uint32_t key_hash(void const *key) {
+  uint64_t hash = hash_wyhash(key, sizeof(uint64_t), 0);
+  return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static bool key_comparison(void const *key1, void const *key2) {
+  return *(uint64_t const *)key1 == *(uint64_t const *)key2;
+}
+
+static void *key_copy(void const *key) {
+  uint64_t *copy = malloc(sizeof(uint64_t));
+  *copy = *(uint64_t const *)key;
+  return copy;
+}
+
+/*
+ * Keys below count are inserted; a query is one of them one time in ten and
+ * a missing key otherwise.
+ */
+static uint64_t *make_queries(unsigned count, unsigned query_count) {
+  uint64_t *queries = malloc(sizeof(uint64_t) * query_count);
+  uint64_t state = 88172645463325252ull;
+
+  for (unsigned i = 0; i < query_count; ++i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    queries[i] = state % 10 == 0 ? state % count : count + state % count;
+  }
+
+  return queries;
+}
+
+static void run_filters(unsigned count, uint64_t *queries,
+                        unsigned query_count) {
+  bloom_filter bloom = bloom_filter_new(count, 0.01, key_hash);
+  cuckoo_filter cuckoo = cuckoo_filter_new(count, key_hash);
+
+  for (uint64_t key = 0; key < count; ++key) {
+    bloom_filter_add(&bloom, &key);
+    cuckoo_filter_add(&cuckoo, &key);
+  }
+
+  unsigned hits = 0;
+  double start = benchmark_now();
+  for (unsigned i = 0; i < query_count; ++i) {
+    hits += bloom_filter_contains(&bloom, &queries[i]);
+  }
+  BENCHMARK_REPORT("bloom filter contains", query_count,
+                   benchmark_now() - start);
+  printf("    %.2f%% said maybe, %.1f bits per key\n",
+         100.0 * hits / query_count,
+         bloom.block_count * BLOOM_FILTER_BLOCK_WORDS * 32.0 / count);
+
+  hits = 0;
+  start = benchmark_now();
+  for (unsigned i = 0; i < query_count; ++i) {
+    hits += cuckoo_filter_contains(&cuckoo, &queries[i]);
+  }
+  BENCHMARK_REPORT("cuckoo filter contains", query_count,
+                   benchmark_now() - start);
+  printf("    %.2f%% said maybe, %.1f bits per key\n",
+         100.0 * hits / query_count, cuckoo.bucket_count * 64.0 / count);
+
+  bloom_filter_free(&bloom);
+  cuckoo_filter_free(&cuckoo);
+}
+
+static void run_table(char const *engine, table_constructor constructor,
+                      bool filtered, unsigned count, uint64_t *queries,
+                      unsigned query_count) {
+  hashtable table =
+      constructor(sizeof(unsigned), key_hash, key_comparison, key_copy);
+  hashtable_set_filter(&table, filtered);
+
+  for (uint64_t key = 0; key < count; ++key) {
+    unsigned value = (unsigned)key;
+    hashtable_insert(&table, &key, &value);
+  }
+
+  unsigned found = 0;
+  double start = benchmark_now();
+  for (unsigned i = 0; i < query_count; ++i) {
+    found += hashtable_exists(&table, &queries[i]);
+  }
+  double elapsed = benchmark_now() - start;
+
+  char name[64];
+  sprintf(name, "%s exists, 90%% misses%s", engine,
+          filtered ? ", filtered" : "");
+  BENCHMARK_REPORT(name, query_count, elapsed);
+  benchmark_consume(&found);
+
+  hashtable_free(&table);
+}
+
+int main(int argc, char **argv) {
+  unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 2000000;
+  unsigned query_count = count * 2;
+  uint64_t *queries = make_queries(count, query_count);
+
+  run_filters(count, queries, query_count);
+
+  char const *engines[] = {"coalesced", "flat", "robin hood"};
+  table_constructor constructors[] = {hashtable_new, hashtable_new_flat,
+                                      hashtable_new_robin_hood};
+  for (unsigned e = 0; e < sizeof(engines) / sizeof(char *); ++e) {
+    run_table(engines[e], constructors[e], false, count, queries,
+              query_count);
+    run_table(engines[e], constructors[e], true, count, queries,
+              query_count);
+  }
+
+  free(queries);
+
+  return 0;
+}
@@ -0,0 +1,196 @@
+#include "data_structures/hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include "utilities/hash.h"
+#include <stdio.h>
+
+#define KEY_COUNT (1u << 18)
+#define BUCKET_BITS 16
+#define THROUGHPUT_BYTES (1u << 28)
+
+/*
+ * Compares the old one byte at a time string hash with the byte hashes in
+ * utilities/hash.h: how evenly they spread real looking keys over the low
+ * bits (which is all a power of two table looks at), how many bytes per second
+ * they get through, and what that does to a string hashtable.
+ */
+typedef struct {
+  char const *name;
+  hash_bytes_function_type function;
+} hash_candidate;
+
+typedef struct {
+  char const *name;
+  char const *format;
+} key_set;
+
+static uint64_t legacy_hash(void const *data, uint32_t length, uint64_t seed) {
+  (void)seed;
+  char const *s = (char const *)data;
+  uint32_t hash = 0;
+  for (uint32_t i = 0; i < length; ++i)
+    hash = hash * 101 + s[i];
+  return hash;
+}
+
+static uint32_t legacy_string_hash(void const *string) {
+  return (uint32_t)legacy_hash(string, (uint32_t)strlen((char const *)string),
+                               0);
+}
+
+static bool string_comparison(void const *string1, void const *string2) {
+  return strcmp((char const *)string1, (char const *)string2) == 0;
+}
+
+static void *string_copy(void const *string) {
+  return strdup((char const *)string);
+}
+
+static uint32_t fold(uint64_t hash) { return (uint32_t)(hash ^ (hash >> 32)); }
+
+static char **make_keys(char const *format) {
+  char **keys = malloc(sizeof(char *) * KEY_COUNT);
+
+  for (unsigned i = 0; i < KEY_COUNT; ++i) {
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer), format, i);
+    keys[i] = strdup(buffer);
+  }
+
+  return keys;
+}
+
+static void free_keys(char **keys) {
+  for (unsigned i = 0; i < KEY_COUNT; ++i) {
+    free(keys[i]);
+  }
+
+  free(keys);
+}
+
+/*
+ * Chi-square of the bucket counts divided by its degrees of freedom. A random
+ * function scores close to 1.0, clustering pushes it up.
+ */
+static void distribution(hash_candidate const *candidate, key_set const *set,
+                         char **keys) {
+  uint32_t bucket_count = 1u << BUCKET_BITS;
+  uint32_t *buckets = calloc(bucket_count, sizeof(uint32_t));
+
+  for (unsigned i = 0; i < KEY_COUNT; ++i) {
+    uint32_t length = (uint32_t)strlen(keys[i]);
+    uint32_t hash = fold(candidate->function(keys[i], length, 42));
+    buckets[hash & (bucket_count - 1)] += 1;
+  }
+
+  double expected = (double)KEY_COUNT / bucket_count;
+  double chi_square = 0;
+  uint32_t longest = 0;
+  for (uint32_t i = 0; i < bucket_count; ++i) {
+    double difference = buckets[i] - expected;
+    chi_square += difference * difference / expected;
+    longest = buckets[i] > longest ? buckets[i] : longest;
+  }
+
+  printf("%-10s %-8s chi^2/df %10.2f   fullest bucket %6u (expected %.0f)\n",
+         candidate->name, set->name, chi_square / (bucket_count - 1), longest,
+         expected);
+
+  free(buckets);
+}
+
+static void throughput(hash_candidate const *candidate, uint32_t length) {
+  uint8_t *data = malloc(length);
+  for (uint32_t i = 0; i < length; ++i) {
+    data[i] = (uint8_t)(i * 31 + 7);
+  }
+
+  uint32_t iterations = THROUGHPUT_BYTES / length;
+  uint64_t total = 0;
+
+  double start = benchmark_now();
+  for (uint32_t i = 0; i < iterations; ++i) {
+    /* Feed the last hash back in so calls can't overlap or be hoisted. */
+    total += candidate->function(data, length, total);
+  }
+  double elapsed = benchmark_now() - start;
+  benchmark_consume((void const *)(uintptr_t)total);
+
+  char name[64];
+  sprintf(name, "%s %u bytes", candidate->name, length);
+  BENCHMARK_REPORT(name, iterations, elapsed);
+  printf("    %.2f GB/s\n", (double)length * iterations / elapsed / 1e9);
+
+  free(data);
+}
+
+static void table(hash_candidate const *candidate, char **keys, bool report) {
+  hashtable h;
+  if (candidate->function == legacy_hash) {
+    h = hashtable_new(sizeof(unsigned), legacy_string_hash, string_comparison,
+                      string_copy);
+  } else {
+    h = hashtable_new_string(sizeof(unsigned));
+    hashtable_set_string_hash(&h, candidate->function, 42);
+  }
+
+  double start = benchmark_now();
+  for (unsigned i = 0; i < KEY_COUNT; ++i) {
+    hashtable_insert(&h, keys[i], &i);
+  }
+  double insert_elapsed = benchmark_now() - start;
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < KEY_COUNT; ++i) {
+    benchmark_consume(hashtable_lookup(&h, keys[i]));
+  }
+  double lookup_elapsed = benchmark_now() - start;
+
+  if (report) {
+    char name[64];
+    sprintf(name, "%s table insert", candidate->name);
+    BENCHMARK_REPORT(name, KEY_COUNT, insert_elapsed);
+    sprintf(name, "%s table lookup", candidate->name);
+    BENCHMARK_REPORT(name, KEY_COUNT, lookup_elapsed);
+  }
+
+  hashtable_free(&h);
+}
+
+int main(void) {
+  hash_candidate candidates[] = {{"legacy", legacy_hash},
+                                 {"wyhash", hash_wyhash},
+                                 {"crc32c", hash_crc32c}};
+  key_set sets[] = {{"numbers", "%u"},
+                    {"words", "test string %u"},
+                    {"paths", "/usr/share/doc/package-%u/README.md"},
+                    {"long", "%u/the quick brown fox jumps over the lazy dog "
+                             "while the five boxing wizards jump quickly and "
+                             "pack my box with five dozen liquor jugs"}};
+  uint32_t candidate_count = sizeof(candidates) / sizeof(hash_candidate);
+  uint32_t set_count = sizeof(sets) / sizeof(key_set);
+  uint32_t lengths[] = {8, 16, 32, 64, 256, 4096};
+
+  for (uint32_t s = 0; s < set_count; ++s) {
+    char **keys = make_keys(sets[s].format);
+    for (uint32_t c = 0; c < candidate_count; ++c) {
+      distribution(&candidates[c], &sets[s], keys);
+    }
+    free_keys(keys);
+  }
+
+  for (uint32_t c = 0; c < candidate_count; ++c) {
+    for (uint32_t l = 0; l < sizeof(lengths) / sizeof(uint32_t); ++l) {
+      throughput(&candidates[c], lengths[l]);
+    }
+  }
+
+  /* The first table to grow pays for faulting in the heap, so warm it up. */
+  char **keys = make_keys(sets[2].format);
+  table(&candidates[0], keys, false);
+  for (uint32_t c = 0; c < candidate_count; ++c) {
+    table(&candidates[c], keys, true);
+  }
+  free_keys(keys);
+
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include "data_structures/hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+/*
+ * Word count: a stream of words, most of them repeats, is counted into a
+ * string table. Compares a lookup followed by an insert for new words with
+ * hashtable_find_or_insert, with and without reserving room for the number of
+ * distinct words up front.
+ */
+typedef hashtable (*table_constructor)(uint32_t object_size);
+
+static char **make_words(unsigned distinct) {
+  char **words = malloc(sizeof(char *) * distinct);
+
+  for (unsigned i = 0; i < distinct; ++i) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "word%u", i);
+    words[i] = strdup(buffer);
+  }
+
+  return words;
+}
+
+/*
+ * Roughly Zipf shaped: small word numbers are much more common.
+ */
+static unsigned *make_stream(unsigned length, unsigned distinct) {
+  unsigned *stream = malloc(sizeof(unsigned) * length);
+  uint32_t state = 2463534242u;
+
+  for (unsigned i = 0; i < length; ++i) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    double uniform = (state >> 8) / (double)(1u << 24);
+    stream[i] = (unsigned)(distinct * uniform * uniform * uniform);
+  }
+
+  return stream;
+}
+
+static void count_words(char const *engine, char const *method,
+                        table_constructor constructor, bool reserve,
+                        char **words, unsigned distinct, unsigned *stream,
+                        unsigned length) {
+  hashtable table = constructor(sizeof(unsigned));
+  unsigned growths = 0;
+
+  double start = benchmark_now();
+  if (reserve) {
+    hashtable_reserve(&table, distinct);
+  }
+
+  uint32_t capacity = table.capacity;
+  for (unsigned i = 0; i < length; ++i) {
+    char const *word = words[stream[i]];
+
+    if (strcmp(method, "find_or_insert") == 0) {
+      bool inserted;
+      *(unsigned *)hashtable_find_or_insert(&table, word, &inserted) += 1;
+    } else {
+      unsigned *count = hashtable_lookup(&table, word);
+      if (count != NULL) {
+        *count += 1;
+      } else {
+        unsigned one = 1;
+        hashtable_insert(&table, word, &one);
+      }
+    }
+
+    if (table.capacity != capacity) {
+      capacity = table.capacity;
+      ++growths;
+    }
+  }
+  double elapsed = benchmark_now() - start;
+
+  char name[64];
+  sprintf(name, "%s %s%s", engine, method, reserve ? " reserved" : "");
+  BENCHMARK_REPORT(name, length, elapsed);
+  printf("    %u distinct words, %u growths\n", table.size, growths);
+
+  hashtable_free(&table);
+}
+
+int main(int argc, char **argv) {
+  unsigned distinct = argc > 1 ? (unsigned)atoi(argv[1]) : 500000;
+  unsigned length = distinct * 10;
+  char **words = make_words(distinct);
+  unsigned *stream = make_stream(length, distinct);
+
+  char const *engines[] = {"coalesced", "flat", "robin hood"};
+  table_constructor constructors[] = {hashtable_new_string,
+                                      hashtable_new_flat_string,
+                                      hashtable_new_robin_hood_string};
+
+  for (unsigned e = 0; e < sizeof(engines) / sizeof(char *); ++e) {
+    count_words(engines[e], "lookup + insert", constructors[e], false, words,
+                distinct, stream, length);
+    count_words(engines[e], "find_or_insert", constructors[e], false, words,
+                distinct, stream, length);
+    count_words(engines[e], "find_or_insert", constructors[e], true, words,
+                distinct, stream, length);
+  }
+
+  for (unsigned i = 0; i < distinct; ++i) {
+    free(words[i]);
+  }
+  free(words);
+  free(stream);
+
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include "data_structures/hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+/*
+ * The default table is several hundred MB, well past the size of any last
+ * level cache, which is where overlapping the misses pays off.
+ */
+#define DEFAULT_COUNT (4u * 1024u * 1024u)
+#define KEYS_PER_CALL 256
+
+typedef hashtable (*table_constructor)(uint32_t object_size,
+                                       hash_function_type hash_function,
+                                       hash_comparison_function_type compare,
+                                       hash_key_copy_function_type copy);
+
+static uint32_t unsigned_hash(void const *key) {
+  uint32_t hash = *(unsigned const *)key;
+  hash ^= hash >> 16;
+  hash *= 0x7feb352d;
+  hash ^= hash >> 15;
+  hash *= 0x846ca68b;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+static bool unsigned_comparison(void const *key1, void const *key2) {
+  return *(unsigned const *)key1 == *(unsigned const *)key2;
+}
+
+static void *unsigned_copy(void const *key) {
+  unsigned *copy = malloc(sizeof(unsigned));
+  *copy = *(unsigned const *)key;
+  return copy;
+}
+
+static void run(char const *engine, table_constructor constructor,
+                unsigned count) {
+  unsigned *keys = malloc(sizeof(unsigned) * count);
+  unsigned *values = malloc(sizeof(unsigned) * count);
+  void const **key_pointers = malloc(sizeof(void *) * count);
+  void *found[KEYS_PER_CALL];
+  char name[64];
+
+  uint32_t state = 88172645u;
+  for (unsigned i = 0; i < count; ++i) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    keys[i] = state;
+    values[i] = i;
+    key_pointers[i] = &keys[i];
+  }
+
+  hashtable single = constructor(sizeof(unsigned), unsigned_hash,
+                                 unsigned_comparison, unsigned_copy);
+  double start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&single, &keys[i], &values[i]);
+  }
+  double elapsed = benchmark_now() - start;
+  sprintf(name, "%s insert", engine);
+  BENCHMARK_REPORT(name, count, elapsed);
+
+  hashtable batched = constructor(sizeof(unsigned), unsigned_hash,
+                                  unsigned_comparison, unsigned_copy);
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; i += KEYS_PER_CALL) {
+    unsigned batch = count - i < KEYS_PER_CALL ? count - i : KEYS_PER_CALL;
+    hashtable_insert_batch(&batched, key_pointers + i, values + i, batch);
+  }
+  elapsed = benchmark_now() - start;
+  sprintf(name, "%s insert_batch (%u per call)", engine, KEYS_PER_CALL);
+  BENCHMARK_REPORT(name, count, elapsed);
+  hashtable_free(&batched);
+
+  /*
+   * Look the keys up in a different order than they were inserted.
+   */
+  for (unsigned i = count - 1; i > 0; --i) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    unsigned j = state % (i + 1);
+    void const *temp = key_pointers[i];
+    key_pointers[i] = key_pointers[j];
+    key_pointers[j] = temp;
+  }
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    benchmark_consume(hashtable_lookup(&single, key_pointers[i]));
+  }
+  elapsed = benchmark_now() - start;
+  sprintf(name, "%s lookup", engine);
+  BENCHMARK_REPORT(name, count, elapsed);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; i += KEYS_PER_CALL) {
+    unsigned batch = count - i < KEYS_PER_CALL ? count - i : KEYS_PER_CALL;
+    hashtable_lookup_batch(&single, key_pointers + i, batch, found);
+    benchmark_consume(found[0]);
+  }
+  elapsed = benchmark_now() - start;
+  sprintf(name, "%s lookup_batch (%u per call)", engine, KEYS_PER_CALL);
+  BENCHMARK_REPORT(name, count, elapsed);
+
+  hashtable_free(&single);
+  free(keys);
+  free(values);
+  free(key_pointers);
+}
+
+int main(int argc, char **argv) {
+  unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : DEFAULT_COUNT;
+
+  run("coalesced", hashtable_new, count);
+  run("flat", hashtable_new_flat, count);
+
+  return 0;
+}
@@ -0,0 +1,142 @@
+#include "data_structures/hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+typedef hashtable (*table_constructor)(uint32_t object_size);
+
+static char **make_keys(unsigned count, char const *prefix) {
+  char **keys = malloc(sizeof(char *) * count);
+
+  for (unsigned i = 0; i < count; ++i) {
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer), "%s key %u", prefix, i);
+    keys[i] = strdup(buffer);
+  }
+
+  return keys;
+}
+
+/*
+ * Lookups are done in a shuffled order so sequential keys don't turn into
+ * sequential memory accesses.
+ */
+static void shuffle_keys(char **keys, unsigned count) {
+  uint32_t state = 2463534242u;
+  for (unsigned i = count - 1; i > 0; --i) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    unsigned j = state % (i + 1);
+    char *temp = keys[i];
+    keys[i] = keys[j];
+    keys[j] = temp;
+  }
+}
+
+static void free_keys(char **keys, unsigned count) {
+  for (unsigned i = 0; i < count; ++i) {
+    free(keys[i]);
+  }
+
+  free(keys);
+}
+
+static void run(char const *engine, table_constructor constructor,
+                float load_factor, unsigned capacity, char **keys,
+                char **missing_keys) {
+  unsigned count = (unsigned)(load_factor * (float)capacity);
+  hashtable table = constructor(sizeof(unsigned));
+  char name[64];
+
+  double start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&table, keys[i], &i);
+  }
+  double elapsed = benchmark_now() - start;
+  sprintf(name, "%s insert @ %.2f (cap %u)", engine,
+          (double)table.size / table.capacity, table.capacity);
+  BENCHMARK_REPORT(name, count, elapsed);
+
+  shuffle_keys(keys, count);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    benchmark_consume(hashtable_lookup(&table, keys[i]));
+  }
+  elapsed = benchmark_now() - start;
+  sprintf(name, "%s lookup hit @ %.2f", engine, load_factor);
+  BENCHMARK_REPORT(name, count, elapsed);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    benchmark_consume(hashtable_lookup(&table, missing_keys[i]));
+  }
+  elapsed = benchmark_now() - start;
+  sprintf(name, "%s lookup miss @ %.2f", engine, load_factor);
+  BENCHMARK_REPORT(name, count, elapsed);
+
+  hashtable_free(&table);
+}
+
+/*
+ * Keys that share a long prefix make every key comparison expensive, which is
+ * what growth (re-hashing) and chain walks pay for.
+ */
+static void run_long_keys(char const *engine, table_constructor constructor,
+                          unsigned count) {
+  char prefix[257];
+  memset(prefix, 'x', sizeof(prefix) - 1);
+  prefix[sizeof(prefix) - 1] = 0;
+
+  char **keys = make_keys(count, prefix);
+  hashtable table = constructor(sizeof(unsigned));
+  char name[64];
+
+  double start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&table, keys[i], &i);
+  }
+  double elapsed = benchmark_now() - start;
+  sprintf(name, "%s long key insert (with growth)", engine);
+  BENCHMARK_REPORT(name, count, elapsed);
+
+  shuffle_keys(keys, count);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    benchmark_consume(hashtable_lookup(&table, keys[i]));
+  }
+  elapsed = benchmark_now() - start;
+  sprintf(name, "%s long key lookup hit", engine);
+  BENCHMARK_REPORT(name, count, elapsed);
+
+  hashtable_free(&table);
+  free_keys(keys, count);
+}
+
+int main(int argc, char **argv) {
+  unsigned capacity_log2 = argc > 1 ? (unsigned)atoi(argv[1]) : 20;
+  unsigned capacity = 1u << capacity_log2;
+  float load_factors[] = {0.5f, 0.6f, 0.7f, 0.8f, 0.85f};
+
+  char **keys = make_keys(capacity, "present");
+  char **missing_keys = make_keys(capacity, "missing");
+
+  for (unsigned i = 0; i < sizeof(load_factors) / sizeof(float); ++i) {
+    run("coalesced", hashtable_new_string, load_factors[i], capacity, keys,
+        missing_keys);
+    run("flat", hashtable_new_flat_string, load_factors[i], capacity, keys,
+        missing_keys);
+    run("robin hood", hashtable_new_robin_hood_string, load_factors[i],
+        capacity, keys, missing_keys);
+  }
+
+  free_keys(keys, capacity);
+  free_keys(missing_keys, capacity);
+
+  run_long_keys("coalesced", hashtable_new_string, capacity / 2);
+  run_long_keys("flat", hashtable_new_flat_string, capacity / 2);
+  run_long_keys("robin hood", hashtable_new_robin_hood_string, capacity / 2);
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+#include "data_structures/hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+/*
+ * A FIFO cache in front of a larger key space: every request looks its key
+ * up, and a miss inserts the key and evicts the oldest one. Roughly one
+ * remove per insert keeps the table at a constant size while its contents
+ * turn over many times, which is what wears down tables that leave
+ * tombstones or relinked chains behind.
+ */
+typedef hashtable (*table_constructor)(
+    uint32_t object_size, hash_function_type hash_function,
+    hash_comparison_function_type comparison_function,
+    hash_key_copy_function_type copy_function);
+
+static uint32_t key_hash(void const *key) {
+  uint64_t hash = hash_wyhash(key, sizeof(uint64_t), 0);
+  return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static bool key_comparison(void const *key1, void const *key2) {
+  return *(uint64_t const *)key1 == *(uint64_t const *)key2;
+}
+
+static void *key_copy(void const *key) {
+  uint64_t *copy = malloc(sizeof(uint64_t));
+  *copy = *(uint64_t const *)key;
+  return copy;
+}
+
+/*
+ * Requests favour a hot part of the key space so the cache has hits, with a
+ * long tail that keeps it evicting.
+ */
+static uint64_t next_request(uint64_t *state, uint64_t key_space) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  uint64_t pick = *state % key_space;
+  return (*state >> 60) < 10 ? pick / 8 : pick;
+}
+
+static void run(char const *engine, table_constructor constructor,
+                unsigned cache_size, unsigned requests) {
+  hashtable table =
+      constructor(sizeof(unsigned), key_hash, key_comparison, key_copy);
+  uint64_t *ring = malloc(sizeof(uint64_t) * cache_size);
+  unsigned ring_head = 0, hits = 0, removes = 0;
+  uint64_t state = 88172645463325252ull;
+  uint64_t key_space = (uint64_t)cache_size * 4;
+
+  double start = benchmark_now();
+  for (unsigned i = 0; i < requests; ++i) {
+    uint64_t key = next_request(&state, key_space);
+    if (hashtable_lookup(&table, &key) != NULL) {
+      ++hits;
+      continue;
+    }
+
+    if (table.size == cache_size) {
+      hashtable_remove(&table, &ring[ring_head]);
+      ++removes;
+    }
+    hashtable_insert(&table, &key, &i);
+    ring[ring_head] = key;
+    ring_head = (ring_head + 1) % cache_size;
+  }
+  double elapsed = benchmark_now() - start;
+
+  char name[64];
+  sprintf(name, "%s cache churn", engine);
+  BENCHMARK_REPORT(name, requests, elapsed);
+  printf("    %.1f%% hits, %u removes, max probe length %u\n",
+         100.0 * hits / requests, removes, hashtable_max_probe_length(&table));
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < cache_size; ++i) {
+    benchmark_consume(hashtable_lookup(&table, &ring[i]));
+  }
+  sprintf(name, "%s lookup after churn", engine);
+  BENCHMARK_REPORT(name, cache_size, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < cache_size; ++i) {
+    uint64_t missing = key_space + i;
+    benchmark_consume(hashtable_lookup(&table, &missing));
+  }
+  sprintf(name, "%s miss after churn", engine);
+  BENCHMARK_REPORT(name, cache_size, benchmark_now() - start);
+
+  hashtable_free(&table);
+  free(ring);
+}
+
+int main(int argc, char **argv) {
+  unsigned cache_size = argc > 1 ? (unsigned)atoi(argv[1]) : 200000;
+  unsigned requests = cache_size * 50;
+
+  run("coalesced", hashtable_new, cache_size, requests);
+  run("flat", hashtable_new_flat, cache_size, requests);
+  run("robin hood", hashtable_new_robin_hood, cache_size, requests);
+
+  return 0;
+}
@@ -0,0 +1,131 @@
+#include "data_structures/hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * Inserts count string keys into a table that strdups every key, a string
+ * table (key arena) and a string table with inline keys, looks them all up,
+ * then frees the table. Each run happens in
+ * its own process so the RSS growth isn't hidden by memory an earlier run gave
+ * back to malloc.
+ */
+typedef struct {
+  char const *name;
+  char const *format;
+} key_set;
+
+static uint32_t string_hash(void const *string) {
+  uint32_t length = (uint32_t)strlen((char const *)string);
+  uint64_t hash = hash_wyhash(string, length, 0);
+  return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static bool string_comparison(void const *string1, void const *string2) {
+  return strcmp((char const *)string1, (char const *)string2) == 0;
+}
+
+static void *string_copy(void const *string) {
+  return strdup((char const *)string);
+}
+
+static double resident_megabytes(void) {
+  FILE *statm = fopen("/proc/self/statm", "r");
+  if (statm == NULL) {
+    return -1;
+  }
+
+  unsigned long pages = 0, resident = 0;
+  int read = fscanf(statm, "%lu %lu", &pages, &resident);
+  fclose(statm);
+
+  if (read != 2) {
+    return -1;
+  }
+
+  return (double)resident * (double)sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+static void run(char const *storage, bool flat, key_set const *set,
+                unsigned count) {
+  char **keys = malloc(sizeof(char *) * count);
+  for (unsigned i = 0; i < count; ++i) {
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), set->format, i);
+    keys[i] = strdup(buffer);
+  }
+
+  hashtable table;
+  if (strcmp(storage, "strdup") == 0) {
+    table = flat ? hashtable_new_flat(sizeof(unsigned), string_hash,
+                                      string_comparison, string_copy)
+                 : hashtable_new(sizeof(unsigned), string_hash,
+                                 string_comparison, string_copy);
+  } else {
+    table = flat ? hashtable_new_flat_string(sizeof(unsigned))
+                 : hashtable_new_string(sizeof(unsigned));
+    hashtable_set_arena_keys(&table, true);
+    hashtable_set_inline_keys(&table, strcmp(storage, "inline") == 0);
+  }
+
+  double resident_before = resident_megabytes();
+
+  double start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&table, keys[i], &i);
+  }
+  double insert_elapsed = benchmark_now() - start;
+
+  double resident_after = resident_megabytes();
+
+  /* Look the keys up in a scattered order so every lookup misses the cache. */
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned index = (unsigned)(((uint64_t)i * 2654435761u) % count);
+    benchmark_consume(hashtable_lookup(&table, keys[index]));
+  }
+  double lookup_elapsed = benchmark_now() - start;
+
+  start = benchmark_now();
+  hashtable_free(&table);
+  double free_elapsed = benchmark_now() - start;
+
+  char name[64];
+  sprintf(name, "%s %s %s keys insert", flat ? "flat" : "coalesced", storage,
+          set->name);
+  BENCHMARK_REPORT(name, count, insert_elapsed);
+  sprintf(name, "%s %s %s keys lookup", flat ? "flat" : "coalesced", storage,
+          set->name);
+  BENCHMARK_REPORT(name, count, lookup_elapsed);
+  printf("    rss +%.1f MB, hashtable_free %.2f ms\n",
+         resident_after - resident_before, free_elapsed * 1e3);
+  fflush(stdout);
+
+  for (unsigned i = 0; i < count; ++i) {
+    free(keys[i]);
+  }
+  free(keys);
+}
+
+int main(int argc, char **argv) {
+  unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 2000000;
+  key_set sets[] = {{"short", "user:%u"},
+                    {"long", "/usr/share/doc/package-%u/changelog.Debian.gz"}};
+  char const *storages[] = {"strdup", "arena", "inline"};
+
+  for (unsigned s = 0; s < sizeof(sets) / sizeof(key_set); ++s) {
+    for (unsigned flat = 0; flat < 2; ++flat) {
+      for (unsigned k = 0; k < sizeof(storages) / sizeof(char *); ++k) {
+        pid_t child = fork();
+        if (child == 0) {
+          run(storages[k], flat, &sets[s], count);
+          exit(0);
+        }
+        waitpid(child, NULL, 0);
+      }
+    }
+  }
+
+  return 0;
+}
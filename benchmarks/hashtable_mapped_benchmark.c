@@ -0,0 +1,73 @@
+#include "data_structures/hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+/*
+ * Startup cost of rebuilding a string table from its source keys compared
+ * with opening a saved copy with hashtable_open_mapped, and lookups in each.
+ */
+static char **make_keys(unsigned count) {
+  char **keys = malloc(sizeof(char *) * count);
+
+  for (unsigned i = 0; i < count; ++i) {
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "/usr/share/doc/package-%u/README", i);
+    keys[i] = strdup(buffer);
+  }
+
+  return keys;
+}
+
+static void lookups(char const *name, hashtable *table, char **keys,
+                    unsigned count) {
+  double start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned index = (unsigned)(((uint64_t)i * 2654435761u) % count);
+    benchmark_consume(hashtable_lookup(table, keys[index]));
+  }
+  BENCHMARK_REPORT(name, count, benchmark_now() - start);
+}
+
+int main(int argc, char **argv) {
+  unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 1000000;
+  string path = string_wrap_cstring("hashtable_mapped_benchmark.bin");
+  char **keys = make_keys(count);
+
+  double start = benchmark_now();
+  hashtable built = hashtable_new_string(sizeof(unsigned));
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&built, keys[i], &i);
+  }
+  double build_elapsed = benchmark_now() - start;
+
+  start = benchmark_now();
+  hashtable_save(&built, &path);
+  double save_elapsed = benchmark_now() - start;
+
+  start = benchmark_now();
+  hashtable mapped = hashtable_open_mapped(&path);
+  double open_elapsed = benchmark_now() - start;
+
+  start = benchmark_now();
+  benchmark_consume(hashtable_lookup(&mapped, keys[0]));
+  double first_lookup_elapsed = benchmark_now() - start;
+
+  printf("%u keys: build %.1f ms, save %.1f ms, open_mapped %.3f ms, first "
+         "mapped lookup %.3f ms\n",
+         count, build_elapsed * 1e3, save_elapsed * 1e3, open_elapsed * 1e3,
+         first_lookup_elapsed * 1e3);
+
+  lookups("built table lookup", &built, keys, count);
+  lookups("mapped table lookup", &mapped, keys, count);
+
+  hashtable_free(&built);
+  hashtable_free(&mapped);
+  remove(path.data);
+
+  for (unsigned i = 0; i < count; ++i) {
+    free(keys[i]);
+  }
+  free(keys);
+
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include "data_structures/hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+#define DEFAULT_COUNT (4u * 1024u * 1024u)
+
+static uint32_t unsigned_hash(void const *key) {
+  uint32_t hash = *(unsigned const *)key;
+  hash ^= hash >> 16;
+  hash *= 0x7feb352d;
+  hash ^= hash >> 15;
+  hash *= 0x846ca68b;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+static bool unsigned_comparison(void const *key1, void const *key2) {
+  return *(unsigned const *)key1 == *(unsigned const *)key2;
+}
+
+static void *unsigned_copy(void const *key) {
+  unsigned *copy = malloc(sizeof(unsigned));
+  *copy = *(unsigned const *)key;
+  return copy;
+}
+
+static int compare_doubles(void const *a, void const *b) {
+  double da = *(double const *)a;
+  double db = *(double const *)b;
+  return (da > db) - (da < db);
+}
+
+/*
+ * Times every single insert so the latency tail (where a full reallocation
+ * lands) is visible, not just the average.
+ */
+static void run(char const *mode, bool incremental, unsigned count) {
+  double *latencies = malloc(sizeof(double) * count);
+  hashtable table = hashtable_new(sizeof(unsigned), unsigned_hash,
+                                  unsigned_comparison, unsigned_copy);
+  hashtable_set_incremental_resize(&table, incremental);
+
+  double total_start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    double start = benchmark_now();
+    hashtable_insert(&table, &i, &i);
+    latencies[i] = benchmark_now() - start;
+  }
+  double total = benchmark_now() - total_start;
+
+  qsort(latencies, count, sizeof(double), compare_doubles);
+
+  char name[64];
+  sprintf(name, "%s insert", mode);
+  BENCHMARK_REPORT(name, count, total);
+  printf("    p50 %8.0f ns  p99 %8.0f ns  p99.9 %8.0f ns  max %10.0f ns\n",
+         latencies[count / 2] * 1e9, latencies[count / 100 * 99] * 1e9,
+         latencies[count / 1000 * 999] * 1e9, latencies[count - 1] * 1e9);
+
+  hashtable_free(&table);
+  free(latencies);
+}
+
+int main(int argc, char **argv) {
+  unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : DEFAULT_COUNT;
+
+  run("stop-the-world resize", false, count);
+  run("incremental resize", true, count);
+
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include "data_structures/hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+/*
+ * A tokenizer loop: walk a buffer of space separated words and look each one
+ * up in a table of known identifiers. Compares copying every token into its
+ * own string first with looking the bytes up where they are.
+ */
+static char *make_text(unsigned token_count, unsigned identifiers,
+                       unsigned *length) {
+  char *text = malloc((size_t)token_count * 16 + 1);
+  uint32_t state = 2463534242u;
+  unsigned position = 0;
+
+  for (unsigned i = 0; i < token_count; ++i) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    /* Half the tokens aren't identifiers. */
+    unsigned id = state % (identifiers * 2);
+    position += (unsigned)sprintf(text + position, "%s%u ",
+                                  id < identifiers ? "id" : "xx", id);
+  }
+
+  *length = position;
+  return text;
+}
+
+static void run(char const *engine, hashtable table, char const *text,
+                unsigned length, unsigned token_count) {
+  unsigned found = 0;
+
+  double start = benchmark_now();
+  for (unsigned begin = 0, end = 0; end < length; begin = ++end) {
+    while (text[end] != ' ') {
+      ++end;
+    }
+
+    string token = string_new_substring(text, begin, end);
+    found += hashtable_lookup(&table, token.data) != NULL;
+    string_free(&token);
+  }
+  char name[64];
+  sprintf(name, "%s substring + lookup", engine);
+  BENCHMARK_REPORT(name, token_count, benchmark_now() - start);
+
+  unsigned found_bytes = 0;
+  start = benchmark_now();
+  for (unsigned begin = 0, end = 0; end < length; begin = ++end) {
+    while (text[end] != ' ') {
+      ++end;
+    }
+
+    found_bytes +=
+        hashtable_lookup_bytes(&table, text + begin, end - begin) != NULL;
+  }
+  sprintf(name, "%s lookup_bytes", engine);
+  BENCHMARK_REPORT(name, token_count, benchmark_now() - start);
+
+  if (found != found_bytes) {
+    printf("    found %u tokens one way and %u the other\n", found,
+           found_bytes);
+  }
+
+  hashtable_free(&table);
+}
+
+static hashtable fill(hashtable table, unsigned identifiers) {
+  for (unsigned i = 0; i < identifiers; ++i) {
+    char buffer[32];
+    sprintf(buffer, "id%u", i);
+    hashtable_insert(&table, buffer, &i);
+  }
+
+  return table;
+}
+
+int main(int argc, char **argv) {
+  unsigned token_count = argc > 1 ? (unsigned)atoi(argv[1]) : 2000000;
+  unsigned identifiers = 5000;
+  unsigned length;
+  char *text = make_text(token_count, identifiers, &length);
+
+  run("coalesced", fill(hashtable_new_string(sizeof(unsigned)), identifiers),
+      text, length, token_count);
+  run("flat", fill(hashtable_new_flat_string(sizeof(unsigned)), identifiers),
+      text, length, token_count);
+  run("robin hood",
+      fill(hashtable_new_robin_hood_string(sizeof(unsigned)), identifiers),
+      text, length, token_count);
+
+  free(text);
+
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include "data_structures/dynamic_array.h"
+#include "data_structures/large_array.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+/*
+ * Growing an array of 64 bit values one push_back at a time, reading it back
+ * in a random order and shrinking it to a quarter: a dynamic_array (realloc)
+ * against a large_array with and without transparent huge pages.
+ */
+static uint64_t *random_indices(uint64_t count, uint64_t range) {
+  uint64_t *indices = malloc(sizeof(uint64_t) * count);
+  uint64_t state = 88172645463325252ull;
+  for (uint64_t i = 0; i < count; ++i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    indices[i] = state % range;
+  }
+  return indices;
+}
+
+static void run_large_array(char const *name, uint32_t flags, uint64_t count,
+                            uint64_t const *indices) {
+  char label[96];
+  large_array a = large_array_new(sizeof(uint64_t), flags);
+
+  double start = benchmark_now();
+  for (uint64_t i = 0; i < count; ++i) {
+    large_array_push_back(&a, &i);
+  }
+  snprintf(label, sizeof(label), "%s push_back", name);
+  BENCHMARK_REPORT(label, count, benchmark_now() - start);
+
+  uint64_t sum = 0;
+  start = benchmark_now();
+  for (uint64_t i = 0; i < count; ++i) {
+    sum += ((uint64_t const *)a.data)[indices[i]];
+  }
+  benchmark_consume(&sum);
+  snprintf(label, sizeof(label), "%s random reads", name);
+  BENCHMARK_REPORT(label, count, benchmark_now() - start);
+
+  large_array_resize(&a, count / 4);
+  start = benchmark_now();
+  large_array_shrink(&a);
+  printf("    shrink to a quarter %.3f ms, %llu MB left reserved\n",
+         (benchmark_now() - start) * 1e3,
+         (unsigned long long)(a.reserved_bytes >> 20));
+
+  large_array_free(&a);
+}
+
+int main(int argc, char **argv) {
+  uint64_t count = argc > 1 ? (uint64_t)atoll(argv[1]) : 64000000;
+  uint64_t *indices = random_indices(count, count);
+
+  dynamic_array d = dynamic_array_new(sizeof(uint64_t));
+  double start = benchmark_now();
+  for (uint64_t i = 0; i < count; ++i) {
+    dynamic_array_push_back(&d, &i);
+  }
+  BENCHMARK_REPORT("dynamic_array push_back", count, benchmark_now() - start);
+
+  uint64_t sum = 0;
+  start = benchmark_now();
+  for (uint64_t i = 0; i < count; ++i) {
+    sum += ((uint64_t const *)d.data)[indices[i]];
+  }
+  benchmark_consume(&sum);
+  BENCHMARK_REPORT("dynamic_array random reads", count,
+                   benchmark_now() - start);
+
+  dynamic_array_resize(&d, (uint32_t)(count / 4));
+  start = benchmark_now();
+  dynamic_array_shrink(&d);
+  printf("    shrink to a quarter %.3f ms\n", (benchmark_now() - start) * 1e3);
+  dynamic_array_free(&d);
+
+  run_large_array("large_array", 0, count, indices);
+  run_large_array("large_array, huge pages", large_array_flag_huge_pages, count,
+                  indices);
+
+  free(indices);
+
+  return 0;
+}
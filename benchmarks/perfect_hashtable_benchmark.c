@@ -0,0 +1,100 @@
+#include "data_structures/perfect_hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+#include <unistd.h>
+
+/*
+ * Memory and lookup latency of a string table compared with the
+ * perfect_hashtable built from it. Lookups go in a scattered order so nearly
+ * every one misses the cache, half of them for keys that aren't there.
+ */
+static char **make_keys(char const *format, unsigned count) {
+  char **keys = malloc(sizeof(char *) * count);
+
+  for (unsigned i = 0; i < count; ++i) {
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), format, i);
+    keys[i] = strdup(buffer);
+  }
+
+  return keys;
+}
+
+static void free_keys(char **keys, unsigned count) {
+  for (unsigned i = 0; i < count; ++i) {
+    free(keys[i]);
+  }
+  free(keys);
+}
+
+static double resident_megabytes(void) {
+  FILE *statm = fopen("/proc/self/statm", "r");
+  if (statm == NULL) {
+    return -1;
+  }
+
+  unsigned long pages = 0, resident = 0;
+  int read = fscanf(statm, "%lu %lu", &pages, &resident);
+  fclose(statm);
+
+  if (read != 2) {
+    return -1;
+  }
+
+  return (double)resident * (double)sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+static double perfect_hashtable_megabytes(perfect_hashtable const *table) {
+  uint64_t bytes = sizeof(uint32_t) * ((uint64_t)table->bucket_count +
+                                       (table->table_size - table->size) +
+                                       (table->size + 1)) +
+                   table->entry_offsets[table->size];
+  return (double)bytes / (1024 * 1024);
+}
+
+int main(int argc, char **argv) {
+  unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 1000000;
+  char **keys = make_keys("/usr/share/doc/package-%u/README", count);
+  char **misses = make_keys("/usr/share/doc/package-%u/COPYING", count);
+
+  double resident_before = resident_megabytes();
+  hashtable built = hashtable_new_flat_string(sizeof(unsigned));
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&built, keys[i], &i);
+  }
+  double resident_after = resident_megabytes();
+
+  double start = benchmark_now();
+  perfect_hashtable perfect = perfect_hashtable_from_hashtable(&built);
+  double build_elapsed = benchmark_now() - start;
+
+  printf("%u keys: hashtable rss +%.1f MB, perfect_hashtable %.1f MB "
+         "(%u buckets), built in %.1f ms\n",
+         count, resident_after - resident_before,
+         perfect_hashtable_megabytes(&perfect), perfect.bucket_count,
+         build_elapsed * 1e3);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned index = (unsigned)(((uint64_t)i * 2654435761u) % count);
+    benchmark_consume(
+        hashtable_lookup(&built, i & 1 ? misses[index] : keys[index]));
+  }
+  BENCHMARK_REPORT("hashtable lookup", count, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned index = (unsigned)(((uint64_t)i * 2654435761u) % count);
+    benchmark_consume(perfect_hashtable_lookup(
+        &perfect, i & 1 ? misses[index] : keys[index]));
+  }
+  BENCHMARK_REPORT("perfect_hashtable lookup", count,
+                   benchmark_now() - start);
+
+  perfect_hashtable_free(&perfect);
+  hashtable_free(&built);
+  free_keys(keys, count);
+  free_keys(misses, count);
+
+  return 0;
+}
@@ -0,0 +1,83 @@
+#include "data_structures/dynamic_array.h"
+#include "data_structures/segmented_array.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+/*
+ * Growing an array one push_back at a time: a dynamic_array copies all of its
+ * elements every time it reallocates, a segmented_array just adds a chunk.
+ * The slowest single push_back shows the stall. Then summing the elements of
+ * each, the segmented_array both by index and chunk by chunk.
+ */
+static void push_report(char const *name, unsigned count, double elapsed,
+                        double slowest) {
+  BENCHMARK_REPORT(name, count, elapsed);
+  printf("    slowest push_back %.3f ms\n", slowest * 1e3);
+}
+
+int main(int argc, char **argv) {
+  unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 32000000;
+
+  dynamic_array a = dynamic_array_new(sizeof(uint64_t));
+  double slowest = 0;
+  double start = benchmark_now();
+  for (uint64_t i = 0; i < count; ++i) {
+    double before = benchmark_now();
+    dynamic_array_push_back(&a, &i);
+    double elapsed = benchmark_now() - before;
+    slowest = elapsed > slowest ? elapsed : slowest;
+  }
+  push_report("dynamic_array push_back", count, benchmark_now() - start,
+              slowest);
+
+  segmented_array s = segmented_array_new(sizeof(uint64_t), 0);
+  slowest = 0;
+  start = benchmark_now();
+  for (uint64_t i = 0; i < count; ++i) {
+    double before = benchmark_now();
+    segmented_array_push_back(&s, &i);
+    double elapsed = benchmark_now() - before;
+    slowest = elapsed > slowest ? elapsed : slowest;
+  }
+  push_report("segmented_array push_back", count, benchmark_now() - start,
+              slowest);
+
+  uint64_t sum = 0;
+  start = benchmark_now();
+  uint64_t const *values = (uint64_t const *)a.data;
+  for (uint32_t i = 0; i < a.size; ++i) {
+    sum += values[i];
+  }
+  BENCHMARK_REPORT("dynamic_array sum", count, benchmark_now() - start);
+
+  uint64_t indexed_sum = 0;
+  start = benchmark_now();
+  for (uint32_t i = 0; i < s.size; ++i) {
+    indexed_sum += *(uint64_t *)segmented_array_get_at(&s, i);
+  }
+  BENCHMARK_REPORT("segmented_array sum, get_at", count,
+                   benchmark_now() - start);
+
+  uint64_t chunk_sum = 0;
+  start = benchmark_now();
+  for (uint32_t chunk = 0; chunk < segmented_array_chunk_count(&s); ++chunk) {
+    uint32_t length;
+    uint64_t const *chunk_values =
+        segmented_array_get_chunk(&s, chunk, &length);
+    for (uint32_t i = 0; i < length; ++i) {
+      chunk_sum += chunk_values[i];
+    }
+  }
+  BENCHMARK_REPORT("segmented_array sum, by chunk", count,
+                   benchmark_now() - start);
+
+  if (sum != indexed_sum || sum != chunk_sum) {
+    printf("    sums differ: %llu, %llu, %llu\n", (unsigned long long)sum,
+           (unsigned long long)indexed_sum, (unsigned long long)chunk_sum);
+  }
+
+  dynamic_array_free(&a);
+  segmented_array_free(&s);
+
+  return 0;
+}
@@ -0,0 +1,140 @@
+#include "data_structures/dynamic_array.h"
+#include "data_structures/typed_array.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+/*
+ * Filling an array with push_back and then summing it, through
+ * dynamic_array_push_back / dynamic_array_get_at and through arrays made by
+ * FENNEC_DEFINE_ARRAY, for int, float and a small struct.
+ */
+typedef struct {
+  float x, y, z;
+} point;
+
+FENNEC_DEFINE_ARRAY(int_array, int)
+FENNEC_DEFINE_ARRAY(float_array, float)
+FENNEC_DEFINE_ARRAY(point_array, point)
+
+static void report(char const *type, char const *version,
+                   char const *operation, unsigned count, double elapsed) {
+  char name[64];
+  sprintf(name, "%s %s %s", type, version, operation);
+  BENCHMARK_REPORT(name, count, elapsed);
+}
+
+static void run_int(unsigned count) {
+  dynamic_array generic = dynamic_array_new(sizeof(int));
+  double start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    int value = (int)i;
+    dynamic_array_push_back(&generic, &value);
+  }
+  report("int", "generic", "push_back", count, benchmark_now() - start);
+
+  int sum = 0;
+  start = benchmark_now();
+  for (unsigned i = 0; i < generic.size; ++i) {
+    sum += *(int *)dynamic_array_get_at(&generic, i);
+  }
+  report("int", "generic", "sum", count, benchmark_now() - start);
+  benchmark_consume(&sum);
+  dynamic_array_free(&generic);
+
+  int_array typed = int_array_new();
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    int_array_push_back(&typed, (int)i);
+  }
+  report("int", "typed", "push_back", count, benchmark_now() - start);
+
+  sum = 0;
+  start = benchmark_now();
+  for (int *it = int_array_begin(&typed); it != int_array_end(&typed); ++it) {
+    sum += *it;
+  }
+  report("int", "typed", "sum", count, benchmark_now() - start);
+  benchmark_consume(&sum);
+  int_array_free(&typed);
+}
+
+static void run_float(unsigned count) {
+  dynamic_array generic = dynamic_array_new(sizeof(float));
+  double start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    float value = (float)i;
+    dynamic_array_push_back(&generic, &value);
+  }
+  report("float", "generic", "push_back", count, benchmark_now() - start);
+
+  float sum = 0;
+  start = benchmark_now();
+  for (unsigned i = 0; i < generic.size; ++i) {
+    sum += *(float *)dynamic_array_get_at(&generic, i) * 0.5f;
+  }
+  report("float", "generic", "scaled sum", count, benchmark_now() - start);
+  benchmark_consume(&sum);
+  dynamic_array_free(&generic);
+
+  float_array typed = float_array_new();
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    float_array_push_back(&typed, (float)i);
+  }
+  report("float", "typed", "push_back", count, benchmark_now() - start);
+
+  sum = 0;
+  start = benchmark_now();
+  for (unsigned i = 0; i < typed.size; ++i) {
+    sum += typed.data[i] * 0.5f;
+  }
+  report("float", "typed", "scaled sum", count, benchmark_now() - start);
+  benchmark_consume(&sum);
+  float_array_free(&typed);
+}
+
+static void run_point(unsigned count) {
+  dynamic_array generic = dynamic_array_new(sizeof(point));
+  double start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    point p = {(float)i, 1.f, 2.f};
+    dynamic_array_push_back(&generic, &p);
+  }
+  report("point", "generic", "push_back", count, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < generic.size; ++i) {
+    point *p = dynamic_array_get_at(&generic, i);
+    p->y += p->x;
+  }
+  report("point", "generic", "update", count, benchmark_now() - start);
+  benchmark_consume(generic.data);
+  dynamic_array_free(&generic);
+
+  point_array typed = point_array_new();
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    point p = {(float)i, 1.f, 2.f};
+    point_array_push_back(&typed, p);
+  }
+  report("point", "typed", "push_back", count, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (point *p = point_array_begin(&typed); p != point_array_end(&typed);
+       ++p) {
+    p->y += p->x;
+  }
+  report("point", "typed", "update", count, benchmark_now() - start);
+  benchmark_consume(typed.data);
+  point_array_free(&typed);
+}
+
+int main(int argc, char **argv) {
+  unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 10000000;
+
+  run_int(count);
+  run_float(count);
+  run_point(count);
+
+  return 0;
+}
@@ -0,0 +1,190 @@
+#include "data_structures/hashtable.h"
+#include "data_structures/typed_hashtable.h"
+#include "utilities/benchmark_helpers.h"
+#include <stdio.h>
+
+/*
+ * The same inserts and lookups against hashtable engines, which call the
+ * hash, comparison and copy functions through pointers, and against tables
+ * generated by FENNEC_DEFINE_HASHTABLE for the key type.
+ */
+typedef hashtable (*table_constructor)(
+    uint32_t object_size, hash_function_type hash_function,
+    hash_comparison_function_type comparison_function,
+    hash_key_copy_function_type copy_function);
+typedef hashtable (*string_table_constructor)(uint32_t object_size);
+
+#define uint_hash(key) (key)
+#define uint_eq(key1, key2) ((key1) == (key2))
+
+FENNEC_DEFINE_HASHTABLE(uint_table, uint32_t, unsigned, uint_hash, uint_eq)
+FENNEC_DEFINE_STRING_HASHTABLE(word_table, unsigned)
+
+static uint32_t key_hash(void const *key) { return *(uint32_t const *)key; }
+
+static bool key_comparison(void const *key1, void const *key2) {
+  return *(uint32_t const *)key1 == *(uint32_t const *)key2;
+}
+
+static void *key_copy(void const *key) {
+  uint32_t *copy = malloc(sizeof(uint32_t));
+  *copy = *(uint32_t const *)key;
+  return copy;
+}
+
+static uint32_t *make_integer_keys(unsigned count) {
+  uint32_t *keys = malloc(sizeof(uint32_t) * count * 2);
+  uint32_t state = 2463534242u;
+
+  /* Odd keys are inserted, even ones are only used for misses. */
+  for (unsigned i = 0; i < count * 2; ++i) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    keys[i] = (state & ~1u) | (i < count);
+  }
+
+  return keys;
+}
+
+static char **make_string_keys(unsigned count) {
+  char **keys = malloc(sizeof(char *) * count * 2);
+
+  for (unsigned i = 0; i < count * 2; ++i) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%s key %u", i < count ? "hit" : "miss",
+             i);
+    keys[i] = strdup(buffer);
+  }
+
+  return keys;
+}
+
+static void report(char const *engine, char const *operation, unsigned count,
+                   double elapsed) {
+  char name[64];
+  sprintf(name, "%s %s", engine, operation);
+  BENCHMARK_REPORT(name, count, elapsed);
+}
+
+static void run_integers(char const *engine, table_constructor constructor,
+                         uint32_t *keys, unsigned count) {
+  hashtable table =
+      constructor(sizeof(unsigned), key_hash, key_comparison, key_copy);
+
+  double start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&table, &keys[i], &i);
+  }
+  report(engine, "uint32 insert", count, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    benchmark_consume(hashtable_lookup(&table, &keys[i]));
+  }
+  report(engine, "uint32 lookup hit", count, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (unsigned i = count; i < count * 2; ++i) {
+    benchmark_consume(hashtable_lookup(&table, &keys[i]));
+  }
+  report(engine, "uint32 lookup miss", count, benchmark_now() - start);
+
+  hashtable_free(&table);
+}
+
+static void run_typed_integers(uint32_t *keys, unsigned count) {
+  uint_table table = uint_table_new();
+
+  double start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    uint_table_insert(&table, keys[i], i);
+  }
+  report("typed", "uint32 insert", count, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    benchmark_consume(uint_table_lookup(&table, keys[i]));
+  }
+  report("typed", "uint32 lookup hit", count, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (unsigned i = count; i < count * 2; ++i) {
+    benchmark_consume(uint_table_lookup(&table, keys[i]));
+  }
+  report("typed", "uint32 lookup miss", count, benchmark_now() - start);
+
+  uint_table_free(&table);
+}
+
+static void run_strings(char const *engine,
+                        string_table_constructor constructor, char **keys,
+                        unsigned count) {
+  hashtable table = constructor(sizeof(unsigned));
+
+  double start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&table, keys[i], &i);
+  }
+  report(engine, "string insert", count, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    benchmark_consume(hashtable_lookup(&table, keys[i]));
+  }
+  report(engine, "string lookup hit", count, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (unsigned i = count; i < count * 2; ++i) {
+    benchmark_consume(hashtable_lookup(&table, keys[i]));
+  }
+  report(engine, "string lookup miss", count, benchmark_now() - start);
+
+  hashtable_free(&table);
+}
+
+static void run_typed_strings(char **keys, unsigned count) {
+  word_table table = word_table_new();
+
+  double start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    word_table_insert(&table, keys[i], i);
+  }
+  report("typed", "string insert", count, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (unsigned i = 0; i < count; ++i) {
+    benchmark_consume(word_table_lookup(&table, keys[i]));
+  }
+  report("typed", "string lookup hit", count, benchmark_now() - start);
+
+  start = benchmark_now();
+  for (unsigned i = count; i < count * 2; ++i) {
+    benchmark_consume(word_table_lookup(&table, keys[i]));
+  }
+  report("typed", "string lookup miss", count, benchmark_now() - start);
+
+  word_table_free(&table);
+}
+
+int main(int argc, char **argv) {
+  unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 1000000;
+
+  uint32_t *integer_keys = make_integer_keys(count);
+  run_integers("flat", hashtable_new_flat, integer_keys, count);
+  run_integers("robin hood", hashtable_new_robin_hood, integer_keys, count);
+  run_typed_integers(integer_keys, count);
+  free(integer_keys);
+
+  char **string_keys = make_string_keys(count);
+  run_strings("flat", hashtable_new_flat_string, string_keys, count);
+  run_strings("robin hood", hashtable_new_robin_hood_string, string_keys,
+              count);
+  run_typed_strings(string_keys, count);
+  for (unsigned i = 0; i < count * 2; ++i) {
+    free(string_keys[i]);
+  }
+  free(string_keys);
+
+  return 0;
+}
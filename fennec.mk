@@ -1,4 +1,4 @@
-FENNEC_LDFLAGS := -Ldeps/fennec/build/lib -lfennec
+FENNEC_LDFLAGS := -Ldeps/fennec/build/lib -lfennec -pthread
 FENNEC_CFLAGS := -Ideps/fennec/include
 
 .fennec:
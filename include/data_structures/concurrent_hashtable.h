@@ -0,0 +1,145 @@
+/**
+ * @file
+ * @author Ryan Rohrer <ryan.rohrer@gmail.com>
+ *
+ * @section DESCRIPTION
+ * A thread safe hashtable. Keys are spread over a fixed number of shards, each
+ * an open addressed array with its own writer lock. Readers never lock, they
+ * validate what they read against a per shard sequence counter and retry if a
+ * writer got in the way.
+ *
+ * Removed key copies and outgrown bucket arrays can't be freed straight away
+ * because a reader may still be looking at them. Readers announce the global
+ * epoch while they look, and writers free retired memory in batches once
+ * every reader has announced an epoch at least as new as the one it was
+ * retired in.
+ */
+#ifndef concurrent_hashtable_h
+#define concurrent_hashtable_h
+
+#include "data_structures/hashtable.h"
+#include "fennec.h"
+
+/**
+ * The private per shard state.
+ */
+typedef struct concurrent_hashtable_shard concurrent_hashtable_shard;
+
+/**
+ * The private global epoch and reader announcements.
+ */
+typedef struct concurrent_hashtable_epochs concurrent_hashtable_epochs;
+
+/**
+ * A hashtable that can be used from many threads at once.
+ */
+typedef struct {
+  uint32_t object_size;
+  uint32_t shard_count;
+  hash_function_type hash_function;
+  hash_comparison_function_type comparison_function;
+  hash_key_copy_function_type copy_function;
+  concurrent_hashtable_shard *shards;
+  concurrent_hashtable_epochs *epochs;
+} concurrent_hashtable;
+
+/**
+ * Constructor for a new concurrent_hashtable. Must be freed with
+ * concurrent_hashtable_free.
+ *
+ * @param object_size - the size of the object being stored in this table.
+ * @param hash_function - function that describes how to hash keys.
+ * @param comparison_function - function that tells if two keys are equal.
+ * @param copy_function - function that can allocate new copies of keys.
+ * @return - a newly constructed concurrent_hashtable.
+ */
+concurrent_hashtable
+concurrent_hashtable_new(uint32_t object_size, hash_function_type hash_function,
+                         hash_comparison_function_type comparison_function,
+                         hash_key_copy_function_type copy_function);
+
+/**
+ * Constructor for a new concurrent_hashtable that uses strings as keys.
+ *
+ * @param object_size - the size of the object being stored in this table.
+ * @return - a newly constructed concurrent_hashtable.
+ */
+concurrent_hashtable concurrent_hashtable_new_string(uint32_t object_size);
+
+/**
+ * Insert an element. The element and key are copied. Unlike hashtable_insert,
+ * inserting a key that already exists replaces its value.
+ *
+ * @param table - the table that the element is being inserted into.
+ * @param key - the item that can be used to access this item later.
+ * @param value - the item being inserted, will be copied.
+ */
+void concurrent_hashtable_insert(concurrent_hashtable *table, void const *key,
+                                 void const *value);
+
+/**
+ * Remove an element. The key copy is freed later, once no reader can still be
+ * looking at it.
+ *
+ * @param table - the table that will have an element removed from it.
+ * @param key - the key of which element to remove.
+ */
+void concurrent_hashtable_remove(concurrent_hashtable *table, void const *key);
+
+/**
+ * Copies the item that key refers to into value. Never takes a lock.
+ *
+ * @param table - the table to look into.
+ * @param key - the key to look up.
+ * @param value - where the item is copied to (object_size bytes), may be NULL.
+ * @return - true if the key was found.
+ */
+bool concurrent_hashtable_lookup(concurrent_hashtable const *table,
+                                 void const *key, void *value);
+
+/**
+ * Lookup to see if this key exists. Never takes a lock.
+ *
+ * @param table - the table to check.
+ * @param key - the item to check to see if it exists.
+ * @return - true if the item exists in the table.
+ */
+bool concurrent_hashtable_exists(concurrent_hashtable const *table,
+                                 void const *key);
+
+/**
+ * Returns the number of elements in the table. Only exact when no writers are
+ * running.
+ *
+ * @param table - the table to count.
+ * @return - the number of elements.
+ */
+uint32_t concurrent_hashtable_size(concurrent_hashtable const *table);
+
+/**
+ * Frees the key copies and bucket arrays retired by remove and resize that no
+ * reader can still be looking at. Writers already do this every few dozen
+ * retirements, so this is only needed to hand memory back early. Safe to call
+ * while other threads use the table.
+ *
+ * @param table - the table to clean up.
+ */
+void concurrent_hashtable_reclaim(concurrent_hashtable *table);
+
+/**
+ * Returns the number of key copies and bucket arrays that have been retired
+ * but not freed yet. Only exact when no writers are running.
+ *
+ * @param table - the table to check.
+ * @return - the number of retired allocations.
+ */
+uint32_t concurrent_hashtable_retired_count(concurrent_hashtable const *table);
+
+/**
+ * Deallocates everything owned by the table.
+ *
+ * @param table - the table that's being cleaned up.
+ */
+void concurrent_hashtable_free(concurrent_hashtable *table);
+
+#endif
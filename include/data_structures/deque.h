@@ -0,0 +1,184 @@
+/**
+ * @file
+ * @author Ryan Rohrer <ryan.rohrer@gmail.com>
+ *
+ * @section DESCRIPTION
+ * Double ended queue in a circular buffer, for work queues and sliding
+ * windows where dynamic_array_remove(array, 0) would move every remaining
+ * element. Pushing and popping at either end is O(1); element i is at slot
+ * (head + i) & (capacity - 1) of the buffer, whose capacity is always a
+ * power of two. The buffer is a dynamic_array (with its size set to the
+ * capacity) and only grows, doubling and unwrapping the elements once.
+ *
+ * A deque holds at most 2^31 elements: pushes that would go past that do
+ * nothing, and reserving more than that is ignored.
+ */
+#ifndef deque_h
+#define deque_h
+
+#include "data_structures/dynamic_array.h"
+#include "fennec.h"
+#include "utilities/allocator.h"
+
+/**
+ * A deque. head is the buffer slot of the first element and size the number
+ * of elements; buffer.size is the capacity.
+ */
+typedef struct {
+  uint32_t head;
+  uint32_t size;
+  dynamic_array buffer;
+} deque;
+
+/**
+ * Constructor for a new deque.
+ *
+ * @param object_size - the sizeof() the data that will be stored in the deque.
+ * @return - a newly constructed and empty deque.
+ */
+deque deque_new(uint32_t object_size);
+
+/**
+ * Constructor for a new deque that gets its buffer from allocator.
+ *
+ * @param object_size - the sizeof() the data that will be stored in the deque.
+ * @param allocator - the allocator, must outlive the deque. NULL uses libc.
+ * @return - a newly constructed and empty deque.
+ */
+deque deque_new_with_allocator(uint32_t object_size,
+                               fennec_allocator const *allocator);
+
+/**
+ * Make room for reserve_count elements (rounded up to a power of two).
+ *
+ * @param d - the deque to reserve space in.
+ * @param reserve_count - the number of elements.
+ */
+void deque_reserve(deque *d, uint32_t reserve_count);
+
+/**
+ * Append a value to the back of a deque.
+ *
+ * @param d - the deque getting appended to.
+ * @param data - the data getting appended. (this will be copied)
+ */
+void deque_push_back(deque *d, void const *data);
+
+/**
+ * Prepend a value to the front of a deque.
+ *
+ * @param d - the deque getting prepended to.
+ * @param data - the data getting prepended. (this will be copied)
+ */
+void deque_push_front(deque *d, void const *data);
+
+/**
+ * Append count values to the back of a deque with at most two copies.
+ *
+ * @param d - the deque getting appended to.
+ * @param data - count values laid out back to back. (these will be copied)
+ * Must not point into the deque.
+ * @param count - the number of values to append.
+ */
+void deque_push_back_n(deque *d, void const *data, uint32_t count);
+
+/**
+ * Prepend count values to the front of a deque, keeping their order: the
+ * first of them becomes the new front.
+ *
+ * @param d - the deque getting prepended to.
+ * @param data - count values laid out back to back. (these will be copied)
+ * Must not point into the deque.
+ * @param count - the number of values to prepend.
+ */
+void deque_push_front_n(deque *d, void const *data, uint32_t count);
+
+/**
+ * Remove the first element of a deque.
+ *
+ * @param d - the deque to remove from.
+ * @param out - where the element is copied to, or NULL to drop it.
+ * @return - false if the deque was empty.
+ */
+bool deque_pop_front(deque *d, void *out);
+
+/**
+ * Remove the last element of a deque.
+ *
+ * @param d - the deque to remove from.
+ * @param out - where the element is copied to, or NULL to drop it.
+ * @return - false if the deque was empty.
+ */
+bool deque_pop_back(deque *d, void *out);
+
+/**
+ * Remove up to count elements from the front of a deque.
+ *
+ * @param d - the deque to remove from.
+ * @param out - room for count elements, which are copied there front first,
+ * or NULL to drop them.
+ * @param count - the most elements to remove.
+ * @return - the number of elements removed.
+ */
+uint32_t deque_pop_front_n(deque *d, void *out, uint32_t count);
+
+/**
+ * Remove up to count elements from the back of a deque.
+ *
+ * @param d - the deque to remove from.
+ * @param out - room for count elements, which are copied there in the order
+ * they were in the deque, or NULL to drop them.
+ * @param count - the most elements to remove.
+ * @return - the number of elements removed.
+ */
+uint32_t deque_pop_back_n(deque *d, void *out, uint32_t count);
+
+/**
+ * Return a pointer to the element index places from the front.
+ *
+ * @param d - the deque.
+ * @param index - the index to get.
+ * @return - the element at index, NULL if out of range. Only valid until the
+ * deque next grows.
+ */
+void *deque_get_at(deque const *d, uint32_t index);
+
+/**
+ * Return a pointer to the first element of a deque.
+ *
+ * @param d - the deque.
+ * @return - the first element, NULL if empty.
+ */
+void *deque_get_front(deque const *d);
+
+/**
+ * Return a pointer to the last element of a deque.
+ *
+ * @param d - the deque.
+ * @return - the last element, NULL if empty.
+ */
+void *deque_get_back(deque const *d);
+
+/**
+ * Checks to see if this deque is empty.
+ *
+ * @param d - the deque to check.
+ * @return - returns true if size == 0.
+ */
+bool deque_is_empty(deque const *d);
+
+/**
+ * Removes all elements in a deque, keeping its buffer.
+ *
+ * @param d - the deque that will be cleared.
+ */
+void deque_clear(deque *d);
+
+/**
+ * Deallocates a deque entirely, leaving it empty and ready to use again.
+ *
+ * @param d - the deque that is being deallocated.
+ */
+void deque_free(deque *d);
+
+#endif
@@ -10,15 +10,29 @@
 #define dynamic_array_h
 
 #include "fennec.h"
+#include "utilities/allocator.h"
 
 /**
- * A Dynamically expandable array.
+ * Optional behaviours of a dynamic_array.
+ *
+ * dynamic_array_flag_borrowed_data is set while data is a buffer the array
+ * was given by dynamic_array_new_with_buffer. It is never freed or resized;
+ * the first time the array needs more room its elements are copied to memory
+ * from allocator and the flag is cleared.
+ */
+typedef enum { dynamic_array_flag_borrowed_data = 1 << 0 } dynamic_array_flags;
+
+/**
+ * A Dynamically expandable array. data comes from allocator (NULL for libc)
+ * unless flags has dynamic_array_flag_borrowed_data.
  */
 typedef struct {
   uint32_t size;
   uint32_t capacity;
   uint32_t object_size;
+  uint32_t flags;
   char *data;
+  fennec_allocator const *allocator;
 } dynamic_array;
 
 /**
@@ -29,6 +43,34 @@ typedef struct {
  */
 dynamic_array dynamic_array_new(uint32_t object_size);
 
+/**
+ * Constructor for a new dynamic_array that gets its memory from allocator.
+ *
+ * @param object_size - the sizeof() the data that will be stored in this array.
+ * @param allocator - the allocator for the elements, must outlive the array.
+ * NULL uses libc, the same as dynamic_array_new.
+ * @return - a newly constructed and empty array.
+ */
+dynamic_array
+dynamic_array_new_with_allocator(uint32_t object_size,
+                                 fennec_allocator const *allocator);
+
+/**
+ * Constructor for a new dynamic_array that keeps its first elements in a
+ * buffer owned by the caller, e.g. an array on the stack, and only allocates
+ * once there are more than capacity of them. The result is an ordinary
+ * dynamic_array and works with every dynamic_array function.
+ *
+ * @param object_size - the sizeof() the data that will be stored in this array.
+ * @param buffer - room for capacity elements, suitably aligned for them. It
+ * must outlive the array (or at least the array's time in it), and is never
+ * freed by the array.
+ * @param capacity - the number of elements buffer holds.
+ * @return - a newly constructed and empty array.
+ */
+dynamic_array dynamic_array_new_with_buffer(uint32_t object_size, void *buffer,
+                                            uint32_t capacity);
+
 /**
  * Constructor for a new dynamic_array with reserved capacity.
  *
@@ -55,6 +97,51 @@ void dynamic_array_reserve(dynamic_array *array, uint32_t reserve_cout);
  */
 void dynamic_array_push_back(dynamic_array *array, void const *data);
 
+/**
+ * Append count values to the end of an array with at most one reallocation
+ * and a single copy.
+ *
+ * @param array - the array getting appended to.
+ * @param data - count values laid out back to back. (these will be copied)
+ * Must not point into array.
+ * @param count - the number of values to append.
+ */
+void dynamic_array_push_back_n(dynamic_array *array, void const *data,
+                               uint32_t count);
+
+/**
+ * Append count elements to the end of an array without initializing them,
+ * so they can be written in place (e.g. read straight from a file).
+ *
+ * @param array - the array getting appended to.
+ * @param count - the number of elements to append.
+ * @return - a pointer to the first new element. Only valid until the array
+ * next grows.
+ */
+void *dynamic_array_emplace_back_uninit(dynamic_array *array, uint32_t count);
+
+/**
+ * Insert count values before index, moving the elements after it up once.
+ *
+ * @param array - the array getting inserted into.
+ * @param index - where the first value will end up; size appends. Nothing
+ * happens if index is past the end.
+ * @param data - count values laid out back to back. (these will be copied)
+ * Must not point into array.
+ * @param count - the number of values to insert.
+ */
+void dynamic_array_insert_range(dynamic_array *array, uint32_t index,
+                                void const *data, uint32_t count);
+
+/**
+ * Set the number of elements in an array. Elements added on the end are left
+ * uninitialized; shrinking keeps the capacity (see dynamic_array_shrink).
+ *
+ * @param array - the array to resize.
+ * @param size - the new number of elements.
+ */
+void dynamic_array_resize(dynamic_array *array, uint32_t size);
+
 /**
  * Remove the last element of an array.
  *
@@ -95,6 +182,48 @@ void *dynamic_array_get_at(dynamic_array *array, uint32_t index);
  */
 void dynamic_array_remove(dynamic_array *array, uint32_t index);
 
+/**
+ * Remove an element in O(1) by moving the last element into its place. The
+ * order of the remaining elements is not kept.
+ *
+ * @param array - the array that the element will be removed from.
+ * @param index - the index that will be removed.
+ */
+void dynamic_array_swap_remove(dynamic_array *array, uint32_t index);
+
+/**
+ * Predicate function type for dynamic_array_remove_if. Takes an element and
+ * the context given to dynamic_array_remove_if.
+ */
+typedef bool (*dynamic_array_predicate_function_type)(void const *, void *);
+
+/**
+ * Remove every element predicate returns true for, in a single pass that
+ * keeps the order of the rest and moves each run of kept elements once.
+ *
+ * @param array - the array that the elements will be removed from.
+ * @param predicate - returns true for the elements to remove.
+ * @param context - passed to predicate with every element.
+ * @return - the number of elements removed.
+ */
+uint32_t
+dynamic_array_remove_if(dynamic_array *array,
+                        dynamic_array_predicate_function_type predicate,
+                        void *context);
+
+/**
+ * Remove the elements at a list of indices in a single pass that keeps the
+ * order of the rest.
+ *
+ * @param array - the array that the elements will be removed from.
+ * @param indices - the indices to remove, sorted ascending. Repeated indices
+ * and ones past the end are ignored.
+ * @param count - the number of indices.
+ * @return - the number of elements removed.
+ */
+uint32_t dynamic_array_remove_indices(dynamic_array *array,
+                                      uint32_t const *indices, uint32_t count);
+
 /**
  * Checks to see if this array is empty.
  *
@@ -111,12 +240,75 @@ bool dynamic_array_is_empty(dynamic_array const *array);
 void dynamic_array_clear(dynamic_array *array);
 
 /**
- * Resizes an array to hold only the elements it has. Makes size == capacity.
+ * Resizes an array to hold only the elements it has. Makes size == capacity,
+ * except for an array that is still in its dynamic_array_new_with_buffer
+ * buffer, which is left alone.
  *
  * @param array - the array that will be resized.
  */
 void dynamic_array_shrink(dynamic_array *array);
 
+/**
+ * Ordering function type. Takes two element pointers and returns < 0, 0 or
+ * > 0 like a qsort comparator.
+ */
+typedef int (*dynamic_array_compare_function_type)(void const *,
+                                                   void const *);
+
+/**
+ * The type of the key dynamic_array_radix_sort orders elements by.
+ */
+typedef enum {
+  dynamic_array_key_uint32,
+  dynamic_array_key_int32,
+  dynamic_array_key_float,
+  dynamic_array_key_uint64,
+  dynamic_array_key_int64,
+  dynamic_array_key_double
+} dynamic_array_key_type;
+
+/**
+ * Sorts an array in place with an introsort (quicksort that falls back to
+ * heapsort on bad pivots, and insertion sort for short ranges). Elements of
+ * 4, 8 and 16 bytes are moved with fixed size copies. Not stable.
+ *
+ * @param array - the array to sort.
+ * @param compare - the ordering of the elements.
+ */
+void dynamic_array_sort(dynamic_array *array,
+                        dynamic_array_compare_function_type compare);
+
+/**
+ * Sorts an array by a number stored in each element with a least significant
+ * digit radix sort: one pass to count all digits, then one stable scatter per
+ * byte of the key (bytes that are the same in every key are skipped). Needs
+ * a second buffer the size of the array, taken from its allocator. Stable;
+ * negative numbers sort before positive ones, and NaNs sort by their bits.
+ *
+ * @param array - the array to sort.
+ * @param key_offset - the offset of the key in each element.
+ * @param key_type - the type of the key.
+ */
+void dynamic_array_radix_sort(dynamic_array *array, uint32_t key_offset,
+                              dynamic_array_key_type key_type);
+
+/**
+ * Sorts an array on several threads: each thread introsorts a slice, then the
+ * slices are merged pairwise, with every merge split between the threads so
+ * all of them stay busy until the end. Needs a second buffer the size of the
+ * array, taken from its allocator. Not stable. Small arrays are sorted with
+ * dynamic_array_sort on the calling thread.
+ *
+ * @param array - the array to sort.
+ * @param compare - the ordering of the elements, called from many threads at
+ * once.
+ * @param thread_count - the number of threads to use (rounded down to a power
+ * of two), 0 for one per online CPU.
+ */
+void dynamic_array_parallel_sort(dynamic_array *array,
+                                 dynamic_array_compare_function_type compare,
+                                 uint32_t thread_count);
+
 /**
  * Deallocates a dynamic array entirely.
  *
@@ -0,0 +1,208 @@
+/**
+ * @file
+ * @author Ryan Rohrer <ryan.rohrer@gmail.com>
+ *
+ * @section DESCRIPTION
+ * Approximate membership filters: small structures that answer "definitely
+ * not here" or "probably here" for a key, so a miss can be turned away before
+ * paying for a lookup in a large table.
+ *
+ * bloom_filter is a blocked Bloom filter. Each key sets 8 bits, one in each
+ * 32 bit word of a single 32 byte block, so an add or a test touches one
+ * cache line and the 8 bit tests run side by side. Keys can't be removed.
+ *
+ * cuckoo_filter keeps a 16 bit fingerprint of each key in one of two buckets
+ * of 4. A test compares the fingerprint against both buckets at once, and
+ * keys can be removed again.
+ *
+ * Both take any hash_function_type, and have _hash versions of each function
+ * for callers that already hashed the key.
+ */
+#ifndef filter_h
+#define filter_h
+
+#include "fennec.h"
+#include "utilities/hash.h"
+
+/**
+ * Number of 32 bit words in a bloom_filter block, and so the number of bits
+ * set per key.
+ */
+#define BLOOM_FILTER_BLOCK_WORDS 8
+
+/**
+ * Number of fingerprints in a cuckoo_filter bucket.
+ */
+#define CUCKOO_FILTER_BUCKET_SIZE 4
+
+/**
+ * A blocked Bloom filter. blocks holds block_count blocks of
+ * BLOOM_FILTER_BLOCK_WORDS words, aligned so no block crosses a cache line.
+ */
+typedef struct {
+  uint32_t block_count;
+  uint32_t *blocks;
+  hash_function_type hash_function;
+} bloom_filter;
+
+/**
+ * A cuckoo filter. Each bucket is a uint64_t of 4 fingerprints, 0 meaning an
+ * empty spot; bucket_count is a power of two. When an add runs out of moves
+ * the fingerprint it's left holding goes in the victim spot, and the filter
+ * takes no more adds until a remove makes room.
+ */
+typedef struct {
+  uint32_t size;
+  uint32_t bucket_count;
+  uint64_t *buckets;
+  hash_function_type hash_function;
+  bool has_victim;
+  uint16_t victim_fingerprint;
+  uint32_t victim_index;
+} cuckoo_filter;
+
+/**
+ * Constructor for a new bloom_filter. Must be freed with bloom_filter_free.
+ *
+ * @param expected_count - the number of keys it will hold.
+ * @param false_positive_rate - the rate of false "probably here" answers to
+ * size for once expected_count keys are in, e.g. 0.01.
+ * @param hash_function - function that hashes keys, may be NULL if only the
+ * _hash functions are used.
+ * @return - the new, empty filter.
+ */
+bloom_filter bloom_filter_new(uint32_t expected_count,
+                              double false_positive_rate,
+                              hash_function_type hash_function);
+
+/**
+ * Adds a key to the filter.
+ *
+ * @param filter - the filter to add to.
+ * @param key - the key.
+ */
+void bloom_filter_add(bloom_filter *filter, void const *key);
+
+/**
+ * Adds an already hashed key to the filter.
+ *
+ * @param filter - the filter to add to.
+ * @param hash - the key's hash.
+ */
+void bloom_filter_add_hash(bloom_filter *filter, uint32_t hash);
+
+/**
+ * Tests for a key.
+ *
+ * @param filter - the filter to check.
+ * @param key - the key.
+ * @return - false if the key was never added, true if it probably was.
+ */
+bool bloom_filter_contains(bloom_filter const *filter, void const *key);
+
+/**
+ * Tests for an already hashed key.
+ *
+ * @param filter - the filter to check.
+ * @param hash - the key's hash.
+ * @return - false if the key was never added, true if it probably was.
+ */
+bool bloom_filter_contains_hash(bloom_filter const *filter, uint32_t hash);
+
+/**
+ * Takes every key back out of the filter.
+ *
+ * @param filter - the filter to clear.
+ */
+void bloom_filter_clear(bloom_filter *filter);
+
+/**
+ * Frees the filter's memory.
+ *
+ * @param filter - the filter to free.
+ */
+void bloom_filter_free(bloom_filter *filter);
+
+/**
+ * Constructor for a new cuckoo_filter. Must be freed with cuckoo_filter_free.
+ *
+ * @param expected_count - the number of keys it will hold. There's room for
+ * at least this many, and adds start failing somewhere past it.
+ * @param hash_function - function that hashes keys, may be NULL if only the
+ * _hash functions are used.
+ * @return - the new, empty filter.
+ */
+cuckoo_filter cuckoo_filter_new(uint32_t expected_count,
+                                hash_function_type hash_function);
+
+/**
+ * Adds a key to the filter. Adding a key twice stores it twice, and it then
+ * has to be removed twice.
+ *
+ * @param filter - the filter to add to.
+ * @param key - the key.
+ * @return - true if it was added, false if the filter is full.
+ */
+bool cuckoo_filter_add(cuckoo_filter *filter, void const *key);
+
+/**
+ * Adds an already hashed key to the filter.
+ *
+ * @param filter - the filter to add to.
+ * @param hash - the key's hash.
+ * @return - true if it was added, false if the filter is full.
+ */
+bool cuckoo_filter_add_hash(cuckoo_filter *filter, uint32_t hash);
+
+/**
+ * Tests for a key.
+ *
+ * @param filter - the filter to check.
+ * @param key - the key.
+ * @return - false if the key isn't in the filter, true if it probably is.
+ */
+bool cuckoo_filter_contains(cuckoo_filter const *filter, void const *key);
+
+/**
+ * Tests for an already hashed key.
+ *
+ * @param filter - the filter to check.
+ * @param hash - the key's hash.
+ * @return - false if the key isn't in the filter, true if it probably is.
+ */
+bool cuckoo_filter_contains_hash(cuckoo_filter const *filter, uint32_t hash);
+
+/**
+ * Removes a key from the filter. Only keys that were added may be removed,
+ * otherwise another key with the same fingerprint can go missing.
+ *
+ * @param filter - the filter to remove from.
+ * @param key - the key.
+ * @return - true if a fingerprint for the key was found and removed.
+ */
+bool cuckoo_filter_remove(cuckoo_filter *filter, void const *key);
+
+/**
+ * Removes an already hashed key from the filter.
+ *
+ * @param filter - the filter to remove from.
+ * @param hash - the key's hash.
+ * @return - true if a fingerprint for the key was found and removed.
+ */
+bool cuckoo_filter_remove_hash(cuckoo_filter *filter, uint32_t hash);
+
+/**
+ * Takes every key back out of the filter.
+ *
+ * @param filter - the filter to clear.
+ */
+void cuckoo_filter_clear(cuckoo_filter *filter);
+
+/**
+ * Frees the filter's memory.
+ *
+ * @param filter - the filter to free.
+ */
+void cuckoo_filter_free(cuckoo_filter *filter);
+
+#endif
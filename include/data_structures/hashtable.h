@@ -4,16 +4,36 @@
  *
  * @section DESCRIPTION
  * A coalescing hashtable.  Optimized for fast lookups even after collisions.
+ *
+ * A second "flat" engine is available through hashtable_new_flat.  It stores
+ * a separate array of 1 byte control tags and checks 16 of them at a time so
+ * most misses are rejected without ever touching a key.
+ *
+ * A third, Robin Hood engine (hashtable_new_robin_hood) uses linear probing
+ * and keeps every element's distance from its home slot in a byte array.
+ * Elements far from home take slots from elements close to theirs, which keeps
+ * probe lengths short and even; lookups for missing keys stop early and
+ * removes shift elements back instead of leaving tombstones, so it holds up
+ * under tables that see a lot of removes.
+ *
+ * String tables can be written to disk with hashtable_save and opened again
+ * with hashtable_open_mapped, which maps the file instead of rebuilding the
+ * table.
  */
 #ifndef hashtable_h
 #define hashtable_h
 
+#include "data_structures/filter.h"
 #include "fennec.h"
+#include "utilities/allocator.h"
+#include "utilities/hash.h"
+#include "utilities/string.h"
 
 /**
- * Hashing function type.  Takes KEY data and returns an uint32_t.
+ * Size of the key storage in each bucket of a string table. Keys up to one
+ * less than this many characters never need their own allocation.
  */
-typedef uint32_t (*hash_function_type)(void const *);
+#define HASHTABLE_INLINE_KEY_SIZE 24
 
 /**
  * Comparison function type. Takes two KEY data pointers and returns true if
@@ -27,8 +47,101 @@ typedef bool (*hash_comparison_function_type)(void const *, void const *);
  */
 typedef void *(*hash_key_copy_function_type)(void const *);
 
+/**
+ * The storage strategy used by a hashtable.
+ */
+typedef enum {
+  hashtable_engine_coalesced = 0,
+  hashtable_engine_flat,
+  hashtable_engine_mapped,
+  hashtable_engine_robin_hood
+} hashtable_engine;
+
+/**
+ * Optional behaviours that can be turned on for a hashtable.
+ *
+ * hashtable_flag_arena_keys (see hashtable_set_arena_keys) copies a string
+ * table's keys into a bump allocated arena owned by the table instead of
+ * through copy_function, so inserts never allocate a key on their own and
+ * freeing the table frees every key at once. A removed key's bytes are only
+ * given back when the table is freed or emptied, so it suits tables that are
+ * filled and then read, not ones that keep inserting and removing keys.
+ *
+ * hashtable_flag_inline_keys (see hashtable_set_inline_keys) additionally
+ * stores keys shorter than HASHTABLE_INLINE_KEY_SIZE bytes in the bucket.
+ */
+typedef enum {
+  hashtable_flag_incremental_resize = 1 << 0,
+  hashtable_flag_arena_keys = 1 << 1,
+  hashtable_flag_inline_keys = 1 << 2
+} hashtable_flags;
+
+/**
+ * The private arena long keys are copied into.
+ */
+typedef struct hashtable_key_arena hashtable_key_arena;
+
+/**
+ * Number of entries in each hashtable_statistics histogram. The last one also
+ * counts everything bigger.
+ */
+#define HASHTABLE_STATS_HISTOGRAM_SIZE 16
+
+/**
+ * Counts kept by a table with hashtable_set_counters turned on. A lookup is
+ * any hashtable_lookup, hashtable_exists, hashtable_find_or_insert or key of
+ * a batched lookup; a miss is one that didn't find its key. resizes counts
+ * every time the elements were moved to a new array (for the flat engine
+ * that includes the same sized rehashes that clear out tombstones).
+ */
+typedef struct {
+  uint64_t lookups;
+  uint64_t misses;
+  uint64_t resizes;
+} hashtable_counters;
+
+/**
+ * A snapshot of a table's shape, filled in by hashtable_stats.
+ *
+ * A home is the position a hash picks before any probing: a bucket for the
+ * coalesced engine and mapped tables, a 16 slot group for the flat engine and
+ * a slot for the Robin Hood engine. chain_lengths[n] is the number of homes
+ * that n elements hash to, so a bad hash function shows up as many empty
+ * homes and a long tail. probe_distances[n] is the number of elements that
+ * sit n probes away from their home (quadratic probe steps, groups or slots
+ * depending on the engine; the position in the bucket for mapped tables).
+ *
+ * free_slots doesn't include tombstones. bucket_bytes is every array the
+ * table allocated, key_bytes the arena holding a string table's keys (keys
+ * copied with a copy_function aren't counted since their size is unknown).
+ * counters is all zeros unless hashtable_set_counters is on.
+ */
+typedef struct {
+  uint32_t size;
+  uint32_t capacity;
+  float load_factor;
+  uint32_t free_slots;
+  uint32_t tombstones;
+  uint32_t chain_lengths[HASHTABLE_STATS_HISTOGRAM_SIZE];
+  uint32_t probe_distances[HASHTABLE_STATS_HISTOGRAM_SIZE];
+  uint64_t bucket_bytes;
+  uint64_t key_bytes;
+  hashtable_counters counters;
+} hashtable_statistics;
+
 /**
  * A hashtable (aka dictionary).
+ *
+ * Metadata is only used by the flat and Robin Hood engines, where it holds
+ * one control byte (flat) or home slot distance (Robin Hood) per slot. The
+ * old_* members are only used while an incremental resize is migrating
+ * buckets out of the previous array. When string_hash_function is set, keys
+ * are strings and are hashed with it (and the per table seed) instead of
+ * hash_function. key_arena holds the keys of a table with
+ * hashtable_flag_arena_keys. counters is NULL unless hashtable_set_counters
+ * turned them on, and filter is NULL unless hashtable_set_filter did. The
+ * bucket arrays and key arena come from allocator (NULL for libc); keys made
+ * by a copy_function, the counters and the filter always use libc.
  */
 typedef struct {
   uint32_t size;
@@ -38,6 +151,19 @@ typedef struct {
   hash_comparison_function_type comparison_function;
   hash_key_copy_function_type copy_function;
   char *data;
+  hashtable_engine engine;
+  uint32_t tombstones;
+  uint8_t *metadata;
+  uint32_t flags;
+  char *old_data;
+  uint32_t old_capacity;
+  uint32_t migrate_index;
+  uint64_t seed;
+  hash_bytes_function_type string_hash_function;
+  hashtable_key_arena *key_arena;
+  hashtable_counters *counters;
+  cuckoo_filter *filter;
+  fennec_allocator const *allocator;
 } hashtable;
 
 /**
@@ -54,13 +180,209 @@ hashtable hashtable_new(uint32_t object_size, hash_function_type hash_function,
                         hash_key_copy_function_type copy_function);
 
 /**
- * Constructor for a new hashtable that is meant to use strings as keys.
+ * Constructor for a new hashtable that gets its memory from allocator.
+ *
+ * @param object_size - the size of the object being stored in this table.
+ * @param hash_function - function that describes how to hash keys.
+ * @param comparison_function - function that tells if two keys are equal.
+ * @param copy_function - function that cany allocate new copies of keys.
+ * @param allocator - the allocator, must outlive the table. NULL uses libc,
+ * the same as hashtable_new.
+ * @return - a newly constructed hashtable.
+ */
+hashtable
+hashtable_new_with_allocator(uint32_t object_size,
+                             hash_function_type hash_function,
+                             hash_comparison_function_type comparison_function,
+                             hash_key_copy_function_type copy_function,
+                             fennec_allocator const *allocator);
+
+/**
+ * Constructor for a new hashtable with room for reserve_count elements, so
+ * they can be inserted without the table growing.
+ *
+ * @param object_size - the size of the object being stored in this table.
+ * @param reserve_count - the number of elements to make room for.
+ * @param hash_function - function that describes how to hash keys.
+ * @param comparison_function - function that tells if two keys are equal.
+ * @param copy_function - function that cany allocate new copies of keys.
+ * @return - the newly constructed and reserved hashtable.
+ */
+hashtable
+hashtable_reserved_new(uint32_t object_size, uint32_t reserve_count,
+                       hash_function_type hash_function,
+                       hash_comparison_function_type comparison_function,
+                       hash_key_copy_function_type copy_function);
+
+/**
+ * Constructor for a new hashtable that is meant to use strings as keys. Keys
+ * are hashed with hash_wyhash and a random per table seed, copied with strdup
+ * and freed when they are removed (see hashtable_set_arena_keys).
  *
  * @param object_size - the size of the object being stored in this table.
  * @return - a newly constructed hashtable.
  */
 hashtable hashtable_new_string(uint32_t object_size);
 
+/**
+ * Constructor for a new string keyed hashtable that gets its memory (keys
+ * included) from allocator. The keys are kept in an arena as described for
+ * hashtable_flag_arena_keys, since strdup can't use allocator.
+ *
+ * @param object_size - the size of the object being stored in this table.
+ * @param allocator - the allocator, must outlive the table. NULL uses libc,
+ * the same as hashtable_new_string.
+ * @return - a newly constructed hashtable.
+ */
+hashtable
+hashtable_new_string_with_allocator(uint32_t object_size,
+                                    fennec_allocator const *allocator);
+
+/**
+ * Constructor for a new hashtable that uses the flat (SIMD group probing)
+ * engine. Behaves exactly like a table from hashtable_new.
+ *
+ * @param object_size - the size of the object being stored in this table.
+ * @param hash_function - function that describes how to hash keys.
+ * @param comparison_function - function that tells if two keys are equal.
+ * @param copy_function - function that cany allocate new copies of keys.
+ * @return - a newly constructed hashtable.
+ */
+hashtable hashtable_new_flat(uint32_t object_size,
+                             hash_function_type hash_function,
+                             hash_comparison_function_type comparison_function,
+                             hash_key_copy_function_type copy_function);
+
+/**
+ * Constructor for a new flat hashtable that is meant to use strings as keys.
+ *
+ * @param object_size - the size of the object being stored in this table.
+ * @return - a newly constructed hashtable.
+ */
+hashtable hashtable_new_flat_string(uint32_t object_size);
+
+/**
+ * Constructor for a new hashtable that uses the Robin Hood engine. Behaves
+ * exactly like a table from hashtable_new.
+ *
+ * @param object_size - the size of the object being stored in this table.
+ * @param hash_function - function that describes how to hash keys.
+ * @param comparison_function - function that tells if two keys are equal.
+ * @param copy_function - function that cany allocate new copies of keys.
+ * @return - a newly constructed hashtable.
+ */
+hashtable
+hashtable_new_robin_hood(uint32_t object_size,
+                         hash_function_type hash_function,
+                         hash_comparison_function_type comparison_function,
+                         hash_key_copy_function_type copy_function);
+
+/**
+ * Constructor for a new Robin Hood hashtable that is meant to use strings as
+ * keys.
+ *
+ * @param object_size - the size of the object being stored in this table.
+ * @return - a newly constructed hashtable.
+ */
+hashtable hashtable_new_robin_hood_string(uint32_t object_size);
+
+/**
+ * Picks the byte hash and seed a string table hashes its keys with, e.g.
+ * hash_crc32c, or a fixed seed to get the same layout on every run. Only
+ * works on a string table that is still empty.
+ *
+ * @param table - a table made by hashtable_new_string or
+ * hashtable_new_flat_string.
+ * @param hash_function - the byte hash to use.
+ * @param seed - the seed passed to hash_function.
+ * @return - true if the hash was changed, false if the table isn't an empty
+ * string table.
+ */
+bool hashtable_set_string_hash(hashtable *table,
+                               hash_bytes_function_type hash_function,
+                               uint64_t seed);
+
+/**
+ * Turns arena keys (hashtable_flag_arena_keys) on or off for a string table.
+ * Turning them off also turns off inline keys. Only works on a table that is
+ * still empty.
+ *
+ * @param table - a table made by one of the string constructors.
+ * @param enabled - true to keep keys in an arena owned by the table.
+ * @return - true if the setting was changed, false if the table isn't an
+ * empty string table.
+ */
+bool hashtable_set_arena_keys(hashtable *table, bool enabled);
+
+/**
+ * Turns inline keys on or off for a string table. Inline keys save a cache
+ * miss on every successful lookup, but make every bucket (used or not)
+ * HASHTABLE_INLINE_KEY_SIZE bytes bigger, so they pay off for short keys in
+ * tables that are read much more than they are written. Longer keys go in
+ * the key arena, so turning inline keys on also turns on arena keys. Only
+ * works on a table that is still empty.
+ *
+ * @param table - a table made by one of the string constructors.
+ * @param enabled - true to store short keys in the buckets.
+ * @return - true if the setting was changed, false if the table isn't an
+ * empty string table.
+ */
+bool hashtable_set_inline_keys(hashtable *table, bool enabled);
+
+/**
+ * Picks the allocator a table gets its memory from, e.g. for a flat or Robin
+ * Hood table, which have no *_with_allocator constructors. Only works on a
+ * table that hasn't allocated anything yet (or has been emptied with
+ * hashtable_free).
+ *
+ * @param table - the table to change.
+ * @param allocator - the allocator, must outlive the table. NULL uses libc.
+ * @return - true if the allocator was changed.
+ */
+bool hashtable_set_allocator(hashtable *table,
+                             fennec_allocator const *allocator);
+
+/**
+ * Turns incremental resizing on or off. When on, growing the table allocates
+ * the bigger array but leaves the elements where they are; every insert,
+ * lookup and remove then migrates a small, bounded number of buckets until the
+ * old array is empty. This removes the latency spike of re-inserting every
+ * element at once. Only the coalesced engine resizes incrementally.
+ *
+ * Because lookups move buckets while a migration is running, don't call
+ * hashtable_lookup in the middle of a hashtable_iterate loop.
+ *
+ * @param table - the hashtable to configure.
+ * @param enabled - true to resize incrementally, false to finish any running
+ * migration and go back to resizing all at once.
+ */
+void hashtable_set_incremental_resize(hashtable *table, bool enabled);
+
+/**
+ * Turns the lookup, miss and resize counters reported by hashtable_stats on
+ * or off. They cost a branch per operation, so they're off by default.
+ * Turning them on resets them to zero.
+ *
+ * @param table - the hashtable to configure.
+ * @param enabled - true to count, false to stop counting.
+ */
+void hashtable_set_counters(hashtable *table, bool enabled);
+
+/**
+ * Turns on (or off) a cuckoo filter of the table's keys that is kept up to
+ * date by every insert and remove. Lookups, exists checks and removes for
+ * most missing keys are then answered by the filter, without touching the
+ * buckets, at the cost of 2 to 5 bytes per element and a filter update on
+ * each insert and remove. Worth it for large tables that see many misses.
+ *
+ * A key inserted more than 8 times can't be told apart in the filter, and a
+ * table holding one turns its filter back off.
+ *
+ * @param table - the hashtable to configure.
+ * @param enabled - true to keep a filter, false to drop it.
+ */
+void hashtable_set_filter(hashtable *table, bool enabled);
+
 /**
  * Insert an element into the hashtable. The element and key are copied.
  *
@@ -70,6 +392,44 @@ hashtable hashtable_new_string(uint32_t object_size);
  */
 void hashtable_insert(hashtable *table, void const *key, void const *value);
 
+/**
+ * Returns the value for key, inserting the key with a zeroed value first if it
+ * isn't in the table yet. The key is hashed and looked for once, so counting
+ * or aggregating into a table doesn't need a lookup followed by an insert. A
+ * mapped table is never inserted into and returns NULL for a missing key.
+ *
+ * @param table - the hashtable to look into.
+ * @param key - the key to look up, copied if it gets inserted.
+ * @param inserted - set to true if the key was inserted, false if it was
+ * already there.
+ * @return - the key's value, which can be written to until the table changes.
+ */
+void *hashtable_find_or_insert(hashtable *table, void const *key,
+                               bool *inserted);
+
+/**
+ * Makes room for count elements in total, so inserting up to that many
+ * doesn't grow (and rehash) the table. Never shrinks it, and never grows it
+ * past 2^31 slots however big count is.
+ *
+ * @param table - the hashtable to grow.
+ * @param count - the number of elements to make room for.
+ */
+void hashtable_reserve(hashtable *table, uint32_t count);
+
+/**
+ * Insert many elements at once. The table is grown at most once, and every key
+ * in a batch is hashed and has its bucket prefetched before any of them are
+ * inserted.
+ *
+ * @param table - the hashtable that the elements are being inserted into.
+ * @param keys - an array of count keys.
+ * @param values - count values laid out back to back (object_size apart).
+ * @param count - the number of elements to insert.
+ */
+void hashtable_insert_batch(hashtable *table, void const *const *keys,
+                            void const *values, uint32_t count);
+
 /**
  * Remove an element from the hashtable.
  *
@@ -97,6 +457,88 @@ bool hashtable_exists(hashtable const *table, void const *key);
  */
 void *hashtable_lookup(hashtable *table, void const *key);
 
+/**
+ * Looks up a string key given as length bytes instead of a NUL terminated
+ * string, e.g. a token in the middle of a larger buffer, without copying it.
+ * The bytes are hashed and compared the same way as the NUL terminated key
+ * would be.
+ *
+ * Only works on tables keyed by strings (hashtable_new_string, its flat and
+ * Robin Hood versions and tables opened with hashtable_open_mapped); finds
+ * nothing in any other table.
+ *
+ * @param table - the hashtable to look into.
+ * @param key - the first byte of the key.
+ * @param length - the number of bytes in the key.
+ * @return - the item, if found or NULL if not.
+ */
+void *hashtable_lookup_bytes(hashtable *table, char const *key,
+                             uint32_t length);
+
+/**
+ * hashtable_exists for a key given as length bytes. See
+ * hashtable_lookup_bytes.
+ *
+ * @param table - the hashtable to check.
+ * @param key - the first byte of the key.
+ * @param length - the number of bytes in the key.
+ * @return - true if the item exists in the table.
+ */
+bool hashtable_exists_bytes(hashtable const *table, char const *key,
+                            uint32_t length);
+
+/**
+ * hashtable_remove for a key given as length bytes. See
+ * hashtable_lookup_bytes.
+ *
+ * @param table - the hashtable to remove the item from.
+ * @param key - the first byte of the key.
+ * @param length - the number of bytes in the key.
+ */
+void hashtable_remove_bytes(hashtable *table, char const *key,
+                            uint32_t length);
+
+/**
+ * Looks up the characters a string_range covers (such as the result of
+ * string_trim) as a key. See hashtable_lookup_bytes.
+ *
+ * @param table - the hashtable to look into.
+ * @param range - the key.
+ * @return - the item, if found or NULL if not.
+ */
+void *hashtable_lookup_range(hashtable *table, string_range const *range);
+
+/**
+ * hashtable_exists for the characters a string_range covers.
+ *
+ * @param table - the hashtable to check.
+ * @param range - the key.
+ * @return - true if the item exists in the table.
+ */
+bool hashtable_exists_range(hashtable const *table,
+                            string_range const *range);
+
+/**
+ * hashtable_remove for the characters a string_range covers.
+ *
+ * @param table - the hashtable to remove the item from.
+ * @param range - the key.
+ */
+void hashtable_remove_range(hashtable *table, string_range const *range);
+
+/**
+ * Looks up many keys at once. Keys are hashed and their buckets prefetched a
+ * batch at a time so the memory accesses overlap.
+ *
+ * @param table - the hashtable to look into.
+ * @param keys - an array of count keys.
+ * @param count - the number of keys to look up.
+ * @param values - output array of count pointers; each is set to the item for
+ * that key or NULL if it doesn't exist.
+ */
+void hashtable_lookup_batch(hashtable *table, void const *const *keys,
+                            uint32_t count, void **values);
+
 /**
  * Returns the next node in the hashtable (memory layout wise). NULL when there
  * are no more.
@@ -108,6 +550,62 @@ void *hashtable_lookup(hashtable *table, void const *key);
  */
 void *hashtable_iterate(hashtable *table, void *last_position);
 
+/**
+ * Returns the key of an element returned by hashtable_iterate.
+ *
+ * @param table - the hashtable being iterated over.
+ * @param position - a value returned by hashtable_iterate.
+ * @return - the table's copy of that element's key.
+ */
+void const *hashtable_key_at(hashtable const *table, void const *position);
+
+/**
+ * Returns the most probes a successful lookup in the table currently takes:
+ * slots for the Robin Hood engine, chain links for the coalesced engine, 16
+ * slot groups for the flat engine and entries for a mapped table. Walks the
+ * whole table, so it's meant for tests and tuning rather than hot paths.
+ *
+ * @param table - the hashtable to measure.
+ * @return - the longest probe sequence, 0 for an empty table.
+ */
+uint32_t hashtable_max_probe_length(hashtable const *table);
+
+/**
+ * Fills in stats with the current shape of the table. Walks the whole table,
+ * so it's meant for diagnostics rather than hot paths.
+ *
+ * @param table - the hashtable to inspect.
+ * @param stats - where to write the statistics.
+ */
+void hashtable_stats(hashtable const *table, hashtable_statistics *stats);
+
+/**
+ * Writes a string table to a file that hashtable_open_mapped can open. The
+ * file holds offsets rather than pointers, so it can be mapped anywhere, and
+ * is only readable on machines with the same endianness and type sizes.
+ *
+ * @param table - a table made by hashtable_new_string or
+ * hashtable_new_flat_string that hashes with hash_wyhash or hash_crc32c.
+ * @param path - where to write the table, an existing file is replaced.
+ * @return - true if the table was written.
+ */
+bool hashtable_save(hashtable *table, string const *path);
+
+/**
+ * Opens a file written by hashtable_save by mapping it instead of rebuilding
+ * the table, and processes that open the same file share its memory. Opening
+ * reads the bucket starts and entries once to check that a truncated or
+ * corrupt file can't make lookups read outside it; such a file isn't opened.
+ * The table is read only: lookups, hashtable_exists and iteration work,
+ * inserts, removes and shrinks do nothing, and the values returned must not
+ * be written to. Must be freed with hashtable_free.
+ *
+ * @param path - the file to open.
+ * @return - the mapped table, its data member is NULL if the file couldn't be
+ * opened or isn't a saved table.
+ */
+hashtable hashtable_open_mapped(string const *path);
+
 /**
  * Shrinks the hashtable to slightly under it's optimum load_factor.
  *
@@ -0,0 +1,152 @@
+/**
+ * @file
+ * @author Ryan Rohrer <ryan.rohrer@gmail.com>
+ *
+ * @section DESCRIPTION
+ * Dynamic array with 64 bit sizes for arrays past what a dynamic_array can
+ * index (4G elements). Small arrays live in malloc'd memory like any other;
+ * once an array needs LARGE_ARRAY_MAP_THRESHOLD bytes it is moved to its own
+ * anonymous mmap, which then grows and shrinks with mremap, so the kernel
+ * moves page table entries rather than the array's bytes being copied, and
+ * shrinking hands the pages at the end straight back. Where mremap isn't
+ * available a new mapping is made and the elements copied.
+ *
+ * With large_array_flag_huge_pages mappings are rounded to 2 MiB and marked
+ * with madvise(MADV_HUGEPAGE), which lets the kernel back them with
+ * transparent huge pages (fewer TLB misses on random access) when it is set
+ * to "madvise" or "always".
+ */
+#ifndef large_array_h
+#define large_array_h
+
+#include "fennec.h"
+
+/**
+ * Arrays this many bytes or bigger get their own mapping.
+ */
+#define LARGE_ARRAY_MAP_THRESHOLD (1024 * 1024)
+
+/**
+ * The size mappings are rounded to with large_array_flag_huge_pages.
+ */
+#define LARGE_ARRAY_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * Optional behaviours of a large_array.
+ */
+typedef enum { large_array_flag_huge_pages = 1 << 0 } large_array_flags;
+
+/**
+ * A large array. reserved_bytes is the size of the allocation or mapping
+ * data points to, and mapped tells which of the two it is.
+ */
+typedef struct {
+  uint64_t size;
+  uint64_t capacity;
+  uint64_t object_size;
+  uint64_t reserved_bytes;
+  uint32_t flags;
+  bool mapped;
+  char *data;
+} large_array;
+
+/**
+ * Constructor for a new large_array.
+ *
+ * @param object_size - the sizeof() the data that will be stored in this array.
+ * @param flags - large_array_flags, or 0.
+ * @return - a newly constructed and empty array.
+ */
+large_array large_array_new(uint64_t object_size, uint32_t flags);
+
+/**
+ * Make room for reserve_count elements.
+ *
+ * @param array - the array to reserve space in.
+ * @param reserve_count - the number of elements.
+ */
+void large_array_reserve(large_array *array, uint64_t reserve_count);
+
+/**
+ * Copy an object to the back of the array.
+ *
+ * @param array - the array to add to.
+ * @param data - the object, object_size bytes.
+ */
+void large_array_push_back(large_array *array, void const *data);
+
+/**
+ * Copy count contiguous objects to the back of the array.
+ *
+ * @param array - the array to add to.
+ * @param data - the objects, count * object_size bytes.
+ * @param count - the number of objects.
+ */
+void large_array_push_back_n(large_array *array, void const *data,
+                             uint64_t count);
+
+/**
+ * Grow the array by count elements without initializing them.
+ *
+ * @param array - the array to grow.
+ * @param count - the number of elements to add.
+ * @return - a pointer to the first new element, for the caller to fill in.
+ */
+void *large_array_emplace_back_uninit(large_array *array, uint64_t count);
+
+/**
+ * Set the number of elements. New elements are uninitialized.
+ *
+ * @param array - the array to resize.
+ * @param size - the new number of elements.
+ */
+void large_array_resize(large_array *array, uint64_t size);
+
+/**
+ * Remove the last element of the array, if it has any.
+ *
+ * @param array - the array to remove from.
+ */
+void large_array_pop_back(large_array *array);
+
+/**
+ * Get an element of the array.
+ *
+ * @param array - the array.
+ * @param index - the index of the element.
+ * @return - a pointer to the element, NULL if index is out of range.
+ */
+void *large_array_get_at(large_array const *array, uint64_t index);
+
+/**
+ * Get the last element of the array.
+ *
+ * @param array - the array.
+ * @return - a pointer to the last element, NULL if the array is empty.
+ */
+void *large_array_get_back(large_array const *array);
+
+/**
+ * Clears the array without giving back its memory.
+ *
+ * @param array - the array to clear.
+ */
+void large_array_clear(large_array *array);
+
+/**
+ * Give back the memory past the array's last element: a mapping is cut down
+ * to the pages the elements need (moved back to malloc when that is under
+ * LARGE_ARRAY_MAP_THRESHOLD), an empty array frees everything.
+ *
+ * @param array - the array to shrink.
+ */
+void large_array_shrink(large_array *array);
+
+/**
+ * Deallocates a large array entirely.
+ *
+ * @param array - the array that is being deallocated.
+ */
+void large_array_free(large_array *array);
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * @file
+ * @author Ryan Rohrer <ryan.rohrer@gmail.com>
+ *
+ * @section DESCRIPTION
+ * A frozen string keyed table built around a minimal perfect hash (PTHash
+ * style: keys are split into small buckets and each bucket gets a "pilot"
+ * that sends its keys to free positions). A lookup hashes the key, reads one
+ * pilot and then compares against exactly one stored key. Keys and values
+ * are packed back to back with no empty slots.
+ *
+ * Once built the table can't be changed.
+ */
+#ifndef perfect_hashtable_h
+#define perfect_hashtable_h
+
+#include "data_structures/hashtable.h"
+#include "fennec.h"
+
+/**
+ * A read only table with one position per key.
+ *
+ * table_size is the number of positions the pilots hash into, slightly more
+ * than size so the search for pilots stays quick; the positions past size are
+ * sent back to the unused ones below it through remap. The element at
+ * position i starts at entries + entry_offsets[i]: its value (padded to 8
+ * bytes) followed by its key, so a hit reads the key and value from the same
+ * cache line.
+ */
+typedef struct {
+  uint32_t size;
+  uint32_t object_size;
+  uint32_t bucket_count;
+  uint32_t table_size;
+  uint64_t seed;
+  uint32_t *pilots;
+  uint32_t *remap;
+  uint32_t *entry_offsets;
+  char *entries;
+} perfect_hashtable;
+
+/**
+ * Builds a perfect_hashtable from arrays of keys and values. Both are copied.
+ * If a key is repeated only its first value is kept. Must be freed with
+ * perfect_hashtable_free.
+ *
+ * @param keys - count NUL terminated strings.
+ * @param values - count values laid out back to back (object_size apart).
+ * @param count - the number of keys.
+ * @param object_size - the size of each value.
+ * @return - the new table.
+ */
+perfect_hashtable perfect_hashtable_new(char const *const *keys,
+                                        void const *values, uint32_t count,
+                                        uint32_t object_size);
+
+/**
+ * Builds a perfect_hashtable holding the same elements as a string table.
+ * The hashtable is left as it was.
+ *
+ * @param table - a table made by hashtable_new_string or
+ * hashtable_new_flat_string (or opened with hashtable_open_mapped).
+ * @return - the new table, empty if table isn't keyed by strings.
+ */
+perfect_hashtable perfect_hashtable_from_hashtable(hashtable *table);
+
+/**
+ * Returns the value for key, or NULL if it isn't in the table.
+ *
+ * @param table - the table to look into.
+ * @param key - the string to look up.
+ * @return - the value, if found or NULL if not.
+ */
+void *perfect_hashtable_lookup(perfect_hashtable const *table,
+                               char const *key);
+
+/**
+ * Lookup to see if this key exists in the table.
+ *
+ * @param table - the table to check.
+ * @param key - the string to look for.
+ * @return - true if the key is in the table.
+ */
+bool perfect_hashtable_exists(perfect_hashtable const *table, char const *key);
+
+/**
+ * Deallocates everything owned by the table.
+ *
+ * @param table - the table that's being cleaned up.
+ */
+void perfect_hashtable_free(perfect_hashtable *table);
+
+#endif
@@ -0,0 +1,161 @@
+/**
+ * @file
+ * @author Ryan Rohrer <ryan.rohrer@gmail.com>
+ *
+ * @section DESCRIPTION
+ * Array made of equally sized chunks whose length is a power of two. Growing
+ * it only allocates another chunk, so elements are never copied and pointers
+ * to them stay valid until they are popped or the array is freed. Element i is
+ * in chunk i >> chunk_shift at position i & (chunk length - 1).
+ *
+ * Loops over every element should go chunk by chunk with
+ * segmented_array_get_chunk, which hands out contiguous runs the compiler can
+ * vectorize, rather than calling segmented_array_get_at for each one.
+ */
+#ifndef segmented_array_h
+#define segmented_array_h
+
+#include "data_structures/dynamic_array.h"
+#include "fennec.h"
+#include "utilities/allocator.h"
+
+/**
+ * The size in bytes chunks get when no chunk length is asked for. The chunk
+ * length is the largest power of two that fits (at least one element).
+ */
+#define SEGMENTED_ARRAY_DEFAULT_CHUNK_BYTES (64 * 1024)
+
+/**
+ * A segmented array. chunks is a dynamic_array of pointers to the chunks,
+ * each holding 1 << chunk_shift elements; the chunks past the one holding the
+ * last element are reserved capacity.
+ */
+typedef struct {
+  uint32_t size;
+  uint32_t object_size;
+  uint32_t chunk_shift;
+  dynamic_array chunks;
+  fennec_allocator const *allocator;
+} segmented_array;
+
+/**
+ * Constructor for a new segmented_array.
+ *
+ * @param object_size - the sizeof() the data that will be stored in this array.
+ * @param chunk_length - the number of elements in each chunk, rounded up to a
+ * power of two. 0 picks one to fit SEGMENTED_ARRAY_DEFAULT_CHUNK_BYTES.
+ * @return - a newly constructed and empty array.
+ */
+segmented_array segmented_array_new(uint32_t object_size,
+                                    uint32_t chunk_length);
+
+/**
+ * Constructor for a new segmented_array that gets its chunks (and the table
+ * pointing to them) from allocator.
+ *
+ * @param object_size - the sizeof() the data that will be stored in this array.
+ * @param chunk_length - the number of elements in each chunk, as for
+ * segmented_array_new.
+ * @param allocator - the allocator, must outlive the array. NULL uses libc.
+ * @return - a newly constructed and empty array.
+ */
+segmented_array
+segmented_array_new_with_allocator(uint32_t object_size, uint32_t chunk_length,
+                                   fennec_allocator const *allocator);
+
+/**
+ * Allocate chunks until the array can hold reserve_count elements.
+ *
+ * @param array - the array to reserve space in.
+ * @param reserve_count - the number of elements to make room for.
+ */
+void segmented_array_reserve(segmented_array *array, uint32_t reserve_count);
+
+/**
+ * Copy an object to the back of the array.
+ *
+ * @param array - the array to add to.
+ * @param data - the object, object_size bytes.
+ * @return - where the object was copied to, valid until it is popped or the
+ * array is freed.
+ */
+void *segmented_array_push_back(segmented_array *array, void const *data);
+
+/**
+ * Copy count contiguous objects to the back of the array, a chunk at a time.
+ *
+ * @param array - the array to add to.
+ * @param data - the objects, count * object_size bytes.
+ * @param count - the number of objects.
+ */
+void segmented_array_push_back_n(segmented_array *array, void const *data,
+                                 uint32_t count);
+
+/**
+ * Remove the last element of the array, if it has any. Its chunk is kept.
+ *
+ * @param array - the array to remove from.
+ */
+void segmented_array_pop_back(segmented_array *array);
+
+/**
+ * Get an element of the array.
+ *
+ * @param array - the array.
+ * @param index - the index of the element, less than the array's size.
+ * @return - a pointer to the element.
+ */
+void *segmented_array_get_at(segmented_array const *array, uint32_t index);
+
+/**
+ * Get the last element of the array.
+ *
+ * @param array - the array.
+ * @return - a pointer to the last element, NULL if the array is empty.
+ */
+void *segmented_array_get_back(segmented_array const *array);
+
+/**
+ * The number of chunks that hold elements.
+ *
+ * @param array - the array.
+ * @return - the number of chunks to pass to segmented_array_get_chunk.
+ */
+uint32_t segmented_array_chunk_count(segmented_array const *array);
+
+/**
+ * Get a chunk of the array, for iterating over it chunk by chunk.
+ *
+ * @param array - the array.
+ * @param chunk - the index of the chunk, less than
+ * segmented_array_chunk_count.
+ * @param count - set to the number of elements in the chunk (the chunk length,
+ * except for the last one).
+ * @return - a pointer to the chunk's first element, the chunk's elements
+ * follow it contiguously.
+ */
+void *segmented_array_get_chunk(segmented_array const *array, uint32_t chunk,
+                                uint32_t *count);
+
+/**
+ * Clears the array, keeping its chunks for the elements that follow.
+ *
+ * @param array - the array to clear.
+ */
+void segmented_array_clear(segmented_array *array);
+
+/**
+ * Deallocates the chunks that hold no elements.
+ *
+ * @param array - the array to shrink.
+ */
+void segmented_array_shrink(segmented_array *array);
+
+/**
+ * Deallocates a segmented array entirely.
+ *
+ * @param array - the array that is being deallocated.
+ */
+void segmented_array_free(segmented_array *array);
+
+#endif
@@ -0,0 +1,174 @@
+/**
+ * @file
+ * @author Ryan Rohrer <ryan.rohrer@gmail.com>
+ *
+ * @section DESCRIPTION
+ * Dynamic arrays specialized at compile time for one element type.
+ *
+ * FENNEC_DEFINE_ARRAY(name, T) defines an array type called name and static
+ * inline functions name_new, name_push_back, name_get_at and so on that
+ * mirror the dynamic_array API, but with T instead of void pointers and
+ * sizeof(T) instead of object_size, so loops over the elements can be
+ * inlined and vectorized. name_begin and name_end give the range of elements
+ * for loops that walk the whole array.
+ *
+ * The array has the same layout as a dynamic_array (data is a T * instead of
+ * a char *), and name_from_dynamic_array and name_to_dynamic_array convert
+ * between the two without copying. Growing goes through dynamic_array so
+ * both grow the same way (and use the same allocator, see
+ * name_new_with_allocator).
+ */
+#ifndef typed_array_h
+#define typed_array_h
+
+#include "data_structures/dynamic_array.h"
+#include "fennec.h"
+
+/**
+ * Defines an array of T. See the file description.
+ */
+#define FENNEC_DEFINE_ARRAY(name, T)                                           \
+typedef struct {                                                               \
+  uint32_t size;                                                               \
+  uint32_t capacity;                                                           \
+  uint32_t object_size;                                                        \
+  uint32_t flags;                                                              \
+  T *data;                                                                     \
+  fennec_allocator const *allocator;                                           \
+} name;                                                                        \
+                                                                               \
+static inline name name##_from_dynamic_array(dynamic_array array) {            \
+  name result = {array.size, array.capacity, array.object_size, array.flags,   \
+                 (T *)(void *)array.data, array.allocator};                    \
+  return result;                                                               \
+}                                                                              \
+                                                                               \
+static inline dynamic_array name##_to_dynamic_array(name array) {              \
+  dynamic_array result = {array.size, array.capacity, array.object_size,       \
+                          array.flags, (char *)array.data, array.allocator};   \
+  return result;                                                               \
+}                                                                              \
+                                                                               \
+static inline name name##_new(void) {                                          \
+  return name##_from_dynamic_array(dynamic_array_new(sizeof(T)));              \
+}                                                                              \
+                                                                               \
+static inline name                                                             \
+name##_new_with_allocator(fennec_allocator const *allocator) {                 \
+  return name##_from_dynamic_array(                                            \
+      dynamic_array_new_with_allocator(sizeof(T), allocator));                 \
+}                                                                              \
+                                                                               \
+static inline name name##_new_with_buffer(T *buffer, uint32_t capacity) {      \
+  return name##_from_dynamic_array(                                            \
+      dynamic_array_new_with_buffer(sizeof(T), buffer, capacity));             \
+}                                                                              \
+                                                                               \
+static inline name name##_reserved_new(uint32_t reserve_count) {               \
+  return name##_from_dynamic_array(                                            \
+      dynamic_array_reserved_new(sizeof(T), reserve_count));                   \
+}                                                                              \
+                                                                               \
+static inline void name##_reserve(name *array, uint32_t reserve_count) {       \
+  dynamic_array generic = name##_to_dynamic_array(*array);                     \
+  dynamic_array_reserve(&generic, reserve_count);                              \
+  *array = name##_from_dynamic_array(generic);                                 \
+}                                                                              \
+                                                                               \
+static inline void name##_push_back(name *array, T value) {                    \
+  if (array->size < array->capacity) {                                         \
+    array->data[array->size++] = value;                                        \
+    return;                                                                    \
+  }                                                                            \
+                                                                               \
+  dynamic_array generic = name##_to_dynamic_array(*array);                     \
+  dynamic_array_push_back(&generic, &value);                                   \
+  *array = name##_from_dynamic_array(generic);                                 \
+}                                                                              \
+                                                                               \
+static inline void name##_push_back_n(name *array, T const *values,            \
+                                      uint32_t count) {                        \
+  dynamic_array generic = name##_to_dynamic_array(*array);                     \
+  dynamic_array_push_back_n(&generic, values, count);                          \
+  *array = name##_from_dynamic_array(generic);                                 \
+}                                                                              \
+                                                                               \
+static inline void name##_pop_back(name *array) {                              \
+  if (array->size > 0) {                                                       \
+    array->size -= 1;                                                          \
+  }                                                                            \
+}                                                                              \
+                                                                               \
+static inline T *name##_get_at(name const *array, uint32_t index) {            \
+  return index < array->size ? &array->data[index] : NULL;                     \
+}                                                                              \
+                                                                               \
+static inline T *name##_get_front(name const *array) {                         \
+  return name##_get_at(array, 0);                                              \
+}                                                                              \
+                                                                               \
+static inline T *name##_get_back(name const *array) {                          \
+  return array->size > 0 ? &array->data[array->size - 1] : NULL;               \
+}                                                                              \
+                                                                               \
+static inline T *name##_begin(name const *array) { return array->data; }       \
+                                                                               \
+static inline T *name##_end(name const *array) {                               \
+  return array->data + array->size;                                            \
+}                                                                              \
+                                                                               \
+static inline void name##_remove(name *array, uint32_t index) {                \
+  dynamic_array generic = name##_to_dynamic_array(*array);                     \
+  dynamic_array_remove(&generic, index);                                       \
+  *array = name##_from_dynamic_array(generic);                                 \
+}                                                                              \
+                                                                               \
+static inline void name##_swap_remove(name *array, uint32_t index) {           \
+  if (index < array->size) {                                                   \
+    array->size -= 1;                                                          \
+    array->data[index] = array->data[array->size];                             \
+  }                                                                            \
+}                                                                              \
+                                                                               \
+static inline uint32_t name##_remove_if(name *array,                           \
+                                        bool (*predicate)(T const *, void *),  \
+                                        void *context) {                       \
+  uint32_t kept = 0;                                                           \
+  for (uint32_t i = 0; i < array->size; ++i) {                                 \
+    if (!predicate(&array->data[i], context)) {                                \
+      array->data[kept++] = array->data[i];                                    \
+    }                                                                          \
+  }                                                                            \
+  uint32_t removed = array->size - kept;                                       \
+  array->size = kept;                                                          \
+  return removed;                                                              \
+}                                                                              \
+                                                                               \
+static inline uint32_t name##_remove_indices(name *array,                      \
+                                             uint32_t const *indices,          \
+                                             uint32_t count) {                 \
+  dynamic_array generic = name##_to_dynamic_array(*array);                     \
+  uint32_t removed = dynamic_array_remove_indices(&generic, indices, count);   \
+  *array = name##_from_dynamic_array(generic);                                 \
+  return removed;                                                              \
+}                                                                              \
+                                                                               \
+static inline bool name##_is_empty(name const *array) {                        \
+  return array->size == 0;                                                     \
+}                                                                              \
+                                                                               \
+static inline void name##_clear(name *array) { array->size = 0; }              \
+                                                                               \
+static inline void name##_shrink(name *array) {                                \
+  dynamic_array generic = name##_to_dynamic_array(*array);                     \
+  dynamic_array_shrink(&generic);                                              \
+  *array = name##_from_dynamic_array(generic);                                 \
+}                                                                              \
+                                                                               \
+static inline void name##_free(name *array) {                                  \
+  dynamic_array generic = name##_to_dynamic_array(*array);                     \
+  dynamic_array_free(&generic);                                                \
+  *array = name##_new_with_allocator(array->allocator);                        \
+}
+
+#endif
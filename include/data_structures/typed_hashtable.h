@@ -0,0 +1,308 @@
+/**
+ * @file
+ * @author Ryan Rohrer <ryan.rohrer@gmail.com>
+ *
+ * @section DESCRIPTION
+ * Hashtables specialized at compile time for one key and value type.
+ *
+ * FENNEC_DEFINE_HASHTABLE(name, K, V, hash, eq) defines a table type called
+ * name and static inline functions name_new, name_insert, name_lookup and so
+ * on that mirror the hashtable API. hash is called as hash(key) and returns a
+ * uint32_t, eq as eq(key1, key2) and returns true for equal keys; both can be
+ * functions or macros and are inlined, and buckets are plain structs, so
+ * nothing goes through a function pointer or an object_size multiply.
+ *
+ * Like a hashtable, inserting a key that is already there adds a second
+ * element, and keys are copied into the table. FENNEC_DEFINE_HASHTABLE keeps
+ * keys by value; FENNEC_DEFINE_HASHTABLE_WITH_KEYS also takes copy(key) and
+ * release(key) to deep copy keys such as strings, and
+ * FENNEC_DEFINE_STRING_HASHTABLE(name, V) sets that up for char const * keys.
+ *
+ * The tables use Robin Hood linear probing with backward shift removal, the
+ * same scheme as hashtable_new_robin_hood, with the displacement stored in
+ * the bucket.
+ */
+#ifndef typed_hashtable_h
+#define typed_hashtable_h
+
+#include "fennec.h"
+#include "utilities/hash.h"
+#include <stddef.h>
+
+#define FENNEC_HASHTABLE_INITIAL_CAPACITY 16
+/* The largest power of two capacity; reserving past it stops here. */
+#define FENNEC_HASHTABLE_MAX_CAPACITY (1u << 31)
+
+/**
+ * Key helpers for FENNEC_DEFINE_STRING_HASHTABLE. The hash is wyhash with a
+ * fixed seed.
+ */
+static inline uint32_t fennec_hashtable_string_hash(char const *key) {
+  uint64_t hash = hash_wyhash(key, (uint32_t)strlen(key), 0);
+  return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static inline bool fennec_hashtable_string_eq(char const *key1,
+                                              char const *key2) {
+  return strcmp(key1, key2) == 0;
+}
+
+static inline char const *fennec_hashtable_string_copy(char const *key) {
+  size_t size = strlen(key) + 1;
+  char *copy = (char *)malloc(size);
+  memcpy(copy, key, size);
+  return copy;
+}
+
+static inline void fennec_hashtable_string_release(char const *key) {
+  free((void *)key);
+}
+
+/**
+ * Copy and release for keys kept by value.
+ */
+#define FENNEC_HASHTABLE_KEY_BY_VALUE(key) (key)
+#define FENNEC_HASHTABLE_KEY_NO_RELEASE(key) ((void)(key))
+
+/**
+ * Defines a hashtable that stores keys by value. See the file description.
+ */
+#define FENNEC_DEFINE_HASHTABLE(name, K, V, hash, eq)                          \
+  FENNEC_DEFINE_HASHTABLE_WITH_KEYS(name, K, V, hash, eq,                      \
+                                    FENNEC_HASHTABLE_KEY_BY_VALUE,             \
+                                    FENNEC_HASHTABLE_KEY_NO_RELEASE)
+
+/**
+ * Defines a hashtable keyed by NUL terminated strings, which are copied in.
+ */
+#define FENNEC_DEFINE_STRING_HASHTABLE(name, V)                                \
+  FENNEC_DEFINE_HASHTABLE_WITH_KEYS(name, char const *, V,                     \
+                                    fennec_hashtable_string_hash,              \
+                                    fennec_hashtable_string_eq,                \
+                                    fennec_hashtable_string_copy,              \
+                                    fennec_hashtable_string_release)
+
+/**
+ * Defines a hashtable whose keys are copied in with copy(key) and let go of
+ * with release(key).
+ *
+ * A bucket's distance is 0 when it's empty, otherwise 1 + how far it is from
+ * the bucket its hash picks.
+ */
+#define FENNEC_DEFINE_HASHTABLE_WITH_KEYS(name, K, V, hash, eq, copy, release) \
+typedef struct {                                                               \
+  K key;                                                                       \
+  V value;                                                                     \
+  uint32_t key_hash;                                                           \
+  uint32_t distance;                                                           \
+} name##_bucket;                                                               \
+                                                                               \
+typedef struct {                                                               \
+  uint32_t size;                                                               \
+  uint32_t capacity;                                                           \
+  name##_bucket *buckets;                                                      \
+} name;                                                                        \
+                                                                               \
+static inline name name##_new(void) {                                          \
+  name table = {0, FENNEC_HASHTABLE_INITIAL_CAPACITY, NULL};                   \
+  return table;                                                                \
+}                                                                              \
+                                                                               \
+/* Puts entry in its place and returns where its value ended up. */            \
+static inline V *name##_place(name *table, name##_bucket entry) {              \
+  uint32_t mask = table->capacity - 1;                                         \
+  uint32_t index = entry.key_hash & mask;                                      \
+  V *result = NULL;                                                            \
+                                                                               \
+  for (entry.distance = 1;; ++entry.distance) {                                \
+    name##_bucket *bucket = &table->buckets[index];                            \
+    if (bucket->distance == 0) {                                               \
+      *bucket = entry;                                                         \
+      return result != NULL ? result : &bucket->value;                         \
+    }                                                                          \
+                                                                               \
+    if (bucket->distance < entry.distance) {                                   \
+      name##_bucket displaced = *bucket;                                       \
+      *bucket = entry;                                                         \
+      entry = displaced;                                                       \
+      if (result == NULL) {                                                    \
+        result = &bucket->value;                                               \
+      }                                                                        \
+    }                                                                          \
+                                                                               \
+    index = (index + 1) & mask;                                                \
+  }                                                                            \
+}                                                                              \
+                                                                               \
+static inline void name##_rehash(name *table, uint32_t new_capacity) {         \
+  name##_bucket *old_buckets = table->buckets;                                 \
+  uint32_t old_capacity = table->capacity;                                     \
+                                                                               \
+  table->buckets =                                                             \
+      (name##_bucket *)calloc(new_capacity, sizeof(name##_bucket));            \
+  table->capacity = new_capacity;                                              \
+                                                                               \
+  if (old_buckets == NULL) {                                                   \
+    return;                                                                    \
+  }                                                                            \
+                                                                               \
+  for (uint32_t i = 0; i < old_capacity; ++i) {                                \
+    if (old_buckets[i].distance != 0) {                                        \
+      name##_place(table, old_buckets[i]);                                     \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  free(old_buckets);                                                           \
+}                                                                              \
+                                                                               \
+static inline uint32_t name##_max_load(uint32_t capacity) {                    \
+  return capacity - capacity / 8;                                              \
+}                                                                              \
+                                                                               \
+static inline void name##_reserve(name *table, uint32_t count) {               \
+  uint32_t new_capacity = table->capacity;                                     \
+  while (new_capacity < FENNEC_HASHTABLE_MAX_CAPACITY &&                       \
+         name##_max_load(new_capacity) <= count) {                             \
+    new_capacity = new_capacity << 1;                                          \
+  }                                                                            \
+                                                                               \
+  if (table->buckets == NULL || new_capacity != table->capacity) {             \
+    name##_rehash(table, new_capacity);                                        \
+  }                                                                            \
+}                                                                              \
+                                                                               \
+static inline V *name##_insert_hashed(name *table, K key,                      \
+                                     uint32_t key_hash) {                      \
+  if (table->buckets == NULL) {                                                \
+    name##_rehash(table, table->capacity);                                     \
+  } else if (table->size >= name##_max_load(table->capacity)) {                \
+    name##_rehash(table, table->capacity << 1);                                \
+  }                                                                            \
+                                                                               \
+  name##_bucket entry;                                                         \
+  memset(&entry, 0, sizeof(entry));                                            \
+  entry.key = copy(key);                                                       \
+  entry.key_hash = key_hash;                                                   \
+  table->size += 1;                                                            \
+  return name##_place(table, entry);                                           \
+}                                                                              \
+                                                                               \
+static inline void name##_insert(name *table, K key, V value) {                \
+  *name##_insert_hashed(table, key, hash_mix32(hash(key))) = value;            \
+}                                                                              \
+                                                                               \
+static inline name##_bucket *name##_find(name const *table, K key,             \
+                                         uint32_t key_hash) {                  \
+  if (table->buckets == NULL) {                                                \
+    return NULL;                                                               \
+  }                                                                            \
+                                                                               \
+  uint32_t mask = table->capacity - 1;                                         \
+  uint32_t index = key_hash & mask;                                            \
+                                                                               \
+  for (uint32_t distance = 1;; ++distance) {                                   \
+    name##_bucket *bucket = &table->buckets[index];                            \
+    if (bucket->distance < distance) {                                         \
+      return NULL;                                                             \
+    }                                                                          \
+    if (bucket->key_hash == key_hash && eq(bucket->key, key)) {                \
+      return bucket;                                                           \
+    }                                                                          \
+    index = (index + 1) & mask;                                                \
+  }                                                                            \
+}                                                                              \
+                                                                               \
+static inline V *name##_lookup(name const *table, K key) {                     \
+  name##_bucket *bucket = name##_find(table, key, hash_mix32(hash(key)));      \
+  return bucket != NULL ? &bucket->value : NULL;                               \
+}                                                                              \
+                                                                               \
+static inline bool name##_exists(name const *table, K key) {                   \
+  return name##_lookup(table, key) != NULL;                                    \
+}                                                                              \
+                                                                               \
+/* Returns the key's value, inserting it with a zeroed value if missing. */    \
+static inline V *name##_find_or_insert(name *table, K key, bool *inserted) {   \
+  uint32_t hashed_key = hash_mix32(hash(key));                                 \
+  name##_bucket *bucket = name##_find(table, key, hashed_key);                 \
+                                                                               \
+  *inserted = bucket == NULL;                                                  \
+  if (bucket != NULL) {                                                        \
+    return &bucket->value;                                                     \
+  }                                                                            \
+  return name##_insert_hashed(table, key, hashed_key);                         \
+}                                                                              \
+                                                                               \
+static inline void name##_remove(name *table, K key) {                         \
+  name##_bucket *bucket = name##_find(table, key, hash_mix32(hash(key)));      \
+  if (bucket == NULL) {                                                        \
+    return;                                                                    \
+  }                                                                            \
+                                                                               \
+  release(bucket->key);                                                        \
+  table->size -= 1;                                                            \
+                                                                               \
+  /* Backward shift the rest of the run. */                                    \
+  uint32_t mask = table->capacity - 1;                                         \
+  uint32_t index = (uint32_t)(bucket - table->buckets);                        \
+  uint32_t next = (index + 1) & mask;                                          \
+  while (table->buckets[next].distance > 1) {                                  \
+    table->buckets[index] = table->buckets[next];                              \
+    table->buckets[index].distance -= 1;                                       \
+    index = next;                                                              \
+    next = (next + 1) & mask;                                                  \
+  }                                                                            \
+  table->buckets[index].distance = 0;                                          \
+}                                                                              \
+                                                                               \
+static inline V *name##_iterate(name *table, V *last_position) {               \
+  if (table->buckets == NULL) {                                                \
+    return NULL;                                                               \
+  }                                                                            \
+                                                                               \
+  uint32_t index = 0;                                                          \
+  if (last_position != NULL) {                                                 \
+    name##_bucket *last =                                                      \
+        (name##_bucket *)((char *)last_position -                              \
+                          offsetof(name##_bucket, value));                     \
+    index = (uint32_t)(last - table->buckets) + 1;                             \
+  }                                                                            \
+                                                                               \
+  for (; index < table->capacity; ++index) {                                   \
+    if (table->buckets[index].distance != 0) {                                 \
+      return &table->buckets[index].value;                                     \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  return NULL;                                                                 \
+}                                                                              \
+                                                                               \
+static inline K name##_key_at(V const *position) {                             \
+  return ((name##_bucket const *)((char const *)position -                     \
+                                  offsetof(name##_bucket, value)))             \
+      ->key;                                                                   \
+}                                                                              \
+                                                                               \
+static inline void name##_shrink(name *table) {                                \
+  uint32_t new_capacity = FENNEC_HASHTABLE_INITIAL_CAPACITY;                   \
+  while (name##_max_load(new_capacity) <= table->size) {                       \
+    new_capacity = new_capacity << 1;                                          \
+  }                                                                            \
+                                                                               \
+  name##_rehash(table, new_capacity);                                          \
+}                                                                              \
+                                                                               \
+static inline void name##_free(name *table) {                                  \
+  if (table->buckets != NULL) {                                                \
+    for (uint32_t i = 0; i < table->capacity; ++i) {                           \
+      if (table->buckets[i].distance != 0) {                                   \
+        release(table->buckets[i].key);                                        \
+      }                                                                        \
+    }                                                                          \
+    free(table->buckets);                                                      \
+  }                                                                            \
+                                                                               \
+  *table = name##_new();                                                       \
+}
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file
+ * @author Ryan Rohrer <ryan.rohrer@gmail.com>
+ *
+ * @section DESCRIPTION
+ * A pluggable allocator. Containers made with one of the *_with_allocator
+ * constructors get and give back their memory through it instead of
+ * malloc/realloc/free, so they can live in an arena, a huge page pool or
+ * memory local to a NUMA node. A NULL allocator means libc, which is what
+ * every other constructor uses.
+ */
+#ifndef allocator_h
+#define allocator_h
+
+#include "fennec.h"
+
+/**
+ * The functions behind an allocator. Each one is handed context as its first
+ * argument. Sizes are in bytes; old_size and size are the sizes the block was
+ * last allocated (or reallocated) with, so allocators that don't keep their
+ * own headers know how much to copy or give back. reallocate(context, NULL,
+ * 0, size) must behave like allocate.
+ */
+typedef struct {
+  void *(*allocate)(void *context, size_t size);
+  void *(*reallocate)(void *context, void *pointer, size_t old_size,
+                      size_t new_size);
+  void (*deallocate)(void *context, void *pointer, size_t size);
+  void *context;
+} fennec_allocator;
+
+/**
+ * Allocate size bytes.
+ *
+ * @param allocator - the allocator to use, NULL for malloc.
+ * @param size - the number of bytes.
+ * @return - the new block.
+ */
+void *fennec_allocate(fennec_allocator const *allocator, size_t size);
+
+/**
+ * Allocate count * size bytes that are all zero.
+ *
+ * @param allocator - the allocator to use, NULL for calloc.
+ * @param count - the number of elements.
+ * @param size - the size of each element.
+ * @return - the new block.
+ */
+void *fennec_allocate_zeroed(fennec_allocator const *allocator, size_t count,
+                             size_t size);
+
+/**
+ * Grow or shrink a block, keeping the first min(old_size, new_size) bytes.
+ *
+ * @param allocator - the allocator to use, NULL for realloc.
+ * @param pointer - the block, or NULL to allocate a new one.
+ * @param old_size - the size the block was allocated with.
+ * @param new_size - the size wanted.
+ * @return - the (possibly moved) block.
+ */
+void *fennec_reallocate(fennec_allocator const *allocator, void *pointer,
+                        size_t old_size, size_t new_size);
+
+/**
+ * Give a block back. Nothing happens if pointer is NULL.
+ *
+ * @param allocator - the allocator to use, NULL for free.
+ * @param pointer - the block.
+ * @param size - the size the block was allocated with.
+ */
+void fennec_deallocate(fennec_allocator const *allocator, void *pointer,
+                       size_t size);
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * @file
+ * @author Ryan Rohrer <ryan.rohrer@gmail.com>
+ *
+ * @section DESCRIPTION
+ * An arena (bump allocator). Memory is handed out of large chunks by moving a
+ * pointer forward and is only given back all at once, either to a mark taken
+ * earlier (arena_rewind) or entirely (arena_reset). Chunks that are given back
+ * are kept for reuse, so an arena that is reset after every request stops
+ * calling malloc once it has grown to the size of the biggest request.
+ *
+ * arena_allocator wraps an arena in a fennec_allocator so containers made
+ * with the *_with_allocator constructors live in it. Freeing such a container
+ * is then close to free: only the most recent allocation in the current chunk
+ * is actually given back (and grows in place when reallocated), everything
+ * else waits for the rewind or reset.
+ */
+#ifndef arena_h
+#define arena_h
+
+#include "fennec.h"
+#include "utilities/allocator.h"
+
+/**
+ * The default size of each chunk.
+ */
+#define ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+
+/**
+ * Every allocation is aligned to this many bytes.
+ */
+#define ARENA_ALIGNMENT 16
+
+/**
+ * A chunk of an arena.
+ */
+typedef struct arena_chunk arena_chunk;
+
+/**
+ * An arena. current is the chunk being allocated from, with the chunks before
+ * it linked behind it; spare holds chunks given back by a rewind or reset.
+ */
+typedef struct {
+  arena_chunk *current;
+  arena_chunk *spare;
+  uint32_t chunk_size;
+  uint64_t allocations;
+  uint64_t chunk_allocations;
+} arena;
+
+/**
+ * A position in an arena to rewind to.
+ */
+typedef struct {
+  arena_chunk *chunk;
+  size_t used;
+} arena_mark;
+
+/**
+ * A snapshot of an arena, filled in by arena_stats.
+ *
+ * used_bytes is what has been handed out since the last reset (rounded up to
+ * ARENA_ALIGNMENT, plus the tail of each chunk that was too small for the
+ * allocation that started the next one). reserved_bytes is every chunk the
+ * arena holds, spare chunks included. allocations and chunk_allocations count
+ * arena_allocate calls and chunks taken from malloc over the arena's life.
+ */
+typedef struct {
+  uint64_t used_bytes;
+  uint64_t reserved_bytes;
+  uint32_t chunk_count;
+  uint32_t spare_chunk_count;
+  uint64_t allocations;
+  uint64_t chunk_allocations;
+} arena_statistics;
+
+/**
+ * Constructor for a new arena. Nothing is allocated until the first
+ * arena_allocate.
+ *
+ * @param chunk_size - the size of each chunk, 0 for ARENA_DEFAULT_CHUNK_SIZE.
+ * Allocations bigger than this get a chunk of their own.
+ * @return - a newly constructed and empty arena.
+ */
+arena arena_new(uint32_t chunk_size);
+
+/**
+ * Allocate size bytes, aligned to ARENA_ALIGNMENT.
+ *
+ * @param a - the arena to allocate from.
+ * @param size - the number of bytes.
+ * @return - the new block, valid until the arena is rewound past it, reset or
+ * freed.
+ */
+void *arena_allocate(arena *a, size_t size);
+
+/**
+ * Remember the current position of an arena.
+ *
+ * @param a - the arena.
+ * @return - a mark that arena_rewind can go back to.
+ */
+arena_mark arena_get_mark(arena const *a);
+
+/**
+ * Give back everything allocated since mark was taken. Marks taken after it
+ * are no longer valid.
+ *
+ * @param a - the arena to rewind.
+ * @param mark - a mark from arena_get_mark on the same arena, since its last
+ * reset.
+ */
+void arena_rewind(arena *a, arena_mark mark);
+
+/**
+ * Give back everything allocated from an arena, keeping its chunks for the
+ * allocations that follow.
+ *
+ * @param a - the arena to reset.
+ */
+void arena_reset(arena *a);
+
+/**
+ * Fill in stats with a snapshot of an arena.
+ *
+ * @param a - the arena to look at.
+ * @param stats - the statistics to fill in.
+ */
+void arena_stats(arena const *a, arena_statistics *stats);
+
+/**
+ * Wrap an arena in a fennec_allocator.
+ *
+ * @param a - the arena, which must not move while the allocator is in use.
+ * @return - an allocator that gets its memory from a. The allocator has to
+ * outlive every container using it, so keep it next to the arena.
+ */
+fennec_allocator arena_allocator(arena *a);
+
+/**
+ * Deallocates every chunk of an arena, spares included.
+ *
+ * @param a - the arena that is being deallocated.
+ */
+void arena_free(arena *a);
+
+#endif
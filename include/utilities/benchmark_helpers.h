@@ -0,0 +1,31 @@
+#ifndef benchmark_helpers_h
+#define benchmark_helpers_h
+
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Wall clock seconds from C11's timespec_get, since clock_gettime and
+ * CLOCK_MONOTONIC aren't declared under -std=c11.
+ */
+static inline double benchmark_now(void) {
+  struct timespec now;
+  timespec_get(&now, TIME_UTC);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/*
+ * Keeps the optimizer from throwing away the result of a benchmarked loop.
+ */
+static void const *volatile benchmark_sink;
+
+static inline void benchmark_consume(void const *value) {
+  benchmark_sink = value;
+}
+
+#define BENCHMARK_REPORT(name, operations, seconds)                            \
+  printf("%-44s %10.2f ns/op %12.0f ops/s\n", name,                           \
+         (seconds)*1e9 / (double)(operations),                                 \
+         (double)(operations) / (seconds))
+
+#endif
@@ -9,14 +9,19 @@
 #define file_h
 
 #include "fennec.h"
+#include "utilities/allocator.h"
 #include "utilities/string.h"
 
 /**
- * A memory mapped file.
+ * A memory mapped file. Mapped is true when data is a read only mapping from
+ * file_map rather than a heap copy from file_load_all. A heap copy comes from
+ * allocator (NULL for libc).
  */
 typedef struct {
   void *data;
   uint32_t size;
+  bool mapped;
+  fennec_allocator const *allocator;
 } file_data;
 
 /**
@@ -27,6 +32,41 @@ typedef struct {
  */
 file_data file_load_all(string const *path);
 
+/**
+ * Load all of a file into memory from allocator. file_data_free gives it back
+ * to the same allocator.
+ *
+ * @param path - the path of the file to load.
+ * @param allocator - the allocator, must outlive the file_data. NULL uses
+ * libc, the same as file_load_all.
+ * @return - the file_data containing the file, data is NULL if the file
+ * couldn't be opened.
+ */
+file_data file_load_all_with_allocator(string const *path,
+                                       fennec_allocator const *allocator);
+
+/**
+ * Map a whole file read only. Pages are only read in as they are touched and
+ * are shared with every other process that maps the same file.
+ *
+ * @param path - the path of the file to map.
+ * @return - the file_data for the mapping, data is NULL if the file couldn't
+ * be mapped (or is empty).
+ */
+file_data file_map(string const *path);
+
+/**
+ * Write size bytes to a file, replacing it. The bytes go to a temporary file
+ * that is renamed over path, so a process that has the old file mapped keeps
+ * seeing the old contents.
+ *
+ * @param path - the path of the file to write.
+ * @param data - the bytes to write.
+ * @param size - the number of bytes.
+ * @return - true if the whole file was written.
+ */
+bool file_write_all(string const *path, void const *data, uint32_t size);
+
 /**
  * Clean up the filedata that was loaded.
  *
@@ -0,0 +1,77 @@
+/**
+ * @file
+ * @author Ryan Rohrer <ryan.rohrer@gmail.com>
+ *
+ * @section DESCRIPTION
+ * Seeded hash functions over runs of bytes. They read 8 or 16 bytes per step
+ * instead of one, and every output bit depends on every input bit, so masking
+ * off the low bits (like the hashtable does) still gives a good spread.
+ */
+#ifndef hash_h
+#define hash_h
+
+#include "fennec.h"
+
+/**
+ * Hashing function type.  Takes KEY data and returns an uint32_t.
+ */
+typedef uint32_t (*hash_function_type)(void const *);
+
+/**
+ * Byte hashing function type. Takes a pointer to length bytes and a seed and
+ * returns a 64 bit hash. Different seeds give unrelated hashes for the same
+ * bytes.
+ */
+typedef uint64_t (*hash_bytes_function_type)(void const *, uint32_t,
+                                             uint64_t);
+
+/**
+ * wyhash (final version 4). Multiply-and-fold over 16 bytes per step, the
+ * fastest general purpose choice here.
+ *
+ * @param data - the bytes to hash.
+ * @param length - the number of bytes.
+ * @param seed - the seed to mix in.
+ * @return - the 64 bit hash.
+ */
+uint64_t hash_wyhash(void const *data, uint32_t length, uint64_t seed);
+
+/**
+ * CRC32C (Castagnoli). Uses the SSE4.2 / ARMv8 crc32 instructions when the
+ * CPU has them and a table driven version otherwise. Only the low 32 bits are
+ * set. With a seed of 0 this is the standard CRC32C checksum.
+ *
+ * @param data - the bytes to hash.
+ * @param length - the number of bytes.
+ * @param seed - the seed to mix in.
+ * @return - the 32 bit checksum, widened to 64 bits.
+ */
+uint64_t hash_crc32c(void const *data, uint32_t length, uint64_t seed);
+
+/**
+ * Returns a seed that is different for every call and every run of the
+ * program. Not suitable for cryptography, only to keep hash flooding inputs
+ * from being precomputed.
+ *
+ * @return - a new seed.
+ */
+uint64_t hash_random_seed(void);
+
+/**
+ * The murmur3 fmix32 finalizer. Spreads the bits of a 32 bit hash so tables
+ * that index with its low bits still use every bucket when the hash is weak
+ * (e.g. the identity for integers).
+ *
+ * @param hash - the hash to mix.
+ * @return - the mixed hash.
+ */
+static inline uint32_t hash_mix32(uint32_t hash) {
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+#endif
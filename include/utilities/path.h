@@ -34,7 +34,7 @@ char path_get_system_slash(void);
  * @param first - the beginning of the path that will be appended to.
  * @param second - the path that will be appended onto the base path.
  * @return - a string that contains the complete path.  Must call string_free on
- * it when done.
+ * it when done. It uses the same allocator as first.
  */
 string path_join(string const *first, string const *second);
 
@@ -43,7 +43,7 @@ string path_join(string const *first, string const *second);
  *
  * @param path - the path that will be converted.
  * @return - a string containing the path with the correct system slashes. Must
- * call string_free when done.
+ * call string_free when done. It uses the same allocator as path.
  */
 string path_to_system_slashes(string const *path);
 
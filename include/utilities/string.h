@@ -11,18 +11,21 @@
 
 #include "data_structures/dynamic_array.h"
 #include "fennec.h"
+#include "utilities/allocator.h"
 
 /**
  * A string that is null terminated, as well as having a cached
  * length and capacity.
  *
  * Length is what strlen() would return. Capacity is the size allocated
- * (includes null)
+ * (includes null), 0 for a wrapped C string. Data comes from allocator (NULL
+ * for libc).
  */
 typedef struct {
   char *data;
   uint32_t length;
   uint32_t capacity;
+  fennec_allocator const *allocator;
 } string;
 
 /**
@@ -55,6 +58,17 @@ typedef enum {
  */
 string string_new(char const *data);
 
+/**
+ * Create a string from a C string, getting its memory from allocator.
+ * string_append and string_free use the same allocator.
+ *
+ * @param data - the C string to turn into a string.
+ * @param allocator - the allocator, must outlive the string. NULL uses libc.
+ * @return - a new string containing the contents of that C string.
+ */
+string string_new_with_allocator(char const *data,
+                                 fennec_allocator const *allocator);
+
 /**
  * Create a string range from a string + range.
  *
@@ -77,6 +91,20 @@ string_range string_range_new(string *s, uint32_t start, uint32_t end);
  */
 string string_new_substring(char const *data, uint32_t start, uint32_t end);
 
+/**
+ * Create a string from a buffer and a range, getting its memory from
+ * allocator.
+ *
+ * @param data - the buffer that a range is being pulled from.
+ * @param start - the index of the first character to take.
+ * @param end - the EXCLUSIVE end of the string.
+ * @param allocator - the allocator, must outlive the string. NULL uses libc.
+ * @return - a string built from the range included.
+ */
+string string_new_substring_with_allocator(char const *data, uint32_t start,
+                                           uint32_t end,
+                                           fennec_allocator const *allocator);
+
 /**
  * Create a string from a cstring. This DOES NOT ALLOCATE so do not free it.
  *
@@ -189,13 +217,28 @@ int32_t string_find_last_any(string const *s, string const *character_set,
 string string_join(string const *strings, string const *separator,
                    uint32_t count);
 
+/**
+ * Joins an array of strings into one new string that gets its memory from
+ * allocator.
+ *
+ * @param strings - a pointer to an array of strings.
+ * @param separator - the string to use between elements of the array.
+ * @param count - the length of the array that is getting joined, in elements.
+ * @param allocator - the allocator, must outlive the string. NULL uses libc.
+ * @return - a string that contains all of the substrings concatinated with the
+ * separator.
+ */
+string string_join_with_allocator(string const *strings,
+                                  string const *separator, uint32_t count,
+                                  fennec_allocator const *allocator);
+
 /**
  * Replaces all instances of search with the contents of replace_with.
  * @param s - the original string to have items replaced.
  * @param search - the search string to lookup and replace in s.
  * @param replace_with - the string getting inserted wherever search is found.
  * @return - a new string with all instances of search replaced with
- * replace_with.
+ * replace_with. It uses the same allocator as s.
  */
 string string_replace(string const *s, string const *search,
                       string const *replace_with);
@@ -207,7 +250,8 @@ string string_replace(string const *s, string const *search,
  * @param s - the string that will be split up.
  * @param seperator - the substring to split by, and that will be stripped.
  * @return - a dynamic_array of string_range structs that contain all the
- * splits. NOTE: caller must call dynamic_array_free when done.
+ * splits. NOTE: caller must call dynamic_array_free when done. The array and
+ * the strings in it use the same allocator as s.
  */
 dynamic_array string_split(string const *s, string const *seperator);
 
@@ -218,7 +262,8 @@ dynamic_array string_split(string const *s, string const *seperator);
  * @param * s - the string to split.
  * @param * character_set - the characters to split on, and drop.
  * @return - a dynamic_array containing string_range structs that contain the
- * splits. NOTE: caller must call dynamic_array_free when done.
+ * splits. NOTE: caller must call dynamic_array_free when done. The array and
+ * the strings in it use the same allocator as s.
  */
 dynamic_array string_split_any(string const *s, string const *character_set);
 
@@ -228,7 +273,8 @@ dynamic_array string_split_any(string const *s, string const *character_set);
  * @param s - the string to be split up.
  * @param seperator - the seperator to split after.
  * @return - a dynamic_array of string_range's that contain all the splits +
- * seperators. NOTE: caller must call dynamic_array_free when done.
+ * seperators. NOTE: caller must call dynamic_array_free when done. The array
+ * and the strings in it use the same allocator as s.
  */
 dynamic_array string_split_after(string const *s, string const *seperator);
 
@@ -1,6 +1,8 @@
 #ifndef test_helpers_h
 #define test_helpers_h
 
+#include "utilities/allocator.h"
+
 #define RETURN_IF_FAILED(x)                                                    \
   {                                                                            \
     int ret = x;                                                               \
@@ -14,4 +16,54 @@
     return 1;                                                                  \
   }
 
+/**
+ * What an allocator from test_counting_allocator has seen. wrong_sizes counts
+ * blocks given back (or reallocated) with a size other than the one they
+ * were allocated with.
+ */
+typedef struct {
+  uint64_t live_bytes;
+  uint32_t allocations;
+  uint32_t wrong_sizes;
+} test_allocator_counts;
+
+static inline void *test_counting_allocate(void *context, size_t size) {
+  test_allocator_counts *counts = (test_allocator_counts *)context;
+  size_t *block = (size_t *)malloc(size + sizeof(size_t) * 2);
+  block[0] = size;
+  counts->live_bytes += size;
+  counts->allocations += 1;
+  return block + 2;
+}
+
+static inline void test_counting_deallocate(void *context, void *pointer,
+                                            size_t size) {
+  test_allocator_counts *counts = (test_allocator_counts *)context;
+  size_t *block = (size_t *)pointer - 2;
+  counts->wrong_sizes += block[0] != size;
+  counts->live_bytes -= block[0];
+  free(block);
+}
+
+static inline void *test_counting_reallocate(void *context, void *pointer,
+                                             size_t old_size,
+                                             size_t new_size) {
+  void *result = test_counting_allocate(context, new_size);
+  if (pointer != NULL) {
+    memcpy(result, pointer, old_size < new_size ? old_size : new_size);
+    test_counting_deallocate(context, pointer, old_size);
+  }
+  return result;
+}
+
+/**
+ * An allocator on top of malloc that keeps the size of each block in front of
+ * it and tallies what it's asked to do in counts.
+ */
+static inline fennec_allocator
+test_counting_allocator(test_allocator_counts *counts) {
+  return (fennec_allocator){test_counting_allocate, test_counting_reallocate,
+                            test_counting_deallocate, counts};
+}
+
 #endif
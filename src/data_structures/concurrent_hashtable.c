@@ -0,0 +1,604 @@
+#include "data_structures/concurrent_hashtable.h"
+#include "data_structures/dynamic_array.h"
+#include "hashtable_internal.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define CONCURRENT_HASHTABLE_SHARD_BITS 6
+#define CONCURRENT_HASHTABLE_SHARD_COUNT (1u << CONCURRENT_HASHTABLE_SHARD_BITS)
+#define CONCURRENT_HASHTABLE_INITIAL_CAPACITY 16
+#define CONCURRENT_HASHTABLE_READER_COUNT 64
+#define CONCURRENT_HASHTABLE_RETIRE_BATCH 64
+
+typedef enum {
+  concurrent_hashtable_slot_empty = 0,
+  concurrent_hashtable_slot_deleted,
+  concurrent_hashtable_slot_full
+} concurrent_hashtable_slot_state;
+
+/*
+ * state, hash and key are read by lock-free readers while a writer may be
+ * changing them, so they are atomics: a writer fills in hash, key and value
+ * and then publishes the slot with a release store of state, which readers
+ * load with acquire before touching the rest. key is also stored with release
+ * and loaded with acquire, because a slot can be deleted and reused between a
+ * reader's load of state and its load of key, and the reader must then see
+ * the bytes of the new key copy before comparing them.
+ */
+typedef struct {
+  atomic_uint state;
+  atomic_uint hash;
+  _Atomic(void *) key;
+  char value[];
+} concurrent_hashtable_slot;
+
+typedef struct {
+  uint32_t capacity;
+  uint32_t slot_size;
+  char slots[];
+} concurrent_hashtable_array;
+
+/*
+ * Writers hold the lock and bump the sequence to an odd number while they
+ * modify the shard. Readers take a snapshot of the sequence, read without
+ * locking and retry if the sequence changed. Arrays and key copies that a
+ * reader could still be looking at are retired instead of freed, and the
+ * retired list is collected once it reaches collect_at entries.
+ *
+ * The padding keeps the hot members of neighbouring shards on different cache
+ * lines.
+ */
+struct concurrent_hashtable_shard {
+  _Atomic(concurrent_hashtable_array *) array;
+  atomic_uint sequence;
+  atomic_uint size;
+  uint32_t tombstones;
+  uint32_t collect_at;
+  pthread_mutex_t lock;
+  dynamic_array retired;
+  char padding[64];
+};
+
+/*
+ * A reader stores the global epoch it saw in one of these for as long as it
+ * may hold pointers into the table, and 0 when it is done. Each sits on its
+ * own cache line so readers on different threads don't contend.
+ */
+typedef struct {
+  _Atomic(uint64_t) epoch;
+  char padding[64 - sizeof(uint64_t)];
+} concurrent_hashtable_reader;
+
+struct concurrent_hashtable_epochs {
+  _Atomic(uint64_t) epoch;
+  char padding[64 - sizeof(uint64_t)];
+  concurrent_hashtable_reader readers[CONCURRENT_HASHTABLE_READER_COUNT];
+};
+
+/*
+ * A retired allocation. epoch is 0 until the first collection after it was
+ * retired, which stamps it with the epoch that collection advanced to.
+ */
+typedef struct {
+  void *pointer;
+  uint64_t epoch;
+} concurrent_hashtable_retired;
+
+/*
+ * The reader slot each thread tries first, handed out round robin so threads
+ * mostly keep to their own slot.
+ */
+static atomic_uint concurrent_hashtable_next_reader;
+static _Thread_local uint32_t concurrent_hashtable_reader_index = UINT32_MAX;
+
+/*
+ * Values are copied in and out of slots with relaxed atomic accesses, a word
+ * at a time, so a reader copying a value while a writer changes it gets bytes
+ * the sequence check throws away rather than undefined behaviour. value
+ * starts at a word boundary in the slot, and slot sizes are whole words.
+ */
+static void concurrent_hashtable_store_value(char *destination,
+                                             void const *value,
+                                             uint32_t size) {
+  char const *source = (char const *)value;
+  uint32_t i = 0;
+
+  for (; i + sizeof(uintptr_t) <= size; i += sizeof(uintptr_t)) {
+    uintptr_t word;
+    memcpy(&word, source + i, sizeof(uintptr_t));
+    atomic_store_explicit((_Atomic(uintptr_t) *)(destination + i), word,
+                          memory_order_relaxed);
+  }
+  for (; i < size; ++i) {
+    atomic_store_explicit((_Atomic(unsigned char) *)(destination + i),
+                          (unsigned char)source[i], memory_order_relaxed);
+  }
+}
+
+static void concurrent_hashtable_load_value(void *value, char *source,
+                                            uint32_t size) {
+  char *destination = (char *)value;
+  uint32_t i = 0;
+
+  for (; i + sizeof(uintptr_t) <= size; i += sizeof(uintptr_t)) {
+    uintptr_t word = atomic_load_explicit(
+        (_Atomic(uintptr_t) *)(source + i), memory_order_relaxed);
+    memcpy(destination + i, &word, sizeof(uintptr_t));
+  }
+  for (; i < size; ++i) {
+    destination[i] = (char)atomic_load_explicit(
+        (_Atomic(unsigned char) *)(source + i), memory_order_relaxed);
+  }
+}
+
+static concurrent_hashtable_shard *
+concurrent_hashtable_get_shard(concurrent_hashtable const *table,
+                               uint32_t hash) {
+  return &table->shards[hash >> (32 - CONCURRENT_HASHTABLE_SHARD_BITS)];
+}
+
+static concurrent_hashtable_slot *
+concurrent_hashtable_slot_at(concurrent_hashtable_array *array,
+                             uint32_t index) {
+  return (concurrent_hashtable_slot *)(array->slots +
+                                       (size_t)array->slot_size * index);
+}
+
+static concurrent_hashtable_array *
+concurrent_hashtable_array_new(concurrent_hashtable const *table,
+                               uint32_t capacity) {
+  uint32_t slot_size = sizeof(concurrent_hashtable_slot) + table->object_size;
+  slot_size = (slot_size + sizeof(void *) - 1) &
+              ~(uint32_t)(sizeof(void *) - 1);
+
+  concurrent_hashtable_array *array = (concurrent_hashtable_array *)calloc(
+      1, sizeof(concurrent_hashtable_array) + (size_t)slot_size * capacity);
+  array->capacity = capacity;
+  array->slot_size = slot_size;
+  return array;
+}
+
+/*
+ * Linear probe for key. Bounded by the capacity so a reader racing a writer
+ * can't spin forever; the sequence check throws away whatever it found.
+ */
+static concurrent_hashtable_slot *
+concurrent_hashtable_find(concurrent_hashtable const *table,
+                          concurrent_hashtable_array *array, void const *key,
+                          uint32_t hash) {
+  if (array == NULL) {
+    return NULL;
+  }
+
+  uint32_t mask = array->capacity - 1;
+  uint32_t index = hash & mask;
+
+  for (uint32_t i = 0; i < array->capacity; ++i) {
+    concurrent_hashtable_slot *slot =
+        concurrent_hashtable_slot_at(array, (index + i) & mask);
+
+    unsigned state = atomic_load_explicit(&slot->state, memory_order_acquire);
+    if (state == concurrent_hashtable_slot_empty) {
+      return NULL;
+    }
+
+    if (state == concurrent_hashtable_slot_full &&
+        atomic_load_explicit(&slot->hash, memory_order_relaxed) == hash &&
+        table->comparison_function(
+            atomic_load_explicit(&slot->key, memory_order_acquire), key)) {
+      return slot;
+    }
+  }
+
+  return NULL;
+}
+
+static concurrent_hashtable_slot *
+concurrent_hashtable_find_free(concurrent_hashtable_array *array,
+                               uint32_t hash) {
+  uint32_t mask = array->capacity - 1;
+  uint32_t index = hash & mask;
+
+  while (true) {
+    concurrent_hashtable_slot *slot =
+        concurrent_hashtable_slot_at(array, index);
+    if (atomic_load_explicit(&slot->state, memory_order_relaxed) !=
+        concurrent_hashtable_slot_full) {
+      return slot;
+    }
+    index = (index + 1) & mask;
+  }
+}
+
+static void
+concurrent_hashtable_begin_write(concurrent_hashtable_shard *shard) {
+  unsigned sequence =
+      atomic_load_explicit(&shard->sequence, memory_order_relaxed);
+  atomic_store_explicit(&shard->sequence, sequence + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+static void concurrent_hashtable_end_write(concurrent_hashtable_shard *shard) {
+  unsigned sequence =
+      atomic_load_explicit(&shard->sequence, memory_order_relaxed);
+  atomic_store_explicit(&shard->sequence, sequence + 1, memory_order_release);
+}
+
+/*
+ * Claims a reader slot and announces the current epoch in it. The epoch is
+ * read again after the announcement and the announcement redone until the two
+ * agree, so a writer that advances the epoch either sees this reader in its
+ * scan or is seen by it, in which case the reader also sees everything the
+ * writer unlinked before advancing. More than CONCURRENT_HASHTABLE_READER_COUNT
+ * readers at once take turns for the slots.
+ */
+static concurrent_hashtable_reader *
+concurrent_hashtable_enter(concurrent_hashtable const *table) {
+  concurrent_hashtable_epochs *epochs = table->epochs;
+
+  if (concurrent_hashtable_reader_index == UINT32_MAX) {
+    concurrent_hashtable_reader_index =
+        atomic_fetch_add_explicit(&concurrent_hashtable_next_reader, 1,
+                                  memory_order_relaxed) %
+        CONCURRENT_HASHTABLE_READER_COUNT;
+  }
+
+  uint32_t index = concurrent_hashtable_reader_index;
+  uint64_t epoch = atomic_load(&epochs->epoch);
+  concurrent_hashtable_reader *reader = &epochs->readers[index];
+
+  uint64_t unused = 0;
+  while (!atomic_compare_exchange_weak(&reader->epoch, &unused, epoch)) {
+    unused = 0;
+    index = (index + 1) % CONCURRENT_HASHTABLE_READER_COUNT;
+    reader = &epochs->readers[index];
+  }
+
+  uint64_t current = atomic_load(&epochs->epoch);
+  while (current != epoch) {
+    epoch = current;
+    atomic_store(&reader->epoch, epoch);
+    current = atomic_load(&epochs->epoch);
+  }
+
+  return reader;
+}
+
+static void concurrent_hashtable_leave(concurrent_hashtable_reader *reader) {
+  atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+}
+
+/*
+ * Advances the epoch, stamps the newly retired entries with it and frees every
+ * entry whose stamp no active reader is behind. A reader that announced the
+ * stamp or later read it from this advance (or a later one), so everything
+ * unlinked before the advance is out of its reach. Needs the shard lock.
+ */
+static void concurrent_hashtable_collect(concurrent_hashtable const *table,
+                                         concurrent_hashtable_shard *shard) {
+  concurrent_hashtable_epochs *epochs = table->epochs;
+  uint64_t epoch = atomic_fetch_add(&epochs->epoch, 1) + 1;
+
+  uint64_t oldest = UINT64_MAX;
+  for (uint32_t i = 0; i < CONCURRENT_HASHTABLE_READER_COUNT; ++i) {
+    uint64_t reader_epoch = atomic_load(&epochs->readers[i].epoch);
+    if (reader_epoch != 0 && reader_epoch < oldest) {
+      oldest = reader_epoch;
+    }
+  }
+
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < shard->retired.size; ++i) {
+    concurrent_hashtable_retired retired =
+        *(concurrent_hashtable_retired *)dynamic_array_get_at(&shard->retired,
+                                                              i);
+    if (retired.epoch == 0) {
+      retired.epoch = epoch;
+    }
+
+    if (retired.epoch <= oldest) {
+      free(retired.pointer);
+    } else {
+      *(concurrent_hashtable_retired *)dynamic_array_get_at(&shard->retired,
+                                                            kept) = retired;
+      kept += 1;
+    }
+  }
+  dynamic_array_resize(&shard->retired, kept);
+
+  /*
+   * Entries a stalled reader holds back are only looked at again once the
+   * list has doubled, so collecting stays amortized O(1) per retirement.
+   */
+  shard->collect_at = kept * 2 > CONCURRENT_HASHTABLE_RETIRE_BATCH
+                          ? kept * 2
+                          : CONCURRENT_HASHTABLE_RETIRE_BATCH;
+}
+
+/*
+ * Must be called after pointer has been unlinked from the shard, with the
+ * shard lock held.
+ */
+static void concurrent_hashtable_retire(concurrent_hashtable const *table,
+                                        concurrent_hashtable_shard *shard,
+                                        void *pointer) {
+  concurrent_hashtable_retired retired = {pointer, 0};
+  dynamic_array_push_back(&shard->retired, &retired);
+
+  if (shard->retired.size >= shard->collect_at) {
+    concurrent_hashtable_collect(table, shard);
+  }
+}
+
+/*
+ * Builds the bigger array while readers keep using the current one (nothing
+ * changes it while the lock is held), then publishes it in a single store.
+ */
+static void concurrent_hashtable_grow(concurrent_hashtable const *table,
+                                      concurrent_hashtable_shard *shard) {
+  concurrent_hashtable_array *array =
+      atomic_load_explicit(&shard->array, memory_order_relaxed);
+  uint32_t size = atomic_load_explicit(&shard->size, memory_order_relaxed);
+
+  uint32_t new_capacity = CONCURRENT_HASHTABLE_INITIAL_CAPACITY;
+  while ((size + 1) * 2 > new_capacity) {
+    new_capacity = new_capacity << 1;
+  }
+
+  concurrent_hashtable_array *new_array =
+      concurrent_hashtable_array_new(table, new_capacity);
+
+  if (array != NULL) {
+    for (uint32_t i = 0; i < array->capacity; ++i) {
+      concurrent_hashtable_slot *slot = concurrent_hashtable_slot_at(array, i);
+      if (atomic_load_explicit(&slot->state, memory_order_relaxed) ==
+          concurrent_hashtable_slot_full) {
+        uint32_t hash = atomic_load_explicit(&slot->hash, memory_order_relaxed);
+        memcpy(concurrent_hashtable_find_free(new_array, hash), slot,
+               array->slot_size);
+      }
+    }
+  }
+
+  concurrent_hashtable_begin_write(shard);
+  atomic_store_explicit(&shard->array, new_array, memory_order_release);
+  shard->tombstones = 0;
+  concurrent_hashtable_end_write(shard);
+
+  if (array != NULL) {
+    concurrent_hashtable_retire(table, shard, array);
+  }
+}
+
+concurrent_hashtable
+concurrent_hashtable_new(uint32_t object_size, hash_function_type hash_function,
+                         hash_comparison_function_type comparison_function,
+                         hash_key_copy_function_type copy_function) {
+  concurrent_hashtable table = {object_size,
+                                CONCURRENT_HASHTABLE_SHARD_COUNT,
+                                hash_function,
+                                comparison_function,
+                                copy_function,
+                                NULL,
+                                NULL};
+
+  table.shards = (concurrent_hashtable_shard *)calloc(
+      table.shard_count, sizeof(concurrent_hashtable_shard));
+
+  for (uint32_t i = 0; i < table.shard_count; ++i) {
+    concurrent_hashtable_shard *shard = &table.shards[i];
+    atomic_init(&shard->array, NULL);
+    atomic_init(&shard->sequence, 0);
+    atomic_init(&shard->size, 0);
+    shard->collect_at = CONCURRENT_HASHTABLE_RETIRE_BATCH;
+    pthread_mutex_init(&shard->lock, NULL);
+    shard->retired = dynamic_array_new(sizeof(concurrent_hashtable_retired));
+  }
+
+  table.epochs = (concurrent_hashtable_epochs *)calloc(
+      1, sizeof(concurrent_hashtable_epochs));
+  atomic_init(&table.epochs->epoch, 1);
+  for (uint32_t i = 0; i < CONCURRENT_HASHTABLE_READER_COUNT; ++i) {
+    atomic_init(&table.epochs->readers[i].epoch, 0);
+  }
+
+  return table;
+}
+
+concurrent_hashtable concurrent_hashtable_new_string(uint32_t object_size) {
+  return concurrent_hashtable_new(object_size, hashtable_string_hash,
+                                  hashtable_string_comparison,
+                                  hashtable_string_copy);
+}
+
+void concurrent_hashtable_insert(concurrent_hashtable *table, void const *key,
+                                 void const *value) {
+  uint32_t hash = hash_mix32(table->hash_function(key));
+  concurrent_hashtable_shard *shard =
+      concurrent_hashtable_get_shard(table, hash);
+
+  pthread_mutex_lock(&shard->lock);
+
+  concurrent_hashtable_array *array =
+      atomic_load_explicit(&shard->array, memory_order_relaxed);
+  concurrent_hashtable_slot *slot =
+      concurrent_hashtable_find(table, array, key, hash);
+
+  if (slot != NULL) {
+    concurrent_hashtable_begin_write(shard);
+    concurrent_hashtable_store_value(slot->value, value, table->object_size);
+    concurrent_hashtable_end_write(shard);
+    pthread_mutex_unlock(&shard->lock);
+    return;
+  }
+
+  uint32_t size = atomic_load_explicit(&shard->size, memory_order_relaxed);
+  if (array == NULL ||
+      (size + shard->tombstones + 1) * 4 > array->capacity * 3) {
+    concurrent_hashtable_grow(table, shard);
+    array = atomic_load_explicit(&shard->array, memory_order_relaxed);
+  }
+
+  /*
+   * The key is copied before the write section so readers are held off for
+   * as short a time as possible.
+   */
+  void *key_copy = table->copy_function(key);
+  slot = concurrent_hashtable_find_free(array, hash);
+
+  concurrent_hashtable_begin_write(shard);
+  if (atomic_load_explicit(&slot->state, memory_order_relaxed) ==
+      concurrent_hashtable_slot_deleted) {
+    shard->tombstones -= 1;
+  }
+  atomic_store_explicit(&slot->hash, hash, memory_order_relaxed);
+  atomic_store_explicit(&slot->key, key_copy, memory_order_release);
+  concurrent_hashtable_store_value(slot->value, value, table->object_size);
+  atomic_store_explicit(&slot->state, concurrent_hashtable_slot_full,
+                        memory_order_release);
+  atomic_store_explicit(&shard->size, size + 1, memory_order_relaxed);
+  concurrent_hashtable_end_write(shard);
+
+  pthread_mutex_unlock(&shard->lock);
+}
+
+void concurrent_hashtable_remove(concurrent_hashtable *table,
+                                 void const *key) {
+  uint32_t hash = hash_mix32(table->hash_function(key));
+  concurrent_hashtable_shard *shard =
+      concurrent_hashtable_get_shard(table, hash);
+
+  pthread_mutex_lock(&shard->lock);
+
+  concurrent_hashtable_array *array =
+      atomic_load_explicit(&shard->array, memory_order_relaxed);
+  concurrent_hashtable_slot *slot =
+      concurrent_hashtable_find(table, array, key, hash);
+
+  if (slot != NULL) {
+    concurrent_hashtable_begin_write(shard);
+    atomic_store_explicit(&slot->state, concurrent_hashtable_slot_deleted,
+                          memory_order_release);
+    shard->tombstones += 1;
+    atomic_fetch_sub_explicit(&shard->size, 1, memory_order_relaxed);
+    concurrent_hashtable_end_write(shard);
+
+    concurrent_hashtable_retire(
+        table, shard, atomic_load_explicit(&slot->key, memory_order_relaxed));
+  }
+
+  pthread_mutex_unlock(&shard->lock);
+}
+
+/*
+ * Note that the reads inside the retry loop race with writers by design (it's
+ * a seqlock); anything read during a write is discarded by the sequence check.
+ * The whole loop runs inside an epoch so the array and key copies it reads
+ * stay allocated.
+ */
+bool concurrent_hashtable_lookup(concurrent_hashtable const *table,
+                                 void const *key, void *value) {
+  uint32_t hash = hash_mix32(table->hash_function(key));
+  concurrent_hashtable_shard *shard =
+      concurrent_hashtable_get_shard(table, hash);
+  concurrent_hashtable_reader *reader = concurrent_hashtable_enter(table);
+
+  while (true) {
+    unsigned sequence =
+        atomic_load_explicit(&shard->sequence, memory_order_acquire);
+    if (sequence & 1) {
+      continue;
+    }
+
+    concurrent_hashtable_array *array =
+        atomic_load_explicit(&shard->array, memory_order_acquire);
+    concurrent_hashtable_slot *slot =
+        concurrent_hashtable_find(table, array, key, hash);
+
+    if (slot != NULL && value != NULL) {
+      concurrent_hashtable_load_value(value, slot->value, table->object_size);
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&shard->sequence, memory_order_relaxed) ==
+        sequence) {
+      concurrent_hashtable_leave(reader);
+      return slot != NULL;
+    }
+  }
+}
+
+bool concurrent_hashtable_exists(concurrent_hashtable const *table,
+                                 void const *key) {
+  return concurrent_hashtable_lookup(table, key, NULL);
+}
+
+uint32_t concurrent_hashtable_size(concurrent_hashtable const *table) {
+  uint32_t size = 0;
+
+  for (uint32_t i = 0; i < table->shard_count; ++i) {
+    size += atomic_load_explicit(&table->shards[i].size, memory_order_relaxed);
+  }
+
+  return size;
+}
+
+void concurrent_hashtable_reclaim(concurrent_hashtable *table) {
+  for (uint32_t i = 0; i < table->shard_count; ++i) {
+    concurrent_hashtable_shard *shard = &table->shards[i];
+
+    pthread_mutex_lock(&shard->lock);
+    concurrent_hashtable_collect(table, shard);
+    pthread_mutex_unlock(&shard->lock);
+  }
+}
+
+uint32_t concurrent_hashtable_retired_count(concurrent_hashtable const *table) {
+  uint32_t count = 0;
+
+  for (uint32_t i = 0; i < table->shard_count; ++i) {
+    count += table->shards[i].retired.size;
+  }
+
+  return count;
+}
+
+void concurrent_hashtable_free(concurrent_hashtable *table) {
+  if (table->shards == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < table->shard_count; ++i) {
+    concurrent_hashtable_shard *shard = &table->shards[i];
+    concurrent_hashtable_array *array =
+        atomic_load_explicit(&shard->array, memory_order_relaxed);
+
+    for (uint32_t j = 0; j < shard->retired.size; ++j) {
+      free(((concurrent_hashtable_retired *)dynamic_array_get_at(
+                &shard->retired, j))
+               ->pointer);
+    }
+
+    if (array != NULL) {
+      for (uint32_t j = 0; j < array->capacity; ++j) {
+        concurrent_hashtable_slot *slot =
+            concurrent_hashtable_slot_at(array, j);
+        if (atomic_load_explicit(&slot->state, memory_order_relaxed) ==
+            concurrent_hashtable_slot_full) {
+          free(atomic_load_explicit(&slot->key, memory_order_relaxed));
+        }
+      }
+
+      free(array);
+    }
+
+    dynamic_array_free(&shard->retired);
+    pthread_mutex_destroy(&shard->lock);
+  }
+
+  free(table->shards);
+  free(table->epochs);
+  table->shards = NULL;
+  table->epochs = NULL;
+}
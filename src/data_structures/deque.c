@@ -0,0 +1,190 @@
+#include "data_structures/deque.h"
+
+#define DEQUE_MINIMUM_CAPACITY 16
+#define DEQUE_MAXIMUM_CAPACITY (1u << 31)
+
+static uint32_t deque_mask(deque const *d) { return d->buffer.size - 1; }
+
+static char *deque_slot(deque const *d, uint32_t index) {
+  return d->buffer.data +
+         (size_t)((d->head + index) & deque_mask(d)) * d->buffer.object_size;
+}
+
+/*
+ * Doubles the buffer until it holds count elements. The elements that had
+ * wrapped around to the start of the old buffer are moved to just past its
+ * old end, which is free because the buffer at least doubled. Returns false,
+ * leaving the deque as it was, if count is past DEQUE_MAXIMUM_CAPACITY.
+ */
+static bool deque_grow_to(deque *d, uint64_t count) {
+  uint32_t old_capacity = d->buffer.size;
+  if (count <= old_capacity) {
+    return true;
+  }
+  if (count > DEQUE_MAXIMUM_CAPACITY) {
+    return false;
+  }
+
+  uint32_t capacity = old_capacity ? old_capacity : DEQUE_MINIMUM_CAPACITY;
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  dynamic_array_reserve(&d->buffer, capacity);
+  dynamic_array_resize(&d->buffer, capacity);
+
+  if (d->head + d->size > old_capacity) {
+    uint32_t wrapped = d->head + d->size - old_capacity;
+    memcpy(d->buffer.data + (size_t)old_capacity * d->buffer.object_size,
+           d->buffer.data, (size_t)wrapped * d->buffer.object_size);
+  }
+
+  return true;
+}
+
+/*
+ * Copies count elements between data and the deque starting index places
+ * from the front, in at most two pieces.
+ */
+static void deque_copy(deque *d, uint32_t index, void *data, uint32_t count,
+                       bool into_deque) {
+  uint32_t object_size = d->buffer.object_size;
+  uint32_t start = (d->head + index) & deque_mask(d);
+  uint32_t first = d->buffer.size - start;
+  first = count < first ? count : first;
+
+  char *slot = d->buffer.data + (size_t)start * object_size;
+  char *rest = (char *)data + (size_t)first * object_size;
+  size_t first_size = (size_t)first * object_size;
+  size_t rest_size = (size_t)(count - first) * object_size;
+
+  if (into_deque) {
+    memcpy(slot, data, first_size);
+    memcpy(d->buffer.data, rest, rest_size);
+  } else {
+    memcpy(data, slot, first_size);
+    memcpy(rest, d->buffer.data, rest_size);
+  }
+}
+
+deque deque_new(uint32_t object_size) {
+  return deque_new_with_allocator(object_size, NULL);
+}
+
+deque deque_new_with_allocator(uint32_t object_size,
+                               fennec_allocator const *allocator) {
+  return (deque){0, 0,
+                 dynamic_array_new_with_allocator(object_size, allocator)};
+}
+
+void deque_reserve(deque *d, uint32_t reserve_count) {
+  deque_grow_to(d, reserve_count);
+}
+
+void deque_push_back(deque *d, void const *data) {
+  if (!deque_grow_to(d, (uint64_t)d->size + 1)) {
+    return;
+  }
+
+  memcpy(deque_slot(d, d->size), data, d->buffer.object_size);
+  d->size += 1;
+}
+
+void deque_push_front(deque *d, void const *data) {
+  if (!deque_grow_to(d, (uint64_t)d->size + 1)) {
+    return;
+  }
+
+  d->head = (d->head - 1) & deque_mask(d);
+  memcpy(deque_slot(d, 0), data, d->buffer.object_size);
+  d->size += 1;
+}
+
+void deque_push_back_n(deque *d, void const *data, uint32_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  if (!deque_grow_to(d, (uint64_t)d->size + count)) {
+    return;
+  }
+  deque_copy(d, d->size, (void *)data, count, true);
+  d->size += count;
+}
+
+void deque_push_front_n(deque *d, void const *data, uint32_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  if (!deque_grow_to(d, (uint64_t)d->size + count)) {
+    return;
+  }
+  d->head = (d->head - count) & deque_mask(d);
+  deque_copy(d, 0, (void *)data, count, true);
+  d->size += count;
+}
+
+bool deque_pop_front(deque *d, void *out) {
+  return deque_pop_front_n(d, out, 1) == 1;
+}
+
+bool deque_pop_back(deque *d, void *out) {
+  return deque_pop_back_n(d, out, 1) == 1;
+}
+
+uint32_t deque_pop_front_n(deque *d, void *out, uint32_t count) {
+  count = count < d->size ? count : d->size;
+  if (count == 0) {
+    return 0;
+  }
+
+  if (out != NULL) {
+    deque_copy(d, 0, out, count, false);
+  }
+  d->head = (d->head + count) & deque_mask(d);
+  d->size -= count;
+  return count;
+}
+
+uint32_t deque_pop_back_n(deque *d, void *out, uint32_t count) {
+  count = count < d->size ? count : d->size;
+  if (count == 0) {
+    return 0;
+  }
+
+  if (out != NULL) {
+    deque_copy(d, d->size - count, out, count, false);
+  }
+  d->size -= count;
+  return count;
+}
+
+void *deque_get_at(deque const *d, uint32_t index) {
+  if (index >= d->size) {
+    return NULL;
+  }
+
+  return deque_slot(d, index);
+}
+
+void *deque_get_front(deque const *d) { return deque_get_at(d, 0); }
+
+void *deque_get_back(deque const *d) {
+  if (deque_is_empty(d)) {
+    return NULL;
+  }
+
+  return deque_get_at(d, d->size - 1);
+}
+
+bool deque_is_empty(deque const *d) { return d->size == 0; }
+
+void deque_clear(deque *d) {
+  d->head = 0;
+  d->size = 0;
+}
+
+void deque_free(deque *d) {
+  dynamic_array_free(&d->buffer);
+  *d = deque_new_with_allocator(d->buffer.object_size, d->buffer.allocator);
+}
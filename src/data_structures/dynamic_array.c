@@ -1,15 +1,63 @@
 #include "data_structures/dynamic_array.h"
 
-static void dynamic_array_grow_if_needed(dynamic_array *array) {
-  if (array->size > array->capacity) {
-    array->capacity = (uint32_t)ceil((array->capacity + 10) * 1.8);
-    array->data =
-        (char *)realloc(array->data, array->capacity * array->object_size);
+/*
+ * Moves data to an allocation of capacity elements. A borrowed buffer is
+ * copied out of instead of being reallocated (size may already count the
+ * elements being added, so only what fits in the buffer is copied).
+ */
+static void dynamic_array_reallocate(dynamic_array *array, uint32_t capacity) {
+  size_t old_size = (size_t)array->capacity * array->object_size;
+  size_t new_size = (size_t)capacity * array->object_size;
+
+  if (array->flags & dynamic_array_flag_borrowed_data) {
+    char *data = (char *)fennec_allocate(array->allocator, new_size);
+    uint32_t count =
+        array->size < array->capacity ? array->size : array->capacity;
+    memcpy(data, array->data, (size_t)count * array->object_size);
+    array->data = data;
+    array->flags &= ~(uint32_t)dynamic_array_flag_borrowed_data;
+  } else {
+    array->data = (char *)fennec_reallocate(array->allocator, array->data,
+                                            old_size, new_size);
   }
+  array->capacity = capacity;
+}
+
+/*
+ * Makes room for count elements with a single realloc, growing by the usual
+ * factor unless count needs even more.
+ */
+static void dynamic_array_grow_to(dynamic_array *array, uint32_t count) {
+  if (count > array->capacity) {
+    double grown = ceil((array->capacity + 10) * 1.8);
+    uint32_t new_capacity = grown < UINT32_MAX ? (uint32_t)grown : UINT32_MAX;
+    dynamic_array_reallocate(array,
+                             count > new_capacity ? count : new_capacity);
+  }
+}
+
+static void dynamic_array_grow_if_needed(dynamic_array *array) {
+  dynamic_array_grow_to(array, array->size);
 }
 
 dynamic_array dynamic_array_new(uint32_t object_size) {
-  return (dynamic_array){0, 0, object_size, NULL};
+  return (dynamic_array){0, 0, object_size, 0, NULL, NULL};
+}
+
+dynamic_array
+dynamic_array_new_with_allocator(uint32_t object_size,
+                                 fennec_allocator const *allocator) {
+  return (dynamic_array){0, 0, object_size, 0, NULL, allocator};
+}
+
+dynamic_array dynamic_array_new_with_buffer(uint32_t object_size, void *buffer,
+                                            uint32_t capacity) {
+  return (dynamic_array){0,
+                         capacity,
+                         object_size,
+                         dynamic_array_flag_borrowed_data,
+                         (char *)buffer,
+                         NULL};
 }
 
 dynamic_array dynamic_array_reserved_new(uint32_t object_size,
@@ -21,8 +69,7 @@ dynamic_array dynamic_array_reserved_new(uint32_t object_size,
 
 void dynamic_array_reserve(dynamic_array *array, uint32_t reserve_count) {
   if (array->capacity < reserve_count) {
-    array->capacity = reserve_count;
-    array->data = realloc(array->data, array->capacity * array->object_size);
+    dynamic_array_reallocate(array, reserve_count);
   }
 }
 
@@ -30,10 +77,49 @@ void dynamic_array_push_back(dynamic_array *array, void const *data) {
   uint32_t insertion_point = array->size++;
   dynamic_array_grow_if_needed(array);
 
-  memcpy(array->data + insertion_point * array->object_size, data,
+  memcpy(array->data + (size_t)insertion_point * array->object_size, data,
          array->object_size);
 }
 
+void dynamic_array_push_back_n(dynamic_array *array, void const *data,
+                               uint32_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  memcpy(dynamic_array_emplace_back_uninit(array, count), data,
+         (size_t)count * array->object_size);
+}
+
+void *dynamic_array_emplace_back_uninit(dynamic_array *array,
+                                        uint32_t count) {
+  uint32_t insertion_point = array->size;
+  dynamic_array_resize(array, array->size + count);
+
+  return array->data + (size_t)insertion_point * array->object_size;
+}
+
+void dynamic_array_insert_range(dynamic_array *array, uint32_t index,
+                                void const *data, uint32_t count) {
+  if (index > array->size || count == 0) {
+    return;
+  }
+
+  uint32_t tail_count = array->size - index;
+  dynamic_array_resize(array, array->size + count);
+
+  char *destination = array->data + (size_t)index * array->object_size;
+  size_t range_size = (size_t)count * array->object_size;
+  memmove(destination + range_size, destination,
+          (size_t)tail_count * array->object_size);
+  memcpy(destination, data, range_size);
+}
+
+void dynamic_array_resize(dynamic_array *array, uint32_t size) {
+  dynamic_array_grow_to(array, size);
+  array->size = size;
+}
+
 void dynamic_array_pop_back(dynamic_array *array) {
   if (array->size > 0) {
     array->size -= 1;
@@ -61,7 +147,7 @@ void *dynamic_array_get_at(dynamic_array *array, uint32_t index) {
     return NULL;
   }
 
-  return array->data + index * array->object_size;
+  return array->data + (size_t)index * array->object_size;
 }
 
 void dynamic_array_remove(dynamic_array *array, uint32_t index) {
@@ -71,13 +157,82 @@ void dynamic_array_remove(dynamic_array *array, uint32_t index) {
 
   array->size -= 1;
 
-  void *destination = array->data + index * array->object_size;
-  void *source = array->data + (index + 1) * array->object_size;
-  uint32_t move_size = (array->size - index) * array->object_size;
+  char *destination = array->data + (size_t)index * array->object_size;
+  char const *source = destination + array->object_size;
+  size_t move_size = (size_t)(array->size - index) * array->object_size;
 
   memmove(destination, source, move_size);
 }
 
+void dynamic_array_swap_remove(dynamic_array *array, uint32_t index) {
+  if (index >= array->size) {
+    return;
+  }
+
+  array->size -= 1;
+  if (index != array->size) {
+    memcpy(array->data + (size_t)index * array->object_size,
+           array->data + (size_t)array->size * array->object_size,
+           array->object_size);
+  }
+}
+
+/*
+ * Moves the count elements starting at from down to to, if they aren't
+ * already there.
+ */
+static void dynamic_array_move_run(dynamic_array *array, uint32_t to,
+                                   uint32_t from, uint32_t count) {
+  if (to != from && count > 0) {
+    memmove(array->data + (size_t)to * array->object_size,
+            array->data + (size_t)from * array->object_size,
+            (size_t)count * array->object_size);
+  }
+}
+
+uint32_t
+dynamic_array_remove_if(dynamic_array *array,
+                        dynamic_array_predicate_function_type predicate,
+                        void *context) {
+  uint32_t kept = 0;
+  uint32_t run_start = 0;
+
+  for (uint32_t i = 0; i < array->size; ++i) {
+    if (predicate(array->data + (size_t)i * array->object_size, context)) {
+      dynamic_array_move_run(array, kept, run_start, i - run_start);
+      kept += i - run_start;
+      run_start = i + 1;
+    }
+  }
+  dynamic_array_move_run(array, kept, run_start, array->size - run_start);
+  kept += array->size - run_start;
+
+  uint32_t removed = array->size - kept;
+  array->size = kept;
+  return removed;
+}
+
+uint32_t dynamic_array_remove_indices(dynamic_array *array,
+                                      uint32_t const *indices, uint32_t count) {
+  uint32_t kept = 0;
+  uint32_t run_start = 0;
+
+  for (uint32_t i = 0; i < count && indices[i] < array->size; ++i) {
+    if (indices[i] < run_start) {
+      continue;
+    }
+    dynamic_array_move_run(array, kept, run_start, indices[i] - run_start);
+    kept += indices[i] - run_start;
+    run_start = indices[i] + 1;
+  }
+  dynamic_array_move_run(array, kept, run_start, array->size - run_start);
+  kept += array->size - run_start;
+
+  uint32_t removed = array->size - kept;
+  array->size = kept;
+  return removed;
+}
+
 bool dynamic_array_is_empty(dynamic_array const *array) {
   return array->size == 0;
 }
@@ -85,16 +240,26 @@ bool dynamic_array_is_empty(dynamic_array const *array) {
 void dynamic_array_clear(dynamic_array *array) { array->size = 0; }
 
 void dynamic_array_shrink(dynamic_array *array) {
-  if (array->size == array->capacity) {
+  if (array->size == array->capacity ||
+      (array->flags & dynamic_array_flag_borrowed_data)) {
+    return;
+  }
+
+  if (array->size == 0) {
+    dynamic_array_free(array);
+    *array = dynamic_array_new_with_allocator(array->object_size,
+                                              array->allocator);
     return;
   }
 
-  array->capacity = array->size;
-  array->data = realloc(array->data, array->capacity * array->object_size);
+  dynamic_array_reallocate(array, array->size);
 }
 
 void dynamic_array_free(dynamic_array *array) {
-  if (array->data) {
-    free(array->data);
+  if (array->flags & dynamic_array_flag_borrowed_data) {
+    return;
   }
+
+  fennec_deallocate(array->allocator, array->data,
+                    (size_t)array->capacity * array->object_size);
 }
@@ -0,0 +1,541 @@
+#include "data_structures/dynamic_array.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#define DYNAMIC_ARRAY_INSERTION_SORT_SIZE 16
+#define DYNAMIC_ARRAY_PARALLEL_SORT_MIN_SIZE (1u << 16)
+#define DYNAMIC_ARRAY_MAX_SORT_THREADS 64
+
+/*
+ * Defines the loops that move elements around (introsort, radix scatter and
+ * merge) for one element size. SIZE is a constant for the common sizes, so
+ * every memcpy becomes a plain load and store, and object_size for the rest.
+ * temporary has room for two elements: a swap slot and the pivot.
+ */
+#define DYNAMIC_ARRAY_DEFINE_SORT(suffix, SIZE)                                \
+  static void dynamic_array_swap_##suffix(char *a, char *b,                    \
+                                          uint32_t object_size,                \
+                                          char *temporary) {                   \
+    (void)object_size;                                                         \
+    memcpy(temporary, a, SIZE);                                                \
+    memcpy(a, b, SIZE);                                                        \
+    memcpy(b, temporary, SIZE);                                                \
+  }                                                                            \
+                                                                               \
+  static void dynamic_array_insertion_sort_##suffix(                           \
+      char *base, size_t count, uint32_t object_size,                          \
+      dynamic_array_compare_function_type compare, char *temporary) {          \
+    (void)object_size;                                                         \
+    for (size_t i = 1; i < count; ++i) {                                       \
+      char *current = base + i * (SIZE);                                       \
+      if (compare(current - (SIZE), current) <= 0) {                           \
+        continue;                                                              \
+      }                                                                        \
+                                                                               \
+      memcpy(temporary, current, SIZE);                                        \
+      size_t j = i;                                                            \
+      do {                                                                     \
+        memcpy(base + j * (SIZE), base + (j - 1) * (SIZE), SIZE);              \
+        --j;                                                                   \
+      } while (j > 0 && compare(base + (j - 1) * (SIZE), temporary) > 0);      \
+      memcpy(base + j * (SIZE), temporary, SIZE);                              \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static void dynamic_array_sift_down_##suffix(                                \
+      char *base, size_t root, size_t count, uint32_t object_size,             \
+      dynamic_array_compare_function_type compare, char *temporary) {          \
+    (void)object_size;                                                         \
+    memcpy(temporary, base + root * (SIZE), SIZE);                             \
+    for (size_t child = root * 2 + 1; child < count; child = root * 2 + 1) {   \
+      if (child + 1 < count &&                                                 \
+          compare(base + child * (SIZE), base + (child + 1) * (SIZE)) < 0) {   \
+        child += 1;                                                            \
+      }                                                                        \
+      if (compare(temporary, base + child * (SIZE)) >= 0) {                    \
+        break;                                                                 \
+      }                                                                        \
+      memcpy(base + root * (SIZE), base + child * (SIZE), SIZE);               \
+      root = child;                                                            \
+    }                                                                          \
+    memcpy(base + root * (SIZE), temporary, SIZE);                             \
+  }                                                                            \
+                                                                               \
+  static void dynamic_array_heap_sort_##suffix(                                \
+      char *base, size_t count, uint32_t object_size,                          \
+      dynamic_array_compare_function_type compare, char *temporary) {          \
+    for (size_t i = count / 2; i-- > 0;) {                                     \
+      dynamic_array_sift_down_##suffix(base, i, count, object_size, compare,   \
+                                       temporary);                             \
+    }                                                                          \
+    for (size_t end = count - 1; end > 0; --end) {                             \
+      dynamic_array_swap_##suffix(base, base + end * (SIZE), object_size,      \
+                                  temporary);                                  \
+      dynamic_array_sift_down_##suffix(base, 0, end, object_size, compare,     \
+                                       temporary);                             \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static void dynamic_array_introsort_##suffix(                                \
+      char *base, size_t count, uint32_t depth, uint32_t object_size,          \
+      dynamic_array_compare_function_type compare, char *temporary) {          \
+    char *pivot = temporary + (SIZE);                                          \
+                                                                               \
+    while (count > DYNAMIC_ARRAY_INSERTION_SORT_SIZE) {                        \
+      if (depth == 0) {                                                        \
+        dynamic_array_heap_sort_##suffix(base, count, object_size, compare,    \
+                                         temporary);                           \
+        return;                                                                \
+      }                                                                        \
+      depth -= 1;                                                              \
+                                                                               \
+      /* Median of three, which also leaves sentinels at both ends. */         \
+      char *first = base;                                                      \
+      char *middle = base + (count / 2) * (SIZE);                              \
+      char *last = base + (count - 1) * (SIZE);                                \
+      if (compare(middle, first) < 0) {                                        \
+        dynamic_array_swap_##suffix(middle, first, object_size, temporary);    \
+      }                                                                        \
+      if (compare(last, middle) < 0) {                                         \
+        dynamic_array_swap_##suffix(last, middle, object_size, temporary);     \
+        if (compare(middle, first) < 0) {                                      \
+          dynamic_array_swap_##suffix(middle, first, object_size, temporary);  \
+        }                                                                      \
+      }                                                                        \
+      memcpy(pivot, middle, SIZE);                                             \
+                                                                               \
+      size_t i = 0;                                                            \
+      size_t j = count - 1;                                                    \
+      for (;;) {                                                               \
+        do {                                                                   \
+          ++i;                                                                 \
+        } while (compare(base + i * (SIZE), pivot) < 0);                       \
+        do {                                                                   \
+          --j;                                                                 \
+        } while (compare(pivot, base + j * (SIZE)) < 0);                       \
+        if (i >= j) {                                                          \
+          break;                                                               \
+        }                                                                      \
+        dynamic_array_swap_##suffix(base + i * (SIZE), base + j * (SIZE),      \
+                                    object_size, temporary);                   \
+      }                                                                        \
+                                                                               \
+      /* Recurse into the smaller side so the stack stays O(log n). */        \
+      if (i < count - i) {                                                     \
+        dynamic_array_introsort_##suffix(base, i, depth, object_size, compare, \
+                                         temporary);                           \
+        base += i * (SIZE);                                                    \
+        count -= i;                                                            \
+      } else {                                                                 \
+        dynamic_array_introsort_##suffix(base + i * (SIZE), count - i, depth,  \
+                                         object_size, compare, temporary);     \
+        count = i;                                                             \
+      }                                                                        \
+    }                                                                          \
+                                                                               \
+    dynamic_array_insertion_sort_##suffix(base, count, object_size, compare,   \
+                                          temporary);                          \
+  }                                                                            \
+                                                                               \
+  static void dynamic_array_radix_scatter_##suffix(                            \
+      char const *from, char *to, size_t count, uint32_t object_size,          \
+      uint32_t key_offset, uint32_t key_size, uint32_t shift,                  \
+      size_t *offsets) {                                                       \
+    (void)object_size;                                                         \
+    for (size_t i = 0; i < count; ++i) {                                       \
+      char const *element = from + i * (SIZE);                                 \
+      uint64_t key = 0;                                                        \
+      if (key_size == 4) {                                                     \
+        uint32_t key32;                                                        \
+        memcpy(&key32, element + key_offset, 4);                               \
+        key = key32;                                                           \
+      } else {                                                                 \
+        memcpy(&key, element + key_offset, 8);                                 \
+      }                                                                        \
+      memcpy(to + offsets[(key >> shift) & 0xFF]++ * (SIZE), element, SIZE);   \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static void dynamic_array_merge_##suffix(                                    \
+      char const *left, size_t left_count, char const *right,                  \
+      size_t right_count, char *output, uint32_t object_size,                  \
+      dynamic_array_compare_function_type compare) {                           \
+    (void)object_size;                                                         \
+    char const *left_end = left + left_count * (SIZE);                         \
+    char const *right_end = right + right_count * (SIZE);                      \
+    while (left != left_end && right != right_end) {                           \
+      if (compare(left, right) <= 0) {                                         \
+        memcpy(output, left, SIZE);                                            \
+        left += (SIZE);                                                        \
+      } else {                                                                 \
+        memcpy(output, right, SIZE);                                           \
+        right += (SIZE);                                                       \
+      }                                                                        \
+      output += (SIZE);                                                        \
+    }                                                                          \
+    memcpy(output, left, (size_t)(left_end - left));                           \
+    memcpy(output + (left_end - left), right, (size_t)(right_end - right));    \
+  }
+
+DYNAMIC_ARRAY_DEFINE_SORT(4, 4)
+DYNAMIC_ARRAY_DEFINE_SORT(8, 8)
+DYNAMIC_ARRAY_DEFINE_SORT(16, 16)
+DYNAMIC_ARRAY_DEFINE_SORT(any, object_size)
+
+static void dynamic_array_sort_range(
+    char *base, size_t count, uint32_t object_size,
+    dynamic_array_compare_function_type compare) {
+  if (count < 2) {
+    return;
+  }
+
+  uint32_t depth = 0;
+  for (size_t n = count; n > 1; n >>= 1) {
+    depth += 2;
+  }
+
+  max_align_t stack_temporary[4];
+  char *temporary = object_size * 2 <= sizeof(stack_temporary)
+                        ? (char *)stack_temporary
+                        : (char *)malloc((size_t)object_size * 2);
+
+  switch (object_size) {
+  case 4:
+    dynamic_array_introsort_4(base, count, depth, 4, compare, temporary);
+    break;
+  case 8:
+    dynamic_array_introsort_8(base, count, depth, 8, compare, temporary);
+    break;
+  case 16:
+    dynamic_array_introsort_16(base, count, depth, 16, compare, temporary);
+    break;
+  default:
+    dynamic_array_introsort_any(base, count, depth, object_size, compare,
+                                temporary);
+  }
+
+  if (temporary != (char *)stack_temporary) {
+    free(temporary);
+  }
+}
+
+void dynamic_array_sort(dynamic_array *array,
+                        dynamic_array_compare_function_type compare) {
+  dynamic_array_sort_range(array->data, array->size, array->object_size,
+                           compare);
+}
+
+static uint32_t dynamic_array_key_size(dynamic_array_key_type key_type) {
+  return key_type <= dynamic_array_key_float ? 4 : 8;
+}
+
+/*
+ * Rewrites every key as an unsigned number with the same ordering (or back
+ * again), so the digit passes only deal with unsigned keys: signed keys get
+ * their sign bit flipped, negative floats all their bits.
+ */
+static void dynamic_array_radix_convert_keys(dynamic_array *array,
+                                             uint32_t key_offset,
+                                             dynamic_array_key_type key_type,
+                                             bool to_unsigned) {
+  if (key_type == dynamic_array_key_uint32 ||
+      key_type == dynamic_array_key_uint64) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < array->size; ++i) {
+    char *key =
+        array->data + (size_t)i * array->object_size + key_offset;
+
+    if (key_type == dynamic_array_key_int32) {
+      uint32_t bits;
+      memcpy(&bits, key, 4);
+      bits ^= 0x80000000u;
+      memcpy(key, &bits, 4);
+    } else if (key_type == dynamic_array_key_int64) {
+      uint64_t bits;
+      memcpy(&bits, key, 8);
+      bits ^= 0x8000000000000000ull;
+      memcpy(key, &bits, 8);
+    } else if (key_type == dynamic_array_key_float) {
+      uint32_t bits;
+      memcpy(&bits, key, 4);
+      bool negative = to_unsigned ? (bits >> 31) != 0 : (bits >> 31) == 0;
+      bits = negative ? ~bits : bits ^ 0x80000000u;
+      memcpy(key, &bits, 4);
+    } else {
+      uint64_t bits;
+      memcpy(&bits, key, 8);
+      bool negative = to_unsigned ? (bits >> 63) != 0 : (bits >> 63) == 0;
+      bits = negative ? ~bits : bits ^ 0x8000000000000000ull;
+      memcpy(key, &bits, 8);
+    }
+  }
+}
+
+void dynamic_array_radix_sort(dynamic_array *array, uint32_t key_offset,
+                              dynamic_array_key_type key_type) {
+  if (array->size < 2) {
+    return;
+  }
+
+  uint32_t object_size = array->object_size;
+  uint32_t key_size = dynamic_array_key_size(key_type);
+  size_t byte_count = (size_t)array->size * object_size;
+  dynamic_array_radix_convert_keys(array, key_offset, key_type, true);
+
+  /* Every digit's histogram in one pass. */
+  size_t(*counts)[256] = calloc(key_size, sizeof(size_t[256]));
+  for (uint32_t i = 0; i < array->size; ++i) {
+    char const *key = array->data + (size_t)i * object_size + key_offset;
+    uint64_t bits = 0;
+    if (key_size == 4) {
+      uint32_t bits32;
+      memcpy(&bits32, key, 4);
+      bits = bits32;
+    } else {
+      memcpy(&bits, key, 8);
+    }
+
+    for (uint32_t digit = 0; digit < key_size; ++digit) {
+      counts[digit][(bits >> (digit * 8)) & 0xFF] += 1;
+    }
+  }
+
+  char *from = array->data;
+  char *to = (char *)fennec_allocate(array->allocator, byte_count);
+  for (uint32_t digit = 0; digit < key_size; ++digit) {
+    size_t offsets[256];
+    size_t total = 0;
+    bool all_same = false;
+    for (uint32_t value = 0; value < 256; ++value) {
+      all_same = all_same || counts[digit][value] == array->size;
+      offsets[value] = total;
+      total += counts[digit][value];
+    }
+    if (all_same) {
+      continue;
+    }
+
+    uint32_t shift = digit * 8;
+    switch (object_size) {
+    case 4:
+      dynamic_array_radix_scatter_4(from, to, array->size, 4, key_offset,
+                                    key_size, shift, offsets);
+      break;
+    case 8:
+      dynamic_array_radix_scatter_8(from, to, array->size, 8, key_offset,
+                                    key_size, shift, offsets);
+      break;
+    case 16:
+      dynamic_array_radix_scatter_16(from, to, array->size, 16, key_offset,
+                                     key_size, shift, offsets);
+      break;
+    default:
+      dynamic_array_radix_scatter_any(from, to, array->size, object_size,
+                                      key_offset, key_size, shift, offsets);
+    }
+
+    char *swap = from;
+    from = to;
+    to = swap;
+  }
+
+  if (from != array->data) {
+    memcpy(array->data, from, byte_count);
+    to = from;
+  }
+  fennec_deallocate(array->allocator, to, byte_count);
+  free(counts);
+
+  dynamic_array_radix_convert_keys(array, key_offset, key_type, false);
+}
+
+/*
+ * One thread's share of a parallel sort: sorts left in place when output is
+ * NULL, otherwise merges left and right into output.
+ */
+typedef struct {
+  char *left;
+  size_t left_count;
+  char *right;
+  size_t right_count;
+  char *output;
+  uint32_t object_size;
+  dynamic_array_compare_function_type compare;
+} dynamic_array_sort_task;
+
+static void *dynamic_array_run_sort_task(void *argument) {
+  dynamic_array_sort_task const *task = argument;
+
+  if (task->output == NULL) {
+    dynamic_array_sort_range(task->left, task->left_count, task->object_size,
+                             task->compare);
+    return NULL;
+  }
+
+  switch (task->object_size) {
+  case 4:
+    dynamic_array_merge_4(task->left, task->left_count, task->right,
+                          task->right_count, task->output, 4, task->compare);
+    break;
+  case 8:
+    dynamic_array_merge_8(task->left, task->left_count, task->right,
+                          task->right_count, task->output, 8, task->compare);
+    break;
+  case 16:
+    dynamic_array_merge_16(task->left, task->left_count, task->right,
+                           task->right_count, task->output, 16, task->compare);
+    break;
+  default:
+    dynamic_array_merge_any(task->left, task->left_count, task->right,
+                            task->right_count, task->output, task->object_size,
+                            task->compare);
+  }
+  return NULL;
+}
+
+/*
+ * Runs task 0 on the calling thread and the rest on their own threads (or
+ * also on the calling thread if one can't be started).
+ */
+static void dynamic_array_run_sort_tasks(dynamic_array_sort_task *tasks,
+                                         uint32_t count) {
+  pthread_t threads[DYNAMIC_ARRAY_MAX_SORT_THREADS];
+  bool started[DYNAMIC_ARRAY_MAX_SORT_THREADS] = {false};
+
+  for (uint32_t i = 1; i < count; ++i) {
+    started[i] = pthread_create(&threads[i], NULL, dynamic_array_run_sort_task,
+                                &tasks[i]) == 0;
+    if (!started[i]) {
+      dynamic_array_run_sort_task(&tasks[i]);
+    }
+  }
+
+  dynamic_array_run_sort_task(&tasks[0]);
+
+  for (uint32_t i = 1; i < count; ++i) {
+    if (started[i]) {
+      pthread_join(threads[i], NULL);
+    }
+  }
+}
+
+/*
+ * The number of elements of left that are among the first k elements of the
+ * merge of left and right (which takes from left on ties).
+ */
+static size_t dynamic_array_merge_split(
+    char const *left, size_t left_count, char const *right, size_t right_count,
+    size_t k, uint32_t object_size,
+    dynamic_array_compare_function_type compare) {
+  size_t low = k > right_count ? k - right_count : 0;
+  size_t high = k < left_count ? k : left_count;
+
+  while (low < high) {
+    size_t i = low + (high - low) / 2;
+    size_t j = k - i;
+    if (compare(right + (j - 1) * object_size, left + i * object_size) >= 0) {
+      low = i + 1;
+    } else {
+      high = i;
+    }
+  }
+
+  return low;
+}
+
+void dynamic_array_parallel_sort(dynamic_array *array,
+                                 dynamic_array_compare_function_type compare,
+                                 uint32_t thread_count) {
+  if (thread_count == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    thread_count = online > 0 ? (uint32_t)online : 1;
+  }
+  if (thread_count > DYNAMIC_ARRAY_MAX_SORT_THREADS) {
+    thread_count = DYNAMIC_ARRAY_MAX_SORT_THREADS;
+  }
+
+  uint32_t runs = 1;
+  while (runs * 2 <= thread_count) {
+    runs *= 2;
+  }
+
+  if (runs == 1 || array->size < DYNAMIC_ARRAY_PARALLEL_SORT_MIN_SIZE) {
+    dynamic_array_sort(array, compare);
+    return;
+  }
+
+  uint32_t object_size = array->object_size;
+  size_t count = array->size;
+  size_t bounds[DYNAMIC_ARRAY_MAX_SORT_THREADS + 1];
+  dynamic_array_sort_task tasks[DYNAMIC_ARRAY_MAX_SORT_THREADS];
+
+  for (uint32_t run = 0; run <= runs; ++run) {
+    bounds[run] = count * run / runs;
+  }
+  for (uint32_t run = 0; run < runs; ++run) {
+    tasks[run] = (dynamic_array_sort_task){
+        array->data + bounds[run] * object_size,
+        bounds[run + 1] - bounds[run],
+        NULL,
+        0,
+        NULL,
+        object_size,
+        compare};
+  }
+  dynamic_array_run_sort_tasks(tasks, runs);
+
+  char *from = array->data;
+  char *to = (char *)fennec_allocate(array->allocator, count * object_size);
+
+  /* Each round merges pairs of runs, every pair split between threads. */
+  for (uint32_t pairs = runs / 2; pairs > 0; pairs /= 2) {
+    uint32_t pieces = runs / pairs;
+
+    for (uint32_t pair = 0; pair < pairs; ++pair) {
+      size_t start = bounds[pair * 2];
+      char *left = from + start * object_size;
+      size_t left_count = bounds[pair * 2 + 1] - start;
+      char *right = from + bounds[pair * 2 + 1] * object_size;
+      size_t right_count = bounds[pair * 2 + 2] - bounds[pair * 2 + 1];
+      size_t total = left_count + right_count;
+
+      size_t split = 0;
+      for (uint32_t piece = 0; piece < pieces; ++piece) {
+        size_t k = total * (piece + 1) / pieces;
+        size_t next_split =
+            dynamic_array_merge_split(left, left_count, right, right_count, k,
+                                      object_size, compare);
+        size_t k_begin = total * piece / pieces;
+        size_t right_begin = k_begin - split;
+
+        tasks[pair * pieces + piece] = (dynamic_array_sort_task){
+            left + split * object_size,
+            next_split - split,
+            right + right_begin * object_size,
+            (k - next_split) - right_begin,
+            to + (start + k_begin) * object_size,
+            object_size,
+            compare};
+        split = next_split;
+      }
+    }
+    dynamic_array_run_sort_tasks(tasks, runs);
+
+    for (uint32_t pair = 0; pair <= pairs; ++pair) {
+      bounds[pair] = bounds[pair * 2];
+    }
+
+    char *swap = from;
+    from = to;
+    to = swap;
+  }
+
+  if (from != array->data) {
+    memcpy(array->data, from, count * object_size);
+    to = from;
+  }
+  fennec_deallocate(array->allocator, to, count * object_size);
+}
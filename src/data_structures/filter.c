@@ -0,0 +1,299 @@
+#include "data_structures/filter.h"
+
+#define BLOOM_FILTER_BLOCK_BYTES (BLOOM_FILTER_BLOCK_WORDS * sizeof(uint32_t))
+#define BLOOM_FILTER_BLOCKING_OVERHEAD 1.2
+#define CUCKOO_FILTER_LOAD_FACTOR 0.9
+#define CUCKOO_FILTER_MAX_KICKS 500
+#define CUCKOO_FILTER_LANES 0x0001000100010001ull
+
+/*
+ * One odd multiplier per word of a block, each picking a different bit for
+ * the same key.
+ */
+static uint32_t const bloom_filter_salts[BLOOM_FILTER_BLOCK_WORDS] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+
+/*
+ * Spreads a key's hash (which may be weak, e.g. the identity for integers)
+ * over 64 bits: the high half picks a block or bucket, the low half the bits
+ * or fingerprint.
+ */
+static uint64_t filter_spread(uint32_t hash) {
+  return hash_mix32(hash) * 0x9e3779b97f4a7c15ull;
+}
+
+static uint32_t const *bloom_filter_block(bloom_filter const *filter,
+                                          uint64_t spread) {
+  uint32_t index =
+      (uint32_t)(((spread >> 32) * (uint64_t)filter->block_count) >> 32);
+  return filter->blocks + (size_t)index * BLOOM_FILTER_BLOCK_WORDS;
+}
+
+/*
+ * The bit each word of the block gets for a key. Written as a plain loop
+ * over the words so the compiler can do all of them in one vector.
+ */
+static void bloom_filter_masks(uint32_t key_bits,
+                               uint32_t masks[BLOOM_FILTER_BLOCK_WORDS]) {
+  for (uint32_t i = 0; i < BLOOM_FILTER_BLOCK_WORDS; ++i) {
+    masks[i] = 1u << ((key_bits * bloom_filter_salts[i]) >> 27);
+  }
+}
+
+bloom_filter bloom_filter_new(uint32_t expected_count,
+                              double false_positive_rate,
+                              hash_function_type hash_function) {
+  if (false_positive_rate <= 0.0 || false_positive_rate >= 1.0) {
+    false_positive_rate = 0.01;
+  }
+
+  double bits_per_key = -log(false_positive_rate) / (log(2.0) * log(2.0)) *
+                        BLOOM_FILTER_BLOCKING_OVERHEAD;
+  double bits = ceil(bits_per_key * expected_count);
+  uint32_t block_count =
+      (uint32_t)ceil(bits / (BLOOM_FILTER_BLOCK_BYTES * 8.0));
+  if (block_count == 0) {
+    block_count = 1;
+  }
+
+  bloom_filter filter = {block_count, NULL, hash_function};
+  filter.blocks = (uint32_t *)aligned_alloc(
+      BLOOM_FILTER_BLOCK_BYTES, block_count * BLOOM_FILTER_BLOCK_BYTES);
+  bloom_filter_clear(&filter);
+  return filter;
+}
+
+void bloom_filter_add(bloom_filter *filter, void const *key) {
+  bloom_filter_add_hash(filter, filter->hash_function(key));
+}
+
+void bloom_filter_add_hash(bloom_filter *filter, uint32_t hash) {
+  uint64_t spread = filter_spread(hash);
+  uint32_t *block = (uint32_t *)bloom_filter_block(filter, spread);
+  uint32_t masks[BLOOM_FILTER_BLOCK_WORDS];
+
+  bloom_filter_masks((uint32_t)spread, masks);
+  for (uint32_t i = 0; i < BLOOM_FILTER_BLOCK_WORDS; ++i) {
+    block[i] |= masks[i];
+  }
+}
+
+bool bloom_filter_contains(bloom_filter const *filter, void const *key) {
+  return bloom_filter_contains_hash(filter, filter->hash_function(key));
+}
+
+bool bloom_filter_contains_hash(bloom_filter const *filter, uint32_t hash) {
+  uint64_t spread = filter_spread(hash);
+  uint32_t const *block = bloom_filter_block(filter, spread);
+  uint32_t masks[BLOOM_FILTER_BLOCK_WORDS];
+  uint32_t missing = 0;
+
+  bloom_filter_masks((uint32_t)spread, masks);
+  for (uint32_t i = 0; i < BLOOM_FILTER_BLOCK_WORDS; ++i) {
+    missing |= masks[i] & ~block[i];
+  }
+
+  return missing == 0;
+}
+
+void bloom_filter_clear(bloom_filter *filter) {
+  if (filter->blocks != NULL) {
+    memset(filter->blocks, 0,
+           filter->block_count * BLOOM_FILTER_BLOCK_BYTES);
+  }
+}
+
+void bloom_filter_free(bloom_filter *filter) {
+  free(filter->blocks);
+  filter->blocks = NULL;
+  filter->block_count = 0;
+}
+
+/*
+ * Splits a hash into a non-zero fingerprint and the first of its two
+ * buckets.
+ */
+static uint16_t cuckoo_filter_locate(cuckoo_filter const *filter,
+                                     uint32_t hash, uint32_t *index) {
+  uint64_t spread = filter_spread(hash);
+  uint16_t fingerprint = (uint16_t)spread;
+
+  *index = (uint32_t)(spread >> 32) & (filter->bucket_count - 1);
+  return fingerprint != 0 ? fingerprint : 1;
+}
+
+/*
+ * A fingerprint's other bucket. Applying it twice gets back to the first, so
+ * a fingerprint can be moved without knowing its key.
+ */
+static uint32_t cuckoo_filter_alternate(cuckoo_filter const *filter,
+                                        uint32_t index, uint16_t fingerprint) {
+  return (index ^ (fingerprint * 0x5bd1e995u)) & (filter->bucket_count - 1);
+}
+
+/*
+ * Tests all 4 fingerprints of a bucket at once: lanes equal to fingerprint
+ * become zero, and the subtraction borrows out of (only) zero lanes.
+ */
+static bool cuckoo_filter_bucket_has(uint64_t bucket, uint16_t fingerprint) {
+  uint64_t lanes = bucket ^ (CUCKOO_FILTER_LANES * fingerprint);
+  return ((lanes - CUCKOO_FILTER_LANES) & ~lanes &
+          (CUCKOO_FILTER_LANES << 15)) != 0;
+}
+
+static uint16_t cuckoo_filter_lane(uint64_t bucket, uint32_t lane) {
+  return (uint16_t)(bucket >> (lane * 16));
+}
+
+static void cuckoo_filter_set_lane(uint64_t *bucket, uint32_t lane,
+                                   uint16_t fingerprint) {
+  *bucket &= ~(0xffffull << (lane * 16));
+  *bucket |= (uint64_t)fingerprint << (lane * 16);
+}
+
+/*
+ * Replaces the first lane holding from with to.
+ */
+static bool cuckoo_filter_replace(uint64_t *bucket, uint16_t from,
+                                  uint16_t to) {
+  if (!cuckoo_filter_bucket_has(*bucket, from)) {
+    return false;
+  }
+
+  for (uint32_t lane = 0; lane < CUCKOO_FILTER_BUCKET_SIZE; ++lane) {
+    if (cuckoo_filter_lane(*bucket, lane) == from) {
+      cuckoo_filter_set_lane(bucket, lane, to);
+      break;
+    }
+  }
+  return true;
+}
+
+static bool cuckoo_filter_place(cuckoo_filter *filter, uint32_t index,
+                                uint16_t fingerprint) {
+  return cuckoo_filter_replace(&filter->buckets[index], 0, fingerprint) ||
+         cuckoo_filter_replace(
+             &filter->buckets[cuckoo_filter_alternate(filter, index,
+                                                      fingerprint)],
+             0, fingerprint);
+}
+
+cuckoo_filter cuckoo_filter_new(uint32_t expected_count,
+                                hash_function_type hash_function) {
+  uint32_t needed = (uint32_t)ceil(
+      expected_count / (CUCKOO_FILTER_BUCKET_SIZE * CUCKOO_FILTER_LOAD_FACTOR));
+  uint32_t bucket_count = 2;
+  while (bucket_count < needed) {
+    bucket_count = bucket_count << 1;
+  }
+
+  cuckoo_filter filter = {0, bucket_count, NULL, hash_function, false, 0, 0};
+  filter.buckets = (uint64_t *)calloc(bucket_count, sizeof(uint64_t));
+  return filter;
+}
+
+bool cuckoo_filter_add(cuckoo_filter *filter, void const *key) {
+  return cuckoo_filter_add_hash(filter, filter->hash_function(key));
+}
+
+bool cuckoo_filter_add_hash(cuckoo_filter *filter, uint32_t hash) {
+  if (filter->has_victim) {
+    return false;
+  }
+
+  uint32_t index;
+  uint16_t fingerprint = cuckoo_filter_locate(filter, hash, &index);
+  filter->size += 1;
+
+  if (cuckoo_filter_place(filter, index, fingerprint)) {
+    return true;
+  }
+
+  /* Both buckets are full: evict fingerprints until one lands somewhere. */
+  for (uint32_t kick = 0; kick < CUCKOO_FILTER_MAX_KICKS; ++kick) {
+    uint32_t lane = (fingerprint + kick) % CUCKOO_FILTER_BUCKET_SIZE;
+    uint64_t *bucket = &filter->buckets[index];
+    uint16_t evicted = cuckoo_filter_lane(*bucket, lane);
+
+    cuckoo_filter_set_lane(bucket, lane, fingerprint);
+    fingerprint = evicted;
+    index = cuckoo_filter_alternate(filter, index, fingerprint);
+
+    if (cuckoo_filter_replace(&filter->buckets[index], 0, fingerprint)) {
+      return true;
+    }
+  }
+
+  filter->has_victim = true;
+  filter->victim_fingerprint = fingerprint;
+  filter->victim_index = index;
+  return true;
+}
+
+bool cuckoo_filter_contains(cuckoo_filter const *filter, void const *key) {
+  return cuckoo_filter_contains_hash(filter, filter->hash_function(key));
+}
+
+static bool cuckoo_filter_is_victim(cuckoo_filter const *filter,
+                                    uint32_t index, uint16_t fingerprint) {
+  return filter->has_victim && filter->victim_fingerprint == fingerprint &&
+         (filter->victim_index == index ||
+          filter->victim_index ==
+              cuckoo_filter_alternate(filter, index, fingerprint));
+}
+
+bool cuckoo_filter_contains_hash(cuckoo_filter const *filter, uint32_t hash) {
+  uint32_t index;
+  uint16_t fingerprint = cuckoo_filter_locate(filter, hash, &index);
+  uint32_t alternate = cuckoo_filter_alternate(filter, index, fingerprint);
+
+  return cuckoo_filter_bucket_has(filter->buckets[index], fingerprint) ||
+         cuckoo_filter_bucket_has(filter->buckets[alternate], fingerprint) ||
+         cuckoo_filter_is_victim(filter, index, fingerprint);
+}
+
+bool cuckoo_filter_remove(cuckoo_filter *filter, void const *key) {
+  return cuckoo_filter_remove_hash(filter, filter->hash_function(key));
+}
+
+bool cuckoo_filter_remove_hash(cuckoo_filter *filter, uint32_t hash) {
+  uint32_t index;
+  uint16_t fingerprint = cuckoo_filter_locate(filter, hash, &index);
+  uint32_t alternate = cuckoo_filter_alternate(filter, index, fingerprint);
+
+  if (cuckoo_filter_is_victim(filter, index, fingerprint)) {
+    filter->has_victim = false;
+    filter->size -= 1;
+    return true;
+  }
+
+  if (!cuckoo_filter_replace(&filter->buckets[index], fingerprint, 0) &&
+      !cuckoo_filter_replace(&filter->buckets[alternate], fingerprint, 0)) {
+    return false;
+  }
+  filter->size -= 1;
+
+  /* There may be room for the victim now. */
+  if (filter->has_victim &&
+      cuckoo_filter_place(filter, filter->victim_index,
+                          filter->victim_fingerprint)) {
+    filter->has_victim = false;
+  }
+  return true;
+}
+
+void cuckoo_filter_clear(cuckoo_filter *filter) {
+  if (filter->buckets != NULL) {
+    memset(filter->buckets, 0, filter->bucket_count * sizeof(uint64_t));
+  }
+  filter->size = 0;
+  filter->has_victim = false;
+}
+
+void cuckoo_filter_free(cuckoo_filter *filter) {
+  free(filter->buckets);
+  filter->buckets = NULL;
+  filter->bucket_count = 0;
+  cuckoo_filter_clear(filter);
+}
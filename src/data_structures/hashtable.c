@@ -1,40 +1,91 @@
-#include "data_structures/hashtable.h"
+#include "hashtable_internal.h"
+#include <stddef.h>
 
 #define HASHTABLE_MAX_LOAD_FACTOR 0.85f
-#define HASHTABLE_INITIAL_CAPACITY 16
+#define HASHTABLE_BATCH_SIZE 32
+#define HASHTABLE_MIGRATION_STEP 16
+#define HASHTABLE_FILTER_ATTEMPTS 4
 
 struct hashtable_bucket;
 typedef struct {
   struct hashtable_bucket *next;
   bool is_valid;
   uint32_t probe_count;
+  uint32_t hash;
   void *key;
   char value[];
 } hashtable_bucket;
 
-static uint32_t hashtable_string_hash(void const *string) {
-  char const *s = (char const *)string;
-  uint32_t hash = 0;
-  while (*s)
-    hash = hash * 101 + *s++;
-  return hash;
+uint32_t hashtable_string_hash(void const *string) {
+  uint32_t length = (uint32_t)strlen((char const *)string);
+  uint64_t hash = hash_wyhash(string, length, 0);
+  return (uint32_t)(hash ^ (hash >> 32));
 }
 
-static bool hashtable_string_comparison(void const *string1,
-                                        void const *string2) {
+bool hashtable_string_comparison(void const *string1, void const *string2) {
   return strcmp((char const *)string1, (char const *)string2) == 0;
 }
 
-static void *hashtable_string_copy(void const *string) {
+void *hashtable_string_copy(void const *string) {
   return strdup((char const *)string);
 }
 
-static void *hashtable_passthrough_copy(void const *data) {
-  return (void *)data;
+static char *hashtable_key_arena_allocate(hashtable *table, uint32_t size) {
+  hashtable_key_arena *chunk = table->key_arena;
+
+  if (chunk == NULL || chunk->capacity - chunk->used < size) {
+    uint32_t capacity = size > HASHTABLE_KEY_ARENA_CHUNK_SIZE
+                            ? size
+                            : HASHTABLE_KEY_ARENA_CHUNK_SIZE;
+    chunk = (hashtable_key_arena *)fennec_allocate(
+        table->allocator, sizeof(hashtable_key_arena) + capacity);
+    chunk->next = table->key_arena;
+    chunk->used = 0;
+    chunk->capacity = capacity;
+    table->key_arena = chunk;
+  }
+
+  char *result = chunk->data + chunk->used;
+  chunk->used += size;
+  return result;
+}
+
+void *hashtable_store_key(hashtable *table, char *inline_key, void const *key) {
+  if ((table->flags & hashtable_flag_arena_keys) == 0) {
+    return table->copy_function(key);
+  }
+
+  uint32_t size = (uint32_t)strlen((char const *)key) + 1;
+  if (size <= hashtable_inline_key_size(table)) {
+    memcpy(inline_key, key, size);
+    return NULL;
+  }
+
+  char *copy = hashtable_key_arena_allocate(table, size);
+  memcpy(copy, key, size);
+  return copy;
+}
+
+void hashtable_release_key(hashtable const *table, void *stored_key) {
+  if ((table->flags & hashtable_flag_arena_keys) == 0) {
+    free(stored_key);
+  }
+}
+
+void hashtable_free_key_arena(hashtable *table) {
+  hashtable_key_arena *chunk = table->key_arena;
+  while (chunk != NULL) {
+    hashtable_key_arena *next = chunk->next;
+    fennec_deallocate(table->allocator, chunk,
+                      sizeof(hashtable_key_arena) + chunk->capacity);
+    chunk = next;
+  }
+
+  table->key_arena = NULL;
 }
 
 static float hashtable_calculate_load_factor(hashtable const *table) {
-  if (table->capacity == HASHTABLE_INITIAL_CAPACITY) {
+  if (table->data == NULL) {
     return 1.f;
   }
 
@@ -42,7 +93,41 @@ static float hashtable_calculate_load_factor(hashtable const *table) {
 }
 
 static uint32_t hashtable_calculate_bucket_size(hashtable const *table) {
-  return sizeof(hashtable_bucket) + table->object_size;
+  uint32_t size = sizeof(hashtable_bucket) + table->object_size +
+                  hashtable_inline_key_size(table);
+  return (size + sizeof(void *) - 1) & ~(uint32_t)(sizeof(void *) - 1);
+}
+
+static char *hashtable_bucket_inline_key(hashtable const *table,
+                                         hashtable_bucket const *bucket) {
+  return (char *)bucket->value + table->object_size;
+}
+
+static void const *hashtable_bucket_key(hashtable const *table,
+                                        hashtable_bucket const *bucket) {
+  return hashtable_stored_key(bucket->key,
+                              hashtable_bucket_inline_key(table, bucket));
+}
+
+static hashtable_bucket *hashtable_claim_bucket(hashtable *table,
+                                                uint32_t hashed_key);
+static void hashtable_release(hashtable *table);
+static void *hashtable_lookup_hashed_value(
+    hashtable const *table, void const *key, uint32_t hashed_key,
+    hash_comparison_function_type comparison_function);
+
+/*
+ * Buckets keep their full hash, so moving them never calls the hash function
+ * and the already copied keys are moved as is.
+ */
+static void hashtable_move_bucket(hashtable *table,
+                                  hashtable_bucket const *from) {
+  hashtable_bucket *bucket = hashtable_claim_bucket(table, from->hash);
+  bucket->is_valid = true;
+  bucket->hash = from->hash;
+  bucket->key = from->key;
+  memcpy(bucket->value, from->value,
+         table->object_size + hashtable_inline_key_size(table));
 }
 
 static void hashtable_reallocate(hashtable *table, uint32_t new_capacity) {
@@ -50,36 +135,118 @@ static void hashtable_reallocate(hashtable *table, uint32_t new_capacity) {
   uint32_t old_capacity = table->capacity;
 
   uint32_t bucket_size = hashtable_calculate_bucket_size(table);
-  uint32_t new_size = bucket_size * new_capacity;
-  table->data = (char *)malloc(new_size);
-  memset(table->data, 0, new_size);
+  table->data = (char *)fennec_allocate_zeroed(table->allocator, new_capacity,
+                                               bucket_size);
   table->capacity = new_capacity;
-  table->size = 0;
 
   if (old_data == NULL) {
     return;
   }
+  hashtable_count_resize(table);
 
-  hash_key_copy_function_type copy_func = table->copy_function;
-  table->copy_function = hashtable_passthrough_copy;
   for (uint32_t i = 0; i < old_capacity; ++i) {
     hashtable_bucket *current =
         (hashtable_bucket *)(old_data + bucket_size * i);
 
     if (current->is_valid) {
-      hashtable_insert(table, current->key, current->value);
+      hashtable_move_bucket(table, current);
     }
   }
-  table->copy_function = copy_func;
 
-  free(old_data);
+  fennec_deallocate(table->allocator, old_data,
+                    (size_t)old_capacity * bucket_size);
+}
+
+/*
+ * Moves every bucket of the chain that starts at home into the new array and
+ * clears them out of the old one.
+ */
+static void hashtable_migrate_chain(hashtable *table, hashtable_bucket *home,
+                                    uint32_t bucket_size) {
+  hashtable_bucket *current = home;
+  do {
+    hashtable_bucket *next = (hashtable_bucket *)current->next;
+    hashtable_move_bucket(table, current);
+    memset(current, 0, bucket_size);
+    current = next;
+  } while (current != home);
+}
+
+/*
+ * Walks at most HASHTABLE_MIGRATION_STEP buckets of the old array. Chains are
+ * only ever moved from their home bucket, so a chain is always entirely in one
+ * of the two arrays.
+ */
+static void hashtable_migrate_step(hashtable *table, uint32_t step) {
+  if (table->old_data == NULL) {
+    return;
+  }
+
+  uint32_t bucket_size = hashtable_calculate_bucket_size(table);
+  uint32_t end = table->old_capacity - table->migrate_index > step
+                     ? table->migrate_index + step
+                     : table->old_capacity;
+
+  for (; table->migrate_index < end; ++table->migrate_index) {
+    hashtable_bucket *current =
+        (hashtable_bucket *)(table->old_data +
+                             bucket_size * table->migrate_index);
+
+    if (current->is_valid && current->probe_count == 0) {
+      hashtable_migrate_chain(table, current, bucket_size);
+    }
+  }
+
+  if (table->migrate_index == table->old_capacity) {
+    fennec_deallocate(table->allocator, table->old_data,
+                      (size_t)table->old_capacity * bucket_size);
+    table->old_data = NULL;
+    table->old_capacity = 0;
+    table->migrate_index = 0;
+  }
+}
+
+static void hashtable_finish_migration(hashtable *table) {
+  hashtable_migrate_step(table, UINT32_MAX);
+}
+
+/*
+ * Incremental version of hashtable_reallocate. calloc keeps the new array from
+ * being touched up front (large blocks come straight from the OS already
+ * zeroed; a custom allocator has to clear it) and the elements are moved by
+ * later operations.
+ */
+static void hashtable_begin_migration(hashtable *table,
+                                      uint32_t new_capacity) {
+  hashtable_finish_migration(table);
+  hashtable_count_resize(table);
+
+  table->old_data = table->data;
+  table->old_capacity = table->capacity;
+  table->migrate_index = 0;
+  table->data = (char *)fennec_allocate_zeroed(
+      table->allocator, new_capacity, hashtable_calculate_bucket_size(table));
+  table->capacity = new_capacity;
+}
+
+static void hashtable_grow(hashtable *table, uint32_t new_capacity) {
+  if ((table->flags & hashtable_flag_incremental_resize) &&
+      table->data != NULL) {
+    hashtable_begin_migration(table, new_capacity);
+  } else {
+    hashtable_finish_migration(table);
+    hashtable_reallocate(table, new_capacity);
+  }
 }
 
 static void hashtable_fill_bucket(hashtable *table, hashtable_bucket *bucket,
-                                  void const *key, void const *value) {
+                                  uint32_t hashed_key, void const *key,
+                                  void const *value) {
   bucket->is_valid = true;
-  bucket->key = table->copy_function(key);
-  memcpy(bucket->value, value, table->object_size);
+  bucket->hash = hashed_key;
+  char *inline_key = hashtable_bucket_inline_key(table, bucket);
+  bucket->key = hashtable_store_key(table, inline_key, key);
+  hashtable_store_value(table, bucket->value, value);
 }
 
 static hashtable_bucket *hashtable_get_last_in_chain(hashtable_bucket *start) {
@@ -92,25 +259,44 @@ static hashtable_bucket *hashtable_get_last_in_chain(hashtable_bucket *start) {
   return start;
 }
 
-static hashtable_bucket *hashtable_lookup_key(hashtable const *table,
-                                              void const *key) {
-  if (table->capacity == HASHTABLE_INITIAL_CAPACITY) {
-    return NULL;
+/*
+ * Records a lookup (and whether it missed) when counters are on and passes
+ * its result through.
+ */
+static void *hashtable_count_lookup(hashtable const *table, void *found) {
+  if (table->counters != NULL) {
+    table->counters->lookups += 1;
+    table->counters->misses += found == NULL;
   }
 
-  uint32_t hashed_key = table->hash_function(key);
-  uint32_t index = hashed_key & (table->capacity - 1);
+  return found;
+}
+
+/*
+ * False when the table's filter is sure the key isn't in the table.
+ */
+static bool hashtable_filter_allows(hashtable const *table,
+                                    uint32_t hashed_key) {
+  return table->filter == NULL ||
+         cuckoo_filter_contains_hash(table->filter, hashed_key);
+}
+
+static hashtable_bucket *
+hashtable_lookup_in(hashtable const *table, char *data, uint32_t capacity,
+                    void const *key, uint32_t hashed_key,
+                    hash_comparison_function_type comparison_function) {
+  uint32_t index = hashed_key & (capacity - 1);
   uint32_t bucket_size = hashtable_calculate_bucket_size(table);
 
-  hashtable_bucket *start =
-      (hashtable_bucket *)(table->data + (bucket_size * index));
+  hashtable_bucket *start = (hashtable_bucket *)(data + (bucket_size * index));
   if (start->probe_count != 0 || !start->is_valid)
     return NULL;
 
   hashtable_bucket *current = start;
 
   do {
-    if (table->comparison_function(current->key, key))
+    if (current->hash == hashed_key &&
+        comparison_function(hashtable_bucket_key(table, current), key))
       return current;
     current = (hashtable_bucket *)current->next;
   } while (current != start);
@@ -118,6 +304,99 @@ static hashtable_bucket *hashtable_lookup_key(hashtable const *table,
   return NULL;
 }
 
+static hashtable_bucket *
+hashtable_lookup_hashed(hashtable const *table, void const *key,
+                        uint32_t hashed_key,
+                        hash_comparison_function_type comparison_function) {
+  hashtable_bucket *found =
+      hashtable_lookup_in(table, table->data, table->capacity, key,
+                          hashed_key, comparison_function);
+
+  if (found == NULL && table->old_data != NULL) {
+    found = hashtable_lookup_in(table, table->old_data, table->old_capacity,
+                                key, hashed_key, comparison_function);
+  }
+
+  return found;
+}
+
+static void hashtable_prefetch_home(hashtable const *table,
+                                    uint32_t hashed_key) {
+  if (table->engine == hashtable_engine_flat) {
+    hashtable_flat_prefetch(table, hashed_key);
+    return;
+  }
+  if (table->engine == hashtable_engine_mapped) {
+    hashtable_mapped_prefetch(table, hashed_key);
+    return;
+  }
+  if (table->engine == hashtable_engine_robin_hood) {
+    hashtable_robin_hood_prefetch(table, hashed_key);
+    return;
+  }
+
+  uint32_t index = hashed_key & (table->capacity - 1);
+  HASHTABLE_PREFETCH(table->data +
+                     hashtable_calculate_bucket_size(table) * index);
+}
+
+/*
+ * Second stage of a batched lookup. Once the home bucket (or control group) is
+ * in cache, prefetch the entry most likely to be compared against.
+ */
+static void hashtable_prefetch_candidate(hashtable const *table,
+                                         uint32_t hashed_key) {
+  if (table->engine == hashtable_engine_flat) {
+    hashtable_flat_prefetch_candidate(table, hashed_key);
+    return;
+  }
+  if (table->engine == hashtable_engine_mapped) {
+    hashtable_mapped_prefetch_candidate(table, hashed_key);
+    return;
+  }
+  if (table->engine == hashtable_engine_robin_hood) {
+    hashtable_robin_hood_prefetch_candidate(table, hashed_key);
+    return;
+  }
+
+  uint32_t index = hashed_key & (table->capacity - 1);
+  hashtable_bucket const *home =
+      (hashtable_bucket const *)(table->data +
+                                 hashtable_calculate_bucket_size(table) *
+                                     index);
+  if (home->is_valid && home->probe_count == 0) {
+    HASHTABLE_PREFETCH(home->key);
+  }
+}
+
+/*
+ * Grows the table once so that count elements fit without another
+ * reallocation.
+ */
+static void hashtable_fit(hashtable *table, uint32_t count) {
+  if (table->engine == hashtable_engine_flat) {
+    hashtable_flat_fit(table, count);
+    return;
+  }
+  if (table->engine == hashtable_engine_mapped) {
+    return;
+  }
+  if (table->engine == hashtable_engine_robin_hood) {
+    hashtable_robin_hood_fit(table, count);
+    return;
+  }
+
+  uint32_t new_capacity = table->capacity;
+  while (new_capacity < HASHTABLE_MAX_CAPACITY &&
+         (float)count > (float)new_capacity * HASHTABLE_MAX_LOAD_FACTOR) {
+    new_capacity = new_capacity << 1;
+  }
+
+  if (table->data == NULL || new_capacity != table->capacity) {
+    hashtable_grow(table, new_capacity);
+  }
+}
+
 hashtable hashtable_new(uint32_t object_size, hash_function_type hash_function,
                         hash_comparison_function_type comparison_function,
                         hash_key_copy_function_type copy_function) {
@@ -127,12 +406,110 @@ hashtable hashtable_new(uint32_t object_size, hash_function_type hash_function,
                      hash_function,
                      comparison_function,
                      copy_function,
-                     NULL}; // data pointer
+                     NULL,  // data pointer
+                     hashtable_engine_coalesced,
+                     0,     // tombstones
+                     NULL,  // metadata pointer
+                     0,     // flags
+                     NULL,  // old data pointer
+                     0,     // old capacity
+                     0,     // migrate index
+                     0,     // seed
+                     NULL,  // string hash function
+                     NULL,  // key arena
+                     NULL,  // counters
+                     NULL,  // filter
+                     NULL}; // allocator
+}
+
+hashtable
+hashtable_new_with_allocator(uint32_t object_size,
+                             hash_function_type hash_function,
+                             hash_comparison_function_type comparison_function,
+                             hash_key_copy_function_type copy_function,
+                             fennec_allocator const *allocator) {
+  hashtable table = hashtable_new(object_size, hash_function,
+                                  comparison_function, copy_function);
+  table.allocator = allocator;
+  return table;
+}
+
+hashtable
+hashtable_reserved_new(uint32_t object_size, uint32_t reserve_count,
+                       hash_function_type hash_function,
+                       hash_comparison_function_type comparison_function,
+                       hash_key_copy_function_type copy_function) {
+  hashtable table = hashtable_new(object_size, hash_function,
+                                  comparison_function, copy_function);
+  hashtable_reserve(&table, reserve_count);
+  return table;
 }
 
 hashtable hashtable_new_string(uint32_t object_size) {
-  return hashtable_new(object_size, hashtable_string_hash,
-                       hashtable_string_comparison, hashtable_string_copy);
+  hashtable table = hashtable_new(object_size, hashtable_string_hash,
+                                  hashtable_string_comparison,
+                                  hashtable_string_copy);
+  table.seed = hash_random_seed();
+  table.string_hash_function = hash_wyhash;
+  return table;
+}
+
+hashtable
+hashtable_new_string_with_allocator(uint32_t object_size,
+                                    fennec_allocator const *allocator) {
+  hashtable table = hashtable_new_string(object_size);
+  table.flags |= hashtable_flag_arena_keys;
+  table.allocator = allocator;
+  return table;
+}
+
+hashtable hashtable_new_flat(uint32_t object_size,
+                             hash_function_type hash_function,
+                             hash_comparison_function_type comparison_function,
+                             hash_key_copy_function_type copy_function) {
+  hashtable table = hashtable_new(object_size, hash_function,
+                                  comparison_function, copy_function);
+  table.engine = hashtable_engine_flat;
+  return table;
+}
+
+hashtable hashtable_new_flat_string(uint32_t object_size) {
+  hashtable table = hashtable_new_string(object_size);
+  table.engine = hashtable_engine_flat;
+  return table;
+}
+
+hashtable
+hashtable_new_robin_hood(uint32_t object_size,
+                         hash_function_type hash_function,
+                         hash_comparison_function_type comparison_function,
+                         hash_key_copy_function_type copy_function) {
+  hashtable table = hashtable_new(object_size, hash_function,
+                                  comparison_function, copy_function);
+  table.engine = hashtable_engine_robin_hood;
+  return table;
+}
+
+hashtable hashtable_new_robin_hood_string(uint32_t object_size) {
+  hashtable table = hashtable_new_string(object_size);
+  table.engine = hashtable_engine_robin_hood;
+  return table;
+}
+
+bool hashtable_set_string_hash(hashtable *table,
+                               hash_bytes_function_type hash_function,
+                               uint64_t seed) {
+  if (table->string_hash_function == NULL || table->size != 0 ||
+      table->old_data != NULL) {
+    return false;
+  }
+
+  table->string_hash_function = hash_function;
+  table->seed = seed;
+
+  /* Tombstones and empty chains were laid out with the old hash. */
+  hashtable_release(table);
+  return true;
 }
 
 hashtable_bucket *hashtable_quadtratic_probe(hashtable *table,
@@ -158,22 +535,21 @@ hashtable_bucket *hashtable_quadtratic_probe(hashtable *table,
   }
 }
 
-void hashtable_insert(hashtable *table, void const *key, void const *value) {
-  float load_factor = hashtable_calculate_load_factor(table);
-  if (load_factor > HASHTABLE_MAX_LOAD_FACTOR) {
-    hashtable_reallocate(table, table->capacity << 1);
-  }
-
-  uint32_t hashed_key = table->hash_function(key);
+/*
+ * Finds the bucket a new element with this hash should live in and links it
+ * into its chain. The caller fills in the bucket.
+ */
+static hashtable_bucket *hashtable_claim_bucket(hashtable *table,
+                                                uint32_t hashed_key) {
   uint32_t index = hashed_key & (table->capacity - 1);
   uint32_t bucket_size = hashtable_calculate_bucket_size(table);
 
   hashtable_bucket *current =
       (hashtable_bucket *)(table->data + index * bucket_size);
-  table->size += 1;
 
   if (!current->is_valid) {
-    goto hashtable_insert_here;
+    current->next = (struct hashtable_bucket *)current;
+    return current;
   }
 
   if (current->probe_count == 0) {
@@ -182,8 +558,7 @@ void hashtable_insert(hashtable *table, void const *key, void const *value) {
     hashtable_bucket *last_bucket = hashtable_get_last_in_chain(current);
     new_bucket->next = (struct hashtable_bucket *)current;
     last_bucket->next = (struct hashtable_bucket *)new_bucket;
-    hashtable_fill_bucket(table, new_bucket, key, value);
-    return;
+    return new_bucket;
   }
 
   hashtable_bucket *new_bucket =
@@ -196,20 +571,333 @@ void hashtable_insert(hashtable *table, void const *key, void const *value) {
     last_bucket->next = (struct hashtable_bucket *)new_bucket;
   }
   current->probe_count = 0;
-
-hashtable_insert_here:
-  hashtable_fill_bucket(table, current, key, value);
   current->next = (struct hashtable_bucket *)current;
+  return current;
 }
 
-void hashtable_remove(hashtable *table, void const *key) {
-  hashtable_bucket *found = hashtable_lookup_key(table, key);
+static void *hashtable_insert_into(hashtable *table, void const *key,
+                                   void const *value, uint32_t hashed_key) {
+  if (table->engine == hashtable_engine_flat) {
+    return hashtable_flat_insert_hashed(table, key, value, hashed_key);
+  }
+  if (table->engine == hashtable_engine_mapped) {
+    return NULL;
+  }
+  if (table->engine == hashtable_engine_robin_hood) {
+    return hashtable_robin_hood_insert_hashed(table, key, value, hashed_key);
+  }
+
+  hashtable_migrate_step(table, HASHTABLE_MIGRATION_STEP);
+
+  float load_factor = hashtable_calculate_load_factor(table);
+  if (load_factor > HASHTABLE_MAX_LOAD_FACTOR) {
+    hashtable_grow(table, table->capacity << 1);
+  }
+
+  table->size += 1;
+  hashtable_bucket *bucket = hashtable_claim_bucket(table, hashed_key);
+  hashtable_fill_bucket(table, bucket, hashed_key, key, value);
+  return bucket->value;
+}
+
+/*
+ * Fills a new filter from the table's keys, sized for count of them. When
+ * the keys don't fit it tries again twice as big; a key inserted more times
+ * than its two filter buckets hold never fits, so after a few tries the
+ * filter is dropped.
+ */
+static void hashtable_rebuild_filter(hashtable *table, uint32_t count) {
+  for (uint32_t attempt = 0; attempt < HASHTABLE_FILTER_ATTEMPTS; ++attempt) {
+    cuckoo_filter_free(table->filter);
+    *table->filter = cuckoo_filter_new(count << attempt, NULL);
+
+    bool fits = true;
+    for (void *value = hashtable_iterate(table, NULL); value != NULL && fits;
+         value = hashtable_iterate(table, value)) {
+      void const *key = hashtable_key_at(table, value);
+      fits = cuckoo_filter_add_hash(table->filter,
+                                    hashtable_hash_key(table, key));
+    }
+
+    if (fits) {
+      return;
+    }
+  }
+
+  cuckoo_filter_free(table->filter);
+  free(table->filter);
+  table->filter = NULL;
+}
+
+/*
+ * Adds a newly inserted key's hash to the table's filter, if it has one.
+ */
+static void hashtable_filter_add(hashtable *table, uint32_t hashed_key) {
+  if (table->filter != NULL &&
+      !cuckoo_filter_add_hash(table->filter, hashed_key)) {
+    hashtable_rebuild_filter(table, table->size * 2);
+  }
+}
+
+/*
+ * Inserts without checking for the key and returns the new element's value.
+ */
+static void *hashtable_insert_hashed(hashtable *table, void const *key,
+                                     void const *value, uint32_t hashed_key) {
+  void *inserted = hashtable_insert_into(table, key, value, hashed_key);
+
+  if (inserted != NULL) {
+    hashtable_filter_add(table, hashed_key);
+  }
+
+  return inserted;
+}
+
+/*
+ * Walks key's chain and, if the key isn't on it, links a new bucket onto the
+ * end of the chain the walk just passed. A home bucket that is empty or holds
+ * another chain's element has no chain to walk and goes to
+ * hashtable_claim_bucket. Needs room for one more element and no migration in
+ * progress.
+ */
+static hashtable_bucket *
+hashtable_find_or_claim_bucket(hashtable *table, void const *key,
+                               uint32_t hashed_key, bool *inserted) {
+  uint32_t bucket_size = hashtable_calculate_bucket_size(table);
+  hashtable_bucket *home =
+      (hashtable_bucket *)(table->data +
+                           bucket_size * (hashed_key & (table->capacity - 1)));
+
+  *inserted = true;
+  if (!home->is_valid || home->probe_count != 0) {
+    return hashtable_claim_bucket(table, hashed_key);
+  }
+
+  hashtable_bucket *current = home;
+  hashtable_bucket *last = home;
+  do {
+    if (current->hash == hashed_key &&
+        table->comparison_function(hashtable_bucket_key(table, current),
+                                   key)) {
+      *inserted = false;
+      return current;
+    }
+    last = current;
+    current = (hashtable_bucket *)current->next;
+  } while (current != home);
+
+  hashtable_bucket *new_bucket =
+      hashtable_quadtratic_probe(table, bucket_size, hashed_key);
+  new_bucket->next = (struct hashtable_bucket *)home;
+  last->next = (struct hashtable_bucket *)new_bucket;
+  return new_bucket;
+}
+
+/*
+ * Looks key up and, if it's missing, inserts it with a zeroed value where
+ * the lookup left off, so the key is only probed for once. Only when the
+ * table has to grow first (or is part way through a migration) is it looked
+ * up and inserted separately.
+ */
+static void *hashtable_find_or_insert_into(hashtable *table, void const *key,
+                                           uint32_t hashed_key,
+                                           bool *inserted) {
+  if (table->engine == hashtable_engine_flat) {
+    return hashtable_flat_find_or_insert(table, key, hashed_key, inserted);
+  }
+  if (table->engine == hashtable_engine_robin_hood) {
+    return hashtable_robin_hood_find_or_insert(table, key, hashed_key,
+                                               inserted);
+  }
+
+  hashtable_migrate_step(table, HASHTABLE_MIGRATION_STEP);
+
+  if (table->old_data != NULL || hashtable_calculate_load_factor(table) >
+                                     HASHTABLE_MAX_LOAD_FACTOR) {
+    void *value = hashtable_lookup_hashed_value(table, key, hashed_key,
+                                                table->comparison_function);
+    *inserted = value == NULL;
+    return value != NULL ? value
+                         : hashtable_insert_into(table, key, NULL, hashed_key);
+  }
+
+  hashtable_bucket *bucket =
+      hashtable_find_or_claim_bucket(table, key, hashed_key, inserted);
+  if (*inserted) {
+    table->size += 1;
+    hashtable_fill_bucket(table, bucket, hashed_key, key, NULL);
+  }
+  return bucket->value;
+}
+
+/*
+ * Key storage can only change while a string table holds no keys. Empties
+ * the table (its buckets may be sized for inline keys, and its arena may
+ * still hold removed keys) and returns whether the change is allowed.
+ */
+static bool hashtable_prepare_key_storage_change(hashtable *table) {
+  if (table->string_hash_function == NULL || table->size != 0 ||
+      table->old_data != NULL) {
+    return false;
+  }
+
+  hashtable_release(table);
+  return true;
+}
+
+bool hashtable_set_arena_keys(hashtable *table, bool enabled) {
+  if (!hashtable_prepare_key_storage_change(table)) {
+    return false;
+  }
+
+  if (enabled) {
+    table->flags |= hashtable_flag_arena_keys;
+  } else {
+    table->flags &= ~(uint32_t)(hashtable_flag_arena_keys |
+                                hashtable_flag_inline_keys);
+  }
+  return true;
+}
+
+bool hashtable_set_inline_keys(hashtable *table, bool enabled) {
+  if (!hashtable_prepare_key_storage_change(table)) {
+    return false;
+  }
+
+  if (enabled) {
+    table->flags |= hashtable_flag_arena_keys | hashtable_flag_inline_keys;
+  } else {
+    table->flags &= ~(uint32_t)hashtable_flag_inline_keys;
+  }
+  return true;
+}
+
+void hashtable_set_counters(hashtable *table, bool enabled) {
+  free(table->counters);
+  table->counters = NULL;
+
+  if (enabled) {
+    table->counters =
+        (hashtable_counters *)calloc(1, sizeof(hashtable_counters));
+  }
+}
+
+void hashtable_set_filter(hashtable *table, bool enabled) {
+  if (table->filter != NULL) {
+    cuckoo_filter_free(table->filter);
+    free(table->filter);
+    table->filter = NULL;
+  }
+
+  if (enabled) {
+    table->filter = (cuckoo_filter *)calloc(1, sizeof(cuckoo_filter));
+    hashtable_rebuild_filter(table, table->size > table->capacity
+                                        ? table->size
+                                        : table->capacity);
+  }
+}
+
+bool hashtable_set_allocator(hashtable *table,
+                             fennec_allocator const *allocator) {
+  if (table->data != NULL || table->key_arena != NULL) {
+    return false;
+  }
+
+  table->allocator = allocator;
+  return true;
+}
+
+void hashtable_set_incremental_resize(hashtable *table, bool enabled) {
+  if (enabled) {
+    table->flags |= hashtable_flag_incremental_resize;
+  } else {
+    table->flags &= ~(uint32_t)hashtable_flag_incremental_resize;
+    hashtable_finish_migration(table);
+  }
+}
+
+void hashtable_insert(hashtable *table, void const *key, void const *value) {
+  hashtable_insert_hashed(table, key, value, hashtable_hash_key(table, key));
+}
+
+void *hashtable_find_or_insert(hashtable *table, void const *key,
+                               bool *inserted) {
+  uint32_t hashed_key = hashtable_hash_key(table, key);
+
+  if (table->engine == hashtable_engine_mapped) {
+    *inserted = false;
+    return hashtable_count_lookup(
+        table, hashtable_lookup_hashed_value(table, key, hashed_key,
+                                             table->comparison_function));
+  }
+
+  void *value = hashtable_find_or_insert_into(table, key, hashed_key, inserted);
+  hashtable_count_lookup(table, *inserted ? NULL : value);
+
+  if (*inserted) {
+    hashtable_filter_add(table, hashed_key);
+  }
+  return value;
+}
+
+void hashtable_reserve(hashtable *table, uint32_t count) {
+  hashtable_fit(table, count);
+}
+
+void hashtable_insert_batch(hashtable *table, void const *const *keys,
+                            void const *values, uint32_t count) {
+  uint32_t hashes[HASHTABLE_BATCH_SIZE];
+  char const *value = (char const *)values;
+
+  hashtable_fit(table, count > UINT32_MAX - table->size ? UINT32_MAX
+                                                        : table->size + count);
+
+  for (uint32_t start = 0; start < count; start += HASHTABLE_BATCH_SIZE) {
+    uint32_t batch_count = count - start < HASHTABLE_BATCH_SIZE
+                               ? count - start
+                               : HASHTABLE_BATCH_SIZE;
+
+    for (uint32_t i = 0; i < batch_count; ++i) {
+      hashes[i] = hashtable_hash_key(table, keys[start + i]);
+      hashtable_prefetch_home(table, hashes[i]);
+    }
+
+    for (uint32_t i = 0; i < batch_count; ++i) {
+      hashtable_insert_hashed(table, keys[start + i], value, hashes[i]);
+      value += table->object_size;
+    }
+  }
+}
+
+static void
+hashtable_remove_hashed(hashtable *table, void const *key, uint32_t hashed_key,
+                        hash_comparison_function_type comparison_function) {
+  if (table->engine == hashtable_engine_flat) {
+    hashtable_flat_remove(table, key, hashed_key, comparison_function);
+    return;
+  }
+  if (table->engine == hashtable_engine_mapped) {
+    return;
+  }
+  if (table->engine == hashtable_engine_robin_hood) {
+    hashtable_robin_hood_remove(table, key, hashed_key, comparison_function);
+    return;
+  }
+
+  hashtable_migrate_step(table, HASHTABLE_MIGRATION_STEP);
+
+  if (table->data == NULL) {
+    return;
+  }
+
+  hashtable_bucket *found =
+      hashtable_lookup_hashed(table, key, hashed_key, comparison_function);
   if (found == NULL) {
     return;
   }
 
   table->size -= 1;
-  free(found->key);
+  hashtable_release_key(table, found->key);
 
   hashtable_bucket *last = hashtable_get_last_in_chain(found);
   hashtable_bucket *next = (hashtable_bucket *)found->next;
@@ -230,12 +918,51 @@ void hashtable_remove(hashtable *table, void const *key) {
   memset(found, 0, bucket_size);
 }
 
-bool hashtable_exists(hashtable const *table, void const *key) {
-  return hashtable_lookup_key(table, key) != NULL;
+/*
+ * Removes the key and takes it out of the table's filter (if it has one).
+ */
+static void
+hashtable_remove_filtered(hashtable *table, void const *key,
+                          uint32_t hashed_key,
+                          hash_comparison_function_type comparison_function) {
+  if (!hashtable_filter_allows(table, hashed_key)) {
+    return;
+  }
+
+  uint32_t size = table->size;
+  hashtable_remove_hashed(table, key, hashed_key, comparison_function);
+  if (table->filter != NULL && table->size != size) {
+    cuckoo_filter_remove_hash(table->filter, hashed_key);
+  }
 }
 
-void *hashtable_lookup(hashtable *table, void const *key) {
-  hashtable_bucket *bucket = hashtable_lookup_key(table, key);
+void hashtable_remove(hashtable *table, void const *key) {
+  hashtable_remove_filtered(table, key, hashtable_hash_key(table, key),
+                            table->comparison_function);
+}
+
+static void *hashtable_lookup_hashed_value(
+    hashtable const *table, void const *key, uint32_t hashed_key,
+    hash_comparison_function_type comparison_function) {
+  if (table->data == NULL || !hashtable_filter_allows(table, hashed_key)) {
+    return NULL;
+  }
+
+  if (table->engine == hashtable_engine_flat) {
+    return hashtable_flat_lookup_hashed(table, key, hashed_key,
+                                        comparison_function);
+  }
+  if (table->engine == hashtable_engine_mapped) {
+    return hashtable_mapped_lookup_hashed(table, key, hashed_key,
+                                          comparison_function);
+  }
+  if (table->engine == hashtable_engine_robin_hood) {
+    return hashtable_robin_hood_lookup_hashed(table, key, hashed_key,
+                                              comparison_function);
+  }
+
+  hashtable_bucket *bucket =
+      hashtable_lookup_hashed(table, key, hashed_key, comparison_function);
   if (bucket == NULL) {
     return NULL;
   }
@@ -243,35 +970,389 @@ void *hashtable_lookup(hashtable *table, void const *key) {
   return bucket->value;
 }
 
+static void *hashtable_lookup_value(hashtable const *table, void const *key) {
+  if (table->data == NULL) {
+    return NULL;
+  }
+
+  return hashtable_lookup_hashed_value(table, key,
+                                       hashtable_hash_key(table, key),
+                                       table->comparison_function);
+}
+
+bool hashtable_exists(hashtable const *table, void const *key) {
+  return hashtable_count_lookup(table, hashtable_lookup_value(table, key)) !=
+         NULL;
+}
+
+void *hashtable_lookup(hashtable *table, void const *key) {
+  if (table->engine == hashtable_engine_coalesced) {
+    hashtable_migrate_step(table, HASHTABLE_MIGRATION_STEP);
+  }
+
+  return hashtable_count_lookup(table, hashtable_lookup_value(table, key));
+}
+
+/*
+ * A string key given as a pointer and length, passed to the lookups in place
+ * of a NUL terminated key along with hashtable_bytes_comparison.
+ */
+typedef struct {
+  char const *data;
+  uint32_t length;
+} hashtable_key_bytes;
+
+/*
+ * The stored key is checked for a NUL in the first length bytes before the
+ * memcmp, so a stored key shorter than the bytes is never read past its end.
+ */
+static bool hashtable_bytes_comparison(void const *stored_key,
+                                       void const *key) {
+  char const *stored = (char const *)stored_key;
+  hashtable_key_bytes const *bytes = (hashtable_key_bytes const *)key;
+
+  return memchr(stored, '\0', bytes->length) == NULL &&
+         stored[bytes->length] == '\0' &&
+         memcmp(stored, bytes->data, bytes->length) == 0;
+}
+
+/*
+ * Hashes bytes the same as hashtable_hash_key hashes them as a NUL terminated
+ * string. Returns false for tables that aren't keyed by strings.
+ */
+static bool hashtable_hash_bytes(hashtable const *table,
+                                 hashtable_key_bytes const *bytes,
+                                 uint32_t *hashed_key) {
+  if (table->string_hash_function == NULL) {
+    return false;
+  }
+
+  uint64_t hash =
+      table->string_hash_function(bytes->data, bytes->length, table->seed);
+  *hashed_key = (uint32_t)(hash ^ (hash >> 32));
+  return true;
+}
+
+static void *hashtable_lookup_bytes_value(hashtable const *table,
+                                          char const *key, uint32_t length) {
+  hashtable_key_bytes bytes = {key, length};
+  uint32_t hashed_key;
+
+  if (!hashtable_hash_bytes(table, &bytes, &hashed_key)) {
+    return NULL;
+  }
+
+  return hashtable_lookup_hashed_value(table, &bytes, hashed_key,
+                                       hashtable_bytes_comparison);
+}
+
+void *hashtable_lookup_bytes(hashtable *table, char const *key,
+                             uint32_t length) {
+  if (table->engine == hashtable_engine_coalesced) {
+    hashtable_migrate_step(table, HASHTABLE_MIGRATION_STEP);
+  }
+
+  return hashtable_count_lookup(
+      table, hashtable_lookup_bytes_value(table, key, length));
+}
+
+bool hashtable_exists_bytes(hashtable const *table, char const *key,
+                            uint32_t length) {
+  return hashtable_count_lookup(
+             table, hashtable_lookup_bytes_value(table, key, length)) != NULL;
+}
+
+void hashtable_remove_bytes(hashtable *table, char const *key,
+                            uint32_t length) {
+  hashtable_key_bytes bytes = {key, length};
+  uint32_t hashed_key;
+
+  if (hashtable_hash_bytes(table, &bytes, &hashed_key)) {
+    hashtable_remove_filtered(table, &bytes, hashed_key,
+                              hashtable_bytes_comparison);
+  }
+}
+
+void *hashtable_lookup_range(hashtable *table, string_range const *range) {
+  return hashtable_lookup_bytes(table, range->data->data + range->start,
+                                range->end - range->start);
+}
+
+bool hashtable_exists_range(hashtable const *table,
+                            string_range const *range) {
+  return hashtable_exists_bytes(table, range->data->data + range->start,
+                                range->end - range->start);
+}
+
+void hashtable_remove_range(hashtable *table, string_range const *range) {
+  hashtable_remove_bytes(table, range->data->data + range->start,
+                         range->end - range->start);
+}
+
+void hashtable_lookup_batch(hashtable *table, void const *const *keys,
+                            uint32_t count, void **values) {
+  uint32_t hashes[HASHTABLE_BATCH_SIZE];
+
+  if (table->data == NULL) {
+    memset(values, 0, sizeof(void *) * count);
+    if (table->counters != NULL) {
+      table->counters->lookups += count;
+      table->counters->misses += count;
+    }
+    return;
+  }
+
+  hashtable_migrate_step(table, HASHTABLE_MIGRATION_STEP);
+
+  /*
+   * Hash a whole batch and prefetch every home bucket before touching any of
+   * them, then prefetch the first candidate key/slot of each, so the cache
+   * misses overlap instead of being paid one at a time.
+   */
+  for (uint32_t start = 0; start < count; start += HASHTABLE_BATCH_SIZE) {
+    uint32_t batch_count = count - start < HASHTABLE_BATCH_SIZE
+                               ? count - start
+                               : HASHTABLE_BATCH_SIZE;
+
+    for (uint32_t i = 0; i < batch_count; ++i) {
+      hashes[i] = hashtable_hash_key(table, keys[start + i]);
+      hashtable_prefetch_home(table, hashes[i]);
+    }
+
+    for (uint32_t i = 0; i < batch_count; ++i) {
+      hashtable_prefetch_candidate(table, hashes[i]);
+    }
+
+    for (uint32_t i = 0; i < batch_count; ++i) {
+      values[start + i] =
+          hashtable_lookup_hashed_value(table, keys[start + i], hashes[i],
+                                        table->comparison_function);
+    }
+  }
+
+  if (table->counters != NULL) {
+    for (uint32_t i = 0; i < count; ++i) {
+      hashtable_count_lookup(table, values[i]);
+    }
+  }
+}
+
 void *hashtable_iterate(hashtable *table, void *last_position) {
+  if (table->engine == hashtable_engine_flat) {
+    return hashtable_flat_iterate(table, last_position);
+  }
+  if (table->engine == hashtable_engine_mapped) {
+    return hashtable_mapped_iterate(table, last_position);
+  }
+  if (table->engine == hashtable_engine_robin_hood) {
+    return hashtable_robin_hood_iterate(table, last_position);
+  }
+
   uint32_t bucket_size = hashtable_calculate_bucket_size(table);
   uint32_t index = 0;
+  bool in_old_data = false;
 
   if (table->data == NULL) {
     return NULL;
   }
 
+  /*
+   * While migrating, the new array is walked first and then the old one.
+   */
   if (last_position != NULL) {
-    index = (uint32_t)((char *)last_position - table->data) / bucket_size + 1;
+    char *position = (char *)last_position;
+    if (table->old_data != NULL) {
+      char *old_end = table->old_data + table->old_capacity * bucket_size;
+      in_old_data = position >= table->old_data && position < old_end;
+    }
+    char *base = in_old_data ? table->old_data : table->data;
+    index = (uint32_t)(position - base) / bucket_size + 1;
   }
 
-  hashtable_bucket *current =
-      (hashtable_bucket *)(table->data + index * bucket_size);
-  hashtable_bucket *end =
-      (hashtable_bucket *)(table->data + table->capacity * bucket_size);
+  if (!in_old_data) {
+    for (; index < table->capacity; ++index) {
+      hashtable_bucket *current =
+          (hashtable_bucket *)(table->data + index * bucket_size);
 
-  while (current < end) {
-    if (current->is_valid) {
-      return current->value;
+      if (current->is_valid) {
+        return current->value;
+      }
     }
 
-    current++;
+    index = 0;
+  }
+
+  if (table->old_data != NULL) {
+    for (; index < table->old_capacity; ++index) {
+      hashtable_bucket *current =
+          (hashtable_bucket *)(table->old_data + index * bucket_size);
+
+      if (current->is_valid) {
+        return current->value;
+      }
+    }
   }
 
   return NULL;
 }
 
+void const *hashtable_key_at(hashtable const *table, void const *position) {
+  if (table->engine == hashtable_engine_flat) {
+    return hashtable_flat_key_at(table, position);
+  }
+  if (table->engine == hashtable_engine_mapped) {
+    return hashtable_mapped_key_at(table, position);
+  }
+  if (table->engine == hashtable_engine_robin_hood) {
+    return hashtable_robin_hood_key_at(table, position);
+  }
+
+  hashtable_bucket const *bucket =
+      (hashtable_bucket const *)((char const *)position -
+                                 offsetof(hashtable_bucket, value));
+  return hashtable_bucket_key(table, bucket);
+}
+
+/*
+ * Length of the longest chain that starts in data. Every element of a chain
+ * is compared against before a lookup for a missing key gives up.
+ */
+static uint32_t hashtable_longest_chain(hashtable const *table, char *data,
+                                        uint32_t capacity) {
+  uint32_t bucket_size = hashtable_calculate_bucket_size(table);
+  uint32_t longest = 0;
+
+  for (uint32_t i = 0; i < capacity; ++i) {
+    hashtable_bucket *home = (hashtable_bucket *)(data + i * bucket_size);
+    if (!home->is_valid || home->probe_count != 0) {
+      continue;
+    }
+
+    uint32_t length = 0;
+    hashtable_bucket *current = home;
+    do {
+      ++length;
+      current = (hashtable_bucket *)current->next;
+    } while (current != home);
+
+    longest = length > longest ? length : longest;
+  }
+
+  return longest;
+}
+
+/*
+ * Adds the chains that start in data to stats.
+ */
+static void hashtable_chain_stats(hashtable const *table, char *data,
+                                  uint32_t capacity,
+                                  hashtable_statistics *stats) {
+  uint32_t bucket_size = hashtable_calculate_bucket_size(table);
+
+  for (uint32_t i = 0; i < capacity; ++i) {
+    hashtable_bucket *home = (hashtable_bucket *)(data + i * bucket_size);
+    if (!home->is_valid) {
+      stats->free_slots += 1;
+      continue;
+    }
+
+    hashtable_histogram_add(stats->probe_distances, home->probe_count);
+    if (home->probe_count != 0) {
+      continue;
+    }
+
+    uint32_t length = 0;
+    hashtable_bucket *current = home;
+    do {
+      ++length;
+      current = (hashtable_bucket *)current->next;
+    } while (current != home);
+    hashtable_histogram_add(stats->chain_lengths, length);
+  }
+
+  stats->bucket_bytes += (uint64_t)bucket_size * capacity;
+}
+
+void hashtable_stats(hashtable const *table, hashtable_statistics *stats) {
+  memset(stats, 0, sizeof(hashtable_statistics));
+  stats->size = table->size;
+  stats->capacity = table->capacity;
+  stats->tombstones = table->tombstones;
+  if (table->data != NULL) {
+    stats->load_factor = (float)table->size / (float)table->capacity;
+  }
+
+  if (table->engine == hashtable_engine_flat) {
+    hashtable_flat_stats(table, stats);
+  } else if (table->engine == hashtable_engine_mapped) {
+    hashtable_mapped_stats(table, stats);
+  } else if (table->engine == hashtable_engine_robin_hood) {
+    hashtable_robin_hood_stats(table, stats);
+  } else if (table->data != NULL) {
+    hashtable_chain_stats(table, table->data, table->capacity, stats);
+    if (table->old_data != NULL) {
+      hashtable_chain_stats(table, table->old_data, table->old_capacity,
+                            stats);
+    }
+
+    /* Buckets that no chain starts in are empty homes. */
+    uint32_t chains = 0;
+    for (uint32_t i = 1; i < HASHTABLE_STATS_HISTOGRAM_SIZE; ++i) {
+      chains += stats->chain_lengths[i];
+    }
+    stats->chain_lengths[0] =
+        table->capacity + table->old_capacity - chains;
+  }
+
+  for (hashtable_key_arena *chunk = table->key_arena; chunk != NULL;
+       chunk = chunk->next) {
+    stats->key_bytes += sizeof(hashtable_key_arena) + chunk->capacity;
+  }
+
+  if (table->counters != NULL) {
+    stats->counters = *table->counters;
+  }
+}
+
+uint32_t hashtable_max_probe_length(hashtable const *table) {
+  if (table->engine == hashtable_engine_flat) {
+    return hashtable_flat_max_probe_length(table);
+  }
+  if (table->engine == hashtable_engine_mapped) {
+    return hashtable_mapped_max_probe_length(table);
+  }
+  if (table->engine == hashtable_engine_robin_hood) {
+    return hashtable_robin_hood_max_probe_length(table);
+  }
+
+  if (table->data == NULL) {
+    return 0;
+  }
+
+  uint32_t longest = hashtable_longest_chain(table, table->data,
+                                             table->capacity);
+  if (table->old_data != NULL) {
+    uint32_t old_longest = hashtable_longest_chain(table, table->old_data,
+                                                   table->old_capacity);
+    longest = old_longest > longest ? old_longest : longest;
+  }
+
+  return longest;
+}
+
 void hashtable_shrink(hashtable *table) {
+  if (table->engine == hashtable_engine_flat) {
+    hashtable_flat_shrink(table);
+    return;
+  }
+  if (table->engine == hashtable_engine_mapped) {
+    return;
+  }
+  if (table->engine == hashtable_engine_robin_hood) {
+    hashtable_robin_hood_shrink(table);
+    return;
+  }
+
   uint32_t new_capacity =
       (uint32_t)ceil((float)table->size / HASHTABLE_MAX_LOAD_FACTOR);
   uint32_t new_pow2_capacity = 2;
@@ -279,27 +1360,84 @@ void hashtable_shrink(hashtable *table) {
     new_pow2_capacity = new_pow2_capacity << 1;
   }
 
+  hashtable_finish_migration(table);
   hashtable_reallocate(table, new_pow2_capacity);
 }
 
-void hashtable_free(hashtable *table) {
-  if (table->data == NULL) {
+static void hashtable_free_keys(hashtable const *table, char *data,
+                                uint32_t capacity) {
+  /* Arena keys go away with the table. */
+  if (table->flags & hashtable_flag_arena_keys) {
     return;
   }
 
   uint32_t bucket_size = hashtable_calculate_bucket_size(table);
 
-  for (uint32_t i = 0; i < table->capacity; ++i) {
-    hashtable_bucket *current =
-        (hashtable_bucket *)(table->data + i * bucket_size);
+  for (uint32_t i = 0; i < capacity; ++i) {
+    hashtable_bucket *current = (hashtable_bucket *)(data + i * bucket_size);
 
     if (current->key) {
       free(current->key);
     }
   }
+}
 
-  free(table->data);
+/*
+ * Frees every element and leaves an empty table with the same settings
+ * (counters included).
+ */
+static void hashtable_release(hashtable *table) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  hashtable_engine engine = table->engine;
+  uint32_t flags = table->flags;
+  uint64_t seed = table->seed;
+  hash_bytes_function_type string_hash_function = table->string_hash_function;
+  hashtable_counters *counters = table->counters;
+  cuckoo_filter *filter = table->filter;
+  fennec_allocator const *allocator = table->allocator;
+
+  if (engine == hashtable_engine_flat) {
+    hashtable_flat_free(table);
+  } else if (engine == hashtable_engine_mapped) {
+    hashtable_mapped_free(table);
+  } else if (engine == hashtable_engine_robin_hood) {
+    hashtable_robin_hood_free(table);
+  } else {
+    uint32_t bucket_size = hashtable_calculate_bucket_size(table);
+    hashtable_free_keys(table, table->data, table->capacity);
+    fennec_deallocate(table->allocator, table->data,
+                      (size_t)table->capacity * bucket_size);
+
+    if (table->old_data != NULL) {
+      hashtable_free_keys(table, table->old_data, table->old_capacity);
+      fennec_deallocate(table->allocator, table->old_data,
+                        (size_t)table->old_capacity * bucket_size);
+    }
+  }
+
+  hashtable_free_key_arena(table);
 
   *table = hashtable_new(table->object_size, table->hash_function,
                          table->comparison_function, table->copy_function);
+  table->engine = engine;
+  table->flags = flags;
+  table->seed = seed;
+  table->string_hash_function = string_hash_function;
+  table->counters = counters;
+  table->filter = filter;
+  table->allocator = allocator;
+  if (filter != NULL) {
+    cuckoo_filter_clear(filter);
+  }
+}
+
+void hashtable_free(hashtable *table) {
+  hashtable_release(table);
+
+  free(table->counters);
+  table->counters = NULL;
+  hashtable_set_filter(table, false);
 }
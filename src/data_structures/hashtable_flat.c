@@ -0,0 +1,484 @@
+#include "hashtable_internal.h"
+#include <stddef.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define HASHTABLE_FLAT_USE_SSE2
+#endif
+
+#define HASHTABLE_FLAT_GROUP_WIDTH 16
+#define HASHTABLE_FLAT_EMPTY ((uint8_t)0x80)
+#define HASHTABLE_FLAT_DELETED ((uint8_t)0xFE)
+
+/*
+ * Control bytes: the high bit is set for EMPTY and DELETED slots, a full slot
+ * stores the low 7 bits of its hash. Slots are grouped into aligned runs of 16
+ * and whole groups are probed with triangular steps. padding puts value at
+ * an 8 byte offset so values that need 8 byte alignment get it.
+ */
+typedef struct {
+  void *key;
+  uint32_t hash;
+  uint32_t padding;
+  char value[];
+} hashtable_flat_slot;
+
+static uint32_t hashtable_flat_match(uint8_t const *group, uint8_t tag) {
+#ifdef HASHTABLE_FLAT_USE_SSE2
+  __m128i control = _mm_loadu_si128((__m128i const *)group);
+  __m128i tags = _mm_set1_epi8((char)tag);
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(control, tags));
+#else
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < HASHTABLE_FLAT_GROUP_WIDTH; ++i) {
+    mask |= (uint32_t)(group[i] == tag) << i;
+  }
+  return mask;
+#endif
+}
+
+static uint32_t hashtable_flat_match_free(uint8_t const *group) {
+#ifdef HASHTABLE_FLAT_USE_SSE2
+  __m128i control = _mm_loadu_si128((__m128i const *)group);
+  return (uint32_t)_mm_movemask_epi8(control);
+#else
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < HASHTABLE_FLAT_GROUP_WIDTH; ++i) {
+    mask |= (uint32_t)(group[i] >> 7) << i;
+  }
+  return mask;
+#endif
+}
+
+static uint32_t hashtable_flat_lowest_bit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+  return (uint32_t)__builtin_ctz(mask);
+#else
+  uint32_t bit = 0;
+  while ((mask & 1) == 0) {
+    mask >>= 1;
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+static uint32_t hashtable_flat_slot_size(hashtable const *table) {
+  uint32_t size = sizeof(hashtable_flat_slot) + table->object_size +
+                  hashtable_inline_key_size(table);
+  return (size + sizeof(void *) - 1) & ~(uint32_t)(sizeof(void *) - 1);
+}
+
+static uint32_t hashtable_flat_max_load(uint32_t capacity) {
+  return capacity - capacity / 8;
+}
+
+static hashtable_flat_slot *hashtable_flat_slot_at(hashtable const *table,
+                                                   uint32_t slot_size,
+                                                   uint32_t index) {
+  return (hashtable_flat_slot *)(table->data + (size_t)slot_size * index);
+}
+
+static char *hashtable_flat_inline_key(hashtable const *table,
+                                       hashtable_flat_slot const *slot) {
+  return (char *)slot->value + table->object_size;
+}
+
+static uint32_t hashtable_flat_find_free(hashtable const *table,
+                                         uint32_t hash) {
+  uint32_t group_mask = table->capacity / HASHTABLE_FLAT_GROUP_WIDTH - 1;
+  uint32_t group = (hash >> 7) & group_mask;
+
+  for (uint32_t step = 1;; ++step) {
+    uint32_t mask = hashtable_flat_match_free(
+        table->metadata + group * HASHTABLE_FLAT_GROUP_WIDTH);
+    if (mask != 0) {
+      return group * HASHTABLE_FLAT_GROUP_WIDTH +
+             hashtable_flat_lowest_bit(mask);
+    }
+    group = (group + step) & group_mask;
+  }
+}
+
+/*
+ * Probes for key. When free_index isn't NULL it is also set to the first free
+ * slot on the probe sequence (UINT32_MAX if there was none), which is where
+ * hashtable_flat_find_free would put the key.
+ */
+static hashtable_flat_slot *
+hashtable_flat_find(hashtable const *table, void const *key,
+                    uint32_t hashed_key,
+                    hash_comparison_function_type comparison_function,
+                    uint32_t *found_index, uint32_t *free_index) {
+  if (free_index != NULL) {
+    *free_index = UINT32_MAX;
+  }
+  if (table->data == NULL) {
+    return NULL;
+  }
+
+  uint32_t hash = hash_mix32(hashed_key);
+  uint8_t tag = (uint8_t)(hash & 0x7F);
+  uint32_t slot_size = hashtable_flat_slot_size(table);
+  uint32_t group_count = table->capacity / HASHTABLE_FLAT_GROUP_WIDTH;
+  uint32_t group = (hash >> 7) & (group_count - 1);
+
+  for (uint32_t step = 1; step <= group_count; ++step) {
+    uint8_t const *control =
+        table->metadata + group * HASHTABLE_FLAT_GROUP_WIDTH;
+
+    uint32_t matches = hashtable_flat_match(control, tag);
+    while (matches != 0) {
+      uint32_t index = group * HASHTABLE_FLAT_GROUP_WIDTH +
+                       hashtable_flat_lowest_bit(matches);
+      matches &= matches - 1;
+
+      hashtable_flat_slot *slot =
+          hashtable_flat_slot_at(table, slot_size, index);
+      void const *slot_key = hashtable_stored_key(
+          slot->key, hashtable_flat_inline_key(table, slot));
+      if (slot->hash == hash && comparison_function(slot_key, key)) {
+        *found_index = index;
+        return slot;
+      }
+    }
+
+    if (free_index != NULL && *free_index == UINT32_MAX) {
+      uint32_t free = hashtable_flat_match_free(control);
+      if (free != 0) {
+        *free_index = group * HASHTABLE_FLAT_GROUP_WIDTH +
+                      hashtable_flat_lowest_bit(free);
+      }
+    }
+
+    if (hashtable_flat_match(control, HASHTABLE_FLAT_EMPTY) != 0) {
+      return NULL;
+    }
+
+    group = (group + step) & (group_count - 1);
+  }
+
+  return NULL;
+}
+
+static void hashtable_flat_rehash(hashtable *table, uint32_t new_capacity) {
+  char *old_data = table->data;
+  uint8_t *old_metadata = table->metadata;
+  uint32_t old_capacity = table->capacity;
+  uint32_t slot_size = hashtable_flat_slot_size(table);
+
+  table->data = (char *)fennec_allocate(table->allocator,
+                                        (size_t)slot_size * new_capacity);
+  table->metadata = (uint8_t *)fennec_allocate(table->allocator, new_capacity);
+  memset(table->metadata, HASHTABLE_FLAT_EMPTY, new_capacity);
+  table->capacity = new_capacity;
+  table->tombstones = 0;
+
+  if (old_data == NULL) {
+    return;
+  }
+  hashtable_count_resize(table);
+
+  for (uint32_t i = 0; i < old_capacity; ++i) {
+    if (old_metadata[i] & HASHTABLE_FLAT_EMPTY) {
+      continue;
+    }
+
+    char *old_slot = old_data + (size_t)slot_size * i;
+    uint32_t hash = ((hashtable_flat_slot *)old_slot)->hash;
+    uint32_t index = hashtable_flat_find_free(table, hash);
+
+    table->metadata[index] = (uint8_t)(hash & 0x7F);
+    memcpy(hashtable_flat_slot_at(table, slot_size, index), old_slot,
+           slot_size);
+  }
+
+  fennec_deallocate(table->allocator, old_data,
+                    (size_t)slot_size * old_capacity);
+  fennec_deallocate(table->allocator, old_metadata, old_capacity);
+}
+
+void hashtable_flat_fit(hashtable *table, uint32_t count) {
+  uint32_t new_capacity = table->capacity;
+  while (new_capacity < HASHTABLE_MAX_CAPACITY &&
+         hashtable_flat_max_load(new_capacity) <= count) {
+    new_capacity = new_capacity << 1;
+  }
+
+  if (table->data == NULL || new_capacity != table->capacity ||
+      (uint64_t)count + table->tombstones >=
+          hashtable_flat_max_load(new_capacity)) {
+    hashtable_flat_rehash(table, new_capacity);
+  }
+}
+
+void hashtable_flat_prefetch(hashtable const *table, uint32_t hashed_key) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  uint32_t group_mask = table->capacity / HASHTABLE_FLAT_GROUP_WIDTH - 1;
+  uint32_t group = (hash_mix32(hashed_key) >> 7) & group_mask;
+  HASHTABLE_PREFETCH(table->metadata + group * HASHTABLE_FLAT_GROUP_WIDTH);
+}
+
+void hashtable_flat_prefetch_candidate(hashtable const *table,
+                                       uint32_t hashed_key) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  uint32_t hash = hash_mix32(hashed_key);
+  uint32_t group_mask = table->capacity / HASHTABLE_FLAT_GROUP_WIDTH - 1;
+  uint32_t group = (hash >> 7) & group_mask;
+  uint32_t matches = hashtable_flat_match(
+      table->metadata + group * HASHTABLE_FLAT_GROUP_WIDTH,
+      (uint8_t)(hash & 0x7F));
+
+  if (matches != 0) {
+    uint32_t index =
+        group * HASHTABLE_FLAT_GROUP_WIDTH + hashtable_flat_lowest_bit(matches);
+    HASHTABLE_PREFETCH(
+        hashtable_flat_slot_at(table, hashtable_flat_slot_size(table), index));
+  }
+}
+
+/*
+ * Puts a new element in the free slot at index and returns its value.
+ */
+static void *hashtable_flat_fill(hashtable *table, uint32_t index,
+                                 uint32_t hash, void const *key,
+                                 void const *value) {
+  uint32_t slot_size = hashtable_flat_slot_size(table);
+
+  if (table->metadata[index] == HASHTABLE_FLAT_DELETED) {
+    table->tombstones -= 1;
+  }
+  table->metadata[index] = (uint8_t)(hash & 0x7F);
+  table->size += 1;
+
+  hashtable_flat_slot *slot = hashtable_flat_slot_at(table, slot_size, index);
+  slot->key =
+      hashtable_store_key(table, hashtable_flat_inline_key(table, slot), key);
+  slot->hash = hash;
+  hashtable_store_value(table, slot->value, value);
+  return slot->value;
+}
+
+void hashtable_flat_insert(hashtable *table, void const *key,
+                           void const *value) {
+  hashtable_flat_insert_hashed(table, key, value,
+                               hashtable_hash_key(table, key));
+}
+
+void *hashtable_flat_insert_hashed(hashtable *table, void const *key,
+                                   void const *value, uint32_t hashed_key) {
+  if (table->data == NULL) {
+    hashtable_flat_rehash(table, table->capacity);
+  } else if (table->size + table->tombstones >=
+             hashtable_flat_max_load(table->capacity)) {
+    /*
+     * When most of the used slots are tombstones a same sized rehash is enough
+     * to reclaim them.
+     */
+    bool mostly_tombstones = table->tombstones > table->size;
+    hashtable_flat_rehash(table, mostly_tombstones ? table->capacity
+                                                   : table->capacity << 1);
+  }
+
+  uint32_t hash = hash_mix32(hashed_key);
+  return hashtable_flat_fill(table, hashtable_flat_find_free(table, hash),
+                             hash, key, value);
+}
+
+void *hashtable_flat_find_or_insert(hashtable *table, void const *key,
+                                    uint32_t hashed_key, bool *inserted) {
+  uint32_t index;
+  uint32_t free_index;
+  hashtable_flat_slot *slot =
+      hashtable_flat_find(table, key, hashed_key, table->comparison_function,
+                          &index, &free_index);
+
+  *inserted = slot == NULL;
+  if (slot != NULL) {
+    return slot->value;
+  }
+
+  /* A rehash moves everything, so the free slot has to be found again. */
+  if (table->data == NULL || table->size + table->tombstones >=
+                                 hashtable_flat_max_load(table->capacity)) {
+    return hashtable_flat_insert_hashed(table, key, NULL, hashed_key);
+  }
+
+  return hashtable_flat_fill(table, free_index, hash_mix32(hashed_key), key,
+                             NULL);
+}
+
+void hashtable_flat_remove(hashtable *table, void const *key,
+                           uint32_t hashed_key,
+                           hash_comparison_function_type comparison_function) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  uint32_t index;
+  hashtable_flat_slot *slot = hashtable_flat_find(
+      table, key, hashed_key, comparison_function, &index, NULL);
+  if (slot == NULL) {
+    return;
+  }
+
+  hashtable_release_key(table, slot->key);
+  table->size -= 1;
+
+  /*
+   * A group that still has an EMPTY slot has never been probed past, so the
+   * slot can go straight back to EMPTY instead of leaving a tombstone.
+   */
+  uint8_t const *group =
+      table->metadata + (index & ~(uint32_t)(HASHTABLE_FLAT_GROUP_WIDTH - 1));
+  if (hashtable_flat_match(group, HASHTABLE_FLAT_EMPTY) != 0) {
+    table->metadata[index] = HASHTABLE_FLAT_EMPTY;
+  } else {
+    table->metadata[index] = HASHTABLE_FLAT_DELETED;
+    table->tombstones += 1;
+  }
+}
+
+void *hashtable_flat_lookup_hashed(
+    hashtable const *table, void const *key, uint32_t hashed_key,
+    hash_comparison_function_type comparison_function) {
+  uint32_t index;
+  hashtable_flat_slot *slot = hashtable_flat_find(
+      table, key, hashed_key, comparison_function, &index, NULL);
+  if (slot == NULL) {
+    return NULL;
+  }
+
+  return slot->value;
+}
+
+void *hashtable_flat_iterate(hashtable *table, void *last_position) {
+  if (table->data == NULL) {
+    return NULL;
+  }
+
+  uint32_t slot_size = hashtable_flat_slot_size(table);
+  uint32_t index = 0;
+
+  if (last_position != NULL) {
+    index = (uint32_t)(((char *)last_position - table->data) / slot_size) + 1;
+  }
+
+  for (; index < table->capacity; ++index) {
+    if ((table->metadata[index] & HASHTABLE_FLAT_EMPTY) == 0) {
+      return hashtable_flat_slot_at(table, slot_size, index)->value;
+    }
+  }
+
+  return NULL;
+}
+
+void const *hashtable_flat_key_at(hashtable const *table,
+                                  void const *position) {
+  hashtable_flat_slot const *slot =
+      (hashtable_flat_slot const *)((char const *)position -
+                                    offsetof(hashtable_flat_slot, value));
+  return hashtable_stored_key(slot->key,
+                              hashtable_flat_inline_key(table, slot));
+}
+
+uint32_t hashtable_flat_max_probe_length(hashtable const *table) {
+  if (table->data == NULL) {
+    return 0;
+  }
+
+  uint32_t slot_size = hashtable_flat_slot_size(table);
+  uint32_t group_mask = table->capacity / HASHTABLE_FLAT_GROUP_WIDTH - 1;
+  uint32_t longest = 0;
+
+  for (uint32_t i = 0; i < table->capacity; ++i) {
+    if (table->metadata[i] & HASHTABLE_FLAT_EMPTY) {
+      continue;
+    }
+
+    /* Count the groups a lookup visits on the way to this slot's group. */
+    uint32_t hash = hashtable_flat_slot_at(table, slot_size, i)->hash;
+    uint32_t group = (hash >> 7) & group_mask;
+    uint32_t length = 1;
+    while (group != i / HASHTABLE_FLAT_GROUP_WIDTH) {
+      group = (group + length) & group_mask;
+      ++length;
+    }
+    longest = length > longest ? length : longest;
+  }
+
+  return longest;
+}
+
+void hashtable_flat_stats(hashtable const *table,
+                          hashtable_statistics *stats) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  uint32_t slot_size = hashtable_flat_slot_size(table);
+  uint32_t group_count = table->capacity / HASHTABLE_FLAT_GROUP_WIDTH;
+  uint32_t *home_counts = (uint32_t *)calloc(group_count, sizeof(uint32_t));
+
+  for (uint32_t i = 0; i < table->capacity; ++i) {
+    if (table->metadata[i] == HASHTABLE_FLAT_EMPTY) {
+      stats->free_slots += 1;
+    }
+    if (table->metadata[i] & HASHTABLE_FLAT_EMPTY) {
+      continue;
+    }
+
+    uint32_t hash = hashtable_flat_slot_at(table, slot_size, i)->hash;
+    uint32_t group = (hash >> 7) & (group_count - 1);
+    uint32_t distance = 0;
+    home_counts[group] += 1;
+    while (group != i / HASHTABLE_FLAT_GROUP_WIDTH) {
+      ++distance;
+      group = (group + distance) & (group_count - 1);
+    }
+    hashtable_histogram_add(stats->probe_distances, distance);
+  }
+
+  for (uint32_t i = 0; i < group_count; ++i) {
+    hashtable_histogram_add(stats->chain_lengths, home_counts[i]);
+  }
+  free(home_counts);
+
+  stats->bucket_bytes = (uint64_t)(slot_size + 1) * table->capacity;
+}
+
+void hashtable_flat_shrink(hashtable *table) {
+  uint32_t new_capacity = HASHTABLE_INITIAL_CAPACITY;
+  while (hashtable_flat_max_load(new_capacity) <= table->size) {
+    new_capacity = new_capacity << 1;
+  }
+
+  hashtable_flat_rehash(table, new_capacity);
+}
+
+void hashtable_flat_free(hashtable *table) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  uint32_t slot_size = hashtable_flat_slot_size(table);
+
+  /* Arena keys go away with the table. */
+  if ((table->flags & hashtable_flag_arena_keys) == 0) {
+    for (uint32_t i = 0; i < table->capacity; ++i) {
+      if ((table->metadata[i] & HASHTABLE_FLAT_EMPTY) == 0) {
+        free(hashtable_flat_slot_at(table, slot_size, i)->key);
+      }
+    }
+  }
+
+  fennec_deallocate(table->allocator, table->data,
+                    (size_t)slot_size * table->capacity);
+  fennec_deallocate(table->allocator, table->metadata, table->capacity);
+}
@@ -0,0 +1,177 @@
+/**
+ * @file
+ * @author Ryan Rohrer <ryan.rohrer@gmail.com>
+ *
+ * @section DESCRIPTION
+ * Private declarations shared between the hashtable engines. Not installed.
+ */
+#ifndef hashtable_internal_h
+#define hashtable_internal_h
+
+#include "data_structures/hashtable.h"
+
+#define HASHTABLE_INITIAL_CAPACITY 16
+/* The largest power of two capacity; reserving past it stops here. */
+#define HASHTABLE_MAX_CAPACITY (1u << 31)
+#define HASHTABLE_KEY_ARENA_CHUNK_SIZE (64 * 1024)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HASHTABLE_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define HASHTABLE_PREFETCH(address) ((void)(address))
+#endif
+
+uint32_t hashtable_string_hash(void const *string);
+bool hashtable_string_comparison(void const *string1, void const *string2);
+void *hashtable_string_copy(void const *string);
+
+/*
+ * A chunk of the arena that holds long keys. Chunks are only ever appended to
+ * and are all freed together.
+ */
+struct hashtable_key_arena {
+  struct hashtable_key_arena *next;
+  uint32_t used;
+  uint32_t capacity;
+  char data[];
+};
+
+/*
+ * Bytes each bucket sets aside after its value for an inline key.
+ */
+static inline uint32_t hashtable_inline_key_size(hashtable const *table) {
+  return (table->flags & hashtable_flag_inline_keys) ? HASHTABLE_INLINE_KEY_SIZE
+                                                     : 0;
+}
+
+/*
+ * Copies key into the table and returns what goes in the bucket's key member:
+ * NULL when the key fit in inline_key, otherwise the copy's address.
+ */
+void *hashtable_store_key(hashtable *table, char *inline_key, void const *key);
+
+/*
+ * Lets go of a key returned by hashtable_store_key.
+ */
+void hashtable_release_key(hashtable const *table, void *stored_key);
+
+void hashtable_free_key_arena(hashtable *table);
+
+/*
+ * Copies a value into a newly filled bucket, a NULL value zeroes it instead
+ * (hashtable_find_or_insert).
+ */
+static inline void hashtable_store_value(hashtable const *table, char *bucket,
+                                         void const *value) {
+  if (value == NULL) {
+    memset(bucket, 0, table->object_size);
+  } else {
+    memcpy(bucket, value, table->object_size);
+  }
+}
+
+/*
+ * Resolves a bucket's key member back to the key.
+ */
+static inline void const *hashtable_stored_key(void const *stored_key,
+                                               char const *inline_key) {
+  return stored_key != NULL ? stored_key : inline_key;
+}
+
+/*
+ * The 32 bit hash the engines work with. String tables hash with their byte
+ * hash and seed, everything else goes through the user's hash_function.
+ */
+static inline uint32_t hashtable_hash_key(hashtable const *table,
+                                          void const *key) {
+  if (table->string_hash_function == NULL) {
+    return table->hash_function(key);
+  }
+
+  uint64_t hash = table->string_hash_function(
+      key, (uint32_t)strlen((char const *)key), table->seed);
+  return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static inline void hashtable_count_resize(hashtable const *table) {
+  if (table->counters != NULL) {
+    table->counters->resizes += 1;
+  }
+}
+
+/*
+ * Adds one to a hashtable_statistics histogram, big values go in the last
+ * entry.
+ */
+static inline void hashtable_histogram_add(uint32_t *histogram,
+                                           uint32_t value) {
+  histogram[value < HASHTABLE_STATS_HISTOGRAM_SIZE
+                ? value
+                : HASHTABLE_STATS_HISTOGRAM_SIZE - 1] += 1;
+}
+
+void hashtable_flat_insert(hashtable *table, void const *key,
+                           void const *value);
+void *hashtable_flat_insert_hashed(hashtable *table, void const *key,
+                                   void const *value, uint32_t hashed_key);
+void *hashtable_flat_find_or_insert(hashtable *table, void const *key,
+                                    uint32_t hashed_key, bool *inserted);
+void hashtable_flat_remove(hashtable *table, void const *key,
+                           uint32_t hashed_key,
+                           hash_comparison_function_type comparison_function);
+void *hashtable_flat_lookup_hashed(
+    hashtable const *table, void const *key, uint32_t hashed_key,
+    hash_comparison_function_type comparison_function);
+void hashtable_flat_prefetch(hashtable const *table, uint32_t hashed_key);
+void hashtable_flat_prefetch_candidate(hashtable const *table,
+                                       uint32_t hashed_key);
+void hashtable_flat_fit(hashtable *table, uint32_t count);
+void *hashtable_flat_iterate(hashtable *table, void *last_position);
+void hashtable_flat_shrink(hashtable *table);
+void const *hashtable_flat_key_at(hashtable const *table,
+                                  void const *position);
+uint32_t hashtable_flat_max_probe_length(hashtable const *table);
+void hashtable_flat_stats(hashtable const *table, hashtable_statistics *stats);
+void hashtable_flat_free(hashtable *table);
+
+void *hashtable_robin_hood_insert_hashed(hashtable *table, void const *key,
+                                         void const *value,
+                                         uint32_t hashed_key);
+void *hashtable_robin_hood_find_or_insert(hashtable *table, void const *key,
+                                          uint32_t hashed_key,
+                                          bool *inserted);
+void hashtable_robin_hood_remove(
+    hashtable *table, void const *key, uint32_t hashed_key,
+    hash_comparison_function_type comparison_function);
+void *hashtable_robin_hood_lookup_hashed(
+    hashtable const *table, void const *key, uint32_t hashed_key,
+    hash_comparison_function_type comparison_function);
+void hashtable_robin_hood_prefetch(hashtable const *table,
+                                   uint32_t hashed_key);
+void hashtable_robin_hood_prefetch_candidate(hashtable const *table,
+                                             uint32_t hashed_key);
+void hashtable_robin_hood_fit(hashtable *table, uint32_t count);
+void *hashtable_robin_hood_iterate(hashtable *table, void *last_position);
+void hashtable_robin_hood_shrink(hashtable *table);
+void const *hashtable_robin_hood_key_at(hashtable const *table,
+                                        void const *position);
+uint32_t hashtable_robin_hood_max_probe_length(hashtable const *table);
+void hashtable_robin_hood_stats(hashtable const *table,
+                                hashtable_statistics *stats);
+void hashtable_robin_hood_free(hashtable *table);
+
+void *hashtable_mapped_lookup_hashed(
+    hashtable const *table, void const *key, uint32_t hashed_key,
+    hash_comparison_function_type comparison_function);
+void hashtable_mapped_prefetch(hashtable const *table, uint32_t hashed_key);
+void hashtable_mapped_prefetch_candidate(hashtable const *table,
+                                         uint32_t hashed_key);
+void *hashtable_mapped_iterate(hashtable *table, void *last_position);
+void const *hashtable_mapped_key_at(hashtable const *table,
+                                    void const *position);
+uint32_t hashtable_mapped_max_probe_length(hashtable const *table);
+void hashtable_mapped_stats(hashtable const *table,
+                            hashtable_statistics *stats);
+void hashtable_mapped_free(hashtable *table);
+
+#endif
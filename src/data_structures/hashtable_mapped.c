@@ -0,0 +1,392 @@
+#include "hashtable_internal.h"
+#include "utilities/file.h"
+#include <stddef.h>
+
+#define HASHTABLE_IMAGE_MAGIC "fennecht"
+#define HASHTABLE_IMAGE_VERSION 1
+
+/*
+ * Layout of a saved table, every offset is from the start of the file:
+ *
+ *   header
+ *   uint32_t starts[bucket_count + 1]   first entry of each bucket
+ *   entries, bucket by bucket           {hash, key offset, value}
+ *   strings                             the keys, NUL terminated
+ *
+ * A lookup hashes the key, reads two neighbouring starts and scans the few
+ * entries between them.
+ */
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t object_size;
+  uint32_t entry_size;
+  uint32_t bucket_count;
+  uint32_t size;
+  uint32_t hash_kind;
+  uint64_t seed;
+  uint64_t image_size;
+  uint64_t starts_offset;
+  uint64_t entries_offset;
+  uint64_t strings_offset;
+} hashtable_image_header;
+
+typedef struct {
+  uint32_t hash;
+  uint32_t key_offset;
+  char value[];
+} hashtable_image_entry;
+
+typedef enum {
+  hashtable_image_hash_wyhash = 1,
+  hashtable_image_hash_crc32c
+} hashtable_image_hash_kind;
+
+static uint64_t hashtable_image_align(uint64_t offset) {
+  return (offset + 7) & ~(uint64_t)7;
+}
+
+static uint32_t hashtable_image_entry_size(uint32_t object_size) {
+  return (uint32_t)hashtable_image_align(sizeof(hashtable_image_entry) +
+                                         object_size);
+}
+
+static hashtable_image_header const *
+hashtable_mapped_header(hashtable const *table) {
+  return (hashtable_image_header const *)table->data;
+}
+
+static uint32_t const *hashtable_mapped_starts(hashtable const *table) {
+  return (uint32_t const *)(table->data +
+                            hashtable_mapped_header(table)->starts_offset);
+}
+
+static hashtable_image_entry *hashtable_mapped_entry(hashtable const *table,
+                                                     uint32_t index) {
+  hashtable_image_header const *header = hashtable_mapped_header(table);
+  return (hashtable_image_entry *)(table->data + header->entries_offset +
+                                   (uint64_t)header->entry_size * index);
+}
+
+static char const *hashtable_mapped_string(hashtable const *table,
+                                           uint32_t offset) {
+  return table->data + hashtable_mapped_header(table)->strings_offset + offset;
+}
+
+void *hashtable_mapped_lookup_hashed(
+    hashtable const *table, void const *key, uint32_t hashed_key,
+    hash_comparison_function_type comparison_function) {
+  if (table->data == NULL) {
+    return NULL;
+  }
+
+  uint32_t const *starts = hashtable_mapped_starts(table);
+  uint32_t bucket = hashed_key & (table->capacity - 1);
+
+  for (uint32_t i = starts[bucket]; i < starts[bucket + 1]; ++i) {
+    hashtable_image_entry *entry = hashtable_mapped_entry(table, i);
+    if (entry->hash == hashed_key &&
+        comparison_function(hashtable_mapped_string(table, entry->key_offset),
+                            key)) {
+      return entry->value;
+    }
+  }
+
+  return NULL;
+}
+
+void hashtable_mapped_prefetch(hashtable const *table, uint32_t hashed_key) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  HASHTABLE_PREFETCH(hashtable_mapped_starts(table) +
+                     (hashed_key & (table->capacity - 1)));
+}
+
+void hashtable_mapped_prefetch_candidate(hashtable const *table,
+                                         uint32_t hashed_key) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  uint32_t const *starts = hashtable_mapped_starts(table);
+  HASHTABLE_PREFETCH(hashtable_mapped_entry(
+      table, starts[hashed_key & (table->capacity - 1)]));
+}
+
+void *hashtable_mapped_iterate(hashtable *table, void *last_position) {
+  if (table->data == NULL) {
+    return NULL;
+  }
+
+  uint32_t index = 0;
+  if (last_position != NULL) {
+    hashtable_image_entry const *first = hashtable_mapped_entry(table, 0);
+    index = (uint32_t)(((char *)last_position - first->value) /
+                       hashtable_mapped_header(table)->entry_size) +
+            1;
+  }
+
+  if (index >= table->size) {
+    return NULL;
+  }
+
+  return hashtable_mapped_entry(table, index)->value;
+}
+
+void const *hashtable_mapped_key_at(hashtable const *table,
+                                    void const *position) {
+  hashtable_image_entry const *entry =
+      (hashtable_image_entry const *)((char const *)position -
+                                      offsetof(hashtable_image_entry, value));
+  return hashtable_mapped_string(table, entry->key_offset);
+}
+
+uint32_t hashtable_mapped_max_probe_length(hashtable const *table) {
+  if (table->data == NULL) {
+    return 0;
+  }
+
+  uint32_t const *starts = hashtable_mapped_starts(table);
+  uint32_t longest = 0;
+  for (uint32_t i = 0; i < table->capacity; ++i) {
+    uint32_t length = starts[i + 1] - starts[i];
+    longest = length > longest ? length : longest;
+  }
+
+  return longest;
+}
+
+void hashtable_mapped_stats(hashtable const *table,
+                            hashtable_statistics *stats) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  uint32_t const *starts = hashtable_mapped_starts(table);
+  for (uint32_t i = 0; i < table->capacity; ++i) {
+    uint32_t length = starts[i + 1] - starts[i];
+    hashtable_histogram_add(stats->chain_lengths, length);
+    for (uint32_t position = 0; position < length; ++position) {
+      hashtable_histogram_add(stats->probe_distances, position);
+    }
+  }
+
+  hashtable_image_header const *header = hashtable_mapped_header(table);
+  stats->bucket_bytes = header->strings_offset;
+  stats->key_bytes = header->image_size - header->strings_offset;
+}
+
+void hashtable_mapped_free(hashtable *table) {
+  file_data mapping = {table->data,
+                       (uint32_t)hashtable_mapped_header(table)->image_size,
+                       true, NULL};
+  file_data_free(&mapping);
+}
+
+bool hashtable_save(hashtable *table, string const *path) {
+  uint32_t hash_kind;
+  if (table->string_hash_function == hash_wyhash) {
+    hash_kind = hashtable_image_hash_wyhash;
+  } else if (table->string_hash_function == hash_crc32c) {
+    hash_kind = hashtable_image_hash_crc32c;
+  } else {
+    return false;
+  }
+
+  uint32_t count = table->size;
+  uint32_t bucket_count = HASHTABLE_INITIAL_CAPACITY;
+  while (bucket_count < count) {
+    bucket_count = bucket_count << 1;
+  }
+
+  /*
+   * First pass: hash every key and count how many land in each bucket, so
+   * the second pass can write the entries straight to their final place.
+   */
+  uint32_t *hashes = (uint32_t *)malloc(sizeof(uint32_t) * (count + 1));
+  void **positions = (void **)malloc(sizeof(void *) * (count + 1));
+  uint32_t *starts = (uint32_t *)calloc(bucket_count + 1, sizeof(uint32_t));
+  uint64_t strings_size = 0;
+
+  uint32_t found = 0;
+  void *position = NULL;
+  while ((position = hashtable_iterate(table, position)) != NULL &&
+         found < count) {
+    char const *key = (char const *)hashtable_key_at(table, position);
+    hashes[found] = hashtable_hash_key(table, key);
+    positions[found] = position;
+    starts[(hashes[found] & (bucket_count - 1)) + 1] += 1;
+    strings_size += strlen(key) + 1;
+    ++found;
+  }
+
+  for (uint32_t i = 0; i < bucket_count; ++i) {
+    starts[i + 1] += starts[i];
+  }
+
+  hashtable_image_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, HASHTABLE_IMAGE_MAGIC, sizeof(header.magic));
+  header.version = HASHTABLE_IMAGE_VERSION;
+  header.object_size = table->object_size;
+  header.entry_size = hashtable_image_entry_size(table->object_size);
+  header.bucket_count = bucket_count;
+  header.size = found;
+  header.hash_kind = hash_kind;
+  header.seed = table->seed;
+  header.starts_offset = hashtable_image_align(sizeof(header));
+  header.entries_offset = hashtable_image_align(
+      header.starts_offset + sizeof(uint32_t) * ((uint64_t)bucket_count + 1));
+  header.strings_offset =
+      header.entries_offset + (uint64_t)header.entry_size * found;
+  header.image_size = header.strings_offset + strings_size;
+
+  bool saved = false;
+  char *image = header.image_size <= UINT32_MAX
+                    ? (char *)calloc(1, (size_t)header.image_size)
+                    : NULL;
+
+  if (image != NULL) {
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + header.starts_offset, starts,
+           sizeof(uint32_t) * ((size_t)bucket_count + 1));
+
+    uint32_t strings_used = 0;
+    for (uint32_t i = 0; i < found; ++i) {
+      uint32_t bucket = hashes[i] & (bucket_count - 1);
+      hashtable_image_entry *entry =
+          (hashtable_image_entry *)(image + header.entries_offset +
+                                    (uint64_t)header.entry_size *
+                                        starts[bucket]++);
+      char const *key = (char const *)hashtable_key_at(table, positions[i]);
+      uint32_t key_size = (uint32_t)strlen(key) + 1;
+
+      entry->hash = hashes[i];
+      entry->key_offset = strings_used;
+      memcpy(entry->value, positions[i], table->object_size);
+      memcpy(image + header.strings_offset + strings_used, key, key_size);
+      strings_used += key_size;
+    }
+
+    saved = file_write_all(path, image, (uint32_t)header.image_size);
+    free(image);
+  }
+
+  free(hashes);
+  free(positions);
+  free(starts);
+
+  return saved;
+}
+
+/*
+ * Checks that the starts never go backwards and end at size, that every key
+ * offset falls inside the strings and that the strings end with a NUL, so
+ * lookups, iteration and hashtable_key_at stay inside the mapping.
+ */
+static bool hashtable_image_contents_valid(hashtable_image_header const *header,
+                                           char const *image) {
+  uint32_t const *starts =
+      (uint32_t const *)(image + header->starts_offset);
+  for (uint32_t i = 0; i < header->bucket_count; ++i) {
+    if (starts[i] > starts[i + 1]) {
+      return false;
+    }
+  }
+  if (starts[header->bucket_count] != header->size) {
+    return false;
+  }
+
+  uint64_t strings_size = header->image_size - header->strings_offset;
+  if (header->size == 0) {
+    return true;
+  }
+  if (strings_size == 0 || image[header->image_size - 1] != '\0') {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < header->size; ++i) {
+    hashtable_image_entry const *entry =
+        (hashtable_image_entry const *)(image + header->entries_offset +
+                                        (uint64_t)header->entry_size * i);
+    if (entry->key_offset >= strings_size) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/*
+ * Checks that the image is a saved table whose sections lie inside the
+ * mapping, in order and without overlapping, and that its contents only point
+ * inside them. A truncated or corrupt file fails to open rather than being
+ * read out of bounds later.
+ */
+static bool hashtable_image_valid(file_data const *mapping) {
+  if (mapping->data == NULL ||
+      mapping->size < sizeof(hashtable_image_header)) {
+    return false;
+  }
+
+  hashtable_image_header const *header =
+      (hashtable_image_header const *)mapping->data;
+  if (memcmp(header->magic, HASHTABLE_IMAGE_MAGIC, sizeof(header->magic)) !=
+          0 ||
+      header->version != HASHTABLE_IMAGE_VERSION ||
+      header->image_size != mapping->size ||
+      (header->hash_kind != hashtable_image_hash_wyhash &&
+       header->hash_kind != hashtable_image_hash_crc32c) ||
+      header->bucket_count == 0 ||
+      (header->bucket_count & (header->bucket_count - 1)) != 0 ||
+      header->entry_size != hashtable_image_entry_size(header->object_size) ||
+      header->entry_size <
+          sizeof(hashtable_image_entry) + (uint64_t)header->object_size) {
+    return false;
+  }
+
+  /* Compared by subtracting, so huge offsets can't wrap around. */
+  if (header->starts_offset < sizeof(hashtable_image_header) ||
+      header->starts_offset % 8 != 0 || header->entries_offset % 8 != 0 ||
+      header->starts_offset > header->entries_offset ||
+      header->entries_offset > header->strings_offset ||
+      header->strings_offset > header->image_size ||
+      sizeof(uint32_t) * ((uint64_t)header->bucket_count + 1) >
+          header->entries_offset - header->starts_offset ||
+      (uint64_t)header->entry_size * header->size >
+          header->strings_offset - header->entries_offset) {
+    return false;
+  }
+
+  return hashtable_image_contents_valid(header, (char const *)mapping->data);
+}
+
+hashtable hashtable_open_mapped(string const *path) {
+  hashtable table =
+      hashtable_new(0, hashtable_string_hash, hashtable_string_comparison,
+                    hashtable_string_copy);
+  table.engine = hashtable_engine_mapped;
+
+  file_data mapping = file_map(path);
+  if (!hashtable_image_valid(&mapping)) {
+    if (mapping.data != NULL) {
+      file_data_free(&mapping);
+    }
+    return table;
+  }
+
+  hashtable_image_header const *header =
+      (hashtable_image_header const *)mapping.data;
+  table.size = header->size;
+  table.capacity = header->bucket_count;
+  table.object_size = header->object_size;
+  table.data = (char *)mapping.data;
+  table.seed = header->seed;
+  table.string_hash_function =
+      header->hash_kind == hashtable_image_hash_wyhash ? hash_wyhash
+                                                       : hash_crc32c;
+
+  return table;
+}
@@ -0,0 +1,464 @@
+#include "hashtable_internal.h"
+#include <stddef.h>
+
+#define HASHTABLE_ROBIN_HOOD_EMPTY ((uint8_t)0)
+#define HASHTABLE_ROBIN_HOOD_SATURATED ((uint8_t)0xFF)
+
+/*
+ * Linear probing where every element records how far it sits from its home
+ * slot. The metadata byte of a slot is 0 when it's empty, otherwise the
+ * element's displacement + 1; displacements too big for a byte are stored as
+ * HASHTABLE_ROBIN_HOOD_SATURATED and worked out again from the stored hash.
+ *
+ * An insert takes the slot of the first element that is closer to its home
+ * than the new one would be and pushes the rest of the run one slot along, so
+ * the elements of a run are always ordered by home slot. A lookup can stop as
+ * soon as it reaches an element closer to its home than the key would be, and
+ * a remove pulls the following elements back one slot instead of leaving a
+ * tombstone. padding puts value at an 8 byte offset so values that need 8
+ * byte alignment get it.
+ */
+typedef struct {
+  void *key;
+  uint32_t hash;
+  uint32_t padding;
+  char value[];
+} hashtable_robin_hood_slot;
+
+static uint32_t hashtable_robin_hood_slot_size(hashtable const *table) {
+  uint32_t size = sizeof(hashtable_robin_hood_slot) + table->object_size +
+                  hashtable_inline_key_size(table);
+  return (size + sizeof(void *) - 1) & ~(uint32_t)(sizeof(void *) - 1);
+}
+
+static uint32_t hashtable_robin_hood_max_load(uint32_t capacity) {
+  return capacity - capacity / 8;
+}
+
+static hashtable_robin_hood_slot *
+hashtable_robin_hood_slot_at(hashtable const *table, uint32_t slot_size,
+                             uint32_t index) {
+  return (hashtable_robin_hood_slot *)(table->data +
+                                       (size_t)slot_size * index);
+}
+
+static char *
+hashtable_robin_hood_inline_key(hashtable const *table,
+                                hashtable_robin_hood_slot const *slot) {
+  return (char *)slot->value + table->object_size;
+}
+
+static uint8_t hashtable_robin_hood_tag(uint32_t distance) {
+  return distance < HASHTABLE_ROBIN_HOOD_SATURATED - 1
+             ? (uint8_t)(distance + 1)
+             : HASHTABLE_ROBIN_HOOD_SATURATED;
+}
+
+/*
+ * Displacement of the element in a full slot.
+ */
+static uint32_t hashtable_robin_hood_distance(hashtable const *table,
+                                              uint32_t slot_size,
+                                              uint32_t index) {
+  uint8_t tag = table->metadata[index];
+  if (tag != HASHTABLE_ROBIN_HOOD_SATURATED) {
+    return tag - 1u;
+  }
+
+  uint32_t home = hashtable_robin_hood_slot_at(table, slot_size, index)->hash &
+                  (table->capacity - 1);
+  return (index - home) & (table->capacity - 1);
+}
+
+/*
+ * Pushes the elements from index up to the next empty slot along one slot and
+ * marks index as holding an element distance from its home. The caller fills
+ * in the slot. Needs at least one empty slot.
+ */
+static void hashtable_robin_hood_shift_into(hashtable *table,
+                                            uint32_t slot_size, uint32_t index,
+                                            uint32_t distance) {
+  uint32_t mask = table->capacity - 1;
+  uint32_t end = index;
+  while (table->metadata[end] != HASHTABLE_ROBIN_HOOD_EMPTY) {
+    end = (end + 1) & mask;
+  }
+
+  while (end != index) {
+    uint32_t previous = (end - 1) & mask;
+    table->metadata[end] = hashtable_robin_hood_tag(
+        hashtable_robin_hood_distance(table, slot_size, previous) + 1);
+    memcpy(hashtable_robin_hood_slot_at(table, slot_size, end),
+           hashtable_robin_hood_slot_at(table, slot_size, previous),
+           slot_size);
+    end = previous;
+  }
+
+  table->metadata[index] = hashtable_robin_hood_tag(distance);
+}
+
+/*
+ * Frees up the slot an element with this hash belongs in and returns its
+ * index, see hashtable_robin_hood_shift_into.
+ */
+static uint32_t hashtable_robin_hood_make_room(hashtable *table,
+                                               uint32_t slot_size,
+                                               uint32_t hash) {
+  uint32_t mask = table->capacity - 1;
+  uint32_t index = hash & mask;
+  uint32_t distance = 0;
+
+  while (table->metadata[index] != HASHTABLE_ROBIN_HOOD_EMPTY &&
+         hashtable_robin_hood_distance(table, slot_size, index) >= distance) {
+    index = (index + 1) & mask;
+    ++distance;
+  }
+
+  hashtable_robin_hood_shift_into(table, slot_size, index, distance);
+  return index;
+}
+
+/*
+ * Probes for key. On a miss found_index is set to the slot the probe stopped
+ * at, which is where hashtable_robin_hood_make_room would put the key.
+ */
+static hashtable_robin_hood_slot *
+hashtable_robin_hood_find(hashtable const *table, void const *key,
+                          uint32_t hashed_key,
+                          hash_comparison_function_type comparison_function,
+                          uint32_t *found_index) {
+  if (table->data == NULL) {
+    return NULL;
+  }
+
+  uint32_t hash = hash_mix32(hashed_key);
+  uint32_t slot_size = hashtable_robin_hood_slot_size(table);
+  uint32_t mask = table->capacity - 1;
+  uint32_t index = hash & mask;
+
+  /* The home slot is usually needed, fetch it alongside its metadata. */
+  HASHTABLE_PREFETCH(hashtable_robin_hood_slot_at(table, slot_size, index));
+
+  for (uint32_t distance = 0;; ++distance) {
+    if (table->metadata[index] == HASHTABLE_ROBIN_HOOD_EMPTY) {
+      *found_index = index;
+      return NULL;
+    }
+
+    /*
+     * Elements closer to their home than the key would be only start after
+     * every element that could be the key.
+     */
+    uint32_t slot_distance =
+        hashtable_robin_hood_distance(table, slot_size, index);
+    if (slot_distance < distance) {
+      *found_index = index;
+      return NULL;
+    }
+
+    if (slot_distance == distance) {
+      hashtable_robin_hood_slot *slot =
+          hashtable_robin_hood_slot_at(table, slot_size, index);
+      void const *slot_key = hashtable_stored_key(
+          slot->key, hashtable_robin_hood_inline_key(table, slot));
+      if (slot->hash == hash && comparison_function(slot_key, key)) {
+        *found_index = index;
+        return slot;
+      }
+    }
+
+    index = (index + 1) & mask;
+  }
+}
+
+static void hashtable_robin_hood_rehash(hashtable *table,
+                                        uint32_t new_capacity) {
+  char *old_data = table->data;
+  uint8_t *old_metadata = table->metadata;
+  uint32_t old_capacity = table->capacity;
+  uint32_t slot_size = hashtable_robin_hood_slot_size(table);
+
+  table->data = (char *)fennec_allocate(table->allocator,
+                                        (size_t)slot_size * new_capacity);
+  table->metadata =
+      (uint8_t *)fennec_allocate_zeroed(table->allocator, new_capacity, 1);
+  table->capacity = new_capacity;
+
+  if (old_data == NULL) {
+    return;
+  }
+  hashtable_count_resize(table);
+
+  for (uint32_t i = 0; i < old_capacity; ++i) {
+    if (old_metadata[i] == HASHTABLE_ROBIN_HOOD_EMPTY) {
+      continue;
+    }
+
+    char *old_slot = old_data + (size_t)slot_size * i;
+    uint32_t index = hashtable_robin_hood_make_room(
+        table, slot_size, ((hashtable_robin_hood_slot *)old_slot)->hash);
+    memcpy(hashtable_robin_hood_slot_at(table, slot_size, index), old_slot,
+           slot_size);
+  }
+
+  fennec_deallocate(table->allocator, old_data,
+                    (size_t)slot_size * old_capacity);
+  fennec_deallocate(table->allocator, old_metadata, old_capacity);
+}
+
+void hashtable_robin_hood_fit(hashtable *table, uint32_t count) {
+  uint32_t new_capacity = table->capacity;
+  while (new_capacity < HASHTABLE_MAX_CAPACITY &&
+         hashtable_robin_hood_max_load(new_capacity) <= count) {
+    new_capacity = new_capacity << 1;
+  }
+
+  if (table->data == NULL || new_capacity != table->capacity) {
+    hashtable_robin_hood_rehash(table, new_capacity);
+  }
+}
+
+void hashtable_robin_hood_prefetch(hashtable const *table,
+                                   uint32_t hashed_key) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  uint32_t index = hash_mix32(hashed_key) & (table->capacity - 1);
+  HASHTABLE_PREFETCH(table->metadata + index);
+  HASHTABLE_PREFETCH(hashtable_robin_hood_slot_at(
+      table, hashtable_robin_hood_slot_size(table), index));
+}
+
+void hashtable_robin_hood_prefetch_candidate(hashtable const *table,
+                                             uint32_t hashed_key) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  uint32_t index = hash_mix32(hashed_key) & (table->capacity - 1);
+  if (table->metadata[index] == hashtable_robin_hood_tag(0)) {
+    HASHTABLE_PREFETCH(
+        hashtable_robin_hood_slot_at(table,
+                                     hashtable_robin_hood_slot_size(table),
+                                     index)
+            ->key);
+  }
+}
+
+/*
+ * Fills in the slot at index, made room for by hashtable_robin_hood_make_room
+ * or hashtable_robin_hood_shift_into, and returns its value.
+ */
+static void *hashtable_robin_hood_fill(hashtable *table, uint32_t slot_size,
+                                       uint32_t index, uint32_t hash,
+                                       void const *key, void const *value) {
+  table->size += 1;
+
+  hashtable_robin_hood_slot *slot =
+      hashtable_robin_hood_slot_at(table, slot_size, index);
+  slot->key = hashtable_store_key(
+      table, hashtable_robin_hood_inline_key(table, slot), key);
+  slot->hash = hash;
+  hashtable_store_value(table, slot->value, value);
+  return slot->value;
+}
+
+void *hashtable_robin_hood_insert_hashed(hashtable *table, void const *key,
+                                         void const *value,
+                                         uint32_t hashed_key) {
+  if (table->data == NULL) {
+    hashtable_robin_hood_rehash(table, table->capacity);
+  } else if (table->size >= hashtable_robin_hood_max_load(table->capacity)) {
+    hashtable_robin_hood_rehash(table, table->capacity << 1);
+  }
+
+  uint32_t hash = hash_mix32(hashed_key);
+  uint32_t slot_size = hashtable_robin_hood_slot_size(table);
+  uint32_t index = hashtable_robin_hood_make_room(table, slot_size, hash);
+  return hashtable_robin_hood_fill(table, slot_size, index, hash, key, value);
+}
+
+void *hashtable_robin_hood_find_or_insert(hashtable *table, void const *key,
+                                          uint32_t hashed_key,
+                                          bool *inserted) {
+  uint32_t index;
+  hashtable_robin_hood_slot *slot = hashtable_robin_hood_find(
+      table, key, hashed_key, table->comparison_function, &index);
+
+  *inserted = slot == NULL;
+  if (slot != NULL) {
+    return slot->value;
+  }
+
+  /* A rehash moves everything, so the slot has to be found again. */
+  if (table->data == NULL ||
+      table->size >= hashtable_robin_hood_max_load(table->capacity)) {
+    return hashtable_robin_hood_insert_hashed(table, key, NULL, hashed_key);
+  }
+
+  uint32_t hash = hash_mix32(hashed_key);
+  uint32_t slot_size = hashtable_robin_hood_slot_size(table);
+  hashtable_robin_hood_shift_into(table, slot_size, index,
+                                  (index - hash) & (table->capacity - 1));
+  return hashtable_robin_hood_fill(table, slot_size, index, hash, key, NULL);
+}
+
+void hashtable_robin_hood_remove(
+    hashtable *table, void const *key, uint32_t hashed_key,
+    hash_comparison_function_type comparison_function) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  uint32_t index;
+  hashtable_robin_hood_slot *slot = hashtable_robin_hood_find(
+      table, key, hashed_key, comparison_function, &index);
+  if (slot == NULL) {
+    return;
+  }
+
+  hashtable_release_key(table, slot->key);
+  table->size -= 1;
+
+  /*
+   * Backward shift: pull the rest of the run back one slot until an empty
+   * slot or an element already in its home slot.
+   */
+  uint32_t slot_size = hashtable_robin_hood_slot_size(table);
+  uint32_t mask = table->capacity - 1;
+  uint32_t next = (index + 1) & mask;
+
+  while (table->metadata[next] != HASHTABLE_ROBIN_HOOD_EMPTY &&
+         table->metadata[next] != hashtable_robin_hood_tag(0)) {
+    table->metadata[index] = hashtable_robin_hood_tag(
+        hashtable_robin_hood_distance(table, slot_size, next) - 1);
+    memcpy(hashtable_robin_hood_slot_at(table, slot_size, index),
+           hashtable_robin_hood_slot_at(table, slot_size, next), slot_size);
+    index = next;
+    next = (next + 1) & mask;
+  }
+
+  table->metadata[index] = HASHTABLE_ROBIN_HOOD_EMPTY;
+}
+
+void *hashtable_robin_hood_lookup_hashed(
+    hashtable const *table, void const *key, uint32_t hashed_key,
+    hash_comparison_function_type comparison_function) {
+  uint32_t index;
+  hashtable_robin_hood_slot *slot = hashtable_robin_hood_find(
+      table, key, hashed_key, comparison_function, &index);
+  if (slot == NULL) {
+    return NULL;
+  }
+
+  return slot->value;
+}
+
+void *hashtable_robin_hood_iterate(hashtable *table, void *last_position) {
+  if (table->data == NULL) {
+    return NULL;
+  }
+
+  uint32_t slot_size = hashtable_robin_hood_slot_size(table);
+  uint32_t index = 0;
+
+  if (last_position != NULL) {
+    index = (uint32_t)(((char *)last_position - table->data) / slot_size) + 1;
+  }
+
+  for (; index < table->capacity; ++index) {
+    if (table->metadata[index] != HASHTABLE_ROBIN_HOOD_EMPTY) {
+      return hashtable_robin_hood_slot_at(table, slot_size, index)->value;
+    }
+  }
+
+  return NULL;
+}
+
+void const *hashtable_robin_hood_key_at(hashtable const *table,
+                                        void const *position) {
+  hashtable_robin_hood_slot const *slot =
+      (hashtable_robin_hood_slot const *)((char const *)position -
+                                          offsetof(hashtable_robin_hood_slot,
+                                                   value));
+  return hashtable_stored_key(slot->key,
+                              hashtable_robin_hood_inline_key(table, slot));
+}
+
+uint32_t hashtable_robin_hood_max_probe_length(hashtable const *table) {
+  if (table->data == NULL) {
+    return 0;
+  }
+
+  uint32_t slot_size = hashtable_robin_hood_slot_size(table);
+  uint32_t longest = 0;
+
+  for (uint32_t i = 0; i < table->capacity; ++i) {
+    if (table->metadata[i] != HASHTABLE_ROBIN_HOOD_EMPTY) {
+      uint32_t length = hashtable_robin_hood_distance(table, slot_size, i) + 1;
+      longest = length > longest ? length : longest;
+    }
+  }
+
+  return longest;
+}
+
+void hashtable_robin_hood_stats(hashtable const *table,
+                                hashtable_statistics *stats) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  uint32_t slot_size = hashtable_robin_hood_slot_size(table);
+  uint32_t mask = table->capacity - 1;
+  uint32_t *home_counts = (uint32_t *)calloc(table->capacity, sizeof(uint32_t));
+
+  for (uint32_t i = 0; i < table->capacity; ++i) {
+    if (table->metadata[i] == HASHTABLE_ROBIN_HOOD_EMPTY) {
+      stats->free_slots += 1;
+      continue;
+    }
+
+    uint32_t distance = hashtable_robin_hood_distance(table, slot_size, i);
+    home_counts[(i - distance) & mask] += 1;
+    hashtable_histogram_add(stats->probe_distances, distance);
+  }
+
+  for (uint32_t i = 0; i < table->capacity; ++i) {
+    hashtable_histogram_add(stats->chain_lengths, home_counts[i]);
+  }
+  free(home_counts);
+
+  stats->bucket_bytes = (uint64_t)(slot_size + 1) * table->capacity;
+}
+
+void hashtable_robin_hood_shrink(hashtable *table) {
+  uint32_t new_capacity = HASHTABLE_INITIAL_CAPACITY;
+  while (hashtable_robin_hood_max_load(new_capacity) <= table->size) {
+    new_capacity = new_capacity << 1;
+  }
+
+  hashtable_robin_hood_rehash(table, new_capacity);
+}
+
+void hashtable_robin_hood_free(hashtable *table) {
+  if (table->data == NULL) {
+    return;
+  }
+
+  uint32_t slot_size = hashtable_robin_hood_slot_size(table);
+
+  /* Arena keys go away with the table. */
+  if ((table->flags & hashtable_flag_arena_keys) == 0) {
+    for (uint32_t i = 0; i < table->capacity; ++i) {
+      if (table->metadata[i] != HASHTABLE_ROBIN_HOOD_EMPTY) {
+        free(hashtable_robin_hood_slot_at(table, slot_size, i)->key);
+      }
+    }
+  }
+
+  fennec_deallocate(table->allocator, table->data,
+                    (size_t)slot_size * table->capacity);
+  fennec_deallocate(table->allocator, table->metadata, table->capacity);
+}
@@ -0,0 +1,200 @@
+#define _GNU_SOURCE
+#include "data_structures/large_array.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+static size_t large_array_granule(large_array const *array) {
+  if (array->flags & large_array_flag_huge_pages) {
+    return LARGE_ARRAY_HUGE_PAGE_SIZE;
+  }
+
+  long page_size = sysconf(_SC_PAGESIZE);
+  return page_size > 0 ? (size_t)page_size : 4096;
+}
+
+static void large_array_advise(large_array const *array, char *data,
+                               size_t bytes) {
+#ifdef MADV_HUGEPAGE
+  if (array->flags & large_array_flag_huge_pages) {
+    madvise(data, bytes, MADV_HUGEPAGE);
+  }
+#else
+  (void)array;
+  (void)data;
+  (void)bytes;
+#endif
+}
+
+static char *large_array_map(size_t bytes) {
+  void *data = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return data == MAP_FAILED ? NULL : (char *)data;
+}
+
+/*
+ * Resizes the array's mapping to new_bytes, moving it if the kernel has to.
+ * Without mremap (or if it fails) the elements are copied to a new mapping.
+ */
+static char *large_array_remap(large_array const *array, size_t new_bytes) {
+#ifdef MREMAP_MAYMOVE
+  void *remapped =
+      mremap(array->data, array->reserved_bytes, new_bytes, MREMAP_MAYMOVE);
+  if (remapped != MAP_FAILED) {
+    return (char *)remapped;
+  }
+#endif
+
+  char *data = large_array_map(new_bytes);
+  if (data != NULL) {
+    size_t used = array->size * array->object_size;
+    memcpy(data, array->data, used < new_bytes ? used : new_bytes);
+    munmap(array->data, array->reserved_bytes);
+  }
+  return data;
+}
+
+static void large_array_release(large_array *array) {
+  if (array->mapped) {
+    munmap(array->data, array->reserved_bytes);
+  } else {
+    free(array->data);
+  }
+}
+
+/*
+ * Moves data to an allocation of at least capacity elements, mapped when it
+ * is past LARGE_ARRAY_MAP_THRESHOLD. If a mapping can't be made the array
+ * stays in (or goes to) malloc'd memory instead.
+ */
+static void large_array_reallocate(large_array *array, uint64_t capacity) {
+  size_t new_bytes = capacity * array->object_size;
+  size_t used = array->size * array->object_size;
+  used = used < new_bytes ? used : new_bytes;
+
+  if (new_bytes >= LARGE_ARRAY_MAP_THRESHOLD) {
+    size_t granule = large_array_granule(array);
+    size_t mapped_bytes = (new_bytes + granule - 1) / granule * granule;
+    char *data = NULL;
+
+    if (array->mapped) {
+      data = large_array_remap(array, mapped_bytes);
+    } else {
+      data = large_array_map(mapped_bytes);
+      if (data != NULL && array->data != NULL) {
+        memcpy(data, array->data, used);
+        free(array->data);
+      }
+    }
+
+    if (data != NULL) {
+      large_array_advise(array, data, mapped_bytes);
+      array->data = data;
+      array->mapped = true;
+      array->reserved_bytes = mapped_bytes;
+      array->capacity = mapped_bytes / array->object_size;
+      return;
+    }
+  }
+
+  char *data = NULL;
+  if (array->mapped) {
+    data = (char *)malloc(new_bytes);
+    memcpy(data, array->data, used);
+    munmap(array->data, array->reserved_bytes);
+  } else {
+    data = (char *)realloc(array->data, new_bytes);
+  }
+
+  array->data = data;
+  array->mapped = false;
+  array->reserved_bytes = new_bytes;
+  array->capacity = capacity;
+}
+
+static void large_array_grow_to(large_array *array, uint64_t count) {
+  if (count > array->capacity) {
+    uint64_t new_capacity = array->capacity * 2 + 16;
+    large_array_reallocate(array,
+                           count > new_capacity ? count : new_capacity);
+  }
+}
+
+large_array large_array_new(uint64_t object_size, uint32_t flags) {
+  return (large_array){0, 0, object_size, 0, flags, false, NULL};
+}
+
+void large_array_reserve(large_array *array, uint64_t reserve_count) {
+  if (array->capacity < reserve_count) {
+    large_array_reallocate(array, reserve_count);
+  }
+}
+
+void large_array_push_back(large_array *array, void const *data) {
+  large_array_grow_to(array, array->size + 1);
+
+  memcpy(array->data + array->size * array->object_size, data,
+         array->object_size);
+  array->size += 1;
+}
+
+void large_array_push_back_n(large_array *array, void const *data,
+                             uint64_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  memcpy(large_array_emplace_back_uninit(array, count), data,
+         count * array->object_size);
+}
+
+void *large_array_emplace_back_uninit(large_array *array, uint64_t count) {
+  uint64_t insertion_point = array->size;
+  large_array_resize(array, array->size + count);
+
+  return array->data + insertion_point * array->object_size;
+}
+
+void large_array_resize(large_array *array, uint64_t size) {
+  large_array_grow_to(array, size);
+  array->size = size;
+}
+
+void large_array_pop_back(large_array *array) {
+  if (array->size > 0) {
+    array->size -= 1;
+  }
+}
+
+void *large_array_get_at(large_array const *array, uint64_t index) {
+  if (index >= array->size) {
+    return NULL;
+  }
+
+  return array->data + index * array->object_size;
+}
+
+void *large_array_get_back(large_array const *array) {
+  if (array->size == 0) {
+    return NULL;
+  }
+
+  return large_array_get_at(array, array->size - 1);
+}
+
+void large_array_clear(large_array *array) { array->size = 0; }
+
+void large_array_shrink(large_array *array) {
+  if (array->size == 0) {
+    large_array_free(array);
+    return;
+  }
+
+  if (array->size < array->capacity) {
+    large_array_reallocate(array, array->size);
+  }
+}
+
+void large_array_free(large_array *array) {
+  large_array_release(array);
+  *array = large_array_new(array->object_size, array->flags);
+}
@@ -0,0 +1,405 @@
+#include "data_structures/perfect_hashtable.h"
+
+#define PERFECT_HASHTABLE_BUCKET_DENSITY 5.f
+#define PERFECT_HASHTABLE_LOAD_FACTOR 0.99f
+#define PERFECT_HASHTABLE_MAX_PILOT (1u << 20)
+#define PERFECT_HASHTABLE_MAX_ATTEMPTS 16
+#define PERFECT_HASHTABLE_ALIGNMENT 8
+
+typedef struct {
+  uint64_t hash;
+  uint32_t index;
+  uint32_t bucket;
+} perfect_hashtable_item;
+
+static uint64_t perfect_hashtable_mix(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+/*
+ * Maps a 32 bit number onto [0, range) without a division.
+ */
+static uint32_t perfect_hashtable_reduce(uint32_t value, uint32_t range) {
+  return (uint32_t)(((uint64_t)value * range) >> 32);
+}
+
+static uint32_t perfect_hashtable_align(uint32_t size) {
+  return (size + PERFECT_HASHTABLE_ALIGNMENT - 1) &
+         ~(uint32_t)(PERFECT_HASHTABLE_ALIGNMENT - 1);
+}
+
+static uint64_t perfect_hashtable_hash(perfect_hashtable const *table,
+                                       char const *key, uint32_t length) {
+  return hash_wyhash(key, length, table->seed);
+}
+
+/*
+ * 60% of the keys go to the first 30% of the buckets. The big buckets are
+ * placed first while most positions are still free, which is what keeps the
+ * pilots small.
+ */
+static uint32_t perfect_hashtable_bucket(perfect_hashtable const *table,
+                                         uint64_t hash) {
+  uint32_t dense_buckets = table->bucket_count * 3 / 10;
+  uint32_t high = (uint32_t)(hash >> 32);
+
+  if ((uint32_t)hash < 0x99999999u) {
+    return perfect_hashtable_reduce(high, dense_buckets);
+  }
+  return dense_buckets +
+         perfect_hashtable_reduce(high, table->bucket_count - dense_buckets);
+}
+
+static uint32_t perfect_hashtable_raw_position(perfect_hashtable const *table,
+                                               uint64_t hash, uint32_t pilot) {
+  uint64_t mixed =
+      perfect_hashtable_mix(hash ^ ((uint64_t)pilot * 0x9e3779b97f4a7c15ull));
+  return perfect_hashtable_reduce((uint32_t)(mixed >> 32), table->table_size);
+}
+
+static uint32_t perfect_hashtable_position(perfect_hashtable const *table,
+                                           uint64_t hash) {
+  uint32_t pilot = table->pilots[perfect_hashtable_bucket(table, hash)];
+  uint32_t position = perfect_hashtable_raw_position(table, hash, pilot);
+  return position < table->size ? position
+                                : table->remap[position - table->size];
+}
+
+static int perfect_hashtable_compare_items(void const *a, void const *b) {
+  perfect_hashtable_item const *item1 = (perfect_hashtable_item const *)a;
+  perfect_hashtable_item const *item2 = (perfect_hashtable_item const *)b;
+
+  if (item1->hash != item2->hash) {
+    return item1->hash < item2->hash ? -1 : 1;
+  }
+  return item1->index < item2->index ? -1 : item1->index > item2->index;
+}
+
+static bool perfect_hashtable_is_taken(uint64_t const *taken,
+                                       uint32_t position) {
+  return (taken[position / 64] >> (position % 64)) & 1;
+}
+
+/*
+ * Finds a pilot for every bucket, biggest buckets first. Returns false if a
+ * bucket needs an unreasonably large pilot, in which case the caller retries
+ * with another seed.
+ */
+static bool perfect_hashtable_search_pilots(perfect_hashtable *table,
+                                            perfect_hashtable_item *items,
+                                            uint64_t *taken) {
+  uint32_t *bucket_starts =
+      (uint32_t *)calloc(table->bucket_count + 1, sizeof(uint32_t));
+  for (uint32_t i = 0; i < table->size; ++i) {
+    bucket_starts[items[i].bucket + 1] += 1;
+  }
+
+  uint32_t largest = 0;
+  for (uint32_t b = 0; b < table->bucket_count; ++b) {
+    largest = bucket_starts[b + 1] > largest ? bucket_starts[b + 1] : largest;
+    bucket_starts[b + 1] += bucket_starts[b];
+  }
+
+  /* Counting sort of the items by bucket, then of the buckets by size. */
+  perfect_hashtable_item *sorted = (perfect_hashtable_item *)malloc(
+      sizeof(perfect_hashtable_item) * (table->size + 1));
+  uint32_t *cursor = (uint32_t *)malloc(sizeof(uint32_t) * table->bucket_count);
+  memcpy(cursor, bucket_starts, sizeof(uint32_t) * table->bucket_count);
+  for (uint32_t i = 0; i < table->size; ++i) {
+    sorted[cursor[items[i].bucket]++] = items[i];
+  }
+
+  uint32_t *size_starts = (uint32_t *)calloc(largest + 2, sizeof(uint32_t));
+  for (uint32_t b = 0; b < table->bucket_count; ++b) {
+    size_starts[largest - (bucket_starts[b + 1] - bucket_starts[b]) + 1] += 1;
+  }
+  for (uint32_t s = 0; s <= largest; ++s) {
+    size_starts[s + 1] += size_starts[s];
+  }
+  uint32_t *bucket_order = cursor;
+  for (uint32_t b = 0; b < table->bucket_count; ++b) {
+    uint32_t size = bucket_starts[b + 1] - bucket_starts[b];
+    bucket_order[size_starts[largest - size]++] = b;
+  }
+
+  uint32_t *positions = (uint32_t *)malloc(sizeof(uint32_t) * (largest + 1));
+  bool found_all = true;
+
+  for (uint32_t o = 0; o < table->bucket_count && found_all; ++o) {
+    uint32_t bucket = bucket_order[o];
+    perfect_hashtable_item const *first = sorted + bucket_starts[bucket];
+    uint32_t count = bucket_starts[bucket + 1] - bucket_starts[bucket];
+    if (count == 0) {
+      break;
+    }
+
+    uint32_t pilot = 0;
+    for (; pilot < PERFECT_HASHTABLE_MAX_PILOT; ++pilot) {
+      uint32_t placed = 0;
+      for (; placed < count; ++placed) {
+        uint32_t position =
+            perfect_hashtable_raw_position(table, first[placed].hash, pilot);
+        if (perfect_hashtable_is_taken(taken, position)) {
+          break;
+        }
+
+        uint32_t other = 0;
+        while (other < placed && positions[other] != position) {
+          ++other;
+        }
+        if (other != placed) {
+          break;
+        }
+        positions[placed] = position;
+      }
+
+      if (placed == count) {
+        break;
+      }
+    }
+
+    if (pilot == PERFECT_HASHTABLE_MAX_PILOT) {
+      found_all = false;
+      break;
+    }
+
+    table->pilots[bucket] = pilot;
+    for (uint32_t k = 0; k < count; ++k) {
+      taken[positions[k] / 64] |= (uint64_t)1 << (positions[k] % 64);
+    }
+  }
+
+  free(positions);
+  free(size_starts);
+  free(cursor);
+  free(sorted);
+  free(bucket_starts);
+
+  return found_all;
+}
+
+/*
+ * Positions past size are pointed at the free positions below it, so every
+ * key ends up in [0, size).
+ */
+static void perfect_hashtable_fill_remap(perfect_hashtable *table,
+                                         uint64_t const *taken) {
+  uint32_t extra = table->table_size - table->size;
+  table->remap = (uint32_t *)calloc(extra + 1, sizeof(uint32_t));
+
+  uint32_t free_position = 0;
+  for (uint32_t i = 0; i < extra; ++i) {
+    if (!perfect_hashtable_is_taken(taken, table->size + i)) {
+      continue;
+    }
+
+    while (perfect_hashtable_is_taken(taken, free_position)) {
+      ++free_position;
+    }
+    table->remap[i] = free_position++;
+  }
+}
+
+/*
+ * One attempt at building the table with table->seed. Fails if two different
+ * keys have the same 64 bit hash or the pilot search gives up.
+ */
+static bool perfect_hashtable_build(perfect_hashtable *table,
+                                    char const *const *keys,
+                                    void const *const *values,
+                                    uint32_t count) {
+  perfect_hashtable_item *items = (perfect_hashtable_item *)malloc(
+      sizeof(perfect_hashtable_item) * (count + 1));
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t length = (uint32_t)strlen(keys[i]);
+    items[i] = (perfect_hashtable_item){
+        perfect_hashtable_hash(table, keys[i], length), i, 0};
+  }
+
+  /* Sorting by hash puts repeated keys next to each other, first one first. */
+  qsort(items, count, sizeof(perfect_hashtable_item),
+        perfect_hashtable_compare_items);
+
+  uint32_t unique = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (unique > 0 && items[unique - 1].hash == items[i].hash) {
+      if (strcmp(keys[items[unique - 1].index], keys[items[i].index]) == 0) {
+        continue;
+      }
+      free(items);
+      return false;
+    }
+    items[unique++] = items[i];
+  }
+
+  table->size = unique;
+  if (unique == 0) {
+    free(items);
+    return true;
+  }
+
+  table->table_size =
+      (uint32_t)ceil((double)unique / PERFECT_HASHTABLE_LOAD_FACTOR);
+  float log_size = log2f((float)unique + 1.f);
+  table->bucket_count =
+      (uint32_t)ceil(PERFECT_HASHTABLE_BUCKET_DENSITY * unique / log_size) + 2;
+
+  for (uint32_t i = 0; i < unique; ++i) {
+    items[i].bucket = perfect_hashtable_bucket(table, items[i].hash);
+  }
+
+  uint64_t *taken =
+      (uint64_t *)calloc(table->table_size / 64 + 1, sizeof(uint64_t));
+  table->pilots = (uint32_t *)calloc(table->bucket_count, sizeof(uint32_t));
+
+  if (!perfect_hashtable_search_pilots(table, items, taken)) {
+    free(taken);
+    free(items);
+    free(table->pilots);
+    table->pilots = NULL;
+    return false;
+  }
+
+  perfect_hashtable_fill_remap(table, taken);
+  free(taken);
+
+  /* Lay the entries out in position order. */
+  uint32_t *order = (uint32_t *)malloc(sizeof(uint32_t) * (unique + 1));
+  for (uint32_t i = 0; i < unique; ++i) {
+    order[perfect_hashtable_position(table, items[i].hash)] = items[i].index;
+  }
+  free(items);
+
+  uint32_t value_size = perfect_hashtable_align(table->object_size);
+  table->entry_offsets = (uint32_t *)malloc(sizeof(uint32_t) * (unique + 1));
+  table->entry_offsets[0] = 0;
+  for (uint32_t i = 0; i < unique; ++i) {
+    uint32_t key_size = (uint32_t)strlen(keys[order[i]]) + 1;
+    table->entry_offsets[i + 1] = table->entry_offsets[i] + value_size +
+                                  perfect_hashtable_align(key_size);
+  }
+
+  table->entries = (char *)calloc(table->entry_offsets[unique] + 1, 1);
+  for (uint32_t i = 0; i < unique; ++i) {
+    char *entry = table->entries + table->entry_offsets[i];
+    memcpy(entry, values[order[i]], table->object_size);
+    memcpy(entry + value_size, keys[order[i]], strlen(keys[order[i]]) + 1);
+  }
+  free(order);
+
+  return true;
+}
+
+static perfect_hashtable perfect_hashtable_build_any_seed(
+    char const *const *keys, void const *const *values, uint32_t count,
+    uint32_t object_size) {
+  perfect_hashtable table;
+  memset(&table, 0, sizeof(table));
+  table.object_size = object_size;
+
+  /* Fixed seeds, so the same keys always build the same table. */
+  for (uint32_t attempt = 0; attempt < PERFECT_HASHTABLE_MAX_ATTEMPTS;
+       ++attempt) {
+    table.seed = perfect_hashtable_mix(attempt + 1);
+    if (perfect_hashtable_build(&table, keys, values, count)) {
+      return table;
+    }
+  }
+
+  memset(&table, 0, sizeof(table));
+  table.object_size = object_size;
+  return table;
+}
+
+perfect_hashtable perfect_hashtable_new(char const *const *keys,
+                                        void const *values, uint32_t count,
+                                        uint32_t object_size) {
+  void const **value_pointers =
+      (void const **)calloc(count + 1, sizeof(void *));
+  for (uint32_t i = 0; i < count; ++i) {
+    value_pointers[i] = (char const *)values + (size_t)object_size * i;
+  }
+
+  perfect_hashtable table =
+      perfect_hashtable_build_any_seed(keys, value_pointers, count,
+                                       object_size);
+  free(value_pointers);
+
+  return table;
+}
+
+perfect_hashtable perfect_hashtable_from_hashtable(hashtable *table) {
+  if (table->string_hash_function == NULL) {
+    return perfect_hashtable_new(NULL, NULL, 0, table->object_size);
+  }
+
+  char const **keys = (char const **)malloc(sizeof(char *) * (table->size + 1));
+  void const **values =
+      (void const **)malloc(sizeof(void *) * (table->size + 1));
+
+  uint32_t count = 0;
+  void *position = NULL;
+  while (count < table->size &&
+         (position = hashtable_iterate(table, position)) != NULL) {
+    keys[count] = (char const *)hashtable_key_at(table, position);
+    values[count] = position;
+    ++count;
+  }
+
+  perfect_hashtable result =
+      perfect_hashtable_build_any_seed(keys, values, count, table->object_size);
+  free(keys);
+  free(values);
+
+  return result;
+}
+
+void *perfect_hashtable_lookup(perfect_hashtable const *table,
+                               char const *key) {
+  if (table->size == 0) {
+    return NULL;
+  }
+
+  uint32_t length = (uint32_t)strlen(key);
+  uint32_t position = perfect_hashtable_position(
+      table, perfect_hashtable_hash(table, key, length));
+
+  /*
+   * The stored key is compared only if it's long enough, so the compare never
+   * reads past the end of the entries.
+   */
+  uint32_t value_size = perfect_hashtable_align(table->object_size);
+  char *entry = table->entries + table->entry_offsets[position];
+  uint32_t key_space =
+      table->entry_offsets[position + 1] - table->entry_offsets[position] -
+      value_size;
+  char const *stored_key = entry + value_size;
+
+  if (key_space <= length || stored_key[length] != '\0' ||
+      memcmp(stored_key, key, length) != 0) {
+    return NULL;
+  }
+
+  return entry;
+}
+
+bool perfect_hashtable_exists(perfect_hashtable const *table,
+                              char const *key) {
+  return perfect_hashtable_lookup(table, key) != NULL;
+}
+
+void perfect_hashtable_free(perfect_hashtable *table) {
+  free(table->pilots);
+  free(table->remap);
+  free(table->entry_offsets);
+  free(table->entries);
+
+  uint32_t object_size = table->object_size;
+  memset(table, 0, sizeof(*table));
+  table->object_size = object_size;
+}
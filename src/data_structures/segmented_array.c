@@ -0,0 +1,135 @@
+#include "data_structures/segmented_array.h"
+
+static size_t segmented_array_chunk_bytes(segmented_array const *array) {
+  return (size_t)array->object_size << array->chunk_shift;
+}
+
+static uint32_t segmented_array_chunk_mask(segmented_array const *array) {
+  return ((uint32_t)1 << array->chunk_shift) - 1;
+}
+
+static char *segmented_array_chunk(segmented_array const *array,
+                                   uint32_t chunk) {
+  return ((char **)array->chunks.data)[chunk];
+}
+
+segmented_array segmented_array_new(uint32_t object_size,
+                                    uint32_t chunk_length) {
+  return segmented_array_new_with_allocator(object_size, chunk_length, NULL);
+}
+
+segmented_array
+segmented_array_new_with_allocator(uint32_t object_size, uint32_t chunk_length,
+                                   fennec_allocator const *allocator) {
+  uint32_t shift = 0;
+  if (chunk_length == 0) {
+    while (shift < 31 && (size_t)object_size << (shift + 1) <=
+                             SEGMENTED_ARRAY_DEFAULT_CHUNK_BYTES) {
+      shift += 1;
+    }
+  } else {
+    while (shift < 31 && ((uint32_t)1 << shift) < chunk_length) {
+      shift += 1;
+    }
+  }
+
+  return (segmented_array){
+      0, object_size, shift,
+      dynamic_array_new_with_allocator(sizeof(char *), allocator), allocator};
+}
+
+void segmented_array_reserve(segmented_array *array, uint32_t reserve_count) {
+  uint32_t needed = (uint32_t)(((uint64_t)reserve_count +
+                                segmented_array_chunk_mask(array)) >>
+                               array->chunk_shift);
+
+  dynamic_array_reserve(&array->chunks, needed);
+  while (array->chunks.size < needed) {
+    char *chunk = (char *)fennec_allocate(array->allocator,
+                                          segmented_array_chunk_bytes(array));
+    dynamic_array_push_back(&array->chunks, &chunk);
+  }
+}
+
+void *segmented_array_push_back(segmented_array *array, void const *data) {
+  uint32_t index = array->size;
+  if ((index >> array->chunk_shift) >= array->chunks.size) {
+    segmented_array_reserve(array, index + 1);
+  }
+
+  char *element = segmented_array_get_at(array, index);
+  memcpy(element, data, array->object_size);
+  array->size += 1;
+  return element;
+}
+
+void segmented_array_push_back_n(segmented_array *array, void const *data,
+                                 uint32_t count) {
+  segmented_array_reserve(array, array->size + count);
+
+  char const *source = (char const *)data;
+  while (count > 0) {
+    uint32_t offset = array->size & segmented_array_chunk_mask(array);
+    uint32_t room = ((uint32_t)1 << array->chunk_shift) - offset;
+    uint32_t n = count < room ? count : room;
+
+    memcpy(segmented_array_get_at(array, array->size), source,
+           (size_t)n * array->object_size);
+    source += (size_t)n * array->object_size;
+    array->size += n;
+    count -= n;
+  }
+}
+
+void segmented_array_pop_back(segmented_array *array) {
+  if (array->size > 0) {
+    array->size -= 1;
+  }
+}
+
+void *segmented_array_get_at(segmented_array const *array, uint32_t index) {
+  return segmented_array_chunk(array, index >> array->chunk_shift) +
+         (size_t)(index & segmented_array_chunk_mask(array)) *
+             array->object_size;
+}
+
+void *segmented_array_get_back(segmented_array const *array) {
+  if (array->size == 0) {
+    return NULL;
+  }
+  return segmented_array_get_at(array, array->size - 1);
+}
+
+uint32_t segmented_array_chunk_count(segmented_array const *array) {
+  return (uint32_t)(((uint64_t)array->size +
+                     segmented_array_chunk_mask(array)) >>
+                    array->chunk_shift);
+}
+
+void *segmented_array_get_chunk(segmented_array const *array, uint32_t chunk,
+                                uint32_t *count) {
+  uint32_t first = chunk << array->chunk_shift;
+  uint32_t remaining = array->size - first;
+  uint32_t length = (uint32_t)1 << array->chunk_shift;
+  *count = remaining < length ? remaining : length;
+  return segmented_array_chunk(array, chunk);
+}
+
+void segmented_array_clear(segmented_array *array) { array->size = 0; }
+
+void segmented_array_shrink(segmented_array *array) {
+  uint32_t used = segmented_array_chunk_count(array);
+  while (array->chunks.size > used) {
+    fennec_deallocate(array->allocator,
+                      segmented_array_chunk(array, array->chunks.size - 1),
+                      segmented_array_chunk_bytes(array));
+    dynamic_array_pop_back(&array->chunks);
+  }
+  dynamic_array_shrink(&array->chunks);
+}
+
+void segmented_array_free(segmented_array *array) {
+  segmented_array_clear(array);
+  segmented_array_shrink(array);
+  dynamic_array_free(&array->chunks);
+}
@@ -0,0 +1,45 @@
+#include "utilities/allocator.h"
+
+void *fennec_allocate(fennec_allocator const *allocator, size_t size) {
+  if (allocator == NULL) {
+    return malloc(size);
+  }
+
+  return allocator->allocate(allocator->context, size);
+}
+
+void *fennec_allocate_zeroed(fennec_allocator const *allocator, size_t count,
+                             size_t size) {
+  if (allocator == NULL) {
+    return calloc(count, size);
+  }
+
+  void *result = allocator->allocate(allocator->context, count * size);
+  if (result != NULL) {
+    memset(result, 0, count * size);
+  }
+  return result;
+}
+
+void *fennec_reallocate(fennec_allocator const *allocator, void *pointer,
+                        size_t old_size, size_t new_size) {
+  if (allocator == NULL) {
+    return realloc(pointer, new_size);
+  }
+
+  return allocator->reallocate(allocator->context, pointer, old_size,
+                               new_size);
+}
+
+void fennec_deallocate(fennec_allocator const *allocator, void *pointer,
+                       size_t size) {
+  if (pointer == NULL) {
+    return;
+  }
+
+  if (allocator == NULL) {
+    free(pointer);
+  } else {
+    allocator->deallocate(allocator->context, pointer, size);
+  }
+}
@@ -0,0 +1,166 @@
+#include "utilities/arena.h"
+#include <stddef.h>
+
+struct arena_chunk {
+  struct arena_chunk *previous;
+  size_t used;
+  size_t capacity;
+  max_align_t data[];
+};
+
+static size_t arena_round_size(size_t size) {
+  size = size == 0 ? 1 : size;
+  return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static char *arena_chunk_data(arena_chunk *chunk) {
+  return (char *)chunk->data;
+}
+
+/*
+ * Makes a chunk with room for size bytes the current one, reusing the first
+ * spare that is big enough.
+ */
+static arena_chunk *arena_push_chunk(arena *a, size_t size) {
+  arena_chunk **link = &a->spare;
+  while (*link != NULL && (*link)->capacity < size) {
+    link = &(*link)->previous;
+  }
+
+  arena_chunk *chunk = *link;
+  if (chunk != NULL) {
+    *link = chunk->previous;
+  } else {
+    size_t capacity = size > a->chunk_size ? size : a->chunk_size;
+    chunk = (arena_chunk *)malloc(sizeof(arena_chunk) + capacity);
+    chunk->capacity = capacity;
+    a->chunk_allocations += 1;
+  }
+
+  chunk->used = 0;
+  chunk->previous = a->current;
+  a->current = chunk;
+  return chunk;
+}
+
+arena arena_new(uint32_t chunk_size) {
+  return (arena){NULL, NULL,
+                 chunk_size == 0 ? ARENA_DEFAULT_CHUNK_SIZE : chunk_size, 0,
+                 0};
+}
+
+void *arena_allocate(arena *a, size_t size) {
+  size = arena_round_size(size);
+
+  arena_chunk *chunk = a->current;
+  if (chunk == NULL || chunk->capacity - chunk->used < size) {
+    chunk = arena_push_chunk(a, size);
+  }
+
+  char *result = arena_chunk_data(chunk) + chunk->used;
+  chunk->used += size;
+  a->allocations += 1;
+  return result;
+}
+
+arena_mark arena_get_mark(arena const *a) {
+  return (arena_mark){a->current, a->current ? a->current->used : 0};
+}
+
+void arena_rewind(arena *a, arena_mark mark) {
+  while (a->current != mark.chunk) {
+    arena_chunk *chunk = a->current;
+    a->current = chunk->previous;
+    chunk->previous = a->spare;
+    a->spare = chunk;
+  }
+
+  if (a->current != NULL) {
+    a->current->used = mark.used;
+  }
+}
+
+void arena_reset(arena *a) { arena_rewind(a, (arena_mark){NULL, 0}); }
+
+void arena_stats(arena const *a, arena_statistics *stats) {
+  memset(stats, 0, sizeof(arena_statistics));
+
+  for (arena_chunk *chunk = a->current; chunk != NULL;
+       chunk = chunk->previous) {
+    stats->used_bytes += chunk == a->current ? chunk->used : chunk->capacity;
+    stats->reserved_bytes += chunk->capacity;
+    stats->chunk_count += 1;
+  }
+  for (arena_chunk *chunk = a->spare; chunk != NULL; chunk = chunk->previous) {
+    stats->reserved_bytes += chunk->capacity;
+    stats->spare_chunk_count += 1;
+  }
+
+  stats->allocations = a->allocations;
+  stats->chunk_allocations = a->chunk_allocations;
+}
+
+/*
+ * True when the size bytes at pointer are the last ones handed out, so they
+ * can be given back or grown by moving the end of the current chunk.
+ */
+static bool arena_is_last(arena const *a, void const *pointer, size_t size) {
+  arena_chunk *chunk = a->current;
+  return chunk != NULL &&
+         (char const *)pointer + arena_round_size(size) ==
+             arena_chunk_data(chunk) + chunk->used;
+}
+
+static void *arena_allocator_allocate(void *context, size_t size) {
+  return arena_allocate((arena *)context, size);
+}
+
+static void *arena_allocator_reallocate(void *context, void *pointer,
+                                        size_t old_size, size_t new_size) {
+  arena *a = (arena *)context;
+  if (pointer == NULL) {
+    return arena_allocate(a, new_size);
+  }
+
+  if (arena_is_last(a, pointer, old_size)) {
+    size_t offset = (size_t)((char *)pointer - arena_chunk_data(a->current));
+    if (a->current->capacity - offset >= arena_round_size(new_size)) {
+      a->current->used = offset + arena_round_size(new_size);
+      return pointer;
+    }
+  } else if (new_size <= old_size) {
+    return pointer;
+  }
+
+  void *result = arena_allocate(a, new_size);
+  memcpy(result, pointer, old_size < new_size ? old_size : new_size);
+  return result;
+}
+
+static void arena_allocator_deallocate(void *context, void *pointer,
+                                       size_t size) {
+  arena *a = (arena *)context;
+  if (arena_is_last(a, pointer, size)) {
+    a->current->used -= arena_round_size(size);
+  }
+}
+
+fennec_allocator arena_allocator(arena *a) {
+  return (fennec_allocator){arena_allocator_allocate,
+                            arena_allocator_reallocate,
+                            arena_allocator_deallocate, a};
+}
+
+static void arena_free_chunks(arena_chunk *chunk) {
+  while (chunk != NULL) {
+    arena_chunk *previous = chunk->previous;
+    free(chunk);
+    chunk = previous;
+  }
+}
+
+void arena_free(arena *a) {
+  arena_free_chunks(a->current);
+  arena_free_chunks(a->spare);
+  *a = arena_new(a->chunk_size);
+}
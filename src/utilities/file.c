@@ -1,16 +1,27 @@
 #include "utilities/file.h"
+#include <fcntl.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 file_data file_load_all(string const *path) {
+  return file_load_all_with_allocator(path, NULL);
+}
+
+file_data file_load_all_with_allocator(string const *path,
+                                       fennec_allocator const *allocator) {
   FILE *ifp = fopen(path->data, "rb");
   if (!ifp) {
-    return (file_data){NULL, 0};
+    return (file_data){NULL, 0, false, NULL};
   }
 
   file_data result;
+  result.mapped = false;
+  result.allocator = allocator;
   fseek(ifp, 0, SEEK_END);
   result.size = ftell(ifp);
-  result.data = malloc(result.size);
+  result.data = fennec_allocate(allocator, result.size);
 
   fseek(ifp, 0, SEEK_SET);
   fread(result.data, 1, result.size, ifp);
@@ -20,7 +31,62 @@ file_data file_load_all(string const *path) {
   return result;
 }
 
+file_data file_map(string const *path) {
+  file_data result = {NULL, 0, false, NULL};
+
+  int fd = open(path->data, O_RDONLY);
+  if (fd < 0) {
+    return result;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0 &&
+      (uint64_t)info.st_size <= UINT32_MAX) {
+    void *data =
+        mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data != MAP_FAILED) {
+      result = (file_data){data, (uint32_t)info.st_size, true, NULL};
+    }
+  }
+
+  close(fd);
+
+  return result;
+}
+
+bool file_write_all(string const *path, void const *data, uint32_t size) {
+  string temporary_path = string_new(path->data);
+  string suffix = string_wrap_cstring(".tmp");
+  string_append(&temporary_path, &suffix);
+
+  FILE *ofp = fopen(temporary_path.data, "wb");
+  bool written = ofp != NULL;
+  if (written) {
+    written = fwrite(data, 1, size, ofp) == size;
+    written = fclose(ofp) == 0 && written;
+  }
+
+  if (written) {
+    written = rename(temporary_path.data, path->data) == 0;
+  }
+  if (!written) {
+    remove(temporary_path.data);
+  }
+
+  string_free(&temporary_path);
+
+  return written;
+}
+
 void file_data_free(file_data *data) {
-  free(data->data);
+  if (data->mapped) {
+    munmap(data->data, data->size);
+  } else {
+    fennec_deallocate(data->allocator, data->data, data->size);
+  }
+
+  data->data = NULL;
   data->size = 0;
+  data->mapped = false;
+  data->allocator = NULL;
 }
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "utilities/hash.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define HASH_CRC32C_X86
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define HASH_CRC32C_ARM
+#endif
+
+#define HASH_CRC32C_POLYNOMIAL 0x82F63B78u
+
+static uint64_t const hash_wyhash_secret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull,
+    0x4d5a2da51de1aa47ull};
+
+/*
+ * Full 64x64 -> 128 bit multiply, low half into a and high half into b.
+ */
+static inline void hash_multiply(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t result = (__uint128_t)*a * *b;
+  *a = (uint64_t)result;
+  *b = (uint64_t)(result >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32;
+  uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32);
+  uint64_t carry = t < rl;
+  uint64_t low = t + (rm1 << 32);
+  carry += low < t;
+  *a = low;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+static inline uint64_t hash_mix(uint64_t a, uint64_t b) {
+  hash_multiply(&a, &b);
+  return a ^ b;
+}
+
+static inline uint64_t hash_read8(uint8_t const *p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint64_t hash_read4(uint8_t const *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint64_t hash_wyhash(void const *data, uint32_t length, uint64_t seed) {
+  uint8_t const *p = (uint8_t const *)data;
+  uint64_t const *secret = hash_wyhash_secret;
+  uint64_t a, b;
+
+  seed ^= hash_mix(seed ^ secret[0], secret[1]);
+
+  if (length <= 16) {
+    if (length >= 4) {
+      uint32_t offset = (length >> 3) << 2;
+      a = (hash_read4(p) << 32) | hash_read4(p + offset);
+      b = (hash_read4(p + length - 4) << 32) |
+          hash_read4(p + length - 4 - offset);
+    } else if (length > 0) {
+      a = ((uint64_t)p[0] << 16) | ((uint64_t)p[length >> 1] << 8) |
+          p[length - 1];
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    uint32_t i = length;
+    if (i >= 48) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = hash_mix(hash_read8(p) ^ secret[1], hash_read8(p + 8) ^ seed);
+        see1 = hash_mix(hash_read8(p + 16) ^ secret[2],
+                        hash_read8(p + 24) ^ see1);
+        see2 = hash_mix(hash_read8(p + 32) ^ secret[3],
+                        hash_read8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i >= 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = hash_mix(hash_read8(p) ^ secret[1], hash_read8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = hash_read8(p + i - 16);
+    b = hash_read8(p + i - 8);
+  }
+
+  a ^= secret[1];
+  b ^= seed;
+  hash_multiply(&a, &b);
+  return hash_mix(a ^ secret[0] ^ length, b ^ secret[1]);
+}
+
+/*
+ * Slicing-by-8 tables for the software CRC32C, built on first use.
+ */
+static uint32_t hash_crc32c_table[8][256];
+static pthread_once_t hash_crc32c_table_once = PTHREAD_ONCE_INIT;
+
+static void hash_crc32c_build_table(void) {
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (HASH_CRC32C_POLYNOMIAL & (0u - (crc & 1)));
+    }
+    hash_crc32c_table[0][i] = crc;
+  }
+
+  for (uint32_t i = 0; i < 256; ++i) {
+    for (int slice = 1; slice < 8; ++slice) {
+      uint32_t previous = hash_crc32c_table[slice - 1][i];
+      hash_crc32c_table[slice][i] =
+          (previous >> 8) ^ hash_crc32c_table[0][previous & 0xFF];
+    }
+  }
+}
+
+static uint32_t hash_crc32c_software(uint32_t crc, uint8_t const *p,
+                                     uint32_t length) {
+  pthread_once(&hash_crc32c_table_once, hash_crc32c_build_table);
+
+  for (; length >= 8; length -= 8, p += 8) {
+    uint64_t word = hash_read8(p) ^ crc;
+    crc = hash_crc32c_table[7][word & 0xFF] ^
+          hash_crc32c_table[6][(word >> 8) & 0xFF] ^
+          hash_crc32c_table[5][(word >> 16) & 0xFF] ^
+          hash_crc32c_table[4][(word >> 24) & 0xFF] ^
+          hash_crc32c_table[3][(word >> 32) & 0xFF] ^
+          hash_crc32c_table[2][(word >> 40) & 0xFF] ^
+          hash_crc32c_table[1][(word >> 48) & 0xFF] ^
+          hash_crc32c_table[0][word >> 56];
+  }
+
+  for (; length > 0; --length, ++p) {
+    crc = (crc >> 8) ^ hash_crc32c_table[0][(crc ^ *p) & 0xFF];
+  }
+
+  return crc;
+}
+
+#if defined(HASH_CRC32C_X86)
+__attribute__((target("sse4.2"))) static uint32_t
+hash_crc32c_hardware(uint32_t crc, uint8_t const *p, uint32_t length) {
+  uint64_t crc64 = crc;
+  for (; length >= 8; length -= 8, p += 8) {
+    crc64 = _mm_crc32_u64(crc64, hash_read8(p));
+  }
+
+  crc = (uint32_t)crc64;
+  for (; length > 0; --length, ++p) {
+    crc = _mm_crc32_u8(crc, *p);
+  }
+
+  return crc;
+}
+#elif defined(HASH_CRC32C_ARM)
+static uint32_t hash_crc32c_hardware(uint32_t crc, uint8_t const *p,
+                                     uint32_t length) {
+  for (; length >= 8; length -= 8, p += 8) {
+    crc = __crc32cd(crc, hash_read8(p));
+  }
+
+  for (; length > 0; --length, ++p) {
+    crc = __crc32cb(crc, *p);
+  }
+
+  return crc;
+}
+#endif
+
+uint64_t hash_crc32c(void const *data, uint32_t length, uint64_t seed) {
+  uint32_t crc = ~(uint32_t)(seed ^ (seed >> 32));
+  uint8_t const *p = (uint8_t const *)data;
+
+#if defined(HASH_CRC32C_X86)
+  if (__builtin_cpu_supports("sse4.2")) {
+    return ~hash_crc32c_hardware(crc, p, length);
+  }
+#elif defined(HASH_CRC32C_ARM)
+  return ~hash_crc32c_hardware(crc, p, length);
+#endif
+
+  return ~hash_crc32c_software(crc, p, length);
+}
+
+uint64_t hash_random_seed(void) {
+  static atomic_uint_fast64_t counter;
+  uint64_t count = atomic_fetch_add(&counter, 1);
+
+  /*
+   * The stack address changes from run to run with ASLR, the clocks and the
+   * counter change from call to call.
+   */
+  uint64_t entropy[4] = {(uint64_t)time(NULL), (uint64_t)clock(),
+                         (uint64_t)(uintptr_t)&count, count};
+  return hash_wyhash(entropy, sizeof(entropy), (uint64_t)(uintptr_t)&counter);
+}
@@ -29,18 +29,19 @@ string path_join(string const *first, string const *second) {
   bool starts_with_slash = string_find_first_any(second, &slashes, 0) == 0;
 
   if (ends_with_slash && starts_with_slash) {
-    string substr = string_new_substring(first->data, 0, second->length - 1);
+    string substr = string_new_substring_with_allocator(
+        first->data, 0, second->length - 1, first->allocator);
     string_append(&substr, second);
     return substr;
   } else if (ends_with_slash || starts_with_slash) {
-    string f = string_new(first->data);
+    string f = string_new_with_allocator(first->data, first->allocator);
     string_append(&f, second);
     return f;
   }
 
   char const slash[] = {path_get_system_slash(), 0};
   string slash_s = string_wrap_cstring(slash);
-  string result = string_new(first->data);
+  string result = string_new_with_allocator(first->data, first->allocator);
   string_append(&result, &slash_s);
   string_append(&result, second);
   return result;
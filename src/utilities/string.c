@@ -1,10 +1,17 @@
 #include "utilities/string.h"
 
 string string_new(char const *data) {
+  return string_new_with_allocator(data, NULL);
+}
+
+string string_new_with_allocator(char const *data,
+                                 fennec_allocator const *allocator) {
   string result;
   result.length = strlen(data);
   result.capacity = result.length + 1;
-  result.data = strdup(data);
+  result.data = (char *)fennec_allocate(allocator, result.capacity);
+  memcpy(result.data, data, result.capacity);
+  result.allocator = allocator;
   return result;
 }
 
@@ -13,21 +20,28 @@ string_range string_range_new(string *s, uint32_t start, uint32_t end) {
 }
 
 string string_new_substring(char const *data, uint32_t start, uint32_t end) {
+  return string_new_substring_with_allocator(data, start, end, NULL);
+}
+
+string string_new_substring_with_allocator(char const *data, uint32_t start,
+                                           uint32_t end,
+                                           fennec_allocator const *allocator) {
   string result;
   result.length = end - start;
   result.capacity = result.length + 1;
-  result.data = (char *)malloc(result.capacity);
+  result.data = (char *)fennec_allocate(allocator, result.capacity);
   memcpy(result.data, data + start, result.length);
   result.data[result.length] = 0;
+  result.allocator = allocator;
   return result;
 }
 
 string string_wrap_cstring(char const *cstring) {
-  return (string){(char *)cstring, strlen(cstring), 0};
+  return (string){(char *)cstring, strlen(cstring), 0, NULL};
 }
 
 void string_free(string *s) {
-  free(s->data);
+  fennec_deallocate(s->allocator, s->data, s->capacity);
   s->data = NULL;
   s->capacity = 0;
   s->length = 0;
@@ -37,11 +51,16 @@ void string_append(string *destination, string const *source) {
   uint32_t destination_min_capacity = source->length + destination->length + 1;
 
   if (destination->capacity < destination_min_capacity) {
-    destination->capacity = destination_min_capacity;
-    char *temp = (char *)malloc(destination_min_capacity);
+    char *temp = (char *)fennec_allocate(destination->allocator,
+                                         destination_min_capacity);
     memcpy(temp, destination->data, destination->length);
     temp[destination->length] = 0;
-    free(destination->data);
+    /* A wrapped C string isn't ours to free. */
+    if (destination->capacity != 0) {
+      fennec_deallocate(destination->allocator, destination->data,
+                        destination->capacity);
+    }
+    destination->capacity = destination_min_capacity;
     destination->data = temp;
   }
 
@@ -159,6 +178,12 @@ int32_t string_find_last_any(string const *s, string const *character_set,
 
 string string_join(string const *strings, string const *separator,
                    uint32_t count) {
+  return string_join_with_allocator(strings, separator, count, NULL);
+}
+
+string string_join_with_allocator(string const *strings,
+                                  string const *separator, uint32_t count,
+                                  fennec_allocator const *allocator) {
   string result;
   result.capacity = 0;
   result.length = separator->length * (count - 1);
@@ -168,7 +193,7 @@ string string_join(string const *strings, string const *separator,
   }
 
   result.capacity = result.length + 1;
-  result.data = (char *)malloc(result.capacity);
+  result.data = (char *)fennec_allocate(allocator, result.capacity);
   uint32_t result_write_index = 0;
 
   for (uint32_t i = 0; i < count; ++i) {
@@ -184,6 +209,7 @@ string string_join(string const *strings, string const *separator,
   }
 
   result.data[result.length] = 0;
+  result.allocator = allocator;
   return result;
 }
 
@@ -201,14 +227,14 @@ string string_replace(string const *s, string const *search,
   } while (search_index != string_invalid_index);
 
   if (found_substrings == 0) {
-    return string_new(s->data);
+    return string_new_with_allocator(s->data, s->allocator);
   }
 
   string result;
   result.length = s->length - (search->length * found_substrings) +
                   (replace_with->length * found_substrings);
   result.capacity = result.length + 1;
-  result.data = (char *)malloc(result.capacity);
+  result.data = (char *)fennec_allocate(s->allocator, result.capacity);
 
   int32_t replace_point = string_find_first(s, search, 0);
   int32_t s_i = 0;
@@ -228,11 +254,13 @@ string string_replace(string const *s, string const *search,
   }
 
   result.data[result.length] = 0;
+  result.allocator = s->allocator;
   return result;
 }
 
 dynamic_array string_split(string const *s, string const *seperator) {
-  dynamic_array result = dynamic_array_new(sizeof(string));
+  dynamic_array result =
+      dynamic_array_new_with_allocator(sizeof(string), s->allocator);
   int32_t search_start = 0;
   int32_t seperator_index;
 
@@ -240,8 +268,8 @@ dynamic_array string_split(string const *s, string const *seperator) {
     seperator_index = string_find_first(s, seperator, search_start);
     if (seperator_index != string_invalid_index &&
         (seperator_index - search_start) != 0) {
-      string new_segment =
-          string_new_substring(s->data, search_start, seperator_index);
+      string new_segment = string_new_substring_with_allocator(
+          s->data, search_start, seperator_index, s->allocator);
       dynamic_array_push_back(&result, &new_segment);
       search_start = seperator_index + seperator->length;
     }
@@ -251,7 +279,8 @@ dynamic_array string_split(string const *s, string const *seperator) {
 }
 
 dynamic_array string_split_any(string const *s, string const *character_set) {
-  dynamic_array result = dynamic_array_new(sizeof(string));
+  dynamic_array result =
+      dynamic_array_new_with_allocator(sizeof(string), s->allocator);
   int32_t search_start = 0;
   int32_t seperator_index;
 
@@ -259,8 +288,8 @@ dynamic_array string_split_any(string const *s, string const *character_set) {
     seperator_index = string_find_first_any(s, character_set, search_start);
     if (seperator_index != string_invalid_index &&
         (seperator_index - search_start) != 0) {
-      string new_segment =
-          string_new_substring(s->data, search_start, seperator_index);
+      string new_segment = string_new_substring_with_allocator(
+          s->data, search_start, seperator_index, s->allocator);
       dynamic_array_push_back(&result, &new_segment);
       search_start = seperator_index + 1;
     }
@@ -271,7 +300,8 @@ dynamic_array string_split_any(string const *s, string const *character_set) {
 
 dynamic_array string_split_after(string const *s, string const *seperator) {
 
-  dynamic_array result = dynamic_array_new(sizeof(string));
+  dynamic_array result =
+      dynamic_array_new_with_allocator(sizeof(string), s->allocator);
   int32_t search_start = 0;
   int32_t seperator_index;
 
@@ -279,8 +309,9 @@ dynamic_array string_split_after(string const *s, string const *seperator) {
     seperator_index = string_find_first(s, seperator, search_start);
     if (seperator_index != string_invalid_index &&
         (seperator_index - search_start) != 0) {
-      string new_segment = string_new_substring(
-          s->data, search_start, seperator_index + seperator->length);
+      string new_segment = string_new_substring_with_allocator(
+          s->data, search_start, seperator_index + seperator->length,
+          s->allocator);
       dynamic_array_push_back(&result, &new_segment);
       search_start = seperator_index + seperator->length;
     }
@@ -290,7 +321,7 @@ dynamic_array string_split_after(string const *s, string const *seperator) {
 }
 
 string_range string_trim(string const *s, string const *cutset) {
-  uint32_t new_start = 0;
+  uint32_t new_start = s->length;
   uint32_t new_end = s->length;
 
   for (uint32_t i = 0; i < s->length; ++i) {
@@ -320,7 +351,7 @@ string_range string_trim(string const *s, string const *cutset) {
     }
 
     if (trim_this_index == false) {
-      new_end = i;
+      new_end = i + 1;
       break;
     }
   }
@@ -329,7 +360,7 @@ string_range string_trim(string const *s, string const *cutset) {
 }
 
 string_range string_trim_left(string const *s, string const *cutset) {
-  uint32_t new_start = 0;
+  uint32_t new_start = s->length;
   uint32_t new_end = s->length;
 
   for (uint32_t i = 0; i < s->length; ++i) {
@@ -353,7 +384,7 @@ string_range string_trim_left(string const *s, string const *cutset) {
 
 string_range string_trim_right(string const *s, string const *cutset) {
   uint32_t new_start = 0;
-  uint32_t new_end = s->length;
+  uint32_t new_end = 0;
 
   for (int32_t i = s->length - 1; i >= 0; --i) {
     bool trim_this_index = false;
@@ -366,7 +397,7 @@ string_range string_trim_right(string const *s, string const *cutset) {
     }
 
     if (trim_this_index == false) {
-      new_end = i;
+      new_end = i + 1;
       break;
     }
   }
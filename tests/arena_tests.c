@@ -0,0 +1,126 @@
+#include "utilities/arena.h"
+#include "utilities/string.h"
+#include "utilities/test_helpers.h"
+#include <stdio.h>
+
+int test_allocate() {
+  arena a = arena_new(1024);
+
+  char *first = arena_allocate(&a, 10);
+  char *second = arena_allocate(&a, 1);
+  FAIL_IF((uintptr_t)first % ARENA_ALIGNMENT != 0 ||
+              (uintptr_t)second % ARENA_ALIGNMENT != 0 || second <= first,
+          "Allocations aren't aligned or overlap.\n");
+
+  char *big = arena_allocate(&a, 5000);
+  memset(big, 1, 5000);
+  char *after = arena_allocate(&a, 100);
+  memset(after, 2, 100);
+
+  arena_statistics stats;
+  arena_stats(&a, &stats);
+  FAIL_IF(stats.chunk_count != 3 || stats.allocations != 4 ||
+              stats.reserved_bytes != 1024 + 5008 + 1024,
+          "Arena has %u chunks and %llu bytes, not 3 and 7056.\n",
+          stats.chunk_count, (unsigned long long)stats.reserved_bytes);
+
+  arena_free(&a);
+  arena_stats(&a, &stats);
+  FAIL_IF(stats.reserved_bytes != 0, "Free kept chunks.\n");
+
+  return 0;
+}
+
+int test_rewind_and_reset() {
+  arena a = arena_new(256);
+  arena_allocate(&a, 64);
+
+  arena_mark mark = arena_get_mark(&a);
+  void *kept = arena_allocate(&a, 64);
+  for (unsigned i = 0; i < 100; ++i) {
+    arena_allocate(&a, 100);
+  }
+
+  arena_statistics stats;
+  arena_stats(&a, &stats);
+  uint64_t chunks = stats.chunk_allocations;
+
+  arena_rewind(&a, mark);
+  FAIL_IF(arena_allocate(&a, 64) != kept,
+          "Rewind didn't go back to the mark.\n");
+
+  arena_stats(&a, &stats);
+  FAIL_IF(stats.chunk_count != 1 || stats.used_bytes != 128 ||
+              stats.spare_chunk_count == 0,
+          "Rewind didn't keep the later chunks as spares.\n");
+
+  for (unsigned round = 0; round < 10; ++round) {
+    arena_reset(&a);
+    for (unsigned i = 0; i < 100; ++i) {
+      arena_allocate(&a, 100);
+    }
+  }
+
+  arena_stats(&a, &stats);
+  FAIL_IF(stats.chunk_allocations != chunks,
+          "Reset arena allocated %llu more chunks.\n",
+          (unsigned long long)(stats.chunk_allocations - chunks));
+
+  arena_free(&a);
+
+  return 0;
+}
+
+int test_allocator() {
+  arena a = arena_new(0);
+  fennec_allocator allocator = arena_allocator(&a);
+
+  dynamic_array numbers =
+      dynamic_array_new_with_allocator(sizeof(unsigned), &allocator);
+  dynamic_array_push_back(&numbers, &(unsigned){0});
+  char *data = numbers.data;
+  for (unsigned i = 1; i < 1000; ++i) {
+    dynamic_array_push_back(&numbers, &i);
+  }
+  FAIL_IF(numbers.data != data,
+          "The last allocation in the arena didn't grow in place.\n");
+  for (unsigned i = 0; i < 1000; ++i) {
+    FAIL_IF(*(unsigned *)dynamic_array_get_at(&numbers, i) != i,
+            "Array element %u is wrong.\n", i);
+  }
+
+  arena_statistics stats;
+  arena_stats(&a, &stats);
+  uint64_t used = stats.used_bytes;
+  dynamic_array_free(&numbers);
+  arena_stats(&a, &stats);
+  FAIL_IF(stats.used_bytes >= used,
+          "Freeing the last allocation didn't give it back.\n");
+
+  arena_mark mark = arena_get_mark(&a);
+  string line = string_new_with_allocator("GET /a/b/c/", &allocator);
+  string slash = string_wrap_cstring("/");
+  string comma = string_wrap_cstring(",");
+  dynamic_array parts = string_split(&line, &slash);
+  string joined = string_join_with_allocator((string *)parts.data, &comma,
+                                             parts.size, &allocator);
+  FAIL_IF(strcmp(joined.data, "GET ,a,b,c") != 0 ||
+              parts.allocator != &allocator ||
+              ((string *)parts.data)->allocator != &allocator,
+          "Split and join in the arena returned \"%s\".\n", joined.data);
+
+  arena_rewind(&a, mark);
+  arena_stats(&a, &stats);
+  FAIL_IF(stats.used_bytes != 0, "Rewind left bytes in use.\n");
+
+  arena_free(&a);
+
+  return 0;
+}
+
+int main(void) {
+  RETURN_IF_FAILED(test_allocate());
+  RETURN_IF_FAILED(test_rewind_and_reset());
+  RETURN_IF_FAILED(test_allocator());
+  return 0;
+}
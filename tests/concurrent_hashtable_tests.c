@@ -0,0 +1,248 @@
+#include "data_structures/concurrent_hashtable.h"
+#include "utilities/test_helpers.h"
+#include <pthread.h>
+#include <stdio.h>
+
+#define WRITER_COUNT 4
+#define READER_COUNT 4
+#define KEYS_PER_WRITER 20000
+#define CHURN_KEYS 64
+#define CHURN_ROUNDS 2000
+
+typedef struct {
+  unsigned key;
+  unsigned check;
+} checked_value;
+
+typedef struct {
+  concurrent_hashtable *table;
+  unsigned first_key;
+  unsigned torn_reads;
+  unsigned found;
+} thread_context;
+
+uint32_t unsigned_hash(void const *key) { return *(unsigned const *)key; }
+
+bool unsigned_comparison(void const *key1, void const *key2) {
+  return *(unsigned const *)key1 == *(unsigned const *)key2;
+}
+
+void *unsigned_copy(void const *key) {
+  unsigned *copy = malloc(sizeof(unsigned));
+  *copy = *(unsigned const *)key;
+  return copy;
+}
+
+int test_basic() {
+  concurrent_hashtable h = concurrent_hashtable_new_string(sizeof(int));
+
+  char const *strings[] = {"hello", "what", "butts", "buuuuuuuts",
+                           "cat",   "bat",  "rat",   "helllooooooooo"};
+  int strings_length = sizeof(strings) / sizeof(char *);
+
+  for (int i = 0; i < strings_length; ++i) {
+    concurrent_hashtable_insert(&h, strings[i], &i);
+  }
+
+  FAIL_IF(concurrent_hashtable_size(&h) != (uint32_t)strings_length,
+          "Concurrent hashtable has the wrong size.\n");
+
+  for (int i = 0; i < strings_length; ++i) {
+    int value = -1;
+    FAIL_IF(!concurrent_hashtable_lookup(&h, strings[i], &value),
+            "Concurrent hashtable failed to find string.\n");
+    FAIL_IF(value != i, "Concurrent hashtable lookup value is wrong.\n");
+  }
+
+  int replacement = 42;
+  concurrent_hashtable_insert(&h, "cat", &replacement);
+  int value = 0;
+  concurrent_hashtable_lookup(&h, "cat", &value);
+  FAIL_IF(value != replacement,
+          "Concurrent hashtable insert didn't replace the value.\n");
+  FAIL_IF(concurrent_hashtable_size(&h) != (uint32_t)strings_length,
+          "Concurrent hashtable replace changed the size.\n");
+
+  concurrent_hashtable_remove(&h, "cat");
+  FAIL_IF(concurrent_hashtable_exists(&h, "cat"),
+          "Concurrent hashtable found a removed string.\n");
+  FAIL_IF(!concurrent_hashtable_exists(&h, "bat"),
+          "Concurrent hashtable lost a string after a remove.\n");
+
+  concurrent_hashtable_free(&h);
+
+  return 0;
+}
+
+void *writer_thread(void *data) {
+  thread_context *context = (thread_context *)data;
+
+  for (unsigned i = 0; i < KEYS_PER_WRITER; ++i) {
+    unsigned key = context->first_key + i;
+    checked_value value = {key, ~key};
+    concurrent_hashtable_insert(context->table, &key, &value);
+  }
+
+  for (unsigned i = 0; i < KEYS_PER_WRITER; i += 2) {
+    unsigned key = context->first_key + i;
+    concurrent_hashtable_remove(context->table, &key);
+  }
+
+  return NULL;
+}
+
+void *reader_thread(void *data) {
+  thread_context *context = (thread_context *)data;
+  unsigned key_count = WRITER_COUNT * KEYS_PER_WRITER;
+  uint32_t state = context->first_key + 1;
+
+  for (unsigned i = 0; i < key_count * 2; ++i) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    unsigned key = state % key_count;
+    checked_value value;
+    if (concurrent_hashtable_lookup(context->table, &key, &value)) {
+      context->found += 1;
+      if (value.key != key || value.check != ~key) {
+        context->torn_reads += 1;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+int test_concurrent_stress() {
+  concurrent_hashtable h = concurrent_hashtable_new(
+      sizeof(checked_value), unsigned_hash, unsigned_comparison, unsigned_copy);
+
+  pthread_t threads[WRITER_COUNT + READER_COUNT];
+  thread_context contexts[WRITER_COUNT + READER_COUNT];
+
+  for (unsigned i = 0; i < WRITER_COUNT + READER_COUNT; ++i) {
+    contexts[i] = (thread_context){&h, i * KEYS_PER_WRITER, 0, 0};
+    pthread_create(&threads[i], NULL,
+                   i < WRITER_COUNT ? writer_thread : reader_thread,
+                   &contexts[i]);
+  }
+
+  for (unsigned i = 0; i < WRITER_COUNT + READER_COUNT; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+
+  for (unsigned i = WRITER_COUNT; i < WRITER_COUNT + READER_COUNT; ++i) {
+    FAIL_IF(contexts[i].torn_reads != 0,
+            "Concurrent hashtable reader saw %u torn values.\n",
+            contexts[i].torn_reads);
+  }
+
+  unsigned key_count = WRITER_COUNT * KEYS_PER_WRITER;
+  FAIL_IF(concurrent_hashtable_size(&h) != key_count / 2,
+          "Concurrent hashtable has the wrong size after the stress run.\n");
+
+  for (unsigned key = 0; key < key_count; ++key) {
+    checked_value value;
+    bool found = concurrent_hashtable_lookup(&h, &key, &value);
+    FAIL_IF(found != (key % 2 == 1),
+            "Concurrent hashtable has the wrong keys after the stress run.\n");
+    FAIL_IF(found && (value.key != key || value.check != ~key),
+            "Concurrent hashtable has the wrong values after the stress "
+            "run.\n");
+  }
+
+  concurrent_hashtable_reclaim(&h);
+  concurrent_hashtable_free(&h);
+
+  return 0;
+}
+
+void *churn_thread(void *data) {
+  thread_context *context = (thread_context *)data;
+
+  for (unsigned round = 0; round < CHURN_ROUNDS; ++round) {
+    for (unsigned i = 0; i < CHURN_KEYS; ++i) {
+      unsigned key = context->first_key + i;
+      checked_value value = {key, ~key};
+      concurrent_hashtable_insert(context->table, &key, &value);
+    }
+    for (unsigned i = 0; i < CHURN_KEYS; ++i) {
+      unsigned key = context->first_key + i;
+      concurrent_hashtable_remove(context->table, &key);
+    }
+  }
+
+  return NULL;
+}
+
+void *churn_reader_thread(void *data) {
+  thread_context *context = (thread_context *)data;
+
+  for (unsigned i = 0; i < CHURN_ROUNDS * CHURN_KEYS; ++i) {
+    unsigned key = i % (WRITER_COUNT * CHURN_KEYS);
+    checked_value value;
+    if (concurrent_hashtable_lookup(context->table, &key, &value)) {
+      context->found += 1;
+      if (value.key != key || value.check != ~key) {
+        context->torn_reads += 1;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * Writers insert and remove the same keys over and over while readers keep
+ * looking, so there is never a moment with no reader. The removed key copies
+ * must still get freed as the writers go.
+ */
+int test_churn_reclaims() {
+  concurrent_hashtable h = concurrent_hashtable_new(
+      sizeof(checked_value), unsigned_hash, unsigned_comparison, unsigned_copy);
+
+  pthread_t threads[WRITER_COUNT + READER_COUNT];
+  thread_context contexts[WRITER_COUNT + READER_COUNT];
+
+  for (unsigned i = 0; i < WRITER_COUNT + READER_COUNT; ++i) {
+    contexts[i] = (thread_context){&h, i * CHURN_KEYS, 0, 0};
+    pthread_create(&threads[i], NULL,
+                   i < WRITER_COUNT ? churn_thread : churn_reader_thread,
+                   &contexts[i]);
+  }
+
+  for (unsigned i = 0; i < WRITER_COUNT + READER_COUNT; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+
+  for (unsigned i = WRITER_COUNT; i < WRITER_COUNT + READER_COUNT; ++i) {
+    FAIL_IF(contexts[i].torn_reads != 0,
+            "Concurrent hashtable reader saw %u torn values.\n",
+            contexts[i].torn_reads);
+  }
+
+  FAIL_IF(concurrent_hashtable_size(&h) != 0,
+          "Concurrent hashtable isn't empty after the churn run.\n");
+
+  uint32_t retired = concurrent_hashtable_retired_count(&h);
+  FAIL_IF(retired > h.shard_count * 128,
+          "Concurrent hashtable kept %u of %u removed keys.\n", retired,
+          WRITER_COUNT * CHURN_ROUNDS * CHURN_KEYS);
+
+  concurrent_hashtable_reclaim(&h);
+  FAIL_IF(concurrent_hashtable_retired_count(&h) != 0,
+          "Concurrent hashtable reclaim left memory behind with no "
+          "readers.\n");
+
+  concurrent_hashtable_free(&h);
+
+  return 0;
+}
+
+int main(void) {
+  RETURN_IF_FAILED(test_basic());
+  RETURN_IF_FAILED(test_concurrent_stress());
+  RETURN_IF_FAILED(test_churn_reclaims());
+  return 0;
+}
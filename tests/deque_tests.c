@@ -0,0 +1,138 @@
+#include "data_structures/deque.h"
+#include "utilities/test_helpers.h"
+#include <stdio.h>
+
+int test_basic() {
+  deque d = deque_new(sizeof(int));
+
+  for (int i = 0; i < 10; ++i) {
+    deque_push_back(&d, &i);
+    int negative = -i - 1;
+    deque_push_front(&d, &negative);
+  }
+  FAIL_IF(d.size != 20 || *(int *)deque_get_front(&d) != -10 ||
+              *(int *)deque_get_back(&d) != 9,
+          "Deque has the wrong ends after pushing on both.\n");
+  for (int i = 0; i < 20; ++i) {
+    FAIL_IF(*(int *)deque_get_at(&d, (uint32_t)i) != i - 10,
+            "Element %d is wrong.\n", i);
+  }
+  FAIL_IF(deque_get_at(&d, 20) != NULL,
+          "An index past the end didn't return NULL.\n");
+
+  int value = 0;
+  FAIL_IF(!deque_pop_front(&d, &value) || value != -10,
+          "Pop front returned %d.\n", value);
+  FAIL_IF(!deque_pop_back(&d, &value) || value != 9,
+          "Pop back returned %d.\n", value);
+
+  deque_clear(&d);
+  FAIL_IF(!deque_is_empty(&d) || deque_pop_front(&d, &value) ||
+              deque_pop_back(&d, NULL) || deque_get_front(&d) != NULL,
+          "A cleared deque isn't empty.\n");
+
+  deque_free(&d);
+
+  return 0;
+}
+
+int test_wrap_and_grow() {
+  deque d = deque_new(sizeof(uint32_t));
+
+  /* Walk the contents around the buffer so they wrap, then grow it. */
+  uint32_t next = 0;
+  uint32_t expected = 0;
+  for (uint32_t round = 0; round < 1000; ++round) {
+    for (uint32_t i = 0; i < 3; ++i, ++next) {
+      deque_push_back(&d, &next);
+    }
+    for (uint32_t i = 0; i < 2; ++i, ++expected) {
+      uint32_t value;
+      deque_pop_front(&d, &value);
+      FAIL_IF(value != expected, "Popped %u, expected %u.\n", value,
+              expected);
+    }
+  }
+  FAIL_IF(d.size != 1000 || (d.buffer.size & (d.buffer.size - 1)) != 0,
+          "Deque has %u elements in a buffer of %u.\n", d.size,
+          d.buffer.size);
+  for (uint32_t i = 0; i < d.size; ++i) {
+    FAIL_IF(*(uint32_t *)deque_get_at(&d, i) != expected + i,
+            "Element %u is wrong after growing.\n", i);
+  }
+
+  deque_free(&d);
+
+  return 0;
+}
+
+int test_bulk() {
+  deque d = deque_new(sizeof(uint32_t));
+  uint32_t values[100];
+  for (uint32_t i = 0; i < 100; ++i) {
+    values[i] = i;
+  }
+
+  deque_reserve(&d, 64);
+  deque_push_back_n(&d, values + 50, 30);
+  deque_push_front_n(&d, values, 50);
+  FAIL_IF(d.buffer.size != 128 || d.size != 80,
+          "Bulk pushes left %u elements in %u slots.\n", d.size,
+          d.buffer.size);
+  for (uint32_t i = 0; i < 80; ++i) {
+    FAIL_IF(*(uint32_t *)deque_get_at(&d, i) != i,
+            "Element %u is wrong after bulk pushes.\n", i);
+  }
+
+  uint32_t out[100];
+  FAIL_IF(deque_pop_front_n(&d, out, 10) != 10 || out[0] != 0 || out[9] != 9,
+          "Bulk pop front returned the wrong elements.\n");
+  FAIL_IF(deque_pop_back_n(&d, out, 10) != 10 || out[0] != 70 ||
+              out[9] != 79,
+          "Bulk pop back returned the wrong elements.\n");
+  FAIL_IF(deque_pop_front_n(&d, NULL, 5) != 5 ||
+              *(uint32_t *)deque_get_front(&d) != 15,
+          "Dropping elements from the front failed.\n");
+  FAIL_IF(deque_pop_back_n(&d, out, 100) != 55 || out[0] != 15 ||
+              out[54] != 69 || !deque_is_empty(&d),
+          "Popping more than the deque holds went wrong.\n");
+
+  deque_free(&d);
+
+  return 0;
+}
+
+int test_limit_and_free(void) {
+  deque d = deque_new(sizeof(uint32_t));
+  uint32_t values[20];
+  for (uint32_t i = 0; i < 20; ++i) {
+    values[i] = i;
+  }
+
+  deque_push_back_n(&d, values, 20);
+  deque_pop_front_n(&d, NULL, 10);
+  deque_reserve(&d, UINT32_MAX);
+  FAIL_IF(d.buffer.size != 32 || d.size != 10,
+          "Reserving past the limit changed the deque.\n");
+
+  deque_free(&d);
+  FAIL_IF(!deque_is_empty(&d) || d.head != 0,
+          "A freed deque is not empty.\n");
+  deque_push_front(&d, &values[1]);
+  deque_push_back(&d, &values[2]);
+  FAIL_IF(d.size != 2 || *(uint32_t *)deque_get_front(&d) != 1 ||
+              *(uint32_t *)deque_get_back(&d) != 2,
+          "Pushing onto a freed deque went wrong.\n");
+
+  deque_free(&d);
+
+  return 0;
+}
+
+int main(void) {
+  RETURN_IF_FAILED(test_basic());
+  RETURN_IF_FAILED(test_wrap_and_grow());
+  RETURN_IF_FAILED(test_bulk());
+  RETURN_IF_FAILED(test_limit_and_free());
+  return 0;
+}
@@ -103,6 +103,50 @@ int test_remove() {
   return 0;
 }
 
+static bool is_multiple(void const *element, void *context) {
+  return *(int const *)element % *(int const *)context == 0;
+}
+
+int test_remove_many() {
+  dynamic_array a = dynamic_array_new(sizeof(int));
+  for (int i = 0; i < 100; ++i) {
+    dynamic_array_push_back(&a, &i);
+  }
+
+  dynamic_array_swap_remove(&a, 10);
+  dynamic_array_swap_remove(&a, 98);
+  dynamic_array_swap_remove(&a, 500);
+  FAIL_IF(a.size != 98 || *(int *)dynamic_array_get_at(&a, 10) != 99 ||
+              *(int *)dynamic_array_get_back(&a) != 97,
+          "Swap remove didn't move the last element into place.\n");
+
+  int three = 3;
+  uint32_t removed = dynamic_array_remove_if(&a, is_multiple, &three);
+  FAIL_IF(removed != 34, "Remove if removed %u elements, not 34.\n", removed);
+  int previous = -1;
+  for (uint32_t i = 0; i < a.size; ++i) {
+    int value = *(int *)dynamic_array_get_at(&a, i);
+    FAIL_IF(value % 3 == 0 || value <= previous,
+            "Remove if kept %d or lost the order at %u.\n", value, i);
+    previous = value;
+  }
+
+  dynamic_array_clear(&a);
+  for (int i = 0; i < 10; ++i) {
+    dynamic_array_push_back(&a, &i);
+  }
+  uint32_t indices[] = {0, 3, 3, 4, 9, 12};
+  removed = dynamic_array_remove_indices(&a, indices, 6);
+  int expected[] = {1, 2, 5, 6, 7, 8};
+  FAIL_IF(removed != 4 || a.size != 6 ||
+              memcmp(a.data, expected, sizeof(expected)) != 0,
+          "Remove indices left the wrong elements.\n");
+
+  dynamic_array_free(&a);
+
+  return 0;
+}
+
 int test_shrink() {
   dynamic_array a = dynamic_array_reserved_new(sizeof(int), 400);
 
@@ -122,11 +166,243 @@ int test_shrink() {
   return 0;
 }
 
+int test_bulk() {
+  dynamic_array a = dynamic_array_new(sizeof(unsigned));
+  unsigned numbers[1000];
+  unsigned count = sizeof(numbers) / sizeof(unsigned);
+
+  for (unsigned i = 0; i < count; ++i) {
+    numbers[i] = i;
+  }
+
+  dynamic_array_push_back_n(&a, numbers, count);
+  FAIL_IF(a.size != count || a.capacity != count,
+          "Bulk append didn't grow straight to size.\n");
+  dynamic_array_push_back_n(&a, numbers, 0);
+  FAIL_IF(a.size != count, "Appending nothing changed the size.\n");
+
+  unsigned middle[] = {7000, 7001, 7002};
+  dynamic_array_insert_range(&a, 10, middle, 3);
+  dynamic_array_insert_range(&a, 0, middle, 1);
+  dynamic_array_insert_range(&a, a.size, middle + 2, 1);
+  dynamic_array_insert_range(&a, a.size + 1, middle, 3);
+  FAIL_IF(a.size != count + 5, "Insert range has the wrong size.\n");
+
+  for (unsigned i = 0; i < a.size; ++i) {
+    unsigned expected = i == 0                ? 7000
+                        : i < 11              ? i - 1
+                        : i < 14              ? 7000 + i - 11
+                        : i == count + 4      ? 7002
+                                              : i - 4;
+    FAIL_IF(*(unsigned *)dynamic_array_get_at(&a, i) != expected,
+            "Element %u is %u, not %u after insert range.\n", i,
+            *(unsigned *)dynamic_array_get_at(&a, i), expected);
+  }
+
+  unsigned *space = dynamic_array_emplace_back_uninit(&a, 2);
+  space[0] = 42;
+  space[1] = 43;
+  FAIL_IF(a.size != count + 7 ||
+              *(unsigned *)dynamic_array_get_back(&a) != 43,
+          "Emplace didn't add writable elements.\n");
+
+  uint32_t capacity = a.capacity;
+  dynamic_array_resize(&a, 5);
+  FAIL_IF(a.size != 5 || a.capacity != capacity ||
+              *(unsigned *)dynamic_array_get_back(&a) != 3,
+          "Resizing down lost elements or capacity.\n");
+  dynamic_array_resize(&a, 5000);
+  FAIL_IF(a.size != 5000 || a.capacity < 5000,
+          "Resizing up didn't make room.\n");
+  FAIL_IF(*(unsigned *)dynamic_array_get_at(&a, 4) != 3,
+          "Resizing up lost elements.\n");
+
+  dynamic_array_free(&a);
+
+  return 0;
+}
+
+int test_allocator() {
+  test_allocator_counts counts = {0, 0, 0};
+  fennec_allocator allocator = test_counting_allocator(&counts);
+  dynamic_array a =
+      dynamic_array_new_with_allocator(sizeof(double), &allocator);
+
+  for (unsigned i = 0; i < 1000; ++i) {
+    double value = i * 0.5;
+    dynamic_array_push_back(&a, &value);
+  }
+  dynamic_array_reserve(&a, 3000);
+  dynamic_array_resize(&a, 500);
+  dynamic_array_shrink(&a);
+
+  FAIL_IF(counts.allocations == 0 || counts.live_bytes != 500 * sizeof(double),
+          "Array didn't get its memory from its allocator.\n");
+  FAIL_IF(*(double *)dynamic_array_get_back(&a) != 249.5,
+          "Array lost elements when its allocator moved them.\n");
+
+  dynamic_array_clear(&a);
+  dynamic_array_shrink(&a);
+  FAIL_IF(a.allocator != &allocator || counts.live_bytes != 0,
+          "Shrinking an empty array didn't give its memory back.\n");
+
+  dynamic_array_push_back(&a, &(double){1});
+  dynamic_array_free(&a);
+  FAIL_IF(counts.live_bytes != 0 || counts.wrong_sizes != 0,
+          "Array gave back %u blocks with the wrong size.\n",
+          counts.wrong_sizes);
+
+  return 0;
+}
+
+int test_buffer() {
+  int buffer[8];
+  dynamic_array a = dynamic_array_new_with_buffer(sizeof(int), buffer, 8);
+
+  for (int i = 0; i < 8; ++i) {
+    dynamic_array_push_back(&a, &i);
+  }
+  dynamic_array_shrink(&a);
+  FAIL_IF(a.data != (char *)buffer || a.capacity != 8 || buffer[7] != 7,
+          "Array left its buffer before it was full.\n");
+
+  int value = 8;
+  dynamic_array_push_back(&a, &value);
+  FAIL_IF(a.data == (char *)buffer ||
+              (a.flags & dynamic_array_flag_borrowed_data) || a.size != 9,
+          "Array didn't move out of its full buffer.\n");
+  for (int i = 0; i < 9; ++i) {
+    FAIL_IF(*(int *)dynamic_array_get_at(&a, i) != i,
+            "Element %d was lost moving out of the buffer.\n", i);
+  }
+  dynamic_array_free(&a);
+
+  a = dynamic_array_new_with_buffer(sizeof(int), buffer, 8);
+  dynamic_array_reserve(&a, 4);
+  FAIL_IF(a.data != (char *)buffer,
+          "Reserving less than the buffer holds left the buffer.\n");
+  dynamic_array_push_back(&a, &value);
+  dynamic_array_reserve(&a, 100);
+  FAIL_IF(a.data == (char *)buffer || a.capacity != 100 ||
+              *(int *)dynamic_array_get_front(&a) != 8,
+          "Reserving past the buffer didn't move the elements.\n");
+  dynamic_array_free(&a);
+
+  return 0;
+}
+
+typedef struct {
+  float key;
+  uint32_t order;
+  char padding[4];
+} sort_record;
+
+static int compare_int(void const *a, void const *b) {
+  int x = *(int const *)a;
+  int y = *(int const *)b;
+  return (x > y) - (x < y);
+}
+
+static int compare_record(void const *a, void const *b) {
+  float x = ((sort_record const *)a)->key;
+  float y = ((sort_record const *)b)->key;
+  return (x > y) - (x < y);
+}
+
+static int compare_bytes(void const *a, void const *b) {
+  return memcmp(a, b, 24);
+}
+
+int test_sort() {
+  unsigned count = 300000;
+  dynamic_array a = dynamic_array_new(sizeof(int));
+  int *expected = malloc(sizeof(int) * count);
+  for (unsigned i = 0; i < count; ++i) {
+    /* Lots of duplicates and negative numbers. */
+    int value = (int)((i * 2654435761u) % 100003) - 50000;
+    dynamic_array_push_back(&a, &value);
+    expected[i] = value;
+  }
+  qsort(expected, count, sizeof(int), compare_int);
+
+  dynamic_array b = dynamic_array_new(sizeof(int));
+  dynamic_array_push_back_n(&b, a.data, a.size);
+  dynamic_array c = dynamic_array_new(sizeof(int));
+  dynamic_array_push_back_n(&c, a.data, a.size);
+
+  dynamic_array_sort(&a, compare_int);
+  dynamic_array_radix_sort(&b, 0, dynamic_array_key_int32);
+  dynamic_array_parallel_sort(&c, compare_int, 4);
+  FAIL_IF(memcmp(a.data, expected, sizeof(int) * count) != 0,
+          "Introsort disagrees with qsort.\n");
+  FAIL_IF(memcmp(b.data, expected, sizeof(int) * count) != 0,
+          "Radix sort disagrees with qsort.\n");
+  FAIL_IF(memcmp(c.data, expected, sizeof(int) * count) != 0,
+          "Parallel sort disagrees with qsort.\n");
+
+  /* Already sorted and reversed input. */
+  for (unsigned i = 0; i < count; ++i) {
+    ((int *)a.data)[i] = (int)(count - i);
+  }
+  dynamic_array_sort(&a, compare_int);
+  FAIL_IF(((int *)a.data)[0] != 1 || ((int *)a.data)[count - 1] != (int)count,
+          "Introsort got reversed input wrong.\n");
+  dynamic_array_free(&a);
+  dynamic_array_free(&b);
+  dynamic_array_free(&c);
+  free(expected);
+
+  dynamic_array records = dynamic_array_new(sizeof(sort_record));
+  for (uint32_t i = 0; i < 1000; ++i) {
+    sort_record record = {(float)(i % 7) - 3.5f, i, {0}};
+    dynamic_array_push_back(&records, &record);
+  }
+  dynamic_array_radix_sort(&records, 0, dynamic_array_key_float);
+  for (uint32_t i = 1; i < records.size; ++i) {
+    sort_record *previous = dynamic_array_get_at(&records, i - 1);
+    sort_record *current = dynamic_array_get_at(&records, i);
+    FAIL_IF(previous->key > current->key ||
+                (previous->key == current->key &&
+                 previous->order > current->order),
+            "Radix sort on floats is out of order or unstable at %u.\n", i);
+  }
+  FAIL_IF(((sort_record *)records.data)->key != -3.5f,
+          "Radix sort put %f first.\n", ((sort_record *)records.data)->key);
+  dynamic_array_sort(&records, compare_record);
+  FAIL_IF(((sort_record *)dynamic_array_get_back(&records))->key != 2.5f,
+          "Introsort of records put the wrong one last.\n");
+  dynamic_array_free(&records);
+
+  /* An element size without a specialization. */
+  dynamic_array wide = dynamic_array_new(24);
+  char element[24];
+  for (unsigned i = 0; i < 2000; ++i) {
+    for (unsigned byte = 0; byte < 24; ++byte) {
+      element[byte] = (char)((i * 31 + byte * 7) % 13);
+    }
+    dynamic_array_push_back(&wide, element);
+  }
+  dynamic_array_sort(&wide, compare_bytes);
+  for (uint32_t i = 1; i < wide.size; ++i) {
+    FAIL_IF(compare_bytes(dynamic_array_get_at(&wide, i - 1),
+                          dynamic_array_get_at(&wide, i)) > 0,
+            "Introsort of 24 byte elements is out of order at %u.\n", i);
+  }
+  dynamic_array_free(&wide);
+
+  return 0;
+}
+
 int main(void) {
   RETURN_IF_FAILED(test_basic());
   RETURN_IF_FAILED(test_reserve());
   RETURN_IF_FAILED(test_get_back());
   RETURN_IF_FAILED(test_remove());
+  RETURN_IF_FAILED(test_remove_many());
   RETURN_IF_FAILED(test_shrink());
+  RETURN_IF_FAILED(test_bulk());
+  RETURN_IF_FAILED(test_allocator());
+  RETURN_IF_FAILED(test_buffer());
+  RETURN_IF_FAILED(test_sort());
   return 0;
 }
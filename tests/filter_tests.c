@@ -0,0 +1,130 @@
+#include "data_structures/filter.h"
+#include "utilities/test_helpers.h"
+#include <stdio.h>
+
+static uint32_t unsigned_hash(void const *key) { return *(unsigned *)key; }
+
+int test_bloom_filter(void) {
+  unsigned count = 100000;
+  double rate = 0.01;
+  bloom_filter filter = bloom_filter_new(count, rate, unsigned_hash);
+
+  for (unsigned i = 0; i < count; ++i) {
+    bloom_filter_add(&filter, &i);
+  }
+
+  for (unsigned i = 0; i < count; ++i) {
+    FAIL_IF(!bloom_filter_contains(&filter, &i), "Lost key %u.\n", i);
+  }
+
+  unsigned false_positives = 0;
+  for (unsigned i = count; i < count * 11; ++i) {
+    false_positives += bloom_filter_contains(&filter, &i);
+  }
+  double measured = (double)false_positives / (count * 10);
+  FAIL_IF(measured > rate * 1.5, "False positive rate %f, wanted %f.\n",
+          measured, rate);
+
+  bloom_filter_clear(&filter);
+  unsigned zero = 0;
+  FAIL_IF(bloom_filter_contains(&filter, &zero),
+          "Cleared filter still has keys.\n");
+
+  bloom_filter_free(&filter);
+
+  return 0;
+}
+
+int test_cuckoo_filter(void) {
+  unsigned count = 100000;
+  cuckoo_filter filter = cuckoo_filter_new(count, unsigned_hash);
+
+  for (unsigned i = 0; i < count; ++i) {
+    FAIL_IF(!cuckoo_filter_add(&filter, &i), "Filter full after %u keys.\n",
+            i);
+  }
+  FAIL_IF(filter.size != count, "Size is %u, not %u.\n", filter.size, count);
+
+  for (unsigned i = 0; i < count; ++i) {
+    FAIL_IF(!cuckoo_filter_contains(&filter, &i), "Lost key %u.\n", i);
+  }
+
+  for (unsigned i = 0; i < count; i += 2) {
+    FAIL_IF(!cuckoo_filter_remove(&filter, &i), "Couldn't remove %u.\n", i);
+  }
+
+  unsigned false_positives = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    bool found = cuckoo_filter_contains(&filter, &i);
+    FAIL_IF(i % 2 == 1 && !found, "Remove lost key %u.\n", i);
+    false_positives += i % 2 == 0 && found;
+  }
+  FAIL_IF(false_positives > count / 200,
+          "%u removed keys still found.\n", false_positives);
+
+  cuckoo_filter_free(&filter);
+
+  return 0;
+}
+
+int test_cuckoo_filter_full(void) {
+  cuckoo_filter filter = cuckoo_filter_new(1000, unsigned_hash);
+  unsigned added = 0;
+
+  while (added < 100000 && cuckoo_filter_add(&filter, &added)) {
+    ++added;
+  }
+  FAIL_IF(added == 100000 || added < 1000,
+          "Filter for 1000 keys took %u.\n", added);
+
+  for (unsigned i = 0; i < added; ++i) {
+    FAIL_IF(!cuckoo_filter_contains(&filter, &i), "Lost key %u.\n", i);
+  }
+
+  /* Making room lets the filter take adds again. */
+  unsigned removed = added / 2;
+  for (unsigned i = 0; i < removed; ++i) {
+    cuckoo_filter_remove(&filter, &i);
+  }
+  FAIL_IF(!cuckoo_filter_add(&filter, &added), "Filter still full.\n");
+
+  for (unsigned i = removed; i <= added; ++i) {
+    FAIL_IF(!cuckoo_filter_contains(&filter, &i), "Lost key %u.\n", i);
+  }
+
+  cuckoo_filter_free(&filter);
+
+  return 0;
+}
+
+int test_cuckoo_filter_duplicates(void) {
+  cuckoo_filter filter = cuckoo_filter_new(100, unsigned_hash);
+  unsigned key = 42;
+
+  for (unsigned i = 0; i < 3; ++i) {
+    cuckoo_filter_add(&filter, &key);
+  }
+
+  for (unsigned i = 0; i < 3; ++i) {
+    FAIL_IF(!cuckoo_filter_contains(&filter, &key),
+            "Lost a copy after %u removes.\n", i);
+    FAIL_IF(!cuckoo_filter_remove(&filter, &key), "Couldn't remove copy %u.\n",
+            i);
+  }
+  FAIL_IF(cuckoo_filter_contains(&filter, &key) ||
+              cuckoo_filter_remove(&filter, &key),
+          "Removed key is still there.\n");
+
+  cuckoo_filter_free(&filter);
+
+  return 0;
+}
+
+int main(void) {
+  RETURN_IF_FAILED(test_bloom_filter());
+  RETURN_IF_FAILED(test_cuckoo_filter());
+  RETURN_IF_FAILED(test_cuckoo_filter_full());
+  RETURN_IF_FAILED(test_cuckoo_filter_duplicates());
+
+  return 0;
+}
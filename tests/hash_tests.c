@@ -0,0 +1,89 @@
+#include "utilities/hash.h"
+#include "utilities/test_helpers.h"
+#include <stdio.h>
+
+int test_wyhash() {
+  /* The test vectors from the reference implementation, hashed with seed i. */
+  char const *messages[] = {
+      "",
+      "a",
+      "abc",
+      "message digest",
+      "abcdefghijklmnopqrstuvwxyz",
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+      "1234567890123456789012345678901234567890123456789012345678901234567890"
+      "1234567890"};
+  uint64_t const expected[] = {0x93228a4de0eec5a2ull, 0xc5bac3db178713c4ull,
+                               0xa97f2f7b1d9b3314ull, 0x786d1f1df3801df4ull,
+                               0xdca5a8138ad37c87ull, 0xb9e734f117cfaf70ull,
+                               0x6cc5eab49a92d617ull};
+
+  for (uint32_t i = 0; i < sizeof(messages) / sizeof(char *); ++i) {
+    uint32_t length = (uint32_t)strlen(messages[i]);
+    FAIL_IF(hash_wyhash(messages[i], length, i) != expected[i],
+            "wyhash of \"%s\" is wrong.\n", messages[i]);
+  }
+
+  FAIL_IF(hash_wyhash("abc", 3, 1) == hash_wyhash("abc", 3, 2),
+          "wyhash ignored the seed.\n");
+
+  return 0;
+}
+
+int test_crc32c() {
+  uint8_t zeros[32] = {0};
+  uint8_t ones[32];
+  memset(ones, 0xFF, sizeof(ones));
+
+  FAIL_IF(hash_crc32c("123456789", 9, 0) != 0xE3069283,
+          "CRC32C check value is wrong.\n");
+  FAIL_IF(hash_crc32c(zeros, sizeof(zeros), 0) != 0x8A9136AA,
+          "CRC32C of 32 zero bytes is wrong.\n");
+  FAIL_IF(hash_crc32c(ones, sizeof(ones), 0) != 0x62A8AB43,
+          "CRC32C of 32 0xFF bytes is wrong.\n");
+  FAIL_IF(hash_crc32c("abc", 3, 1) == hash_crc32c("abc", 3, 2),
+          "CRC32C ignored the seed.\n");
+
+  return 0;
+}
+
+/*
+ * Every length is hashed from an exactly sized allocation so reads past the
+ * end show up under the sanitizers, and every length must hash differently.
+ */
+int test_lengths() {
+  uint64_t wyhashes[128];
+  uint64_t crcs[128];
+
+  for (uint32_t length = 0; length < 128; ++length) {
+    uint8_t *data = malloc(length + 1);
+    memset(data, 'x', length + 1);
+    wyhashes[length] = hash_wyhash(data, length, 7);
+    crcs[length] = hash_crc32c(data, length, 7);
+    free(data);
+
+    for (uint32_t i = 0; i < length; ++i) {
+      FAIL_IF(wyhashes[i] == wyhashes[length],
+              "wyhash collided for lengths %u and %u.\n", i, length);
+      FAIL_IF(crcs[i] == crcs[length],
+              "CRC32C collided for lengths %u and %u.\n", i, length);
+    }
+  }
+
+  return 0;
+}
+
+int test_random_seed() {
+  FAIL_IF(hash_random_seed() == hash_random_seed(),
+          "Two random seeds were the same.\n");
+
+  return 0;
+}
+
+int main(void) {
+  RETURN_IF_FAILED(test_wyhash());
+  RETURN_IF_FAILED(test_crc32c());
+  RETURN_IF_FAILED(test_lengths());
+  RETURN_IF_FAILED(test_random_seed());
+  return 0;
+}
@@ -1,11 +1,11 @@
 #include "data_structures/dynamic_array.h"
 #include "data_structures/hashtable.h"
+#include "utilities/file.h"
 #include "utilities/test_helpers.h"
 #include <stdio.h>
 #include <string.h>
 
-int test_basic() {
-  hashtable h = hashtable_new_string(sizeof(int));
+int test_basic(hashtable h) {
 
   char const *strings[] = {"hello", "what", "butts", "buuuuuuuts",
                            "cat",   "bat",  "rat",   "helllooooooooo"};
@@ -47,8 +47,7 @@ void free_word_list(dynamic_array a) {
   dynamic_array_free(&a);
 }
 
-int test_lookup_remove_and_shrink() {
-  hashtable h = hashtable_new_string(sizeof(unsigned));
+int test_lookup_remove_and_shrink(hashtable h) {
 
   unsigned word_list_size = 129000;
   dynamic_array word_list = make_word_list(word_list_size);
@@ -93,8 +92,988 @@ int test_lookup_remove_and_shrink() {
   return 0;
 }
 
+uint32_t unsigned_hash(void const *key) { return *(unsigned const *)key; }
+
+bool unsigned_comparison(void const *key1, void const *key2) {
+  return *(unsigned const *)key1 == *(unsigned const *)key2;
+}
+
+void *unsigned_copy(void const *key) {
+  unsigned *copy = malloc(sizeof(unsigned));
+  *copy = *(unsigned const *)key;
+  return copy;
+}
+
+unsigned counted_hash_calls = 0;
+unsigned counted_comparison_calls = 0;
+
+uint32_t counted_colliding_hash(void const *key) {
+  counted_hash_calls += 1;
+  return *(unsigned const *)key << 16;
+}
+
+bool counted_comparison(void const *key1, void const *key2) {
+  counted_comparison_calls += 1;
+  return unsigned_comparison(key1, key2);
+}
+
+int test_cached_hashes(hashtable h) {
+  unsigned count = 3000;
+  counted_hash_calls = 0;
+
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&h, &i, &i);
+  }
+
+  FAIL_IF(counted_hash_calls != count,
+          "Hashtable re-hashed keys while growing (%u hash calls).\n",
+          counted_hash_calls);
+
+  /*
+   * Every key shares its low bits, so lookups walk long collision chains. Only
+   * the key with the matching hash should ever be compared.
+   */
+  for (unsigned i = 0; i < count; i += 7) {
+    counted_comparison_calls = 0;
+    unsigned *value = hashtable_lookup(&h, &i);
+    FAIL_IF(value == NULL || *value != i,
+            "Hashtable lookup failed with colliding hashes.\n");
+    FAIL_IF(counted_comparison_calls != 1,
+            "Hashtable compared %u keys for one lookup.\n",
+            counted_comparison_calls);
+  }
+
+  hashtable_free(&h);
+
+  return 0;
+}
+
+int test_batch(hashtable h) {
+  unsigned count = 5000;
+  unsigned *keys = malloc(sizeof(unsigned) * count * 2);
+  unsigned *values = malloc(sizeof(unsigned) * count);
+  void const **key_pointers = malloc(sizeof(void *) * count * 2);
+  void **found = malloc(sizeof(void *) * count * 2);
+
+  for (unsigned i = 0; i < count * 2; ++i) {
+    keys[i] = i * 3;
+    key_pointers[i] = &keys[i];
+  }
+  for (unsigned i = 0; i < count; ++i) {
+    values[i] = i + 1;
+  }
+
+  hashtable_insert_batch(&h, key_pointers, values, count);
+  FAIL_IF(h.size != count, "Hashtable batch insert has the wrong size.\n");
+
+  /*
+   * The second half of the keys were never inserted.
+   */
+  hashtable_lookup_batch(&h, key_pointers, count * 2, found);
+  for (unsigned i = 0; i < count * 2; ++i) {
+    FAIL_IF(found[i] != hashtable_lookup(&h, key_pointers[i]),
+            "Hashtable batch lookup disagrees with lookup.\n");
+    FAIL_IF(i < count && (found[i] == NULL || *(unsigned *)found[i] != i + 1),
+            "Hashtable batch lookup returned the wrong value.\n");
+    FAIL_IF(i >= count && found[i] != NULL,
+            "Hashtable batch lookup found a missing key.\n");
+  }
+
+  free(keys);
+  free(values);
+  free(key_pointers);
+  free(found);
+  hashtable_free(&h);
+
+  return 0;
+}
+
+int test_iterate(hashtable h) {
+  unsigned count = 1000;
+  unsigned long long expected_sum = 0;
+
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&h, &i, &i);
+    expected_sum += i;
+  }
+
+  unsigned visited = 0;
+  unsigned long long sum = 0;
+  for (unsigned *value = hashtable_iterate(&h, NULL); value != NULL;
+       value = hashtable_iterate(&h, value)) {
+    visited += 1;
+    sum += *value;
+  }
+
+  FAIL_IF(visited != count, "Hashtable iterate visited %u of %u values.\n",
+          visited, count);
+  FAIL_IF(sum != expected_sum, "Hashtable iterate returned wrong values.\n");
+
+  hashtable_free(&h);
+
+  return 0;
+}
+
+int test_remove_churn(hashtable h) {
+  unsigned live = 200;
+
+  /*
+   * Keep a sliding window of keys alive so removed slots are constantly
+   * reused.
+   */
+  for (unsigned i = 0; i < 20000; ++i) {
+    hashtable_insert(&h, &i, &i);
+    if (i >= live) {
+      unsigned old = i - live;
+      hashtable_remove(&h, &old);
+      FAIL_IF(hashtable_exists(&h, &old),
+              "Hashtable found a removed key.\n");
+    }
+  }
+
+  FAIL_IF(h.size != live, "Hashtable size is wrong after churn.\n");
+
+  for (unsigned i = 20000 - live; i < 20000; ++i) {
+    unsigned *value = hashtable_lookup(&h, &i);
+    FAIL_IF(value == NULL || *value != i,
+            "Hashtable lost a key during churn.\n");
+  }
+
+  hashtable_free(&h);
+
+  return 0;
+}
+
+/*
+ * Keys on both sides of the inline limit, checked again after removals and
+ * after growing moves every bucket.
+ */
+int test_key_storage(hashtable h) {
+  unsigned const longest = HASHTABLE_INLINE_KEY_SIZE * 4;
+  char key[HASHTABLE_INLINE_KEY_SIZE * 4 + 1];
+
+  for (unsigned length = 1; length <= longest; ++length) {
+    sprintf(key, "%0*u", (int)length, length);
+    hashtable_insert(&h, key, &length);
+  }
+
+  for (unsigned length = 1; length <= longest; length += 2) {
+    sprintf(key, "%0*u", (int)length, length);
+    hashtable_remove(&h, key);
+  }
+
+  for (unsigned i = 0; i < 5000; ++i) {
+    sprintf(key, "filler key that is too long to fit in a bucket %u", i);
+    hashtable_insert(&h, key, &i);
+  }
+
+  for (unsigned length = 1; length <= longest; ++length) {
+    sprintf(key, "%0*u", (int)length, length);
+    unsigned *value = hashtable_lookup(&h, key);
+    if (length % 2 == 1) {
+      FAIL_IF(value != NULL, "Hashtable found a removed %u byte key.\n",
+              length);
+    } else {
+      FAIL_IF(value == NULL || *value != length,
+              "Hashtable lost a %u byte key.\n", length);
+    }
+  }
+
+  hashtable_free(&h);
+
+  return 0;
+}
+
+/*
+ * Saves a table with a removed key in it, maps it back and checks it sees the
+ * same elements through every read path.
+ */
+int test_save_and_open_mapped(hashtable h) {
+  unsigned const count = 20000;
+  string path = string_wrap_cstring("hashtable_tests_image.bin");
+  dynamic_array word_list = make_word_list(count);
+
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&h, *(char **)dynamic_array_get_at(&word_list, i), &i);
+  }
+  hashtable_remove(&h, "test string 7");
+
+  FAIL_IF(!hashtable_save(&h, &path), "Hashtable failed to save.\n");
+  hashtable_free(&h);
+
+  hashtable mapped = hashtable_open_mapped(&path);
+  FAIL_IF(mapped.data == NULL, "Hashtable failed to open a saved table.\n");
+  FAIL_IF(mapped.size != count - 1, "Mapped hashtable has the wrong size.\n");
+
+  for (unsigned i = 0; i < count; ++i) {
+    char const *key = *(char const **)dynamic_array_get_at(&word_list, i);
+    unsigned *value = hashtable_lookup(&mapped, key);
+    if (i == 7) {
+      FAIL_IF(value != NULL, "Mapped hashtable found a removed key.\n");
+    } else {
+      FAIL_IF(value == NULL || *value != i,
+              "Mapped hashtable lost a key.\n");
+    }
+  }
+  FAIL_IF(hashtable_exists(&mapped, "not a key"),
+          "Mapped hashtable found a key that was never inserted.\n");
+  unsigned *bytes_value =
+      hashtable_lookup_bytes(&mapped, "test string 42 and more", 14);
+  FAIL_IF(bytes_value == NULL || *bytes_value != 42,
+          "Mapped hashtable lookup by bytes failed.\n");
+
+  void *values[2];
+  void const *keys[2] = {"test string 42", "not a key"};
+  hashtable_lookup_batch(&mapped, keys, 2, values);
+  FAIL_IF(values[0] == NULL || *(unsigned *)values[0] != 42 ||
+              values[1] != NULL,
+          "Mapped hashtable batch lookup is wrong.\n");
+
+  unsigned iterated = 0;
+  for (void *position = hashtable_iterate(&mapped, NULL); position != NULL;
+       position = hashtable_iterate(&mapped, position)) {
+    char const *key = hashtable_key_at(&mapped, position);
+    FAIL_IF(hashtable_lookup(&mapped, key) != position,
+            "Mapped hashtable iterated to a key it can't find.\n");
+    ++iterated;
+  }
+  FAIL_IF(iterated != count - 1,
+          "Mapped hashtable iterated over %u elements.\n", iterated);
+
+  hashtable_statistics stats;
+  hashtable_stats(&mapped, &stats);
+  FAIL_IF(stats.size != count - 1 || stats.key_bytes == 0 ||
+              stats.bucket_bytes == 0,
+          "Mapped hashtable stats are wrong.\n");
+
+  unsigned value = 0;
+  bool inserted;
+  hashtable_insert(&mapped, "new key", &value);
+  hashtable_remove(&mapped, "test string 1");
+  FAIL_IF(hashtable_find_or_insert(&mapped, "other key", &inserted) != NULL ||
+              inserted,
+          "Mapped hashtable find_or_insert inserted a key.\n");
+  FAIL_IF(hashtable_exists(&mapped, "new key") ||
+              !hashtable_exists(&mapped, "test string 1"),
+          "Mapped hashtable was changed.\n");
+
+  hashtable_free(&mapped);
+  remove(path.data);
+  free_word_list(word_list);
+
+  return 0;
+}
+
+int test_open_mapped_failures() {
+  string missing = string_wrap_cstring("hashtable_tests_missing.bin");
+  hashtable mapped = hashtable_open_mapped(&missing);
+  FAIL_IF(mapped.data != NULL, "Hashtable opened a file that isn't there.\n");
+  FAIL_IF(hashtable_lookup(&mapped, "key") != NULL,
+          "Failed mapped hashtable found a key.\n");
+  hashtable_free(&mapped);
+
+  string path = string_wrap_cstring("hashtable_tests_garbage.bin");
+  FILE *file = fopen(path.data, "wb");
+  fputs("this is not a saved hashtable, but it is long enough to be one "
+        "if only the header were right.",
+        file);
+  fclose(file);
+  mapped = hashtable_open_mapped(&path);
+  FAIL_IF(mapped.data != NULL, "Hashtable opened a file that isn't a table.\n");
+  remove(path.data);
+
+  hashtable numbers = hashtable_new(sizeof(unsigned), unsigned_hash,
+                                    unsigned_comparison, unsigned_copy);
+  FAIL_IF(hashtable_save(&numbers, &path),
+          "Saved a table that isn't keyed by strings.\n");
+
+  return 0;
+}
+
+/*
+ * Writes image to path with the uint32_t at offset replaced and checks that
+ * hashtable_open_mapped refuses it.
+ */
+int open_corrupted_image(file_data const *image, uint64_t offset,
+                         uint32_t corruption, char const *what) {
+  string path = string_wrap_cstring("hashtable_tests_corrupt.bin");
+  char *copy = malloc(image->size);
+  memcpy(copy, image->data, image->size);
+  memcpy(copy + offset, &corruption, sizeof(corruption));
+  FAIL_IF(!file_write_all(&path, copy, image->size),
+          "Failed to write a corrupted image.\n");
+  free(copy);
+
+  hashtable mapped = hashtable_open_mapped(&path);
+  FAIL_IF(mapped.data != NULL, "Hashtable opened an image with %s.\n", what);
+  remove(path.data);
+
+  return 0;
+}
+
+/*
+ * Corrupts the parts of a saved image a lookup trusts. The offsets of the
+ * header fields follow the image layout in hashtable_mapped.c.
+ */
+int test_open_mapped_corrupted() {
+  string path = string_wrap_cstring("hashtable_tests_valid.bin");
+  hashtable h = hashtable_new_string(sizeof(unsigned));
+  for (unsigned i = 0; i < 100; ++i) {
+    char key[32];
+    sprintf(key, "key %u", i);
+    hashtable_insert(&h, key, &i);
+  }
+  FAIL_IF(!hashtable_save(&h, &path), "Hashtable failed to save.\n");
+  hashtable_free(&h);
+
+  file_data image = file_load_all(&path);
+  remove(path.data);
+  FAIL_IF(image.data == NULL, "Failed to read a saved image.\n");
+
+  uint64_t starts_offset;
+  uint64_t entries_offset;
+  memcpy(&starts_offset, (char *)image.data + 48, sizeof(uint64_t));
+  memcpy(&entries_offset, (char *)image.data + 56, sizeof(uint64_t));
+
+  RETURN_IF_FAILED(open_corrupted_image(&image, starts_offset + 4, UINT32_MAX,
+                                        "decreasing bucket starts"));
+  RETURN_IF_FAILED(open_corrupted_image(&image, entries_offset + 4,
+                                        UINT32_MAX - 16,
+                                        "a key outside the strings"));
+  RETURN_IF_FAILED(open_corrupted_image(&image, image.size - 4, 0x78787878,
+                                        "unterminated strings"));
+  RETURN_IF_FAILED(open_corrupted_image(&image, 56, UINT32_MAX,
+                                        "entries past the end"));
+
+  file_data_free(&image);
+
+  return 0;
+}
+
+hashtable inline_keyed(hashtable h) {
+  hashtable_set_inline_keys(&h, true);
+  return h;
+}
+
+int test_set_inline_keys() {
+  hashtable h = hashtable_new_string(sizeof(int));
+  int value = 1;
+
+  hashtable_insert(&h, "key", &value);
+  FAIL_IF(hashtable_set_inline_keys(&h, true),
+          "Turned on inline keys for a table that has keys in it.\n");
+  hashtable_remove(&h, "key");
+  FAIL_IF(!hashtable_set_inline_keys(&h, true),
+          "Couldn't turn on inline keys for an emptied string table.\n");
+  hashtable_insert(&h, "key", &value);
+  FAIL_IF(!hashtable_exists(&h, "key"),
+          "Hashtable lost a key after turning on inline keys.\n");
+  hashtable_free(&h);
+
+  hashtable numbers = hashtable_new(sizeof(unsigned), unsigned_hash,
+                                    unsigned_comparison, unsigned_copy);
+  FAIL_IF(hashtable_set_inline_keys(&numbers, true),
+          "Turned on inline keys for a table that isn't keyed by strings.\n");
+
+  return 0;
+}
+
+int test_set_arena_keys() {
+  hashtable h = hashtable_new_string(sizeof(int));
+  hashtable_statistics stats;
+  char key[32];
+
+  /* Churn with few live keys: removed keys have to be given back. */
+  for (int i = 0; i < 20000; ++i) {
+    snprintf(key, sizeof(key), "churning key number %d", i);
+    hashtable_insert(&h, key, &i);
+    if (i >= 10) {
+      snprintf(key, sizeof(key), "churning key number %d", i - 10);
+      hashtable_remove(&h, key);
+    }
+  }
+  hashtable_stats(&h, &stats);
+  FAIL_IF(stats.size != 10 || stats.key_bytes != 0,
+          "A default string table kept %llu bytes of keys in an arena.\n",
+          (unsigned long long)stats.key_bytes);
+
+  FAIL_IF(hashtable_set_arena_keys(&h, true),
+          "Turned on arena keys for a table that has keys in it.\n");
+  hashtable_free(&h);
+
+  h = hashtable_new_string(sizeof(int));
+  FAIL_IF(!hashtable_set_arena_keys(&h, true),
+          "Couldn't turn on arena keys for an empty string table.\n");
+  int value = 1;
+  hashtable_insert(&h, "a key long enough to need the arena", &value);
+  hashtable_stats(&h, &stats);
+  FAIL_IF(stats.key_bytes == 0, "Arena keys didn't go in the arena.\n");
+  hashtable_free(&h);
+
+  hashtable numbers = hashtable_new(sizeof(unsigned), unsigned_hash,
+                                    unsigned_comparison, unsigned_copy);
+  FAIL_IF(hashtable_set_arena_keys(&numbers, true),
+          "Turned on arena keys for a table that isn't keyed by strings.\n");
+
+  return 0;
+}
+
+int test_value_alignment(hashtable h) {
+  char key[32];
+
+  for (int i = 0; i < 100; ++i) {
+    snprintf(key, sizeof(key), "key %d", i);
+    double value = i * 0.5;
+    hashtable_insert(&h, key, &value);
+  }
+  for (int i = 0; i < 100; ++i) {
+    snprintf(key, sizeof(key), "key %d", i);
+    double *value = hashtable_lookup(&h, key);
+    FAIL_IF(value == NULL || (uintptr_t)value % _Alignof(double) != 0 ||
+                *value != i * 0.5,
+            "Value of \"%s\" is missing or misaligned.\n", key);
+  }
+
+  hashtable_free(&h);
+
+  return 0;
+}
+
+hashtable incremental(hashtable h) {
+  hashtable_set_incremental_resize(&h, true);
+  return h;
+}
+
+hashtable crc32c_keyed(hashtable h) {
+  hashtable_set_string_hash(&h, hash_crc32c, 1234);
+  return h;
+}
+
+int test_set_string_hash() {
+  hashtable h = hashtable_new_string(sizeof(int));
+  int value = 1;
+
+  FAIL_IF(!hashtable_set_string_hash(&h, hash_crc32c, 0),
+          "Couldn't change the hash of an empty string table.\n");
+  hashtable_insert(&h, "key", &value);
+  FAIL_IF(hashtable_set_string_hash(&h, hash_wyhash, 0),
+          "Changed the hash of a string table that has keys in it.\n");
+  FAIL_IF(!hashtable_exists(&h, "key"),
+          "Hashtable lost a key after a refused hash change.\n");
+
+  hashtable_remove(&h, "key");
+  FAIL_IF(!hashtable_set_string_hash(&h, hash_wyhash, 0),
+          "Couldn't change the hash of an emptied string table.\n");
+  hashtable_insert(&h, "key", &value);
+  FAIL_IF(!hashtable_exists(&h, "key"),
+          "Hashtable lost a key after a hash change.\n");
+  hashtable_free(&h);
+
+  hashtable numbers = hashtable_new(sizeof(unsigned), unsigned_hash,
+                                    unsigned_comparison, unsigned_copy);
+  FAIL_IF(hashtable_set_string_hash(&numbers, hash_wyhash, 0),
+          "Changed the hash of a table that isn't keyed by strings.\n");
+
+  return 0;
+}
+
+int test_incremental_resize() {
+  hashtable h = incremental(hashtable_new(sizeof(unsigned), unsigned_hash,
+                                          unsigned_comparison, unsigned_copy));
+
+  /*
+   * Insert until a growth leaves a migration running.
+   */
+  unsigned count = 0;
+  while (h.old_data == NULL || h.old_capacity < 1024) {
+    hashtable_insert(&h, &count, &count);
+    count += 1;
+  }
+
+  unsigned visited = 0;
+  for (void *value = hashtable_iterate(&h, NULL); value != NULL;
+       value = hashtable_iterate(&h, value)) {
+    visited += 1;
+  }
+  FAIL_IF(visited != count,
+          "Hashtable iterate missed values during a migration.\n");
+
+  for (unsigned i = 0; i < count; ++i) {
+    FAIL_IF(!hashtable_exists(&h, &i),
+            "Hashtable lost a key during a migration.\n");
+  }
+
+  /*
+   * Remove every other key while both arrays are live.
+   */
+  for (unsigned i = 0; i < count; i += 2) {
+    hashtable_remove(&h, &i);
+  }
+
+  FAIL_IF(h.old_data != NULL,
+          "Hashtable migration never finished (%u of %u buckets).\n",
+          h.migrate_index, h.old_capacity);
+  FAIL_IF(h.size != count / 2, "Hashtable size is wrong after migration.\n");
+
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned *value = hashtable_lookup(&h, &i);
+    FAIL_IF((i % 2 == 0) != (value == NULL),
+            "Hashtable has the wrong keys after migration.\n");
+    FAIL_IF(value != NULL && *value != i,
+            "Hashtable has the wrong values after migration.\n");
+  }
+
+  hashtable_free(&h);
+
+  return 0;
+}
+
+/*
+ * Counts how often each of a few words shows up, the way aggregation code
+ * uses hashtable_find_or_insert.
+ */
+int test_find_or_insert(hashtable h) {
+  char const *words[] = {"a", "rose", "is", "a", "rose", "is", "a", "rose"};
+  unsigned word_count = sizeof(words) / sizeof(char *);
+  unsigned inserts = 0;
+
+  for (unsigned i = 0; i < word_count; ++i) {
+    bool inserted;
+    unsigned *count = hashtable_find_or_insert(&h, words[i], &inserted);
+    FAIL_IF(count == NULL, "hashtable_find_or_insert returned NULL.\n");
+    FAIL_IF(inserted && *count != 0,
+            "hashtable_find_or_insert didn't zero a new value.\n");
+    inserts += inserted;
+    *count += 1;
+  }
+
+  FAIL_IF(inserts != 3 || h.size != 3,
+          "hashtable_find_or_insert inserted %u keys.\n", inserts);
+  FAIL_IF(*(unsigned *)hashtable_lookup(&h, "a") != 3 ||
+              *(unsigned *)hashtable_lookup(&h, "rose") != 3 ||
+              *(unsigned *)hashtable_lookup(&h, "is") != 2,
+          "hashtable_find_or_insert counts are wrong.\n");
+
+  /* Enough new keys to grow the table a few times. */
+  dynamic_array word_list = make_word_list(2000);
+  for (unsigned i = 0; i < word_list.size; ++i) {
+    bool inserted;
+    char const *word = *(char **)dynamic_array_get_at(&word_list, i);
+    *(unsigned *)hashtable_find_or_insert(&h, word, &inserted) = i;
+    FAIL_IF(!inserted, "hashtable_find_or_insert didn't insert a new key.\n");
+  }
+  for (unsigned i = 0; i < word_list.size; ++i) {
+    bool inserted;
+    char const *word = *(char **)dynamic_array_get_at(&word_list, i);
+    unsigned *value = hashtable_find_or_insert(&h, word, &inserted);
+    FAIL_IF(inserted || *value != i,
+            "hashtable_find_or_insert lost a key after growing.\n");
+  }
+
+  /* Removed keys come back in the slots (or tombstones) the probe passes. */
+  for (unsigned i = 0; i < word_list.size; i += 2) {
+    hashtable_remove(&h, *(char **)dynamic_array_get_at(&word_list, i));
+  }
+  for (unsigned i = 0; i < word_list.size; ++i) {
+    bool inserted;
+    char const *word = *(char **)dynamic_array_get_at(&word_list, i);
+    unsigned *value = hashtable_find_or_insert(&h, word, &inserted);
+    FAIL_IF(inserted != (i % 2 == 0) || *value != (inserted ? 0 : i),
+            "hashtable_find_or_insert got a removed key wrong.\n");
+    *value = i;
+  }
+  FAIL_IF(h.size != word_list.size + 3,
+          "hashtable_find_or_insert reinserted the wrong number of keys.\n");
+  for (unsigned i = 0; i < word_list.size; ++i) {
+    unsigned *value = hashtable_lookup(
+        &h, *(char **)dynamic_array_get_at(&word_list, i));
+    FAIL_IF(value == NULL || *value != i,
+            "hashtable_find_or_insert lost a key after reinserting.\n");
+  }
+  free_word_list(word_list);
+
+  hashtable_free(&h);
+
+  return 0;
+}
+
+int test_reserve(hashtable h) {
+  unsigned count = 10000;
+
+  hashtable_reserve(&h, count);
+  uint32_t capacity = h.capacity;
+  FAIL_IF(h.data == NULL, "hashtable_reserve didn't allocate the table.\n");
+
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&h, &i, &i);
+  }
+  FAIL_IF(h.capacity != capacity,
+          "Hashtable grew from %u to %u after reserving room.\n", capacity,
+          h.capacity);
+
+  hashtable_reserve(&h, 10);
+  FAIL_IF(h.capacity != capacity, "hashtable_reserve shrank the table.\n");
+
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned *value = hashtable_lookup(&h, &i);
+    FAIL_IF(value == NULL || *value != i,
+            "Hashtable lost a key after reserving room.\n");
+  }
+
+  hashtable_free(&h);
+
+  return 0;
+}
+
+int test_stats(hashtable h) {
+  unsigned count = 3000;
+  hashtable_statistics stats;
+
+  hashtable_set_arena_keys(&h, true);
+  hashtable_set_counters(&h, true);
+  dynamic_array word_list = make_word_list(count);
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&h, *(char **)dynamic_array_get_at(&word_list, i), &i);
+  }
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_lookup(&h, *(char **)dynamic_array_get_at(&word_list, i));
+  }
+  hashtable_exists(&h, "not a key");
+
+  hashtable_stats(&h, &stats);
+  FAIL_IF(stats.size != count || stats.capacity != h.capacity,
+          "Hashtable stats has the wrong size.\n");
+  FAIL_IF(stats.load_factor <= 0.f || stats.load_factor > 1.f,
+          "Hashtable stats has a load factor of %f.\n",
+          (double)stats.load_factor);
+  FAIL_IF(stats.free_slots != h.capacity - count,
+          "Hashtable stats has %u free slots.\n", stats.free_slots);
+  FAIL_IF(stats.bucket_bytes == 0 || stats.key_bytes == 0,
+          "Hashtable stats is missing memory use.\n");
+
+  uint32_t elements = 0, homes = 0, placed = 0;
+  for (uint32_t i = 0; i < HASHTABLE_STATS_HISTOGRAM_SIZE; ++i) {
+    elements += i * stats.chain_lengths[i];
+    homes += stats.chain_lengths[i];
+    placed += stats.probe_distances[i];
+  }
+  /* The last entry also holds longer chains, so it can undercount. */
+  bool saturated = stats.chain_lengths[HASHTABLE_STATS_HISTOGRAM_SIZE - 1] != 0;
+  FAIL_IF(elements > count || (!saturated && elements != count) ||
+              placed != count,
+          "Hashtable stats histograms don't add up to the size.\n");
+  FAIL_IF(homes == 0 || homes > h.capacity,
+          "Hashtable stats found %u homes.\n", homes);
+
+  FAIL_IF(stats.counters.lookups != count + 1 || stats.counters.misses != 1,
+          "Hashtable counted %llu lookups and %llu misses.\n",
+          (unsigned long long)stats.counters.lookups,
+          (unsigned long long)stats.counters.misses);
+  FAIL_IF(stats.counters.resizes == 0,
+          "Hashtable didn't count its resizes.\n");
+
+  hashtable_set_counters(&h, false);
+  hashtable_lookup(&h, "not a key");
+  hashtable_stats(&h, &stats);
+  FAIL_IF(stats.counters.lookups != 0,
+          "Hashtable counted with counters off.\n");
+
+  free_word_list(word_list);
+  hashtable_free(&h);
+
+  hashtable_stats(&h, &stats);
+  FAIL_IF(stats.size != 0 || stats.bucket_bytes != 0 || stats.key_bytes != 0,
+          "Freed hashtable has stats.\n");
+
+  return 0;
+}
+
+uint32_t constant_hash(void const *key) {
+  (void)key;
+  return 7;
+}
+
+/*
+ * Every key has the same hash, so displacements grow well past what fits in
+ * the Robin Hood engine's distance bytes.
+ */
+int test_identical_hashes(hashtable h) {
+  unsigned count = 600;
+
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&h, &i, &i);
+  }
+  FAIL_IF(hashtable_max_probe_length(&h) != count,
+          "Max probe length is %u with %u identical hashes.\n",
+          hashtable_max_probe_length(&h), count);
+
+  for (unsigned i = 0; i < count; i += 2) {
+    hashtable_remove(&h, &i);
+  }
+
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned *value = hashtable_lookup(&h, &i);
+    FAIL_IF((i % 2 == 0) != (value == NULL),
+            "Hashtable has the wrong keys with identical hashes.\n");
+    FAIL_IF(value != NULL && *value != i,
+            "Hashtable has the wrong values with identical hashes.\n");
+  }
+
+  hashtable_free(&h);
+
+  return 0;
+}
+
+int test_max_probe_length(hashtable h, uint32_t limit) {
+  unsigned count = 50000;
+
+  FAIL_IF(hashtable_max_probe_length(&h) != 0,
+          "Empty hashtable has a probe length.\n");
+
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&h, &i, &i);
+  }
+
+  uint32_t longest = hashtable_max_probe_length(&h);
+  FAIL_IF(longest == 0 || longest > limit,
+          "Max probe length is %u after %u inserts.\n", longest, count);
+
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_remove(&h, &i);
+  }
+  FAIL_IF(hashtable_max_probe_length(&h) != 0,
+          "Emptied hashtable has a probe length.\n");
+
+  hashtable_free(&h);
+
+  return 0;
+}
+
+int test_filter(hashtable h) {
+  unsigned count = 20000;
+
+  hashtable_set_filter(&h, true);
+  FAIL_IF(h.filter == NULL, "hashtable_set_filter didn't make a filter.\n");
+
+  for (unsigned i = 0; i < count; ++i) {
+    hashtable_insert(&h, &i, &i);
+  }
+  for (unsigned i = 0; i < count; i += 2) {
+    hashtable_remove(&h, &i);
+  }
+
+  unsigned missing = count * 2;
+  hashtable_remove(&h, &missing);
+  FAIL_IF(h.size != count / 2, "Size is %u after removes.\n", h.size);
+
+  for (unsigned i = 0; i < count * 2; ++i) {
+    unsigned *value = hashtable_lookup(&h, &i);
+    bool expected = i < count && i % 2 == 1;
+    FAIL_IF((value != NULL) != expected || hashtable_exists(&h, &i) != expected,
+            "Filtered table is wrong about %u.\n", i);
+    FAIL_IF(value != NULL && *value != i, "Wrong value for %u.\n", i);
+  }
+  FAIL_IF(h.filter == NULL || h.filter->size != h.size,
+          "Filter holds %u keys for %u elements.\n",
+          h.filter ? h.filter->size : 0, h.size);
+
+  bool inserted;
+  hashtable_find_or_insert(&h, &missing, &inserted);
+  FAIL_IF(!inserted || !hashtable_exists(&h, &missing),
+          "find_or_insert didn't update the filter.\n");
+
+  /* A key repeated past what the filter can hold turns the filter off. */
+  unsigned repeated = 7;
+  for (unsigned i = 0; i < 20; ++i) {
+    hashtable_insert(&h, &repeated, &i);
+  }
+  FAIL_IF(h.filter != NULL, "Filter kept 21 copies of a key.\n");
+  FAIL_IF(!hashtable_exists(&h, &repeated), "Lost the repeated key.\n");
+
+  hashtable_free(&h);
+
+  return 0;
+}
+
+int test_lookup_bytes(hashtable h) {
+  char const *words[] = {"alpha", "beta", "gamma", "alphabet", ""};
+  unsigned word_count = sizeof(words) / sizeof(char *);
+
+  for (unsigned i = 0; i < word_count; ++i) {
+    hashtable_insert(&h, words[i], &i);
+  }
+
+  /* Tokens in the middle of a buffer, with no NUL after them. */
+  char const buffer[] = "alphabeta gamma";
+  unsigned *value = hashtable_lookup_bytes(&h, buffer, 5);
+  FAIL_IF(value == NULL || *value != 0, "Failed to find \"alpha\".\n");
+  value = hashtable_lookup_bytes(&h, buffer + 5, 4);
+  FAIL_IF(value == NULL || *value != 1, "Failed to find \"beta\".\n");
+  value = hashtable_lookup_bytes(&h, buffer, 8);
+  FAIL_IF(value == NULL || *value != 3, "Failed to find \"alphabet\".\n");
+  value = hashtable_lookup_bytes(&h, buffer, 0);
+  FAIL_IF(value == NULL || *value != 4, "Failed to find the empty key.\n");
+
+  FAIL_IF(hashtable_exists_bytes(&h, buffer, 4) ||
+              hashtable_exists_bytes(&h, buffer, 9) ||
+              hashtable_exists_bytes(&h, "gamm\0", 5),
+          "Found a prefix or extension of a key.\n");
+
+  string line = string_wrap_cstring("  gamma \n");
+  string cutset = string_wrap_cstring(" \n");
+  string_range token = string_trim(&line, &cutset);
+  value = hashtable_lookup_range(&h, &token);
+  FAIL_IF(value == NULL || *value != 2, "Failed to find a trimmed token.\n");
+  FAIL_IF(!hashtable_exists_range(&h, &token),
+          "hashtable_exists_range missed a trimmed token.\n");
+
+  hashtable_remove_range(&h, &token);
+  hashtable_remove_bytes(&h, buffer, 4);
+  hashtable_remove_bytes(&h, buffer, 5);
+  FAIL_IF(h.size != word_count - 2 || hashtable_exists(&h, "gamma") ||
+              hashtable_exists(&h, "alpha") ||
+              !hashtable_exists(&h, "alphabet"),
+          "Remove by bytes removed the wrong keys.\n");
+
+  hashtable_free(&h);
+
+  hashtable numbers = hashtable_new(sizeof(unsigned), unsigned_hash,
+                                    unsigned_comparison, unsigned_copy);
+  unsigned key = 0x61;
+  hashtable_insert(&numbers, &key, &key);
+  FAIL_IF(hashtable_lookup_bytes(&numbers, "a", 1) != NULL,
+          "Looked up bytes in a table that isn't keyed by strings.\n");
+  hashtable_free(&numbers);
+
+  return 0;
+}
+
+test_allocator_counts counts;
+fennec_allocator counting;
+
+hashtable counted(hashtable h) {
+  hashtable_set_allocator(&h, &counting);
+  return h;
+}
+
+int test_allocator(hashtable h) {
+  counts = (test_allocator_counts){0, 0, 0};
+
+  for (unsigned i = 0; i < 5000; ++i) {
+    char buffer[64];
+    sprintf(buffer, "a key that is too long to be inline %u", i);
+    hashtable_insert(&h, buffer, &i);
+  }
+  for (unsigned i = 0; i < 5000; i += 2) {
+    char buffer[64];
+    sprintf(buffer, "a key that is too long to be inline %u", i);
+    hashtable_remove(&h, buffer);
+  }
+  hashtable_shrink(&h);
+
+  FAIL_IF(counts.allocations == 0 || h.size != 2500 ||
+              !hashtable_exists(&h, "a key that is too long to be inline 1"),
+          "Table didn't use its allocator.\n");
+  FAIL_IF(hashtable_set_allocator(&h, NULL),
+          "Changed the allocator of a table that has elements.\n");
+
+  hashtable_free(&h);
+  FAIL_IF(counts.live_bytes != 0 || counts.wrong_sizes != 0,
+          "Table gave back %u blocks with the wrong size and leaked %llu "
+          "bytes.\n",
+          counts.wrong_sizes, (unsigned long long)counts.live_bytes);
+
+  return 0;
+}
+
+/*
+ * The engines every table test runs on: constructors for tables keyed by
+ * unsigned and by strings, and the longest probe the engine allows
+ * (UINT32_MAX if it doesn't bound them).
+ */
+typedef struct {
+  hashtable (*new)(uint32_t object_size, hash_function_type hash_function,
+                   hash_comparison_function_type comparison_function,
+                   hash_key_copy_function_type copy_function);
+  hashtable (*new_string)(uint32_t object_size);
+  uint32_t max_probe_length;
+} test_engine;
+
+hashtable incremental_new(uint32_t object_size,
+                          hash_function_type hash_function,
+                          hash_comparison_function_type comparison_function,
+                          hash_key_copy_function_type copy_function) {
+  return incremental(hashtable_new(object_size, hash_function,
+                                   comparison_function, copy_function));
+}
+
+hashtable incremental_new_string(uint32_t object_size) {
+  return incremental(hashtable_new_string(object_size));
+}
+
+hashtable unsigned_table(test_engine const *engine) {
+  return engine->new(sizeof(unsigned), unsigned_hash, unsigned_comparison,
+                     unsigned_copy);
+}
+
 int main(void) {
-  RETURN_IF_FAILED(test_basic());
-  RETURN_IF_FAILED(test_lookup_remove_and_shrink());
+  test_engine const engines[] = {
+      {hashtable_new, hashtable_new_string, UINT32_MAX},
+      {incremental_new, incremental_new_string, UINT32_MAX},
+      {hashtable_new_flat, hashtable_new_flat_string, UINT32_MAX},
+      {hashtable_new_robin_hood, hashtable_new_robin_hood_string, 64},
+  };
+
+  counting = test_counting_allocator(&counts);
+
+  for (size_t i = 0; i < sizeof(engines) / sizeof(test_engine); ++i) {
+    test_engine const *engine = &engines[i];
+
+    RETURN_IF_FAILED(test_basic(engine->new_string(sizeof(int))));
+    RETURN_IF_FAILED(
+        test_lookup_remove_and_shrink(engine->new_string(sizeof(unsigned))));
+    RETURN_IF_FAILED(test_iterate(unsigned_table(engine)));
+    RETURN_IF_FAILED(test_remove_churn(unsigned_table(engine)));
+    RETURN_IF_FAILED(test_cached_hashes(
+        engine->new(sizeof(unsigned), counted_colliding_hash,
+                    counted_comparison, unsigned_copy)));
+    RETURN_IF_FAILED(test_batch(unsigned_table(engine)));
+    RETURN_IF_FAILED(test_key_storage(engine->new_string(sizeof(unsigned))));
+    RETURN_IF_FAILED(test_key_storage(
+        inline_keyed(engine->new_string(sizeof(unsigned)))));
+    RETURN_IF_FAILED(
+        test_save_and_open_mapped(engine->new_string(sizeof(unsigned))));
+    RETURN_IF_FAILED(test_save_and_open_mapped(
+        inline_keyed(engine->new_string(sizeof(unsigned)))));
+    RETURN_IF_FAILED(test_max_probe_length(unsigned_table(engine),
+                                           engine->max_probe_length));
+    RETURN_IF_FAILED(test_find_or_insert(engine->new_string(sizeof(unsigned))));
+    RETURN_IF_FAILED(test_reserve(unsigned_table(engine)));
+    RETURN_IF_FAILED(test_value_alignment(engine->new_string(sizeof(double))));
+    RETURN_IF_FAILED(test_stats(engine->new_string(sizeof(unsigned))));
+    RETURN_IF_FAILED(test_filter(unsigned_table(engine)));
+    RETURN_IF_FAILED(test_lookup_bytes(engine->new_string(sizeof(unsigned))));
+    RETURN_IF_FAILED(
+        test_allocator(counted(engine->new_string(sizeof(unsigned)))));
+  }
+
+  RETURN_IF_FAILED(test_set_inline_keys());
+  RETURN_IF_FAILED(test_set_arena_keys());
+  RETURN_IF_FAILED(test_set_string_hash());
+  RETURN_IF_FAILED(test_incremental_resize());
+  RETURN_IF_FAILED(test_open_mapped_failures());
+  RETURN_IF_FAILED(test_open_mapped_corrupted());
+  RETURN_IF_FAILED(test_basic(crc32c_keyed(hashtable_new_string(sizeof(int)))));
+  RETURN_IF_FAILED(test_lookup_remove_and_shrink(
+      crc32c_keyed(hashtable_new_flat_string(sizeof(unsigned)))));
+  RETURN_IF_FAILED(test_save_and_open_mapped(
+      crc32c_keyed(hashtable_new_flat_string(sizeof(unsigned)))));
+  RETURN_IF_FAILED(test_identical_hashes(hashtable_new_robin_hood(
+      sizeof(unsigned), constant_hash, unsigned_comparison, unsigned_copy)));
+  RETURN_IF_FAILED(test_reserve(hashtable_reserved_new(
+      sizeof(unsigned), 100, unsigned_hash, unsigned_comparison,
+      unsigned_copy)));
+  RETURN_IF_FAILED(test_allocator(hashtable_new_string_with_allocator(
+      sizeof(unsigned), &counting)));
   return 0;
 }
@@ -0,0 +1,97 @@
+#include "data_structures/large_array.h"
+#include "utilities/test_helpers.h"
+#include <stdio.h>
+
+int test_basic() {
+  large_array a = large_array_new(sizeof(uint64_t), 0);
+
+  for (uint64_t i = 0; i < 1000; ++i) {
+    large_array_push_back(&a, &i);
+  }
+  FAIL_IF(a.mapped, "A small array was mapped.\n");
+
+  /* Past LARGE_ARRAY_MAP_THRESHOLD, moving to a mapping and growing it. */
+  uint64_t count = 3 * LARGE_ARRAY_MAP_THRESHOLD / sizeof(uint64_t);
+  for (uint64_t i = 1000; i < count; ++i) {
+    large_array_push_back(&a, &i);
+  }
+  FAIL_IF(!a.mapped || a.reserved_bytes % 4096 != 0,
+          "A big array wasn't mapped in whole pages.\n");
+  for (uint64_t i = 0; i < count; ++i) {
+    FAIL_IF(*(uint64_t *)large_array_get_at(&a, i) != i,
+            "Element %llu is wrong.\n", (unsigned long long)i);
+  }
+  FAIL_IF(large_array_get_at(&a, count) != NULL,
+          "An index past the end didn't return NULL.\n");
+
+  large_array_pop_back(&a);
+  FAIL_IF(*(uint64_t *)large_array_get_back(&a) != count - 2,
+          "Pop didn't remove the last element.\n");
+
+  large_array_free(&a);
+  FAIL_IF(a.data != NULL || a.size != 0, "Free didn't reset the array.\n");
+
+  return 0;
+}
+
+int test_shrink() {
+  large_array a =
+      large_array_new(sizeof(uint32_t), large_array_flag_huge_pages);
+
+  large_array_resize(&a, 4 * LARGE_ARRAY_HUGE_PAGE_SIZE / sizeof(uint32_t));
+  FAIL_IF(!a.mapped || a.reserved_bytes % LARGE_ARRAY_HUGE_PAGE_SIZE != 0,
+          "A huge page array wasn't rounded to huge pages.\n");
+  for (uint64_t i = 0; i < a.size; ++i) {
+    ((uint32_t *)a.data)[i] = (uint32_t)i;
+  }
+
+  large_array_resize(&a, LARGE_ARRAY_HUGE_PAGE_SIZE / sizeof(uint32_t) + 1);
+  large_array_shrink(&a);
+  FAIL_IF(a.reserved_bytes != 2 * LARGE_ARRAY_HUGE_PAGE_SIZE,
+          "Shrink kept %llu bytes mapped.\n",
+          (unsigned long long)a.reserved_bytes);
+  FAIL_IF(*(uint32_t *)large_array_get_back(&a) != a.size - 1,
+          "Shrink lost elements.\n");
+
+  large_array_resize(&a, 100);
+  large_array_shrink(&a);
+  FAIL_IF(a.mapped || a.capacity != 100 || ((uint32_t *)a.data)[99] != 99,
+          "A shrunk small array wasn't moved back to malloc.\n");
+
+  large_array_clear(&a);
+  large_array_shrink(&a);
+  FAIL_IF(a.data != NULL || a.reserved_bytes != 0,
+          "Shrinking an empty array kept its memory.\n");
+
+  return 0;
+}
+
+int test_past_4_gib() {
+  /* 4.5 GiB of address space, only the touched pages are ever backed. */
+  uint64_t object_size = 4096;
+  uint64_t count = (9ull << 29) / object_size;
+  large_array a = large_array_new(object_size, 0);
+
+  large_array_resize(&a, count);
+  FAIL_IF(a.data == NULL || a.reserved_bytes < count * object_size,
+          "Couldn't reserve 4.5 GiB.\n");
+
+  char *last = large_array_get_at(&a, count - 1);
+  FAIL_IF(last != a.data + (count - 1) * object_size,
+          "The last element's address overflowed.\n");
+  memset(last, 7, object_size);
+  memset(large_array_get_at(&a, 0), 1, object_size);
+  FAIL_IF(*(char *)large_array_get_back(&a) != 7 || *a.data != 1,
+          "Elements past 4 GiB didn't keep their values.\n");
+
+  large_array_free(&a);
+
+  return 0;
+}
+
+int main(void) {
+  RETURN_IF_FAILED(test_basic());
+  RETURN_IF_FAILED(test_shrink());
+  RETURN_IF_FAILED(test_past_4_gib());
+  return 0;
+}
@@ -0,0 +1,172 @@
+#include "data_structures/perfect_hashtable.h"
+#include "utilities/test_helpers.h"
+#include <stdio.h>
+
+char **make_keys(unsigned count) {
+  char **keys = malloc(sizeof(char *) * (count + 1));
+
+  for (unsigned i = 0; i < count; ++i) {
+    char buffer[64];
+    sprintf(buffer, "test string %u", i);
+    keys[i] = strdup(buffer);
+  }
+
+  return keys;
+}
+
+void free_keys(char **keys, unsigned count) {
+  for (unsigned i = 0; i < count; ++i) {
+    free(keys[i]);
+  }
+  free(keys);
+}
+
+int check_contents(perfect_hashtable *table, char **keys, unsigned count) {
+  FAIL_IF(table->size != count, "Perfect hashtable has the wrong size.\n");
+
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned *value = perfect_hashtable_lookup(table, keys[i]);
+    FAIL_IF(value == NULL, "Perfect hashtable failed to find \"%s\".\n",
+            keys[i]);
+    FAIL_IF(*value != i, "Perfect hashtable value is wrong.\n");
+  }
+
+  FAIL_IF(perfect_hashtable_exists(table, "not a key"),
+          "Perfect hashtable found a missing key.\n");
+  FAIL_IF(perfect_hashtable_exists(table, ""),
+          "Perfect hashtable found the empty string.\n");
+
+  return 0;
+}
+
+int test_new() {
+  unsigned sizes[] = {1, 2, 3, 100, 10000};
+
+  for (unsigned s = 0; s < sizeof(sizes) / sizeof(unsigned); ++s) {
+    unsigned count = sizes[s];
+    char **keys = make_keys(count);
+    unsigned *values = malloc(sizeof(unsigned) * count);
+    for (unsigned i = 0; i < count; ++i) {
+      values[i] = i;
+    }
+
+    perfect_hashtable table = perfect_hashtable_new(
+        (char const *const *)keys, values, count, sizeof(unsigned));
+    RETURN_IF_FAILED(check_contents(&table, keys, count));
+
+    /* Only the length of one stored key is right for these, not the bytes. */
+    FAIL_IF(perfect_hashtable_exists(&table, "test string "),
+            "Perfect hashtable found a prefix of a key.\n");
+    FAIL_IF(perfect_hashtable_exists(&table, "test string 0 and more"),
+            "Perfect hashtable found a key with a suffix.\n");
+
+    perfect_hashtable_free(&table);
+    FAIL_IF(table.size != 0 || table.entries != NULL,
+            "perfect_hashtable_free didn't empty the table.\n");
+
+    free(values);
+    free_keys(keys, count);
+  }
+
+  return 0;
+}
+
+int test_repeated_keys() {
+  char const *keys[] = {"apple", "pear", "apple", "plum", "pear"};
+  unsigned values[] = {1, 2, 3, 4, 5};
+
+  perfect_hashtable table =
+      perfect_hashtable_new(keys, values, 5, sizeof(unsigned));
+  FAIL_IF(table.size != 3, "Repeated keys weren't merged.\n");
+  FAIL_IF(*(unsigned *)perfect_hashtable_lookup(&table, "apple") != 1,
+          "A repeated key didn't keep its first value.\n");
+  FAIL_IF(*(unsigned *)perfect_hashtable_lookup(&table, "pear") != 2,
+          "A repeated key didn't keep its first value.\n");
+  FAIL_IF(*(unsigned *)perfect_hashtable_lookup(&table, "plum") != 4,
+          "Perfect hashtable value is wrong.\n");
+  perfect_hashtable_free(&table);
+
+  return 0;
+}
+
+int test_empty() {
+  perfect_hashtable table =
+      perfect_hashtable_new(NULL, NULL, 0, sizeof(unsigned));
+  FAIL_IF(table.size != 0, "Empty perfect hashtable has elements.\n");
+  FAIL_IF(perfect_hashtable_lookup(&table, "key") != NULL,
+          "Empty perfect hashtable found a key.\n");
+  perfect_hashtable_free(&table);
+
+  return 0;
+}
+
+int test_from_hashtable() {
+  unsigned count = 5000;
+  char **keys = make_keys(count);
+  hashtable tables[] = {hashtable_new_string(sizeof(unsigned)),
+                        hashtable_new_flat_string(sizeof(unsigned))};
+
+  for (unsigned t = 0; t < sizeof(tables) / sizeof(hashtable); ++t) {
+    for (unsigned i = 0; i < count; ++i) {
+      hashtable_insert(&tables[t], keys[i], &i);
+    }
+    hashtable_remove(&tables[t], keys[count - 1]);
+
+    perfect_hashtable table = perfect_hashtable_from_hashtable(&tables[t]);
+    RETURN_IF_FAILED(check_contents(&table, keys, count - 1));
+    FAIL_IF(perfect_hashtable_exists(&table, keys[count - 1]),
+            "Perfect hashtable found a removed key.\n");
+    perfect_hashtable_free(&table);
+  }
+
+  string path = string_wrap_cstring("perfect_hashtable_tests.bin");
+  FAIL_IF(!hashtable_save(&tables[0], &path), "hashtable_save failed.\n");
+  hashtable mapped = hashtable_open_mapped(&path);
+  perfect_hashtable table = perfect_hashtable_from_hashtable(&mapped);
+  RETURN_IF_FAILED(check_contents(&table, keys, count - 1));
+  perfect_hashtable_free(&table);
+  hashtable_free(&mapped);
+  remove(path.data);
+
+  hashtable_free(&tables[0]);
+  hashtable_free(&tables[1]);
+  free_keys(keys, count);
+
+  return 0;
+}
+
+static uint32_t int_hash(void const *key) { return *(uint32_t const *)key; }
+
+static bool int_comparison(void const *key1, void const *key2) {
+  return *(uint32_t const *)key1 == *(uint32_t const *)key2;
+}
+
+static void *int_copy(void const *key) {
+  uint32_t *copy = malloc(sizeof(uint32_t));
+  *copy = *(uint32_t const *)key;
+  return copy;
+}
+
+int test_from_non_string_hashtable() {
+  hashtable h = hashtable_new(sizeof(unsigned), int_hash, int_comparison,
+                              int_copy);
+  uint32_t key = 7;
+  hashtable_insert(&h, &key, &key);
+
+  perfect_hashtable table = perfect_hashtable_from_hashtable(&h);
+  FAIL_IF(table.size != 0,
+          "Perfect hashtable was built from a table without string keys.\n");
+  perfect_hashtable_free(&table);
+  hashtable_free(&h);
+
+  return 0;
+}
+
+int main(void) {
+  RETURN_IF_FAILED(test_new());
+  RETURN_IF_FAILED(test_repeated_keys());
+  RETURN_IF_FAILED(test_empty());
+  RETURN_IF_FAILED(test_from_hashtable());
+  RETURN_IF_FAILED(test_from_non_string_hashtable());
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include "data_structures/segmented_array.h"
+#include "utilities/test_helpers.h"
+#include <stdio.h>
+
+int test_basic() {
+  segmented_array a = segmented_array_new(sizeof(uint32_t), 100);
+  FAIL_IF(a.chunk_shift != 7, "Chunk length 100 wasn't rounded up to 128.\n");
+
+  uint32_t *first = NULL;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    uint32_t *element = segmented_array_push_back(&a, &i);
+    first = i == 0 ? element : first;
+  }
+  FAIL_IF(a.size != 1000 || a.chunks.size != 8,
+          "Array has %u elements in %u chunks, not 1000 in 8.\n", a.size,
+          a.chunks.size);
+  FAIL_IF(segmented_array_get_at(&a, 0) != first || *first != 0,
+          "The first element moved while the array grew.\n");
+
+  for (uint32_t i = 0; i < 1000; ++i) {
+    FAIL_IF(*(uint32_t *)segmented_array_get_at(&a, i) != i,
+            "Element %u is wrong.\n", i);
+  }
+
+  segmented_array_pop_back(&a);
+  FAIL_IF(*(uint32_t *)segmented_array_get_back(&a) != 998,
+          "Pop didn't remove the last element.\n");
+
+  segmented_array_clear(&a);
+  FAIL_IF(segmented_array_get_back(&a) != NULL || a.chunks.size != 8,
+          "Clear didn't empty the array or dropped its chunks.\n");
+  segmented_array_shrink(&a);
+  FAIL_IF(a.chunks.size != 0, "Shrink kept %u chunks.\n", a.chunks.size);
+
+  segmented_array_free(&a);
+
+  return 0;
+}
+
+int test_chunks() {
+  segmented_array a = segmented_array_new(sizeof(double), 0);
+  FAIL_IF((sizeof(double) << a.chunk_shift) !=
+              SEGMENTED_ARRAY_DEFAULT_CHUNK_BYTES,
+          "Default chunks aren't SEGMENTED_ARRAY_DEFAULT_CHUNK_BYTES.\n");
+
+  uint32_t count = 20000;
+  double *values = malloc(sizeof(double) * count);
+  for (uint32_t i = 0; i < count; ++i) {
+    values[i] = i * 0.25;
+  }
+  segmented_array_push_back(&a, &values[0]);
+  segmented_array_push_back_n(&a, values + 1, count - 1);
+
+  uint32_t seen = 0;
+  for (uint32_t chunk = 0; chunk < segmented_array_chunk_count(&a); ++chunk) {
+    uint32_t length;
+    double *elements = segmented_array_get_chunk(&a, chunk, &length);
+    for (uint32_t i = 0; i < length; ++i) {
+      FAIL_IF(elements[i] != values[seen + i],
+              "Chunk %u element %u is wrong.\n", chunk, i);
+    }
+    seen += length;
+  }
+  FAIL_IF(seen != count, "Chunks held %u elements, not %u.\n", seen, count);
+
+  free(values);
+  segmented_array_free(&a);
+
+  return 0;
+}
+
+int test_allocator() {
+  test_allocator_counts counts = {0, 0, 0};
+  fennec_allocator allocator = test_counting_allocator(&counts);
+  segmented_array a =
+      segmented_array_new_with_allocator(sizeof(uint64_t), 64, &allocator);
+
+  segmented_array_reserve(&a, 1000);
+  for (uint64_t i = 0; i < 1000; ++i) {
+    segmented_array_push_back(&a, &i);
+  }
+  FAIL_IF(counts.live_bytes < 1000 * sizeof(uint64_t),
+          "Array didn't get its chunks from its allocator.\n");
+
+  segmented_array_free(&a);
+  FAIL_IF(counts.live_bytes != 0 || counts.wrong_sizes != 0,
+          "Array leaked %llu bytes or gave back wrong sizes.\n",
+          (unsigned long long)counts.live_bytes);
+
+  return 0;
+}
+
+int main(void) {
+  RETURN_IF_FAILED(test_basic());
+  RETURN_IF_FAILED(test_chunks());
+  RETURN_IF_FAILED(test_allocator());
+  return 0;
+}
@@ -140,6 +140,58 @@ int test_string_replace() {
   return 0;
 }
 
+int test_string_trim() {
+  string s = string_wrap_cstring("  token \t");
+  string cutset = string_wrap_cstring(" \t");
+
+  string_range trimmed = string_trim(&s, &cutset);
+  FAIL_IF(trimmed.start != 2 || trimmed.end != 7,
+          "String trim returned [%u, %u) instead of [2, 7).\n", trimmed.start,
+          trimmed.end);
+
+  trimmed = string_trim_left(&s, &cutset);
+  FAIL_IF(trimmed.start != 2 || trimmed.end != s.length,
+          "String trim left returned the wrong range.\n");
+
+  trimmed = string_trim_right(&s, &cutset);
+  FAIL_IF(trimmed.start != 0 || trimmed.end != 7,
+          "String trim right returned the wrong range.\n");
+
+  string blank = string_wrap_cstring(" \t ");
+  trimmed = string_trim(&blank, &cutset);
+  FAIL_IF(trimmed.start != trimmed.end,
+          "Trimming a blank string left characters.\n");
+  trimmed = string_trim_right(&blank, &cutset);
+  FAIL_IF(trimmed.start != trimmed.end,
+          "Trimming the right of a blank string left characters.\n");
+
+  return 0;
+}
+
+int test_string_allocator() {
+  test_allocator_counts counts = {0, 0, 0};
+  fennec_allocator allocator = test_counting_allocator(&counts);
+
+  string s = string_new_with_allocator("hello", &allocator);
+  string world = string_wrap_cstring(" world");
+  string_append(&s, &world);
+  FAIL_IF(strcmp(s.data, "hello world") != 0 || counts.allocations != 2 ||
+              counts.live_bytes != s.capacity,
+          "String didn't get its memory from its allocator.\n");
+
+  string_free(&s);
+  FAIL_IF(counts.live_bytes != 0 || counts.wrong_sizes != 0,
+          "String gave back the wrong number of bytes.\n");
+
+  string wrapped = string_wrap_cstring("hello");
+  string_append(&wrapped, &world);
+  FAIL_IF(strcmp(wrapped.data, "hello world") != 0,
+          "Appending to a wrapped C string failed.\n");
+  string_free(&wrapped);
+
+  return 0;
+}
+
 int main(void) {
   RETURN_IF_FAILED(test_string_append());
   RETURN_IF_FAILED(test_string_find_first());
@@ -148,5 +200,7 @@ int main(void) {
   RETURN_IF_FAILED(test_string_find_last_any());
   RETURN_IF_FAILED(test_string_join());
   RETURN_IF_FAILED(test_string_replace());
+  RETURN_IF_FAILED(test_string_trim());
+  RETURN_IF_FAILED(test_string_allocator());
   return 0;
 }
@@ -0,0 +1,121 @@
+#include "data_structures/typed_array.h"
+#include "utilities/test_helpers.h"
+#include <stdio.h>
+
+typedef struct {
+  float x, y, z;
+} point;
+
+FENNEC_DEFINE_ARRAY(int_array, int)
+FENNEC_DEFINE_ARRAY(point_array, point)
+
+int test_basic() {
+  int_array a = int_array_new();
+
+  FAIL_IF(!int_array_is_empty(&a) || int_array_get_back(&a) != NULL,
+          "Array incorrectly reports itself as non-empty.\n");
+
+  for (int i = 0; i < 1000; ++i) {
+    int_array_push_back(&a, i * 3);
+  }
+  FAIL_IF(a.size != 1000 || a.object_size != sizeof(int),
+          "Array doesn't correctly update size.\n");
+
+  int expected = 0;
+  for (int *it = int_array_begin(&a); it != int_array_end(&a); ++it) {
+    FAIL_IF(*it != expected, "Ordering of array is wrong.\n");
+    expected += 3;
+  }
+  FAIL_IF(*int_array_get_front(&a) != 0 || *int_array_get_back(&a) != 2997 ||
+              int_array_get_at(&a, 1000) != NULL,
+          "Array accessors returned the wrong elements.\n");
+
+  int_array_remove(&a, 0);
+  int_array_pop_back(&a);
+  FAIL_IF(a.size != 998 || *int_array_get_front(&a) != 3 ||
+              *int_array_get_back(&a) != 2994,
+          "Array remove didn't update the array.\n");
+
+  int more[] = {1, 2, 3};
+  int_array_push_back_n(&a, more, 3);
+  FAIL_IF(a.size != 1001 || *int_array_get_back(&a) != 3,
+          "Array bulk append failed.\n");
+
+  int_array_shrink(&a);
+  FAIL_IF(a.capacity != a.size, "Array shrink didn't fit the elements.\n");
+
+  int_array_free(&a);
+
+  return 0;
+}
+
+/*
+ * Converting to a dynamic_array and back keeps the same elements and
+ * storage.
+ */
+int test_conversion() {
+  point_array a = point_array_reserved_new(10);
+
+  for (unsigned i = 0; i < 100; ++i) {
+    point p = {(float)i, (float)i * 2, (float)i * 3};
+    point_array_push_back(&a, p);
+  }
+
+  dynamic_array generic = point_array_to_dynamic_array(a);
+  FAIL_IF(generic.size != 100 || generic.object_size != sizeof(point),
+          "Converted array has the wrong size.\n");
+
+  point extra = {-1, -2, -3};
+  dynamic_array_push_back(&generic, &extra);
+  for (unsigned i = 0; i < 100; ++i) {
+    point *p = dynamic_array_get_at(&generic, i);
+    FAIL_IF(p->x != (float)i || p->z != (float)i * 3,
+            "Converted array has the wrong element at %u.\n", i);
+  }
+
+  a = point_array_from_dynamic_array(generic);
+  FAIL_IF(a.size != 101 || point_array_get_back(&a)->y != -2,
+          "Array lost an element pushed while it was generic.\n");
+
+  point_array_free(&a);
+
+  return 0;
+}
+
+static bool is_odd(int const *value, void *context) {
+  (void)context;
+  return *value % 2 != 0;
+}
+
+int test_remove_many() {
+  int_array a = int_array_new();
+  for (int i = 0; i < 10; ++i) {
+    int_array_push_back(&a, i);
+  }
+
+  int_array_swap_remove(&a, 0);
+  FAIL_IF(a.size != 9 || a.data[0] != 9, "Swap remove left %d first.\n",
+          a.data[0]);
+
+  uint32_t removed = int_array_remove_if(&a, is_odd, NULL);
+  int evens[] = {2, 4, 6, 8};
+  FAIL_IF(removed != 5 || a.size != 4 ||
+              memcmp(a.data, evens, sizeof(evens)) != 0,
+          "Remove if left the wrong elements.\n");
+
+  uint32_t indices[] = {1, 3};
+  removed = int_array_remove_indices(&a, indices, 2);
+  FAIL_IF(removed != 2 || a.size != 2 || a.data[0] != 2 || a.data[1] != 6,
+          "Remove indices left the wrong elements.\n");
+
+  int_array_free(&a);
+
+  return 0;
+}
+
+int main(void) {
+  RETURN_IF_FAILED(test_basic());
+  RETURN_IF_FAILED(test_conversion());
+  RETURN_IF_FAILED(test_remove_many());
+  return 0;
+}
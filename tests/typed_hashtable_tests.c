@@ -0,0 +1,195 @@
+#include "data_structures/hashtable.h"
+#include "data_structures/typed_hashtable.h"
+#include "utilities/test_helpers.h"
+#include <stdio.h>
+#include <string.h>
+
+#define uint_hash(key) (key)
+#define uint_eq(key1, key2) ((key1) == (key2))
+
+FENNEC_DEFINE_HASHTABLE(uint_table, unsigned, unsigned, uint_hash, uint_eq)
+FENNEC_DEFINE_STRING_HASHTABLE(word_table, unsigned)
+
+#define constant_hash(key) ((void)(key), 7u)
+FENNEC_DEFINE_HASHTABLE(colliding_table, unsigned, unsigned, constant_hash,
+                        uint_eq)
+
+static uint32_t unsigned_hash(void const *key) { return *(unsigned *)key; }
+
+static bool unsigned_comparison(void const *key1, void const *key2) {
+  return *(unsigned *)key1 == *(unsigned *)key2;
+}
+
+static void *unsigned_copy(void const *key) {
+  unsigned *copy = malloc(sizeof(unsigned));
+  *copy = *(unsigned *)key;
+  return copy;
+}
+
+static uint32_t next_random(uint32_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+int test_basic(void) {
+  char const *strings[] = {"hello", "what", "butts", "buuuuuuuts",
+                           "cat",   "bat",  "rat",   "helllooooooooo"};
+  unsigned strings_length = sizeof(strings) / sizeof(char *);
+  word_table t = word_table_new();
+
+  FAIL_IF(word_table_lookup(&t, "cat") != NULL,
+          "Empty table found a key.\n");
+
+  for (unsigned i = 0; i < strings_length; ++i) {
+    char buffer[32];
+    strcpy(buffer, strings[i]);
+    word_table_insert(&t, buffer, i);
+  }
+
+  for (unsigned i = 0; i < strings_length; ++i) {
+    unsigned *value = word_table_lookup(&t, strings[i]);
+    FAIL_IF(value == NULL || *value != i, "Failed to find \"%s\".\n",
+            strings[i]);
+    FAIL_IF(strcmp(word_table_key_at(value), strings[i]) != 0,
+            "Wrong key stored for \"%s\".\n", strings[i]);
+  }
+  FAIL_IF(word_table_exists(&t, "dog"), "Found a key never inserted.\n");
+
+  word_table_remove(&t, "cat");
+  word_table_remove(&t, "dog");
+  FAIL_IF(word_table_exists(&t, "cat") || t.size != strings_length - 1,
+          "Remove failed.\n");
+
+  bool inserted;
+  *word_table_find_or_insert(&t, "rat", &inserted) += 10;
+  FAIL_IF(inserted || *word_table_lookup(&t, "rat") != 16,
+          "find_or_insert missed an existing key.\n");
+  unsigned *dog = word_table_find_or_insert(&t, "dog", &inserted);
+  FAIL_IF(!inserted || *dog != 0, "find_or_insert didn't zero a new key.\n");
+
+  word_table_free(&t);
+
+  return 0;
+}
+
+/*
+ * Runs the same random inserts and removes against a typed table and a
+ * hashtable and checks they always agree.
+ */
+int test_matches_hashtable(void) {
+  uint_table t = uint_table_new();
+  hashtable h = hashtable_new(sizeof(unsigned), unsigned_hash,
+                              unsigned_comparison, unsigned_copy);
+  uint32_t state = 2463534242u;
+  unsigned key_space = 20000;
+
+  for (unsigned i = 0; i < 200000; ++i) {
+    unsigned key = next_random(&state) % key_space;
+    unsigned action = next_random(&state) % 4;
+
+    if (action == 0) {
+      uint_table_remove(&t, key);
+      hashtable_remove(&h, &key);
+    } else if (action == 1) {
+      bool inserted, expected = !hashtable_exists(&h, &key);
+      *uint_table_find_or_insert(&t, key, &inserted) += 1;
+      *(unsigned *)hashtable_find_or_insert(&h, &key, &inserted) += 1;
+      FAIL_IF(inserted != expected, "find_or_insert disagrees on %u.\n", key);
+    } else if (!hashtable_exists(&h, &key)) {
+      uint_table_insert(&t, key, i);
+      hashtable_insert(&h, &key, &i);
+    }
+
+    FAIL_IF(t.size != h.size, "Sizes differ: %u and %u.\n", t.size, h.size);
+  }
+
+  for (unsigned key = 0; key < key_space; ++key) {
+    unsigned *typed = uint_table_lookup(&t, key);
+    unsigned *generic = hashtable_lookup(&h, &key);
+    FAIL_IF((typed == NULL) != (generic == NULL),
+            "Tables disagree on whether %u exists.\n", key);
+    FAIL_IF(typed != NULL && *typed != *generic,
+            "Tables disagree on the value of %u.\n", key);
+  }
+
+  unsigned visited = 0;
+  for (unsigned *value = uint_table_iterate(&t, NULL); value != NULL;
+       value = uint_table_iterate(&t, value)) {
+    unsigned key = uint_table_key_at(value);
+    FAIL_IF(*value != *(unsigned *)hashtable_lookup(&h, &key),
+            "Iterated value for %u is wrong.\n", key);
+    ++visited;
+  }
+  FAIL_IF(visited != t.size, "Iterated %u of %u elements.\n", visited,
+          t.size);
+
+  uint_table_free(&t);
+  hashtable_free(&h);
+
+  return 0;
+}
+
+int test_reserve_and_shrink(void) {
+  uint_table t = uint_table_new();
+  unsigned count = 100000;
+
+  uint_table_reserve(&t, count);
+  uint32_t capacity = t.capacity;
+  for (unsigned i = 0; i < count; ++i) {
+    uint_table_insert(&t, i * 3, i);
+  }
+  FAIL_IF(t.capacity != capacity, "Reserved table grew from %u to %u.\n",
+          capacity, t.capacity);
+
+  for (unsigned i = 0; i < count - 10; ++i) {
+    uint_table_remove(&t, i * 3);
+  }
+  uint_table_shrink(&t);
+  FAIL_IF(t.capacity >= capacity || t.size != 10,
+          "Shrink left capacity %u for %u elements.\n", t.capacity, t.size);
+
+  for (unsigned i = count - 10; i < count; ++i) {
+    unsigned *value = uint_table_lookup(&t, i * 3);
+    FAIL_IF(value == NULL || *value != i, "Lost %u when shrinking.\n", i * 3);
+  }
+
+  uint_table_free(&t);
+
+  return 0;
+}
+
+int test_identical_hashes(void) {
+  colliding_table t = colliding_table_new();
+  unsigned count = 500;
+
+  for (unsigned i = 0; i < count; ++i) {
+    colliding_table_insert(&t, i, i);
+  }
+
+  for (unsigned i = 0; i < count; i += 2) {
+    colliding_table_remove(&t, i);
+  }
+
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned *value = colliding_table_lookup(&t, i);
+    FAIL_IF((value != NULL) != (i % 2 == 1),
+            "Colliding key %u is in the wrong state.\n", i);
+    FAIL_IF(value != NULL && *value != i, "Colliding key %u has value %u.\n",
+            i, *value);
+  }
+
+  colliding_table_free(&t);
+
+  return 0;
+}
+
+int main(void) {
+  RETURN_IF_FAILED(test_basic());
+  RETURN_IF_FAILED(test_matches_hashtable());
+  RETURN_IF_FAILED(test_reserve_and_shrink());
+  RETURN_IF_FAILED(test_identical_hashes());
+
+  return 0;
+}